@@ -0,0 +1,9 @@
+// clases_voz.h - Clases de salida del modelo de comandos de voz
+
+#pragma once
+
+#define COMANDO_APAGAR 0
+#define COMANDO_ENCODER 1
+#define COMANDO_HUMEDAD 2
+#define PALABRA_CLAVE_PLUGIN 3
+#define COMANDO_TEMPERATURA 4
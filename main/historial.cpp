@@ -0,0 +1,341 @@
+// historial.cpp - Anillos en PSRAM con resúmenes por minuto y por 15 minutos
+
+#include "historial.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "historial";
+
+#define SEGUNDOS_CRUDO (60 * 60)           // Una hora de muestras crudas
+#define CAPACIDAD_1M (3 * 24 * 60)         // 3 días de resúmenes por minuto
+#define CAPACIDAD_15M (30 * 24 * 4)        // 30 días de resúmenes por 15 minutos
+#define PUNTOS_POR_CHUNK 32                // Puntos copiados por cada toma del mutex al responder
+
+// Muestra cruda compacta (8 bytes)
+typedef struct {
+    uint32_t t;
+    int16_t temp;
+    int16_t hum;
+} muestra_cruda_t;
+
+// Anillo de tamaño fijo ordenado por tiempo
+typedef struct {
+    uint8_t* datos;
+    size_t tam_elem;
+    size_t capacidad;
+    size_t inicio;     // Índice físico del elemento más antiguo
+    size_t n;
+} anillo_t;
+
+// Intervalo de resumen en construcción (todavía no visible en las consultas)
+typedef struct {
+    uint32_t periodo_s;
+    uint32_t t_inicio;
+    int32_t suma_temp, suma_hum;
+    int16_t temp_min, temp_max, hum_min, hum_max;
+    uint16_t n;
+} acumulador_t;
+
+static anillo_t anillos[HISTORIAL_NUM_RES];
+static acumulador_t acumuladores[HISTORIAL_NUM_RES];  // El de HISTORIAL_CRUDO no se usa
+static SemaphoreHandle_t mutex_historial = NULL;
+
+static const char* nombres_res[HISTORIAL_NUM_RES] = { "crudo", "1m", "15m" };
+
+// ==== ANILLO ====
+
+static bool anillo_crear(anillo_t* a, size_t tam_elem, size_t capacidad) {
+    a->datos = (uint8_t*) heap_caps_malloc(tam_elem * capacidad, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    a->tam_elem = tam_elem;
+    a->capacidad = capacidad;
+    a->inicio = 0;
+    a->n = 0;
+    return a->datos != NULL;
+}
+
+static inline uint8_t* anillo_elem(const anillo_t* a, size_t i) {
+    return a->datos + ((a->inicio + i) % a->capacidad) * a->tam_elem;
+}
+
+// Agrega al final; si está lleno pisa el más antiguo
+static void anillo_agregar(anillo_t* a, const void* elem) {
+    if (a->n < a->capacidad) {
+        memcpy(anillo_elem(a, a->n), elem, a->tam_elem);
+        a->n++;
+    } else {
+        memcpy(a->datos + a->inicio * a->tam_elem, elem, a->tam_elem);
+        a->inicio = (a->inicio + 1) % a->capacidad;
+    }
+}
+
+// Todos los elementos empiezan con la marca de tiempo
+static inline uint32_t anillo_tiempo(const anillo_t* a, size_t i) {
+    uint32_t t;
+    memcpy(&t, anillo_elem(a, i), sizeof(t));
+    return t;
+}
+
+// Primer índice lógico con t >= desde (búsqueda binaria)
+static size_t anillo_buscar(const anillo_t* a, uint32_t desde) {
+    size_t lo = 0, hi = a->n;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (anillo_tiempo(a, mid) < desde) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// ==== RESÚMENES ====
+
+static void acumulador_reiniciar(acumulador_t* acc, uint32_t t_inicio) {
+    acc->t_inicio = t_inicio;
+    acc->suma_temp = 0;
+    acc->suma_hum = 0;
+    acc->temp_min = INT16_MAX;
+    acc->temp_max = INT16_MIN;
+    acc->hum_min = INT16_MAX;
+    acc->hum_max = INT16_MIN;
+    acc->n = 0;
+}
+
+// Pasa el intervalo terminado al anillo de su resolución
+static void acumulador_cerrar(acumulador_t* acc, anillo_t* destino) {
+    if (acc->n == 0) return;
+    historial_punto_t p = {
+        .t = acc->t_inicio,
+        .temp_min = acc->temp_min,
+        .temp_max = acc->temp_max,
+        .temp_prom = (int16_t) lroundf((float) acc->suma_temp / acc->n),
+        .hum_min = acc->hum_min,
+        .hum_max = acc->hum_max,
+        .hum_prom = (int16_t) lroundf((float) acc->suma_hum / acc->n),
+        .n = acc->n,
+    };
+    anillo_agregar(destino, &p);
+}
+
+static void acumulador_agregar(acumulador_t* acc, anillo_t* destino, uint32_t t, int16_t temp, int16_t hum) {
+    uint32_t t_intervalo = t - (t % acc->periodo_s);
+    if (acc->n > 0 && t_intervalo != acc->t_inicio) {
+        acumulador_cerrar(acc, destino);
+        acc->n = 0;
+    }
+    if (acc->n == 0) acumulador_reiniciar(acc, t_intervalo);
+
+    acc->suma_temp += temp;
+    acc->suma_hum += hum;
+    if (temp < acc->temp_min) acc->temp_min = temp;
+    if (temp > acc->temp_max) acc->temp_max = temp;
+    if (hum < acc->hum_min) acc->hum_min = hum;
+    if (hum > acc->hum_max) acc->hum_max = hum;
+    acc->n++;
+}
+
+// ==== API ====
+
+uint32_t historial_ahora() {
+    return (uint32_t) (esp_timer_get_time() / 1000000);
+}
+
+esp_err_t historial_init(uint32_t periodo_muestra_s) {
+    if (mutex_historial) return ESP_OK;
+    if (periodo_muestra_s == 0) periodo_muestra_s = 1;
+
+    size_t capacidad_cruda = SEGUNDOS_CRUDO / periodo_muestra_s;
+    if (!anillo_crear(&anillos[HISTORIAL_CRUDO], sizeof(muestra_cruda_t), capacidad_cruda) ||
+        !anillo_crear(&anillos[HISTORIAL_1M], sizeof(historial_punto_t), CAPACIDAD_1M) ||
+        !anillo_crear(&anillos[HISTORIAL_15M], sizeof(historial_punto_t), CAPACIDAD_15M)) {
+        ESP_LOGE(TAG, "Sin PSRAM para el historial");
+        for (int i = 0; i < HISTORIAL_NUM_RES; i++) {
+            heap_caps_free(anillos[i].datos);
+            anillos[i].datos = NULL;
+        }
+        return ESP_ERR_NO_MEM;
+    }
+
+    acumuladores[HISTORIAL_1M].periodo_s = 60;
+    acumuladores[HISTORIAL_15M].periodo_s = 15 * 60;
+    mutex_historial = xSemaphoreCreateMutex();
+
+    ESP_LOGI(TAG, "Historial: %u crudas, %u de 1 min, %u de 15 min (%u bytes en PSRAM)",
+             (unsigned) capacidad_cruda, CAPACIDAD_1M, CAPACIDAD_15M,
+             (unsigned) (capacidad_cruda * sizeof(muestra_cruda_t) +
+                         (CAPACIDAD_1M + CAPACIDAD_15M) * sizeof(historial_punto_t)));
+    return ESP_OK;
+}
+
+void historial_agregar(float temperatura, float humedad) {
+    if (!mutex_historial) return;
+
+    muestra_cruda_t m = {
+        .t = historial_ahora(),
+        .temp = (int16_t) lroundf(temperatura * 10.0f),
+        .hum = (int16_t) lroundf(humedad * 10.0f),
+    };
+
+    xSemaphoreTake(mutex_historial, portMAX_DELAY);
+    anillo_agregar(&anillos[HISTORIAL_CRUDO], &m);
+    acumulador_agregar(&acumuladores[HISTORIAL_1M], &anillos[HISTORIAL_1M], m.t, m.temp, m.hum);
+    acumulador_agregar(&acumuladores[HISTORIAL_15M], &anillos[HISTORIAL_15M], m.t, m.temp, m.hum);
+    xSemaphoreGive(mutex_historial);
+}
+
+int historial_consultar(historial_res_t res, uint32_t desde, uint32_t hasta,
+                        historial_punto_t* destino, int max) {
+    if (!mutex_historial || res >= HISTORIAL_NUM_RES) return 0;
+
+    const anillo_t* a = &anillos[res];
+    int copiados = 0;
+
+    xSemaphoreTake(mutex_historial, portMAX_DELAY);
+    for (size_t i = anillo_buscar(a, desde); i < a->n && copiados < max; i++) {
+        if (res == HISTORIAL_CRUDO) {
+            muestra_cruda_t m;
+            memcpy(&m, anillo_elem(a, i), sizeof(m));
+            if (m.t > hasta) break;
+            historial_punto_t p = {
+                .t = m.t,
+                .temp_min = m.temp, .temp_max = m.temp, .temp_prom = m.temp,
+                .hum_min = m.hum, .hum_max = m.hum, .hum_prom = m.hum,
+                .n = 1,
+            };
+            destino[copiados++] = p;
+        } else {
+            historial_punto_t p;
+            memcpy(&p, anillo_elem(a, i), sizeof(p));
+            if (p.t > hasta) break;
+            destino[copiados++] = p;
+        }
+    }
+    xSemaphoreGive(mutex_historial);
+    return copiados;
+}
+
+// ==== HTTP ====
+
+// Lee un parámetro de tiempo; los valores negativos son relativos a "ahora"
+static uint32_t leer_tiempo(const char* query, const char* clave, uint32_t ahora, uint32_t por_defecto) {
+    char valor[16];
+    if (!query || httpd_query_key_value(query, clave, valor, sizeof(valor)) != ESP_OK) return por_defecto;
+    long v = strtol(valor, NULL, 10);
+    if (v < 0) return (uint32_t) -v > ahora ? 0 : ahora + v;
+    return (uint32_t) v;
+}
+
+// Formato binario: cabecera "HST1", res (u8), tamaño de registro (u8), 2 bytes reservados,
+// ahora (u32) y luego registros little-endian empaquetados:
+//   crudo: t u32, temp i16, hum i16                       (8 bytes)
+//   1m/15m: t u32, temp min/max/prom i16, hum min/max/prom i16, n u16 (18 bytes)
+static size_t escribir_binario(historial_res_t res, const historial_punto_t* p, uint8_t* out) {
+    size_t pos = 0;
+    auto poner = [&](const void* v, size_t n) { memcpy(out + pos, v, n); pos += n; };
+    poner(&p->t, 4);
+    if (res == HISTORIAL_CRUDO) {
+        poner(&p->temp_prom, 2);
+        poner(&p->hum_prom, 2);
+    } else {
+        poner(&p->temp_min, 2); poner(&p->temp_max, 2); poner(&p->temp_prom, 2);
+        poner(&p->hum_min, 2); poner(&p->hum_max, 2); poner(&p->hum_prom, 2);
+        poner(&p->n, 2);
+    }
+    return pos;
+}
+
+static int escribir_json(historial_res_t res, const historial_punto_t* p, bool primero, char* out, size_t len) {
+    const char* sep = primero ? "" : ",";
+    if (res == HISTORIAL_CRUDO) {
+        return snprintf(out, len, "%s[%lu,%.1f,%.1f]", sep, (unsigned long) p->t,
+                        p->temp_prom / 10.0f, p->hum_prom / 10.0f);
+    }
+    return snprintf(out, len, "%s[%lu,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%u]", sep, (unsigned long) p->t,
+                    p->temp_min / 10.0f, p->temp_max / 10.0f, p->temp_prom / 10.0f,
+                    p->hum_min / 10.0f, p->hum_max / 10.0f, p->hum_prom / 10.0f, p->n);
+}
+
+esp_err_t historial_get_handler(httpd_req_t *req) {
+    char query[128];
+    bool hay_query = httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK;
+
+    char valor[8];
+    historial_res_t res = HISTORIAL_CRUDO;
+    if (hay_query && httpd_query_key_value(query, "res", valor, sizeof(valor)) == ESP_OK) {
+        res = HISTORIAL_NUM_RES;
+        for (int i = 0; i < HISTORIAL_NUM_RES; i++) {
+            if (strcmp(valor, nombres_res[i]) == 0) res = (historial_res_t) i;
+        }
+        if (res == HISTORIAL_NUM_RES) {
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "res debe ser crudo, 1m o 15m");
+            return ESP_FAIL;
+        }
+    }
+
+    bool binario = hay_query && httpd_query_key_value(query, "formato", valor, sizeof(valor)) == ESP_OK &&
+                   strcmp(valor, "bin") == 0;
+
+    uint32_t ahora = historial_ahora();
+    uint32_t desde = leer_tiempo(hay_query ? query : NULL, "desde", ahora, 0);
+    uint32_t hasta = leer_tiempo(hay_query ? query : NULL, "hasta", ahora, UINT32_MAX);
+
+    // Los puntos se copian por tandas para no bloquear a task_sensor mientras se envía
+    historial_punto_t* puntos = (historial_punto_t*) malloc(PUNTOS_POR_CHUNK * sizeof(historial_punto_t));
+    char* buffer = (char*) malloc(PUNTOS_POR_CHUNK * 72);
+    if (!puntos || !buffer) {
+        free(puntos);
+        free(buffer);
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+
+    if (binario) {
+        httpd_resp_set_type(req, "application/octet-stream");
+        uint8_t cabecera[12] = { 'H', 'S', 'T', '1', (uint8_t) res,
+                                 (uint8_t) (res == HISTORIAL_CRUDO ? 8 : 18), 0, 0 };
+        memcpy(&cabecera[8], &ahora, 4);
+        httpd_resp_send_chunk(req, (const char*) cabecera, sizeof(cabecera));
+    } else {
+        httpd_resp_set_type(req, "application/json");
+        int n = snprintf(buffer, 128, "{\"res\":\"%s\",\"ahora\":%lu,\"datos\":[",
+                         nombres_res[res], (unsigned long) ahora);
+        httpd_resp_send_chunk(req, buffer, n);
+    }
+
+    esp_err_t err = ESP_OK;
+    bool primero = true;
+    uint32_t cursor = desde;
+    while (err == ESP_OK) {
+        int n = historial_consultar(res, cursor, hasta, puntos, PUNTOS_POR_CHUNK);
+        if (n == 0) break;
+
+        size_t largo = 0;
+        for (int i = 0; i < n; i++) {
+            if (binario) {
+                largo += escribir_binario(res, &puntos[i], (uint8_t*) buffer + largo);
+            } else {
+                largo += escribir_json(res, &puntos[i], primero, buffer + largo, PUNTOS_POR_CHUNK * 72 - largo);
+                primero = false;
+            }
+        }
+        err = httpd_resp_send_chunk(req, buffer, largo);
+
+        cursor = puntos[n - 1].t + 1;
+        if (n < PUNTOS_POR_CHUNK || cursor == 0) break;
+    }
+
+    if (err == ESP_OK && !binario) err = httpd_resp_sendstr_chunk(req, "]}");
+    if (err == ESP_OK) err = httpd_resp_send_chunk(req, NULL, 0);
+
+    free(puntos);
+    free(buffer);
+    return err;
+}
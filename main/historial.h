@@ -0,0 +1,50 @@
+// historial.h - Serie temporal del sensor en PSRAM con varias resoluciones
+//
+// Guarda las muestras crudas de la última hora y resúmenes min/max/promedio
+// por minuto (3 días) y por 15 minutos (30 días). Toda la memoria se reserva
+// una sola vez en historial_init(); agregar una muestra es O(1) y las consultas
+// por rango de tiempo usan búsqueda binaria sobre los anillos.
+//
+// Las marcas de tiempo son segundos desde el arranque (no hay SNTP); las
+// respuestas incluyen "ahora" para que el cliente las convierta a su reloj.
+
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_http_server.h"
+
+// Resoluciones disponibles
+typedef enum {
+    HISTORIAL_CRUDO = 0,   // Cada muestra del sensor
+    HISTORIAL_1M,          // Resumen por minuto
+    HISTORIAL_15M,         // Resumen por 15 minutos
+    HISTORIAL_NUM_RES
+} historial_res_t;
+
+// Punto del historial; en la resolución cruda min = max = promedio y n = 1.
+// Temperatura y humedad en décimas.
+typedef struct {
+    uint32_t t;            // Inicio del intervalo (segundos desde el arranque)
+    int16_t temp_min, temp_max, temp_prom;
+    int16_t hum_min, hum_max, hum_prom;
+    uint16_t n;            // Muestras resumidas
+} historial_punto_t;
+
+// Reserva los anillos en PSRAM; `periodo_muestra_s` dimensiona la hora de datos crudos
+esp_err_t historial_init(uint32_t periodo_muestra_s);
+
+// Agrega una muestra válida del sensor con la marca de tiempo actual
+void historial_agregar(float temperatura, float humedad);
+
+// Copia hasta `max` puntos con t en [desde, hasta] a partir del primero con t >= desde.
+// Devuelve cuántos copió; para seguir, repetir con desde = último t + 1.
+int historial_consultar(historial_res_t res, uint32_t desde, uint32_t hasta,
+                        historial_punto_t* destino, int max);
+
+// Segundos desde el arranque (la misma base que las marcas del historial)
+uint32_t historial_ahora();
+
+// GET /historial?res=crudo|1m|15m&desde=&hasta=&formato=json|bin
+// desde/hasta negativos son relativos a "ahora" (p. ej. desde=-600)
+esp_err_t historial_get_handler(httpd_req_t *req);
@@ -0,0 +1,817 @@
+// modelo.cpp - Carga e inferencia de modelos TFLite Micro desde SPIFFS
+
+#include "modelo.h"
+
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs.h"
+#include "sdkconfig.h"
+
+#include "tensorflow/lite/kernels/internal/quantization_util.h"
+#include "tensorflow/lite/micro/kernels/quantize.h"
+#include "tensorflow/lite/micro/kernels/softmax.h"
+#include "tensorflow/lite/micro/memory_helpers.h"
+#include "tensorflow/lite/micro/micro_allocator.h"
+#include "tensorflow/lite/micro/micro_arena_constants.h"
+#include "tensorflow/lite/micro/micro_kernel_tuner.h"
+#include "tensorflow/lite/micro/micro_resource_variable.h"
+#include "tensorflow/lite/micro/micro_timing_registry.h"
+#include "tensorflow/lite/schema/schema_utils.h"
+
+#include "resolver_modelos.h"
+
+#include "uso_cpu.h"
+
+static const char *TAG = "modelo";
+
+// Los kernels de esp-nn reciben los buffers de trabajo de cada nodo, así que
+// dos modelos pueden ejecutarse a la vez (p. ej. el modelo sombra en el otro
+// núcleo). Sólo se serializan los que descomprimen pesos en la región común.
+static SemaphoreHandle_t mutex_descompresion = NULL;
+
+// Resolver compartido, generado al compilar con las operaciones de los modelos
+// de spiffs/ (tools/generar_resolver.py). Un modelo descargado que use otra
+// operación falla en AllocateTensors() y se descarta.
+static const tflite::MicroOpResolver& resolver_comun() {
+    static const ResolverModelos resolver;
+    return resolver;
+}
+
+#define MAX_CLASES_LOGITS 32   // Para calcular el softmax de la salida en el stack
+
+#if CONFIG_PLUGIN_ARGMAX_LOGITS
+// resolver_comun() pero con un SOFTMAX que sólo copia los logits a la salida.
+// Se usa para los modelos cuyo único softmax es la última operación.
+class ResolverLogits : public tflite::MicroOpResolver {
+ public:
+    ResolverLogits() : softmax_(tflite::Register_SOFTMAX_INT8_LOGITS()) {
+        softmax_.builtin_code = tflite::BuiltinOperator_SOFTMAX;
+    }
+
+    const TFLMRegistration* FindOp(tflite::BuiltinOperator op) const override {
+        return op == tflite::BuiltinOperator_SOFTMAX ? &softmax_ : resolver_comun().FindOp(op);
+    }
+
+    const TFLMRegistration* FindOp(const char* op) const override {
+        return resolver_comun().FindOp(op);
+    }
+
+    tflite::TfLiteBridgeBuiltinParseFunction GetOpDataParser(tflite::BuiltinOperator op) const override {
+        return resolver_comun().GetOpDataParser(op);
+    }
+
+ private:
+    TFLMRegistration softmax_;
+};
+
+static const tflite::MicroOpResolver& resolver_logits() {
+    static const ResolverLogits resolver;
+    return resolver;
+}
+
+// El softmax se puede dejar para después si es el único del modelo, es la
+// última operación, produce la salida y es int8 con la cuantización que exige
+// el kernel (escala 1/256, cero -128). Deja en `params` lo necesario para
+// calcularlo desde los logits.
+static bool softmax_final(const tflite::Model* model, tflite::SoftmaxParams* params) {
+    if (model->subgraphs()->size() != 1) return false;
+    const tflite::SubGraph* sg = model->subgraphs()->Get(0);
+    if (!sg->operators() || sg->operators()->size() == 0 || sg->outputs()->size() != 1) return false;
+
+    auto es_softmax = [&](const tflite::Operator* op) {
+        return op->opcode_index() < model->operator_codes()->size() &&
+               tflite::GetBuiltinCode(model->operator_codes()->Get(op->opcode_index())) ==
+                   tflite::BuiltinOperator_SOFTMAX;
+    };
+    int softmax = 0;
+    for (const tflite::Operator* op : *sg->operators()) {
+        if (es_softmax(op)) softmax++;
+    }
+    const tflite::Operator* op = sg->operators()->Get(sg->operators()->size() - 1);
+    if (softmax != 1 || !es_softmax(op) || op->inputs()->size() != 1 || op->outputs()->size() != 1 ||
+        op->outputs()->Get(0) != sg->outputs()->Get(0)) {
+        return false;
+    }
+
+    const tflite::Tensor* logits = sg->tensors()->Get(op->inputs()->Get(0));
+    const tflite::Tensor* salida = sg->tensors()->Get(op->outputs()->Get(0));
+    const tflite::SoftmaxOptions* opciones = op->builtin_options_as_SoftmaxOptions();
+    auto escala = [](const tflite::Tensor* t) {
+        return t->quantization() && t->quantization()->scale() && t->quantization()->scale()->size() == 1 &&
+               t->quantization()->zero_point() && t->quantization()->zero_point()->size() == 1;
+    };
+    if (!opciones || logits->type() != tflite::TensorType_INT8 || salida->type() != tflite::TensorType_INT8 ||
+        !escala(logits) || !escala(salida) || salida->quantization()->scale()->Get(0) != 1.0f / 256 ||
+        salida->quantization()->zero_point()->Get(0) != -128 ||
+        !logits->shape() || logits->shape()->size() == 0 ||
+        logits->shape()->Get(logits->shape()->size() - 1) > MAX_CLASES_LOGITS) {
+        return false;
+    }
+
+    tflite::SoftmaxInt8Params(opciones->beta(), logits->quantization()->scale()->Get(0), params);
+    return true;
+}
+#endif
+
+#ifdef USE_TFLM_COMPRESSION
+// Región en RAM interna donde los kernels descomprimen los bloques de pesos.
+// La comparten los modelos comprimidos: sólo se escribe dentro de Invoke(),
+// que para ellos está serializado por mutex_descompresion. TFLM guarda un
+// puntero a la lista, por eso es estática.
+static const std::initializer_list<tflite::MicroContext::AlternateMemoryRegion>* regiones_descompresion() {
+    static const size_t tam = CONFIG_PLUGIN_DESCOMPRESION_KB * 1024;
+    static uint8_t* memoria = tam ? (uint8_t*) heap_caps_aligned_alloc(
+        tflite::MicroArenaBufferAlignment(), tam, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT) : NULL;
+    static const std::initializer_list<tflite::MicroContext::AlternateMemoryRegion> regiones = {
+        {memoria, memoria ? tam : 0},
+    };
+    if (memoria && !mutex_descompresion) mutex_descompresion = xSemaphoreCreateMutex();
+    return memoria ? &regiones : NULL;
+}
+#endif
+
+// Buffer del metadato `nombre` del modelo, o NULL si no lo tiene
+static const tflite::Buffer* buscar_metadato(const tflite::Model* model, const char* nombre) {
+    if (!model->metadata()) return NULL;
+    for (const tflite::Metadata* md : *model->metadata()) {
+        if (md->name() && strcmp(md->name()->c_str(), nombre) == 0 && md->buffer() < model->buffers()->size()) {
+            return model->buffers()->Get(md->buffer());
+        }
+    }
+    return NULL;
+}
+
+// Un plan de memoria offline (tools/planificar_memoria.py) lo usa TFLM tal
+// cual, sin verificar que los tensores no se pisen. Antes de crear el
+// intérprete se recalculan las vidas de los tensores igual que
+// micro_allocation_info.cc y se comprueba que el plan sea coherente con el
+// modelo y quepa en la arena. Sin plan no hay nada que validar.
+static bool validar_plan_offline(const char* nombre, const tflite::Model* model, size_t tam_arena) {
+    const tflite::Buffer* plan = buscar_metadato(model, "OfflineMemoryAllocation");
+    if (!plan) return true;
+
+    const auto* subgrafos = model->subgraphs();
+    if (!plan->data() || plan->data()->size() < 3 * sizeof(int32_t) || subgrafos->size() != 1) {
+        ESP_LOGE(TAG, "[%s] Plan offline inválido (sólo se admite un subgrafo)", nombre);
+        return false;
+    }
+    const int32_t* datos = (const int32_t*) plan->data()->data();
+    const tflite::SubGraph* sg = subgrafos->Get(0);
+    const int n = sg->tensors()->size();
+    if (datos[0] != 0 || datos[1] != 0 || datos[2] != n ||
+        plan->data()->size() != (3 + (size_t) n) * sizeof(int32_t)) {
+        ESP_LOGE(TAG, "[%s] Plan offline para otro modelo (versión %ld, %ld tensores de %d)", nombre,
+                 (long) datos[0], (long) datos[2], n);
+        return false;
+    }
+    const int32_t* offsets = datos + 3;
+
+    // Primer y último paso en que se usa cada tensor (-1: nunca)
+    int* primero = (int*) malloc(2 * n * sizeof(int));
+    if (!primero) return false;
+    int* ultimo = primero + n;
+    for (int i = 0; i < n; i++) primero[i] = ultimo[i] = -1;
+    auto usar = [&](int t, int paso, bool crea) {
+        if (t < 0 || t >= n) return;
+        if (crea && (primero[t] < 0 || paso < primero[t])) primero[t] = paso;
+        if (paso > ultimo[t]) ultimo[t] = paso;
+    };
+    int paso = 0;
+    for (int32_t t : *sg->inputs()) usar(t, paso, true);
+    for (const tflite::Operator* op : *sg->operators()) {
+        paso++;
+        for (int32_t t : *op->outputs()) usar(t, paso, true);
+        for (int32_t t : *op->inputs()) usar(t, paso, false);
+    }
+    for (int32_t t : *sg->outputs()) usar(t, paso, true);
+
+    // Tensores que TFLM coloca según el plan: con offset, sin datos constantes y en uso
+    size_t* tam = (size_t*) calloc(n, sizeof(size_t));
+    bool ok = tam != NULL;
+    size_t pico = 0;
+    int planificados = 0;
+    for (int i = 0; ok && i < n; i++) {
+        const tflite::Tensor* t = sg->tensors()->Get(i);
+        const tflite::Buffer* b = model->buffers()->Get(t->buffer());
+        if (offsets[i] < 0 || primero[i] < 0 || t->is_variable() || (b->data() && b->data()->size() > 0)) continue;
+
+        size_t bytes = 0, tam_tipo = 0;
+        if (tflite::BytesRequiredForTensor(*t, &bytes, &tam_tipo) != kTfLiteOk) {
+            ok = false;
+            break;
+        }
+        tam[i] = tflite::AlignSizeUp(bytes, tflite::MicroArenaBufferAlignment());
+        if (offsets[i] % tflite::MicroArenaBufferAlignment() != 0 || offsets[i] + tam[i] > tam_arena) {
+            ESP_LOGE(TAG, "[%s] Plan offline: el tensor %d (offset %ld, %u bytes) no está alineado o no cabe",
+                     nombre, i, (long) offsets[i], (unsigned) tam[i]);
+            ok = false;
+            break;
+        }
+        if (offsets[i] + tam[i] > pico) pico = offsets[i] + tam[i];
+        planificados++;
+
+        // Ningún tensor vivo a la vez puede compartir bytes con éste
+        for (int j = 0; j < i; j++) {
+            if (tam[j] == 0 || primero[i] > ultimo[j] || primero[j] > ultimo[i]) continue;
+            if (offsets[i] < (int32_t) (offsets[j] + tam[j]) && offsets[j] < (int32_t) (offsets[i] + tam[i])) {
+                ESP_LOGE(TAG, "[%s] Plan offline: los tensores %d y %d se pisan", nombre, j, i);
+                ok = false;
+                break;
+            }
+        }
+    }
+    free(tam);
+    free(primero);
+
+    if (ok) ESP_LOGI(TAG, "[%s] Plan de memoria offline: %d tensores, pico %u bytes", nombre, planificados, (unsigned) pico);
+    return ok;
+}
+
+// Modelo streaming (tools/modelo_streaming.py): el metadato "Streaming" trae
+// [versión 0, frames por salto, frames de la ventana original] y las
+// convoluciones guardan su estado en variables de recurso (una por VAR_HANDLE).
+static bool leer_streaming(const char* nombre, modelo_t* m, int* num_variables) {
+    *num_variables = 0;
+    for (const tflite::Operator* op : *m->model->subgraphs()->Get(0)->operators()) {
+        if (op->opcode_index() < m->model->operator_codes()->size() &&
+            tflite::GetBuiltinCode(m->model->operator_codes()->Get(op->opcode_index())) ==
+                tflite::BuiltinOperator_VAR_HANDLE) {
+            (*num_variables)++;
+        }
+    }
+
+    const tflite::Buffer* b = buscar_metadato(m->model, "Streaming");
+    if (!b) return true;
+    if (!b->data() || b->data()->size() != 3 * sizeof(int32_t)) {
+        ESP_LOGE(TAG, "[%s] Metadato Streaming inválido", nombre);
+        return false;
+    }
+    const int32_t* datos = (const int32_t*) b->data()->data();
+    if (datos[0] != 0 || datos[1] <= 0 || datos[2] < datos[1] || datos[2] > UINT16_MAX) {
+        ESP_LOGE(TAG, "[%s] Metadato Streaming no soportado (versión %ld)", nombre, (long) datos[0]);
+        return false;
+    }
+#if !CONFIG_PLUGIN_STREAMING
+    ESP_LOGE(TAG, "[%s] Modelo streaming, pero el firmware no tiene CONFIG_PLUGIN_STREAMING", nombre);
+    return false;
+#endif
+    m->salto = datos[1];
+    m->ventana = datos[2];
+    return true;
+}
+
+// Una muestra a fondo de escala (32768) vale CONFIG_PLUGIN_ENTRADA_FONDO_ESCALA en
+// la entrada real del modelo, o 127 pasos de su cuantización si es 0 (lo que usaban
+// los modelos entrenados hasta ahora): q = muestra * fondo / (32768 * escala) + punto
+// cero, con el factor en punto fijo (multiplicador Q31 y desplazamiento) calculado una vez
+static bool parametros_entrada(modelo_t* m, const char* nombre) {
+    double escala = m->entrada->params.scale;
+    if (m->entrada->type != kTfLiteInt8 || escala <= 0) {
+        ESP_LOGE(TAG, "[%s] La entrada debe ser int8 cuantizada (escala %g)", nombre, escala);
+        return false;
+    }
+
+    double fondo = CONFIG_PLUGIN_ENTRADA_FONDO_ESCALA ? CONFIG_PLUGIN_ENTRADA_FONDO_ESCALA : 127.0 * escala;
+    double pasos = fondo / escala;  // Pasos de cuantización que recorre el fondo de escala
+    if (pasos < 1.0) {  // Todo el audio caería en el punto cero
+        ESP_LOGE(TAG, "[%s] Con escala %g el fondo de escala (%g) no llega a un paso de la entrada",
+                 nombre, escala, fondo);
+        return false;
+    }
+
+    int desplazamiento;
+    tflite::QuantizeMultiplier(pasos / 32768.0, &m->mult_entrada, &desplazamiento);
+    if (desplazamiento > 15) {
+        ESP_LOGE(TAG, "[%s] Factor de entrada fuera de rango (escala %g)", nombre, escala);
+        return false;
+    }
+    m->desplazamiento_entrada = desplazamiento;
+    return true;
+}
+
+// Lleva de 1 a `lote` la primera dimensión de la entrada y de los tensores de
+// activación, escribiendo en el flatbuffer (se copia a RAM si no es propio).
+// TFLM no redimensiona tensores, pero los kernels recorren el lote y RESHAPE
+// toma la forma de su salida. El plan offline se escala igual: ningún tensor
+// crece más de `lote` veces, así que los offsets multiplicados no se pisan.
+static bool preparar_lote(const char* nombre, modelo_t* m, int lote) {
+    const tflite::SubGraph* sg = m->model->subgraphs()->Get(0);
+    const tflite::Tensor* entrada = sg->inputs()->size() == 1 ? sg->tensors()->Get(sg->inputs()->Get(0)) : NULL;
+    if (m->salto || m->model->subgraphs()->size() != 1 || !entrada || !entrada->shape() ||
+        entrada->shape()->size() < 2 || entrada->shape()->Get(0) != 1) {
+        ESP_LOGW(TAG, "[%s] El modelo no admite lotes, se ejecuta de a una ventana", nombre);
+        return true;
+    }
+
+    if (!m->datos_propios) {
+        uint8_t* copia = (uint8_t*) heap_caps_malloc(m->tam_datos, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (!copia) copia = (uint8_t*) malloc(m->tam_datos);
+        if (!copia) {
+            ESP_LOGE(TAG, "[%s] Sin memoria para el modelo en lotes", nombre);
+            return false;
+        }
+        memcpy(copia, m->datos, m->tam_datos);
+        m->datos = copia;
+        m->datos_propios = true;
+        m->model = tflite::GetModel(m->datos);
+        sg = m->model->subgraphs()->Get(0);
+    }
+
+    for (const tflite::Tensor* t : *sg->tensors()) {
+        const tflite::Buffer* b = m->model->buffers()->Get(t->buffer());
+        if ((b->data() && b->data()->size() > 0) || t->is_variable() || !t->shape() || t->shape()->size() < 2 ||
+            t->shape()->Get(0) != 1) {
+            continue;
+        }
+        const_cast<int32_t*>(t->shape()->data())[0] = lote;
+        if (t->shape_signature() && t->shape_signature()->size() > 0 && t->shape_signature()->Get(0) == 1) {
+            const_cast<int32_t*>(t->shape_signature()->data())[0] = lote;
+        }
+    }
+
+    const tflite::Buffer* plan = buscar_metadato(m->model, "OfflineMemoryAllocation");
+    if (plan && plan->data()) {
+        int32_t* offsets = (int32_t*) plan->data()->data();
+        for (size_t i = 3; i < plan->data()->size() / sizeof(int32_t); i++) {
+            if (offsets[i] > 0) offsets[i] *= lote;
+        }
+    }
+    m->lote = lote;
+    return true;
+}
+
+// Lee el archivo completo del modelo; devuelve NULL si no existe o no se puede leer
+static uint8_t* leer_archivo(const char* ruta, size_t* tam) {
+    FILE* file = fopen(ruta, "rb");  // Abre el archivo del modelo en modo binario
+    if (!file) return NULL;
+
+    fseek(file, 0, SEEK_END);  // Se mueve al final del archivo para obtener su tamaño
+    *tam = ftell(file);  // Obtiene el tamaño del archivo
+    fseek(file, 0, SEEK_SET);  // Vuelve al principio del archivo
+
+    uint8_t* datos = (uint8_t*) malloc(*tam);  // Reserva memoria para almacenar el modelo
+    if (datos && fread(datos, 1, *tam, file) != *tam) {
+        free(datos);
+        datos = NULL;
+    }
+    fclose(file);  // Cierra el archivo después de leerlo
+    return datos;
+}
+
+void modelo_liberar(modelo_t* m) {
+    delete m->interprete;
+    if (m->tiempos) {
+        // TFLM no permite delete en sus perfiladores (TF_LITE_STATIC_MEMORY)
+        m->tiempos->~MicroTimingRegistry();
+        heap_caps_free(m->tiempos);
+    }
+    if (m->ajuste) {
+        m->ajuste->~MicroKernelTuner();
+        heap_caps_free(m->ajuste);
+    }
+    heap_caps_free(m->arena);
+    free(m->resto);
+    if (m->datos_propios) free(m->datos);
+    const char* nombre = m->nombre;
+    memset(m, 0, sizeof(*m));
+    m->nombre = nombre;
+}
+
+#if CONFIG_PLUGIN_AUTOAJUSTE_KERNELS
+static bool invocar(modelo_t* m);
+
+// FNV-1a del flatbuffer tal como llegó (antes de preparar_lote) y del lote:
+// identifica las formas de cada capa para las que se midieron las variantes
+static uint32_t hash_modelo(const uint8_t* datos, size_t tam, int lote) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < tam; i++) h = (h ^ datos[i]) * 16777619u;
+    return (h ^ (uint32_t) lote) * 16777619u;
+}
+
+// Tabla de variantes guardada en NVS con la clave del nombre del modelo,
+// precedida del hash del modelo con el que se midió. Si el modelo cambió (OTA,
+// otro lote) no se usa y se vuelve a medir.
+static bool leer_ajuste(const char* nombre, uint32_t hash, tflite::MicroKernelTuner* ajuste) {
+    nvs_handle_t nvs;
+    if (nvs_open("ajuste", NVS_READONLY, &nvs) != ESP_OK) return false;
+    size_t tam = 0;
+    bool ok = false;
+    if (nvs_get_blob(nvs, nombre, NULL, &tam) == ESP_OK && tam > sizeof(hash)) {
+        uint8_t* blob = (uint8_t*) malloc(tam);
+        if (blob && nvs_get_blob(nvs, nombre, blob, &tam) == ESP_OK && memcmp(blob, &hash, sizeof(hash)) == 0) {
+            ok = ajuste->Deserialize(blob + sizeof(hash), tam - sizeof(hash));
+        }
+        free(blob);
+    }
+    nvs_close(nvs);
+    return ok;
+}
+
+static void guardar_ajuste(const char* nombre, uint32_t hash, const tflite::MicroKernelTuner* ajuste) {
+    size_t tam = sizeof(hash) + ajuste->SerializedSize();
+    uint8_t* blob = (uint8_t*) malloc(tam);
+    if (!blob) return;
+    memcpy(blob, &hash, sizeof(hash));
+    ajuste->Serialize(blob + sizeof(hash), tam - sizeof(hash));
+    nvs_handle_t nvs;
+    if (nvs_open("ajuste", NVS_READWRITE, &nvs) == ESP_OK) {
+        if (nvs_set_blob(nvs, nombre, blob, tam) != ESP_OK || nvs_commit(nvs) != ESP_OK) {
+            ESP_LOGW(TAG, "[%s] No se pudo guardar el ajuste de kernels", nombre);
+        }
+        nvs_close(nvs);
+    }
+    free(blob);
+}
+
+// Primera inferencia de un modelo sin ajuste guardado: cada capa de esp-nn
+// mide sus variantes en su primer Eval, compara la salida con la versión ansi
+// y se queda con la más rápida. La entrada es pseudoaleatoria para que una
+// variante equivocada no pase por casualidad con un tensor constante.
+static void calibrar_kernels(modelo_t* m, uint32_t hash) {
+    uint32_t x = hash | 1;
+    for (size_t i = 0; i < m->entrada->bytes; i++) {
+        x = x * 1664525u + 1013904223u;
+        m->entrada->data.int8[i] = (int8_t) (x >> 24);
+    }
+    int64_t inicio = esp_timer_get_time();
+    bool ok = invocar(m);
+    modelo_reiniciar(m);            // La entrada de prueba no queda en el estado
+    m->reiniciar_tiempos = true;    // ni en los tiempos por capa
+    m->ajuste->set_calibrating(false);
+    if (!ok) {
+        ESP_LOGW(TAG, "[%s] Error en la inferencia de ajuste, no se guarda", m->nombre);
+        return;
+    }
+    ESP_LOGI(TAG, "[%s] Variantes de %d capas medidas en %u ms", m->nombre, m->ajuste->num_entries(),
+             (unsigned) ((esp_timer_get_time() - inicio) / 1000));
+    m->ajuste->Log();
+    if (m->ajuste->changed()) guardar_ajuste(m->nombre, hash, m->ajuste);
+}
+#endif
+
+// Crea el intérprete sobre la arena de m y asigna sus tensores. Se puede
+// repetir después de un fallo: el asignador vuelve a ocupar la arena entera.
+static TfLiteStatus asignar_tensores(modelo_t* m, const tflite::MicroOpResolver* resolver, int num_variables) {
+    // Las variables de recurso (estado de los modelos streaming) van en la misma arena
+    tflite::MicroAllocator* asignador = tflite::MicroAllocator::Create(m->arena, m->tam_arena);
+    tflite::MicroResourceVariables* variables =
+        num_variables ? tflite::MicroResourceVariables::Create(asignador, num_variables) : NULL;
+    m->interprete = new tflite::MicroInterpreter(m->model, *resolver, asignador, variables, m->tiempos);
+#if CONFIG_PLUGIN_AUTOAJUSTE_KERNELS
+    if (m->ajuste) m->interprete->SetKernelTuner(m->ajuste);
+#endif
+#ifdef USE_TFLM_COMPRESSION
+    // Sin la región los bloques de descompresión se piden en la arena. Los
+    // modelos sin pesos comprimidos no la usan y no se serializan.
+    if (buscar_metadato(m->model, "COMPRESSION_METADATA") && regiones_descompresion()) {
+        m->interprete->SetDecompressionMemory(*regiones_descompresion());
+        m->region_compartida = true;
+    }
+#endif
+    return m->interprete->AllocateTensors();
+}
+
+// Con `propios` los datos son de m (se liberan con él) y se pueden modificar
+static bool cargar(modelo_t* m, const char* nombre, uint8_t* datos, size_t tam, bool propios,
+                   size_t tam_arena, uint32_t caps_arena, int lote) {
+    memset(m, 0, sizeof(*m));
+    m->nombre = nombre;
+    m->datos = datos;
+    m->tam_datos = tam;
+    m->datos_propios = propios;
+    m->lote = 1;
+
+    // Obtiene el modelo TFLite desde los datos leídos
+    m->model = tflite::GetModel(m->datos);
+    if (m->model->version() != TFLITE_SCHEMA_VERSION) {  // Verifica que la versión del modelo sea compatible
+        ESP_LOGE(TAG, "[%s] Versión del modelo no soportada", nombre);
+        modelo_liberar(m);
+        return false;
+    }
+
+#if CONFIG_PLUGIN_AUTOAJUSTE_KERNELS
+    uint32_t hash = hash_modelo(m->datos, m->tam_datos, lote);  // preparar_lote modifica el flatbuffer
+#endif
+    int num_variables = 0;
+    if (!leer_streaming(nombre, m, &num_variables)) {
+        modelo_liberar(m);
+        return false;
+    }
+    if (lote > 1 && !preparar_lote(nombre, m, lote)) {
+        modelo_liberar(m);
+        return false;
+    }
+    if (!validar_plan_offline(nombre, m->model, tam_arena)) {
+        modelo_liberar(m);
+        return false;
+    }
+
+    // Arena donde se pidió; si no hay lugar (p. ej. RAM interna llena) se usa PSRAM
+    m->arena = (uint8_t*) heap_caps_malloc(tam_arena, caps_arena | MALLOC_CAP_8BIT);
+    if (!m->arena) m->arena = (uint8_t*) heap_caps_malloc(tam_arena, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!m->arena) {
+        ESP_LOGE(TAG, "[%s] Fallo al asignar memoria para tensor arena", nombre);
+        modelo_liberar(m);
+        return false;
+    }
+    m->tam_arena = tam_arena;
+
+    const tflite::MicroOpResolver* resolver = &resolver_comun();
+#if CONFIG_PLUGIN_ARGMAX_LOGITS
+    m->salida_logits = softmax_final(m->model, &m->softmax);
+    if (m->salida_logits) resolver = &resolver_logits();
+#endif
+#if CONFIG_PLUGIN_TIEMPOS_CAPAS
+    void* registro = heap_caps_malloc(sizeof(tflite::MicroTimingRegistry), MALLOC_CAP_8BIT);
+    if (registro) m->tiempos = new (registro) tflite::MicroTimingRegistry();
+#endif
+#if CONFIG_PLUGIN_AUTOAJUSTE_KERNELS
+    // Las capas leen su variante en AllocateTensors(); sin tabla guardada la miden en la primera inferencia
+    void* ajuste = heap_caps_malloc(sizeof(tflite::MicroKernelTuner), MALLOC_CAP_8BIT);
+    if (ajuste) {
+        m->ajuste = new (ajuste) tflite::MicroKernelTuner();
+        if (!leer_ajuste(nombre, hash, m->ajuste)) m->ajuste->set_calibrating(true);
+    }
+#endif
+    TfLiteStatus estado = asignar_tensores(m, resolver, num_variables);
+#if CONFIG_PLUGIN_AUTOAJUSTE_KERNELS
+    // Al medir, cada capa pide el scratch de su variante más grande (Winograd),
+    // que puede no entrar en una arena justa para las variantes por defecto: se
+    // asigna de nuevo sin medir y la tabla vacía se guarda para no reintentarlo
+    if (estado != kTfLiteOk && m->ajuste && m->ajuste->calibrating()) {
+        ESP_LOGW(TAG, "[%s] La arena no alcanza para medir las variantes, se usan las de por defecto", nombre);
+        delete m->interprete;
+        m->interprete = NULL;
+        m->ajuste->set_calibrating(false);
+        estado = asignar_tensores(m, resolver, num_variables);
+        if (estado == kTfLiteOk) guardar_ajuste(nombre, hash, m->ajuste);
+    }
+#endif
+    if (estado != kTfLiteOk) {  // Si no se pueden asignar los tensores
+        ESP_LOGE(TAG, "[%s] Fallo al asignar tensores", nombre);
+        modelo_liberar(m);
+        return false;
+    }
+
+    m->entrada = m->interprete->input(0);
+    m->salida = m->interprete->output(0);
+    m->ultima_clase = -1;
+    if (!parametros_entrada(m, nombre)) {
+        modelo_liberar(m);
+        return false;
+    }
+    if (m->salto) {
+        m->resto = (int8_t*) malloc(m->entrada->bytes);
+        if (!m->resto || m->entrada->bytes % m->salto) {
+            ESP_LOGE(TAG, "[%s] Entrada streaming inválida", nombre);
+            modelo_liberar(m);
+            return false;
+        }
+        ESP_LOGI(TAG, "[%s] Streaming: %u de %u frames por inferencia", nombre, m->salto, m->ventana);
+    }
+#if CONFIG_PLUGIN_AUTOAJUSTE_KERNELS
+    if (m->ajuste && m->ajuste->calibrating()) calibrar_kernels(m, hash);
+#endif
+    ESP_LOGI(TAG, "[%s] Listo: %u bytes de modelo, arena %u/%u bytes", nombre,
+             (unsigned) m->tam_datos, (unsigned) m->interprete->arena_used_bytes(), (unsigned) tam_arena);
+    if (m->salida_logits) ESP_LOGI(TAG, "[%s] Softmax final omitido: la clase sale de los logits", nombre);
+    if (m->lote > 1) ESP_LOGI(TAG, "[%s] Lote de %d ventanas por inferencia", nombre, m->lote);
+    return true;
+}
+
+bool modelo_cargar_memoria(modelo_t* m, const char* nombre, const uint8_t* datos, size_t tam,
+                           size_t tam_arena, uint32_t caps_arena, int lote) {
+    return cargar(m, nombre, (uint8_t*) datos, tam, false, tam_arena, caps_arena, lote);
+}
+
+bool modelo_cargar(modelo_t* m, const char* nombre, const char* ruta, size_t tam_arena, uint32_t caps_arena,
+                   int lote) {
+    memset(m, 0, sizeof(*m));
+    m->nombre = nombre;
+    ESP_LOGI(TAG, "[%s] Cargando modelo desde: %s", nombre, ruta);
+
+    size_t tam = 0;
+    uint8_t* datos = leer_archivo(ruta, &tam);
+    if (!datos) {
+        ESP_LOGW(TAG, "[%s] No se pudo leer el modelo", nombre);
+        return false;
+    }
+
+    return cargar(m, nombre, datos, tam, true, tam_arena, caps_arena, lote);
+}
+
+// Invoke() que deja la duración en ultima_latencia_us. Sólo espera a otro
+// modelo si los dos descomprimen en la región compartida.
+static bool invocar(modelo_t* m) {
+    if (m->region_compartida) xSemaphoreTake(mutex_descompresion, portMAX_DELAY);
+    if (m->reiniciar_tiempos && m->tiempos) {
+        m->tiempos->Reset();
+        m->reiniciar_tiempos = false;
+    }
+    int64_t inicio = esp_timer_get_time();
+    bool ok = m->interprete->Invoke() == kTfLiteOk;
+    m->ultima_latencia_us = (uint32_t) (esp_timer_get_time() - inicio);
+    if (m->region_compartida) xSemaphoreGive(mutex_descompresion);
+    return ok;
+}
+
+void modelo_tiempos_json(const modelo_t* m, cJSON* destino) {
+    if (!m->tiempos) return;
+    // Se lee mientras el modelo puede estar ejecutando: una capa puede
+    // quedar una llamada atrasada respecto de otra, nada más
+    const tflite::MicroTimingRegistry* t = m->tiempos;
+    cJSON* capas = cJSON_AddArrayToObject(destino, "capas");
+    for (int i = 0; i < t->num_entries(); i++) {
+        const tflite::MicroTimingRegistry::Entry& e = t->entry(i);
+        cJSON* c = cJSON_CreateObject();
+        cJSON_AddNumberToObject(c, "subgrafo", e.subgraph_idx);
+        cJSON_AddNumberToObject(c, "indice", e.operator_idx);
+        cJSON_AddStringToObject(c, "op", e.tag);
+        cJSON_AddNumberToObject(c, "llamadas", e.count);
+        cJSON_AddNumberToObject(c, "total_us", (double) e.total_us);
+        cJSON_AddNumberToObject(c, "min_us", e.count ? e.min_us : 0);
+        cJSON_AddNumberToObject(c, "max_us", e.max_us);
+        cJSON* histograma = cJSON_AddArrayToObject(c, "histograma");
+        for (int b = 0; b < tflite::MicroTimingRegistry::kHistogramBins; b++) {
+            cJSON_AddItemToArray(histograma, cJSON_CreateNumber(e.histogram[b]));
+        }
+        cJSON_AddItemToArray(capas, c);
+    }
+    // Límites superiores de los casilleros del histograma (el último no tiene)
+    cJSON* limites = cJSON_AddArrayToObject(destino, "limites_us");
+    for (int b = 0; b < tflite::MicroTimingRegistry::kHistogramBins - 1; b++) {
+        cJSON_AddItemToArray(limites, cJSON_CreateNumber(tflite::MicroTimingRegistry::BinUpperBoundUs(b)));
+    }
+    if (t->dropped()) cJSON_AddNumberToObject(destino, "descartadas", t->dropped());
+}
+
+void modelo_tiempos_reiniciar(modelo_t* m) {
+    m->reiniciar_tiempos = true;
+}
+
+void modelo_reiniciar(modelo_t* m) {
+    if (!m->interprete || !m->salto) return;
+    m->interprete->Reset();  // Vuelve las variables de recurso al punto cero
+    m->num_resto = 0;
+    m->ultima_clase = -1;
+}
+
+static int num_clases(const modelo_t* m) {
+    return m->salida->dims->data[m->salida->dims->size - 1];
+}
+
+// Bytes de una ventana de entrada: la entrada trae `lote` ventanas, y en un
+// modelo streaming es sólo un salto de la ventana original
+static size_t bytes_ventana(const modelo_t* m) {
+    return m->salto ? m->entrada->bytes / m->salto * m->ventana : m->entrada->bytes / m->lote;
+}
+
+// Probabilidades de la ventana `fila` tal como las daría el softmax del modelo
+static const int8_t* probabilidades(modelo_t* m, int fila, int8_t* buffer) {
+    const int8_t* salida = m->salida->data.int8 + fila * num_clases(m);
+    if (!m->salida_logits) return salida;
+
+    int32_t trabajo[MAX_CLASES_LOGITS];
+    tflite::SoftmaxInt8Row(m->softmax, salida, num_clases(m), buffer, trabajo);
+    return buffer;
+}
+
+bool modelo_autoprueba(modelo_t* m, const modelo_t* referencia) {
+    if (!m->interprete) return false;
+
+    if (m->entrada->type != kTfLiteInt8 || m->salida->type != kTfLiteInt8) {
+        ESP_LOGE(TAG, "[%s] Autoprueba: entrada y salida deben ser int8", m->nombre);
+        return false;
+    }
+    if (referencia && referencia->interprete &&
+        (bytes_ventana(m) != bytes_ventana(referencia) || num_clases(m) != num_clases(referencia))) {
+        ESP_LOGE(TAG, "[%s] Autoprueba: forma distinta al modelo activo (%u bytes/%d clases vs %u/%d)", m->nombre,
+                 (unsigned) bytes_ventana(m), num_clases(m),
+                 (unsigned) bytes_ventana(referencia), num_clases(referencia));
+        return false;
+    }
+
+    memset(m->entrada->data.int8, m->entrada->params.zero_point, m->entrada->bytes);
+    bool ok = invocar(m);
+    modelo_reiniciar(m);  // El silencio de la prueba no queda en el estado
+    if (!ok) {
+        ESP_LOGE(TAG, "[%s] Autoprueba: error en la inferencia", m->nombre);
+        return false;
+    }
+
+    int8_t buffer[MAX_CLASES_LOGITS];
+    const int8_t* probs = probabilidades(m, 0, buffer);
+    float suma = 0;
+    for (int i = 0; i < num_clases(m); i++) {
+        suma += (probs[i] - m->salida->params.zero_point) * m->salida->params.scale;
+    }
+    if (suma < 0.9f || suma > 1.1f) {
+        ESP_LOGE(TAG, "[%s] Autoprueba: la salida suma %.3f, no parece un softmax", m->nombre, suma);
+        return false;
+    }
+    return true;
+}
+
+// Cuantiza el bloque de audio con la escala y el punto cero de la entrada del modelo
+static void preprocesar_audio(const modelo_t* m, const int16_t* audio, int8_t* salida, size_t largo) {
+    tflite::QuantizeInt16ToInt8(audio, largo, m->mult_entrada, m->desplazamiento_entrada,
+                                m->entrada->params.zero_point, salida);
+}
+
+// Argmax de la ventana `fila` de la salida y, si se pide, su probabilidad
+static int clase_salida(modelo_t* m, int fila, float* confianza) {
+    // El argmax se hace sobre int8: descuantizar no cambia el orden (escala > 0),
+    // y el softmax tampoco si la salida son los logits
+    const int8_t* salida = m->salida->data.int8 + fila * num_clases(m);
+    int clase = 0;
+    for (int i = 1; i < num_clases(m); i++) {
+        if (salida[i] > salida[clase]) clase = i;
+    }
+
+    if (confianza) {
+        int8_t buffer[MAX_CLASES_LOGITS];
+        const int8_t* probs = probabilidades(m, fila, buffer);
+        *confianza = (probs[clase] - m->salida->params.zero_point) * m->salida->params.scale;
+    }
+    return clase;
+}
+
+// Un Invoke() por cada salto completo; lo que sobra queda en `resto` para el próximo bloque
+static int predecir_streaming(modelo_t* m, const int16_t* audio, size_t num_muestras, float* confianza) {
+    size_t tam_salto = m->entrada->bytes;
+    while (num_muestras > 0) {
+        size_t largo = tam_salto - m->num_resto;
+        if (largo > num_muestras) largo = num_muestras;
+        preprocesar_audio(m, audio, m->resto + m->num_resto, largo);
+        m->num_resto += largo;
+        audio += largo;
+        num_muestras -= largo;
+        if (m->num_resto < tam_salto) break;
+
+        memcpy(m->entrada->data.int8, m->resto, tam_salto);
+        m->num_resto = 0;
+        if (!invocar(m)) {
+            ESP_LOGE(TAG, "[%s] Error en la inferencia", m->nombre);
+            return -1;
+        }
+        uso_cpu_registrar_inferencia(m->ultima_latencia_us);
+        m->ultima_clase = clase_salida(m, 0, NULL);
+    }
+
+    // Si el bloque no completó un salto la salida sigue siendo la del anterior
+    if (m->ultima_clase >= 0 && confianza) clase_salida(m, 0, confianza);
+    return m->ultima_clase;
+}
+
+int modelo_predecir_lote(modelo_t* m, const int16_t* const* ventanas, int num_ventanas, size_t num_muestras,
+                         int* clases, float* confianzas) {
+    if (!m->interprete) {
+        ESP_LOGE(TAG, "[%s] Intérprete no inicializado", m->nombre);
+        return -1;
+    }
+    if (m->salto) {  // Las ventanas de un modelo streaming son saltos consecutivos
+        for (int k = 0; k < num_ventanas; k++) {
+            clases[k] = predecir_streaming(m, ventanas[k], num_muestras, confianzas ? &confianzas[k] : NULL);
+        }
+        return num_ventanas;
+    }
+
+    // Nunca se escribe más allá de la ventana; lo que falte queda en silencio
+    size_t tam = bytes_ventana(m);
+    size_t largo = num_muestras < tam ? num_muestras : tam;
+    for (int inicio = 0; inicio < num_ventanas; inicio += m->lote) {
+        int n = num_ventanas - inicio < m->lote ? num_ventanas - inicio : m->lote;
+        for (int k = 0; k < n; k++) {
+            int8_t* destino = m->entrada->data.int8 + k * tam;
+            preprocesar_audio(m, ventanas[inicio + k], destino, largo);
+            memset(destino + largo, m->entrada->params.zero_point, tam - largo);
+        }
+        // Si el lote no se llena, las filas que sobran se calculan igual y se ignoran
+        if (!invocar(m)) {
+            ESP_LOGE(TAG, "[%s] Error en la inferencia", m->nombre);
+            return -1;
+        }
+        uso_cpu_registrar_inferencia(m->ultima_latencia_us);  // Latencia para el reporte de CPU
+        for (int k = 0; k < n; k++) {
+            clases[inicio + k] = clase_salida(m, k, confianzas ? &confianzas[inicio + k] : NULL);
+        }
+    }
+    return num_ventanas;
+}
+
+int modelo_predecir(modelo_t* m, const int16_t* audio, size_t num_muestras, float* confianza) {
+    if (m->salto && m->interprete) return predecir_streaming(m, audio, num_muestras, confianza);
+
+    int clase = -1;
+    if (modelo_predecir_lote(m, &audio, 1, num_muestras, &clase, confianza) < 0) return -1;
+    return clase;
+}
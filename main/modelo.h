@@ -0,0 +1,101 @@
+// modelo.h - Modelo TFLite Micro con su propia arena e intérprete
+//
+// Cada modelo de voz (palabra clave, comandos) es independiente: se carga
+// desde SPIFFS, reserva su arena y crea su MicroInterpreter. Así el modelo
+// de despertar puede vivir en una arena pequeña en RAM interna mientras el
+// de comandos usa PSRAM.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tensorflow/lite/kernels/internal/types.h"
+#include "tensorflow/lite/micro/micro_interpreter.h"
+#include "tensorflow/lite/schema/schema_generated.h"
+#include "cJSON.h"
+
+namespace tflite {
+class MicroKernelTuner;
+class MicroTimingRegistry;
+}
+
+typedef struct {
+    const char* nombre;                        // Para los logs
+    const tflite::Model* model;
+    uint8_t* datos;                            // Flatbuffer (SPIFFS en RAM o ranura mapeada)
+    size_t tam_datos;
+    bool datos_propios;                        // false si `datos` pertenece a otro (p. ej. mmap)
+    uint8_t* arena;
+    size_t tam_arena;
+    tflite::MicroInterpreter* interprete;      // NULL si el modelo no está disponible
+    TfLiteTensor* entrada;
+    TfLiteTensor* salida;
+    uint32_t ultima_latencia_us;               // Duración del último Invoke()
+    tflite::MicroTimingRegistry* tiempos;      // Tiempos por capa (CONFIG_PLUGIN_TIEMPOS_CAPAS) o NULL
+    volatile bool reiniciar_tiempos;           // Se ponen en cero antes del próximo Invoke()
+    tflite::MicroKernelTuner* ajuste;          // Variante de esp-nn por capa (CONFIG_PLUGIN_AUTOAJUSTE_KERNELS) o NULL
+    bool region_compartida;                    // Descomprime pesos en la región común (se serializa)
+    bool salida_logits;                        // Softmax final omitido: `salida` tiene los logits
+    tflite::SoftmaxParams softmax;             // Para calcular las probabilidades desde los logits
+    int lote;                                  // Ventanas por Invoke() (primera dimensión de la entrada)
+    int32_t mult_entrada;                      // Audio -> int8 de la entrada en punto fijo
+    int desplazamiento_entrada;
+    uint16_t salto;                            // Modelo streaming: frames nuevos por Invoke() (0 = no)
+    uint16_t ventana;                          // Frames de la ventana del modelo original
+    int8_t* resto;                             // Audio que todavía no completa un salto
+    size_t num_resto;
+    int ultima_clase;                          // Del último salto, por si el bloque no completa uno
+} modelo_t;
+
+// Carga el modelo de `ruta` y prepara su intérprete. `caps_arena` indica dónde
+// reservar la arena (MALLOC_CAP_INTERNAL, MALLOC_CAP_SPIRAM); si no hay lugar
+// se intenta en PSRAM. Con `lote` > 1 la entrada se agranda para ejecutar
+// varias ventanas en un Invoke() (modelo_predecir_lote); si el modelo no lo
+// admite queda en 1. Devuelve false y deja el modelo vacío si falla.
+bool modelo_cargar(modelo_t* m, const char* nombre, const char* ruta, size_t tam_arena, uint32_t caps_arena,
+                   int lote = 1);
+
+// Igual que modelo_cargar pero con el flatbuffer ya en memoria. `datos` no se
+// libera y sólo se copia si hace falta para el lote: debe seguir válido
+// mientras el modelo esté en uso.
+bool modelo_cargar_memoria(modelo_t* m, const char* nombre, const uint8_t* datos, size_t tam,
+                           size_t tam_arena, uint32_t caps_arena, int lote = 1);
+
+// Libera arena e intérprete, y los datos si son propios
+void modelo_liberar(modelo_t* m);
+
+// Olvida el audio anterior de un modelo streaming (tools/modelo_streaming.py):
+// la próxima ventana empieza en silencio. No hace nada con los demás modelos.
+void modelo_reiniciar(modelo_t* m);
+
+// Autoprueba de un modelo candidato antes de ponerlo en uso: misma ventana de
+// entrada y número de clases que `referencia` (si no es NULL), Invoke() sobre
+// silencio sin errores y una salida que suma ~1 como un softmax.
+bool modelo_autoprueba(modelo_t* m, const modelo_t* referencia);
+
+// Preprocesa el audio en la entrada, ejecuta la inferencia y devuelve la clase
+// con mayor puntuación (-1 si falla). Un modelo streaming consume el audio en
+// saltos, con un Invoke() por salto, y devuelve la clase del último. Si
+// `confianza` no es NULL deja la probabilidad de esa clase ya descuantizada; si
+// el softmax final se omite (CONFIG_PLUGIN_ARGMAX_LOGITS) sólo se calcula en
+// ese caso. Es seguro llamarla desde dos tareas con modelos distintos: se
+// ejecutan a la vez, salvo los comprimidos que comparten la región de
+// descompresión, que se turnan.
+int modelo_predecir(modelo_t* m, const int16_t* audio, size_t num_muestras, float* confianza);
+
+// Clasifica `num_ventanas` ventanas de audio de `num_muestras` cada una, de a
+// `lote` por Invoke(), y deja en `clases` (y en `confianzas` si no es NULL) el
+// resultado de cada una en el mismo orden. Devuelve las ventanas procesadas o
+// -1 si falla. En un modelo streaming cada ventana es un bloque consecutivo.
+int modelo_predecir_lote(modelo_t* m, const int16_t* const* ventanas, int num_ventanas, size_t num_muestras,
+                         int* clases, float* confianzas);
+
+// Agrega a `destino` el tiempo de cada capa del modelo acumulado desde la carga
+// o el último reinicio: llamadas, total, mínimo, máximo y un histograma de
+// latencias. No agrega nada sin CONFIG_PLUGIN_TIEMPOS_CAPAS.
+void modelo_tiempos_json(const modelo_t* m, cJSON* destino);
+
+// Pide poner en cero los tiempos por capa; se hace antes del próximo Invoke()
+// para no pisar una inferencia en curso.
+void modelo_tiempos_reiniciar(modelo_t* m);
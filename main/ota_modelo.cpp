@@ -0,0 +1,313 @@
+// ota_modelo.cpp - Descarga, verificación y activación de modelos en ranuras A/B
+
+#include "ota_modelo.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_crt_bundle.h"
+#include "esp_http_client.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "mbedtls/sha256.h"
+#include "nvs.h"
+#include "sdkconfig.h"
+
+static const char *TAG = "ota_modelo";
+
+#define OTA_MAGIA 0x314C444D   // "MDL1" en little endian
+#define OTA_SECTOR 4096        // La cabecera ocupa el primer sector; el modelo empieza en el segundo
+#define OTA_BUFFER 4096        // Un sector por lectura: la memoria usada no depende del tamaño del modelo
+
+typedef struct {
+    uint32_t magia;
+    uint32_t tam;              // Bytes del flatbuffer
+    uint8_t sha256[32];
+} cabecera_ranura_t;
+
+// Índice = valor guardado en NVS; 0 es el modelo de SPIFFS
+static const char* const ETIQUETAS[] = { "spiffs", "model_a", "model_b" };
+
+static ota_modelo_instalar_cb_t instalar_cb = NULL;
+
+// Ranura activa y su mapeo en memoria
+static uint8_t ranura_activa = 0;
+static cabecera_ranura_t cabecera_activa;
+static const void* mapeo_datos = NULL;
+static esp_partition_mmap_handle_t mapeo_handle;
+
+// Estado de la actualización en curso
+static portMUX_TYPE estado_mux = portMUX_INITIALIZER_UNLOCKED;
+static ota_modelo_estado_t estado = OTA_MODELO_INACTIVO;
+static size_t progreso = 0;
+static size_t total = 0;
+static char error[64] = "";
+static char url_pendiente[256];
+static uint8_t sha_pendiente[32];
+
+static const esp_partition_t* particion(uint8_t ranura) {
+    if (ranura == 0 || ranura > 2) return NULL;
+    return esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, ETIQUETAS[ranura]);
+}
+
+static void guardar_ranura(uint8_t ranura) {
+    nvs_handle_t nvs;
+    if (nvs_open("modelo", NVS_READWRITE, &nvs) != ESP_OK) return;
+    nvs_set_u8(nvs, "ranura", ranura);
+    nvs_commit(nvs);
+    nvs_close(nvs);
+}
+
+static void fijar_estado(ota_modelo_estado_t nuevo, const char* mensaje) {
+    taskENTER_CRITICAL(&estado_mux);
+    estado = nuevo;
+    strlcpy(error, mensaje ? mensaje : "", sizeof(error));
+    taskEXIT_CRITICAL(&estado_mux);
+    if (mensaje) ESP_LOGE(TAG, "%s", mensaje);
+}
+
+static bool hex_a_bytes(const char* hex, uint8_t* destino, size_t len) {
+    if (strlen(hex) != len * 2) return false;
+    for (size_t i = 0; i < len; i++) {
+        unsigned int byte;
+        if (sscanf(hex + i * 2, "%2x", &byte) != 1) return false;
+        destino[i] = (uint8_t) byte;
+    }
+    return true;
+}
+
+// Lee la cabecera, mapea el flatbuffer y comprueba su SHA-256
+static bool mapear_ranura(uint8_t ranura, cabecera_ranura_t* cabecera, const void** datos,
+                          esp_partition_mmap_handle_t* handle) {
+    const esp_partition_t* part = particion(ranura);
+    if (!part || esp_partition_read(part, 0, cabecera, sizeof(*cabecera)) != ESP_OK) return false;
+    if (cabecera->magia != OTA_MAGIA || cabecera->tam == 0 || cabecera->tam > part->size - OTA_SECTOR) return false;
+
+    if (esp_partition_mmap(part, OTA_SECTOR, cabecera->tam, ESP_PARTITION_MMAP_DATA, datos, handle) != ESP_OK) {
+        ESP_LOGE(TAG, "No se pudo mapear %s", ETIQUETAS[ranura]);
+        return false;
+    }
+
+    uint8_t sha[32];
+    mbedtls_sha256((const unsigned char*) *datos, cabecera->tam, sha, 0);
+    if (memcmp(sha, cabecera->sha256, sizeof(sha)) != 0) {
+        ESP_LOGE(TAG, "%s: el SHA-256 no coincide con la cabecera", ETIQUETAS[ranura]);
+        esp_partition_munmap(*handle);
+        return false;
+    }
+    return true;
+}
+
+void ota_modelo_init(ota_modelo_instalar_cb_t instalar) {
+    instalar_cb = instalar;
+
+    uint8_t ranura = 0;
+    nvs_handle_t nvs;
+    if (nvs_open("modelo", NVS_READONLY, &nvs) == ESP_OK) {
+        nvs_get_u8(nvs, "ranura", &ranura);
+        nvs_close(nvs);
+    }
+    if (ranura == 0) return;
+
+    if (mapear_ranura(ranura, &cabecera_activa, &mapeo_datos, &mapeo_handle)) {
+        ranura_activa = ranura;
+        ESP_LOGI(TAG, "Modelo activo en %s (%lu bytes)", ETIQUETAS[ranura], (unsigned long) cabecera_activa.tam);
+    } else {
+        ESP_LOGW(TAG, "%s no es válida, se usa el modelo de SPIFFS", ETIQUETAS[ranura]);
+        guardar_ranura(0);
+    }
+}
+
+const uint8_t* ota_modelo_activo(size_t* tam) {
+    if (ranura_activa == 0) return NULL;
+    *tam = cabecera_activa.tam;
+    return (const uint8_t*) mapeo_datos;
+}
+
+void ota_modelo_descartar_activo() {
+    if (ranura_activa == 0) return;
+    esp_partition_munmap(mapeo_handle);
+    mapeo_datos = NULL;
+    ranura_activa = 0;
+    guardar_ranura(0);
+}
+
+// Llena `buf` salvo al final de la respuesta; -1 si la conexión falla
+static int leer_bloque(esp_http_client_handle_t cliente, uint8_t* buf, int tam) {
+    int leidos = 0;
+    while (leidos < tam) {
+        int n = esp_http_client_read(cliente, (char*) buf + leidos, tam - leidos);
+        if (n < 0) return -1;
+        if (n == 0) break;  // Fin de los datos
+        leidos += n;
+    }
+    return leidos;
+}
+
+// Descarga en la ranura inactiva. Cada sector se borra justo antes de escribirlo:
+// mientras dura una operación de flash la caché se suspende, así que varias
+// pausas cortas molestan menos a la inferencia que borrar la ranura entera.
+static const char* descargar(const esp_partition_t* part, esp_http_client_handle_t cliente,
+                             uint8_t* buf, cabecera_ranura_t* cabecera) {
+    size_t capacidad = part->size - OTA_SECTOR;
+
+    if (esp_http_client_open(cliente, 0) != ESP_OK) return "No se pudo conectar";
+    int64_t largo = esp_http_client_fetch_headers(cliente);
+    if (esp_http_client_get_status_code(cliente) != 200) return "El servidor no respondió 200";
+    if (largo > (int64_t) capacidad) return "El modelo no entra en la ranura";
+
+    taskENTER_CRITICAL(&estado_mux);
+    total = largo > 0 ? (size_t) largo : 0;
+    taskEXIT_CRITICAL(&estado_mux);
+
+    mbedtls_sha256_context sha;
+    mbedtls_sha256_init(&sha);
+    mbedtls_sha256_starts(&sha, 0);
+
+    size_t escrito = 0;
+    const char* fallo = NULL;
+    while (!fallo) {
+        int n = leer_bloque(cliente, buf, OTA_BUFFER);
+        if (n < 0) fallo = "Error leyendo la descarga";
+        else if (n == 0) break;
+        else if (escrito + n > capacidad) fallo = "El modelo no entra en la ranura";
+        else if (esp_partition_erase_range(part, OTA_SECTOR + escrito, OTA_SECTOR) != ESP_OK ||
+                 esp_partition_write(part, OTA_SECTOR + escrito, buf, n) != ESP_OK) fallo = "Error escribiendo la flash";
+        else {
+            mbedtls_sha256_update(&sha, buf, n);
+            escrito += n;
+            taskENTER_CRITICAL(&estado_mux);
+            progreso = escrito;
+            taskEXIT_CRITICAL(&estado_mux);
+        }
+    }
+    mbedtls_sha256_finish(&sha, cabecera->sha256);
+    mbedtls_sha256_free(&sha);
+
+    if (fallo) return fallo;
+    if (escrito == 0 || (largo > 0 && escrito != (size_t) largo)) return "Descarga incompleta";
+    if (memcmp(cabecera->sha256, sha_pendiente, sizeof(sha_pendiente)) != 0) return "El SHA-256 no coincide";
+
+    cabecera->magia = OTA_MAGIA;
+    cabecera->tam = escrito;
+    return NULL;
+}
+
+static void task_actualizar_modelo(void *pvParameters) {
+    uint8_t ranura = ranura_activa == 1 ? 2 : 1;
+    const esp_partition_t* part = particion(ranura);
+    const char* fallo = NULL;
+
+    if (!part) {
+        fallo = "No existe la partición de la ranura inactiva";
+    } else if (esp_partition_erase_range(part, 0, OTA_SECTOR) != ESP_OK) {  // Invalida la ranura antes de escribirla
+        fallo = "Error borrando la cabecera";
+    } else {
+        ESP_LOGI(TAG, "Descargando modelo en %s", ETIQUETAS[ranura]);
+        esp_http_client_config_t config = {
+            .url = url_pendiente,
+            .timeout_ms = 10000,
+            .crt_bundle_attach = esp_crt_bundle_attach,  // Certificado para HTTPS
+        };
+        esp_http_client_handle_t cliente = esp_http_client_init(&config);
+        uint8_t* buf = (uint8_t*) malloc(OTA_BUFFER);
+        cabecera_ranura_t cabecera = {};
+
+        if (!cliente || !buf) fallo = "Sin memoria para la descarga";
+        else fallo = descargar(part, cliente, buf, &cabecera);
+
+        free(buf);
+        if (cliente) {
+            esp_http_client_close(cliente);
+            esp_http_client_cleanup(cliente);
+        }
+
+        // La cabecera se escribe al final: una descarga cortada deja la ranura inválida
+        if (!fallo && esp_partition_write(part, 0, &cabecera, sizeof(cabecera)) != ESP_OK) {
+            fallo = "Error escribiendo la cabecera";
+        }
+    }
+
+    const void* datos = NULL;
+    esp_partition_mmap_handle_t handle = 0;
+    cabecera_ranura_t cabecera = {};
+    if (!fallo) {
+        fijar_estado(OTA_MODELO_INSTALANDO, NULL);
+        if (!mapear_ranura(ranura, &cabecera, &datos, &handle)) fallo = "La ranura no se pudo verificar";
+        else if (!instalar_cb || !instalar_cb((const uint8_t*) datos, cabecera.tam)) {
+            esp_partition_munmap(handle);
+            fallo = "El modelo no pasó la autoprueba";
+        }
+    }
+
+    if (fallo) {
+        fijar_estado(OTA_MODELO_ERROR, fallo);
+    } else {
+        // El intérprete anterior ya se liberó: su ranura puede desmapearse
+        if (ranura_activa != 0) esp_partition_munmap(mapeo_handle);
+        mapeo_datos = datos;
+        mapeo_handle = handle;
+        cabecera_activa = cabecera;
+        ranura_activa = ranura;
+        guardar_ranura(ranura);
+        fijar_estado(OTA_MODELO_LISTO, NULL);
+        ESP_LOGI(TAG, "Modelo de %s activo (%lu bytes)", ETIQUETAS[ranura], (unsigned long) cabecera.tam);
+    }
+    vTaskDelete(NULL);
+}
+
+esp_err_t ota_modelo_iniciar(const char* url, const char* sha256_hex) {
+    if (strncmp(url, "https://", 8) != 0 || strlen(url) >= sizeof(url_pendiente)) return ESP_ERR_INVALID_ARG;
+
+    uint8_t sha[32];
+    if (!hex_a_bytes(sha256_hex, sha, sizeof(sha))) return ESP_ERR_INVALID_ARG;
+
+    taskENTER_CRITICAL(&estado_mux);
+    bool ocupado = estado == OTA_MODELO_DESCARGANDO || estado == OTA_MODELO_INSTALANDO;
+    if (!ocupado) {
+        estado = OTA_MODELO_DESCARGANDO;
+        progreso = 0;
+        total = 0;
+        error[0] = '\0';
+    }
+    taskEXIT_CRITICAL(&estado_mux);
+    if (ocupado) return ESP_ERR_INVALID_STATE;
+
+    strlcpy(url_pendiente, url, sizeof(url_pendiente));
+    memcpy(sha_pendiente, sha, sizeof(sha));
+    if (xTaskCreatePinnedToCore(task_actualizar_modelo, "ota_modelo", 8192, NULL,
+                                CONFIG_PLUGIN_PRIO_RED, NULL, CONFIG_PLUGIN_CORE_RED) != pdPASS) {
+        fijar_estado(OTA_MODELO_ERROR, "No se pudo crear la tarea");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void ota_modelo_json(cJSON* destino) {
+    static const char* const NOMBRES[] = { "inactivo", "descargando", "instalando", "listo", "error" };
+
+    taskENTER_CRITICAL(&estado_mux);
+    ota_modelo_estado_t e = estado;
+    size_t p = progreso;
+    size_t t = total;
+    char mensaje[sizeof(error)];
+    strlcpy(mensaje, error, sizeof(mensaje));
+    taskEXIT_CRITICAL(&estado_mux);
+
+    cJSON_AddStringToObject(destino, "estado", NOMBRES[e]);
+    cJSON_AddNumberToObject(destino, "progreso", p);
+    cJSON_AddNumberToObject(destino, "total", t);
+    if (mensaje[0]) cJSON_AddStringToObject(destino, "error", mensaje);
+
+    cJSON_AddStringToObject(destino, "ranura", ETIQUETAS[ranura_activa]);
+    if (ranura_activa != 0) {
+        char hex[65];
+        for (int i = 0; i < 32; i++) snprintf(&hex[i * 2], 3, "%02x", cabecera_activa.sha256[i]);
+        cJSON_AddStringToObject(destino, "sha256", hex);
+        cJSON_AddNumberToObject(destino, "bytes", cabecera_activa.tam);
+    }
+}
@@ -0,0 +1,45 @@
+// ota_modelo.h - Actualización del modelo de comandos por HTTPS en ranuras A/B
+//
+// Las particiones model_a y model_b guardan cada una un modelo descargado:
+// una cabecera en el primer sector (magia, tamaño y SHA-256) y el flatbuffer
+// a partir del segundo. La descarga se escribe por sectores en la ranura
+// inactiva con un buffer fijo, se verifica el hash y se mapea la ranura en
+// memoria; la aplicación arma un intérprete sombra, lo prueba y cambia el
+// activo entre dos inferencias. La ranura activa se recuerda en NVS.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cJSON.h"
+#include "esp_err.h"
+
+typedef enum {
+    OTA_MODELO_INACTIVO,
+    OTA_MODELO_DESCARGANDO,
+    OTA_MODELO_INSTALANDO,
+    OTA_MODELO_LISTO,
+    OTA_MODELO_ERROR,
+} ota_modelo_estado_t;
+
+// Arma un modelo con `datos` (ranura mapeada, válida mientras esté activa), lo
+// prueba y lo pone en uso. Devuelve false si el candidato no sirve; en ese
+// caso el modelo activo no se toca.
+typedef bool (*ota_modelo_instalar_cb_t)(const uint8_t* datos, size_t tam);
+
+// Lee la ranura activa de NVS y la mapea si su contenido es válido
+void ota_modelo_init(ota_modelo_instalar_cb_t instalar);
+
+// Flatbuffer de la ranura activa, o NULL si el modelo activo es el de SPIFFS
+const uint8_t* ota_modelo_activo(size_t* tam);
+
+// Vuelve al modelo de SPIFFS en el próximo arranque (p. ej. si el de la ranura no carga)
+void ota_modelo_descartar_activo();
+
+// Lanza la descarga de `url` en una tarea. `sha256_hex` son 64 dígitos hex.
+// ESP_ERR_INVALID_STATE si ya hay una actualización en curso.
+esp_err_t ota_modelo_iniciar(const char* url, const char* sha256_hex);
+
+// Estado, progreso y ranura activa (para /api/modelo)
+void ota_modelo_json(cJSON* destino);
@@ -7,14 +7,19 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <ctype.h>
 
 // Librerías de FreeRTOS
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 
 // Logs y sistema
 #include "esp_log.h"
 #include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "sdkconfig.h"
 
 // Manejo de almacenamiento SPIFFS
 #include "esp_spiffs.h"
@@ -23,11 +28,16 @@
 #include "esp_wifi.h"
 #include "esp_event.h"
 #include "esp_netif.h"
+#include "lwip/sockets.h"
 
 // Almacenamiento no volátil
 #include "nvs_flash.h"
 #include "nvs.h"
 
+// Anuncio en la red local (<nombre>.local)
+#include "mdns.h"
+#include "esp_random.h"
+
 // TLS y HTTPS
 #include "esp_tls.h"
 #include "esp_crt_bundle.h"
@@ -42,14 +52,24 @@
 // Manejo de JSON
 #include "cJSON.h"
 
-// TensorFlow Lite Micro
-#include "tensorflow/lite/micro/micro_mutable_op_resolver.h"
-#include "tensorflow/lite/micro/micro_interpreter.h"
-#include "tensorflow/lite/schema/schema_generated.h"
+// Modelos de voz (TensorFlow Lite Micro) y su actualización remota
+#include "modelo.h"
+#include "ota_modelo.h"
+#include "sombra.h"
 
 // Sensor DHT11 personalizado
 #include "esp32-dht11.h"
 
+// Motor de reglas locales y clases del modelo de voz
+#include "reglas.h"
+#include "clases_voz.h"
+
+// Historial de muestras en PSRAM
+#include "historial.h"
+
+// Reporte de uso de CPU por tarea
+#include "uso_cpu.h"
+
 // Logs para depuración
 static constexpr const char *TAG_PLUGIN = "plugin";
 static const char *TAG = "modelo";
@@ -65,44 +85,70 @@ static const char *TAG = "modelo";
 #define I2S_SD  GPIO_NUM_15        // SD/DATA del micrófono INMP441
 #define I2S_SCK GPIO_NUM_17        // SCK/BCLK
 
-// ==== CLASES DEL MODELO DE VOZ ====
-#define COMANDO_APAGAR 0
-#define COMANDO_ENCODER 1
-#define COMANDO_HUMEDAD 2
-#define PALABRA_CLAVE_PLUGIN 3
-#define COMANDO_TEMPERATURA 4
-
 // ==== CONFIGURACIONES DE TIEMPO ====
 #define WIFI_CONNECT_TIMEOUT_MS 10000
 #define HTTP_TIMEOUT_MS 5000
 #define SCAN_TIMEOUT_MS 10000
+#define SENSOR_PERIODO_MS 2000     // El DHT11 no admite lecturas más rápidas
+#define PROV_MAX_INTENTOS 3        // Reintentos de conexión al aprovisionar antes de reportar fallo
+#define PROV_GRACIA_MS 10000       // Tiempo que el AP sigue activo tras conectar (el navegador lee /estado)
+#define MAX_REDES_ESCANEO 20       // Máximo de redes que se listan en /redes
+#define API_TOKEN_LEN 32           // Caracteres hex del token de la API local
+#define MAX_COMANDOS_RECIENTES 16  // Comandos que devuelve /api/comandos
 
 // ==== MANEJO DE EVENTOS ====
 static EventGroupHandle_t wifi_event_group;
 const int WIFI_CONNECTED_BIT = BIT0;
 const int WIFI_FAIL_BIT = BIT1;
 static std::string ultimo_comando_aplicado = "";  // Guarda el último comando aplicado
+static esp_netif_t* sta_netif = NULL;             // Interfaz STA (se crea una sola vez)
+static volatile bool reconexion_automatica = false;  // Reconectar al perder la red (sólo con credenciales válidas)
+
+// ==== ESTADO DEL APROVISIONAMIENTO ====
+typedef enum {
+    PROV_INACTIVO,    // No se ha enviado configuración
+    PROV_CONECTANDO,  // Probando las credenciales recibidas
+    PROV_CONECTADO,   // Conectado, el AP se apaga tras PROV_GRACIA_MS
+    PROV_FALLO        // Las credenciales no funcionaron, el AP sigue activo
+} estado_prov_t;
+
+static volatile estado_prov_t estado_prov = PROV_INACTIVO;
+static char prov_ssid[33];                 // Credenciales que está probando la tarea de aprovisionamiento
+static char prov_pass[65];
+static TaskHandle_t handle_reportar = NULL;  // Para no duplicar task_reportar
 
 // ==== PROTOTIPOS DE HANDLERS PARA EL SERVIDOR HTTP ====
 esp_err_t guardar_get_handler(httpd_req_t *req);
 esp_err_t root_get_handler(httpd_req_t *req);
 esp_err_t redes_get_handler(httpd_req_t *req);
 esp_err_t ip_get_handler(httpd_req_t *req);
+esp_err_t estado_get_handler(httpd_req_t *req);
+esp_err_t reglas_get_handler(httpd_req_t *req);
+esp_err_t reglas_post_handler(httpd_req_t *req);
+esp_err_t historial_api_handler(httpd_req_t *req);
+esp_err_t api_estado_handler(httpd_req_t *req);
+esp_err_t api_rele_handler(httpd_req_t *req);
+esp_err_t api_comandos_handler(httpd_req_t *req);
+esp_err_t ws_handler(httpd_req_t *req);
+esp_err_t api_cpu_handler(httpd_req_t *req);
+esp_err_t api_modelo_get_handler(httpd_req_t *req);
+esp_err_t api_modelo_post_handler(httpd_req_t *req);
+void notificar_clientes_ws(bool encendido, const char* origen);
+void obtener_nombre_dispositivo(char* buffer, size_t buffer_size);
+void task_reportar(void *pvParameters);
 
 // ==== CONFIGURACIÓN DE TENSORFLOW LITE MICRO ====
-constexpr int kTensorArenaSize = 1024 * 1500;  // Memoria para el modelo
-static uint8_t *tensor_arena = nullptr;
-
-const tflite::Model* model = nullptr;   // Modelo cargado desde SPIFFS
-uint8_t* modelo_data = nullptr;         // Datos crudos del modelo
-size_t modelo_size = 0;
+constexpr size_t ARENA_COMANDOS = 1024 * 1500;  // Memoria para el modelo de comandos
 
-tflite::MicroInterpreter* interpreter = nullptr; // Intérprete del modelo
-TfLiteTensor* input = nullptr;                   // Tensor de entrada
+static modelo_t modelo_despertar;   // Siempre activo, arena chica en RAM interna
+static modelo_t modelo_comandos;    // Sólo se ejecuta tras la palabra clave
+static SemaphoreHandle_t modelo_mutex = NULL;  // Protege modelo_comandos durante el cambio en caliente
+static int lote_comandos = 1;       // Ventanas por Invoke() del modelo de comandos
+static int16_t* audio_lote = NULL;  // Bloques de la ventana de comandos que van en un mismo lote
 
 // ==== VARIABLES GENERALES ====
 httpd_handle_t server = NULL;   // Servidor web HTTP
-char redes_json[2048];          // Buffer para almacenar redes WiFi en JSON
+char redes_json[2048] = "[]";   // Buffer para almacenar redes WiFi en JSON
 
 // ==== SENSOR DHT11 ====
 dht11_t dht = {
@@ -111,6 +157,58 @@ dht11_t dht = {
   .humidity = 0.0f
 };
 
+// Última muestra del sensor (la escribe task_sensor, la leen reportar_datos y las reglas)
+static regla_muestra_t ultima_muestra = { .temperatura = 0.0f, .humedad = 0.0f, .sensor_valido = false, .voz = REGLAS_SIN_VOZ };
+static portMUX_TYPE muestra_mux = portMUX_INITIALIZER_UNLOCKED;
+
+// ==== ESTADO DEL RELÉ ====
+static volatile bool estado_rele = false;  // Nivel actual de LED_GPIO
+
+// Últimos comandos aplicados (para /api/comandos)
+typedef struct {
+    uint32_t t;            // Segundos desde el arranque
+    bool encendido;
+    const char* origen;    // Literal: "voz", "nube", "regla", "local"
+} comando_reciente_t;
+
+static comando_reciente_t comandos_recientes[MAX_COMANDOS_RECIENTES];
+static int comandos_inicio = 0;
+static int comandos_n = 0;
+static portMUX_TYPE comandos_mux = portMUX_INITIALIZER_UNLOCKED;
+
+// Único punto que acciona el relé: voz, nube, reglas y API local pasan por aquí
+void aplicar_rele(bool encendido, const char* origen) {
+    estado_rele = encendido;
+    gpio_set_level(LED_GPIO, encendido ? 1 : 0);
+
+    taskENTER_CRITICAL(&comandos_mux);
+    int i = (comandos_inicio + comandos_n) % MAX_COMANDOS_RECIENTES;
+    if (comandos_n < MAX_COMANDOS_RECIENTES) comandos_n++;
+    else comandos_inicio = (comandos_inicio + 1) % MAX_COMANDOS_RECIENTES;
+    comandos_recientes[i] = { .t = historial_ahora(), .encendido = encendido, .origen = origen };
+    taskEXIT_CRITICAL(&comandos_mux);
+
+    ESP_LOGI(TAG, "Relé %s (%s)", encendido ? "encendido" : "apagado", origen);
+    notificar_clientes_ws(encendido, origen);
+}
+
+// Callback del motor de reglas
+void accionar_por_regla(regla_accion_t accion, int indice_regla) {
+    switch (accion) {
+        case REGLA_ENCENDER: aplicar_rele(true, "regla"); break;
+        case REGLA_APAGAR:   aplicar_rele(false, "regla"); break;
+        case REGLA_ALTERNAR: aplicar_rele(!estado_rele, "regla"); break;
+    }
+}
+
+// Copia la última muestra del sensor
+regla_muestra_t obtener_muestra() {
+    taskENTER_CRITICAL(&muestra_mux);
+    regla_muestra_t muestra = ultima_muestra;
+    taskEXIT_CRITICAL(&muestra_mux);
+    return muestra;
+}
+
 // ==== FUNCIÓN PARA LEER DHT11 ====
 esp_err_t read_dht(float* temp, float* hum) {
     if (dht11_read(&dht, 2) == 0) {
@@ -157,144 +255,157 @@ void setupI2S() {
 
 // ---------------TFLITE--------------------
 
-// Función para cargar el modelo TFLite desde SPIFFS
-const tflite::Model* load_model_from_spiffs(const char* model_path) {
-    ESP_LOGI(TAG, "Cargando modelo desde: %s", model_path);  // Log de inicio de carga del modelo
-    
-    FILE* file = fopen(model_path, "rb");  // Abre el archivo del modelo en modo binario
-    if (!file) {  // Si no se puede abrir el archivo
-        ESP_LOGE(TAG, "No se pudo abrir el archivo del modelo");  // Log de error
-        return nullptr;  // Retorna un puntero nulo
-    }
+#define MUESTRAS_BLOQUE 1024   // Muestras por lectura I2S (64 ms a 16 kHz)
 
-    fseek(file, 0, SEEK_END);  // Se mueve al final del archivo para obtener su tamaño
-    size_t model_size = ftell(file);  // Obtiene el tamaño del archivo
-    fseek(file, 0, SEEK_SET);  // Vuelve al principio del archivo
+// Carga los modelos de voz. El de despertar es opcional: sin él, el de comandos
+// también detecta la palabra clave (como antes) en cada bloque.
+void init_modelos() {
+    ESP_LOGI(TAG, "Inicializando modelos de voz");
+    modelo_mutex = xSemaphoreCreateMutex();
 
-    uint8_t* model_data = (uint8_t*)malloc(model_size);  // Reserva memoria para almacenar el modelo
-    if (!model_data) {  // Si no se puede asignar memoria
-        ESP_LOGE(TAG, "Fallo al asignar memoria para el modelo");  // Log de error
-        fclose(file);  // Cierra el archivo
-        return nullptr;  // Retorna un puntero nulo
+    // Arena chica en RAM interna: corre en cada bloque y no debe esperar a la PSRAM
+    if (!modelo_cargar(&modelo_despertar, "despertar", CONFIG_PLUGIN_MODELO_DESPERTAR,
+                       CONFIG_PLUGIN_ARENA_DESPERTAR_KB * 1024, MALLOC_CAP_INTERNAL)) {
+        ESP_LOGW(TAG, "Sin modelo de despertar, el modelo de comandos escuchará siempre");
     }
 
-    // Lee el contenido del archivo en el buffer de modelo
-    if (fread(model_data, 1, model_size, file) != model_size) {
-        ESP_LOGE(TAG, "Error al leer el modelo");  // Log de error
-        free(model_data);  // Libera la memoria reservada
-        fclose(file);  // Cierra el archivo
-        return nullptr;  // Retorna un puntero nulo
+    // El lote sólo sirve en la ventana de comandos: si el modelo de comandos
+    // también busca la palabra clave corre de a un bloque
+    if (modelo_despertar.interprete && CONFIG_PLUGIN_LOTE_COMANDOS > 1) {
+        audio_lote = (int16_t*) heap_caps_malloc(CONFIG_PLUGIN_LOTE_COMANDOS * MUESTRAS_BLOQUE * sizeof(int16_t),
+                                                 MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (audio_lote) lote_comandos = CONFIG_PLUGIN_LOTE_COMANDOS;
     }
 
-    fclose(file);  // Cierra el archivo después de leerlo
-
-    // Obtiene el modelo TFLite desde los datos leídos
-    const tflite::Model* model = tflite::GetModel(model_data);
-    if (model->version() != TFLITE_SCHEMA_VERSION) {  // Verifica que la versión del modelo sea compatible
-        ESP_LOGE(TAG, "Versión del modelo no soportada");  // Log de error
-        free(model_data);  // Libera la memoria reservada
-        return nullptr;  // Retorna un puntero nulo
+    // Primero el modelo descargado por OTA, si hay uno activo; si no carga se vuelve al de SPIFFS
+    size_t tam_ota = 0;
+    const uint8_t* datos_ota = ota_modelo_activo(&tam_ota);
+    if (datos_ota && !modelo_cargar_memoria(&modelo_comandos, "comandos", datos_ota, tam_ota,
+                                            ARENA_COMANDOS, MALLOC_CAP_SPIRAM, lote_comandos)) {
+        ESP_LOGW(TAG, "El modelo de la ranura OTA no carga, se descarta");
+        ota_modelo_descartar_activo();
+        datos_ota = NULL;
+    }
+    if (!datos_ota && !modelo_cargar(&modelo_comandos, "comandos", "/spiffs/modelo_comandos.tflite",
+                                     ARENA_COMANDOS, MALLOC_CAP_SPIRAM, lote_comandos)) {
+        ESP_LOGE(TAG, "Error al cargar el modelo de comandos");
     }
 
-    ESP_LOGI(TAG, "Modelo cargado correctamente. Tamaño: %d bytes", model_size);  // Log de éxito
-    return model;  // Retorna el modelo cargado
+    // El candidato se compara con el modelo que decide la palabra clave
+    sombra_init(CONFIG_PLUGIN_MODELO_SOMBRA, modelo_despertar.interprete ? &modelo_despertar : &modelo_comandos,
+                CONFIG_PLUGIN_SOMBRA_CADA);
 }
 
-// Función para inicializar el intérprete de TFLite
-void init_tflite_interpreter() {
-    ESP_LOGI(TAG, "Inicializando modelo de voz");  // Log de inicio de inicialización del modelo de voz
-
-    // Carga el modelo desde SPIFFS
-    model = load_model_from_spiffs("/spiffs/modelo_comandos.tflite");
-    if (!model) {  // Si el modelo no se cargó correctamente
-        ESP_LOGE(TAG, "Error al cargar el modelo TFLite");  // Log de error
-        return;  // Sale de la función
+// Arma un intérprete sombra con el modelo descargado, lo prueba y, si pasa, lo
+// cambia por el activo entre dos inferencias (la escucha nunca se detiene)
+bool instalar_modelo_comandos(const uint8_t* datos, size_t tam) {
+    modelo_t candidato;
+    if (!modelo_cargar_memoria(&candidato, "comandos", datos, tam, ARENA_COMANDOS, MALLOC_CAP_SPIRAM,
+                               lote_comandos)) {
+        return false;
     }
-
-    // Asigna memoria para el tensor arena (memoria para tensores temporales)
-    tensor_arena = (uint8_t*) heap_caps_malloc(kTensorArenaSize, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-    if (!tensor_arena) {  // Si no se puede asignar memoria
-        ESP_LOGE(TAG, "Fallo al asignar memoria para tensor arena");  // Log de error
-        return;  // Sale de la función
+    if (!modelo_autoprueba(&candidato, &modelo_comandos)) {
+        modelo_liberar(&candidato);
+        return false;
     }
 
-    // Configura el resuelve de operaciones de TFLite (opciones de operaciones disponibles)
-    static tflite::MicroMutableOpResolver<5> resolver;
-    resolver.AddFullyConnected();  // Añade la operación de capa completamente conectada
-    resolver.AddSoftmax();  // Añade la operación softmax
-    resolver.AddReshape();  // Añade la operación reshape
-    resolver.AddConv2D();  // Añade la operación de convolución 2D
-    resolver.AddMaxPool2D();  // Añade la operación de max pooling 2D
-
-    // Configura el intérprete de TFLite
-    static tflite::MicroInterpreter static_interpreter(
-        model, resolver, tensor_arena, kTensorArenaSize);
-    
-    interpreter = &static_interpreter;  // Asigna el intérprete
+    xSemaphoreTake(modelo_mutex, portMAX_DELAY);
+    modelo_t anterior = modelo_comandos;
+    modelo_comandos = candidato;
+    xSemaphoreGive(modelo_mutex);
 
-    // Asigna los tensores necesarios para la inferencia
-    if (interpreter->AllocateTensors() != kTfLiteOk) {  // Si no se pueden asignar los tensores
-        ESP_LOGE(TAG, "Fallo al asignar tensores");  // Log de error
-        return;  // Sale de la función
-    }
+    modelo_liberar(&anterior);
+    ESP_LOGI(TAG, "Modelo de comandos reemplazado en caliente");
+    if (!modelo_despertar.interprete) sombra_reiniciar(&modelo_comandos);  // Era la referencia del candidato
+    return true;
+}
 
-    input = interpreter->input(0);  // Obtiene el puntero al tensor de entrada
-    ESP_LOGI(TAG, "Intérprete TFLite inicializado correctamente");  // Log de éxito
+// Inferencia con el modelo de comandos sin chocar con un cambio en caliente
+static int predecir_comando(const int16_t* audio, size_t num_muestras, float* confianza) {
+    xSemaphoreTake(modelo_mutex, portMAX_DELAY);
+    int clase = modelo_predecir(&modelo_comandos, audio, num_muestras, confianza);
+    xSemaphoreGive(modelo_mutex);
+    return clase;
 }
 
-// Función para preprocesar los datos de audio (ajustado según el modelo)
-void preprocess_audio(int16_t* audio_data, int8_t* output, size_t length) {
-    for (size_t i = 0; i < length; i++) {
-        float normalized = (float)audio_data[i] / 32768.0f;  // Normaliza el valor de audio a [-1.0, 1.0]
-        output[i] = (int8_t)(normalized * 127.0f);            // Escala el valor normalizado a [-127, 127]
+// Devuelve true si el bloque contiene la palabra clave "plugin"
+static bool detectar_palabra_clave(const int16_t* audio, size_t num_muestras) {
+    float confianza = 0;
+    if (modelo_despertar.interprete) {
+        int clase = modelo_predecir(&modelo_despertar, audio, num_muestras, &confianza);
+        sombra_ofrecer(audio, num_muestras, clase, modelo_despertar.ultima_latencia_us);
+        return clase == CONFIG_PLUGIN_CLASE_DESPERTAR && confianza * 100 >= CONFIG_PLUGIN_UMBRAL_DESPERTAR;
     }
+    int clase = predecir_comando(audio, num_muestras, &confianza);
+    sombra_ofrecer(audio, num_muestras, clase, modelo_comandos.ultima_latencia_us);
+    return clase == PALABRA_CLAVE_PLUGIN;
 }
 
-// Función para realizar predicción con el modelo de TFLite
-int predict_command(int16_t* audio_buffer, size_t buffer_size) {
-    if (!interpreter || !input) {  // Verifica si el intérprete o la entrada no están inicializados
-        ESP_LOGE(TAG, "Intérprete no inicializado");  // Log de error
-        return -1;  // Retorna error
-    }
+// Ventana de comandos de a `lote_comandos` bloques por Invoke(). Si hay audio
+// acumulado (p. ej. mientras corría el modelo de despertar) las lecturas
+// vuelven enseguida y el lote se pone al día de una vez; los resultados se
+// revisan en orden y gana el primer comando.
+static int escuchar_comando_lote(int bloques) {
+    const int16_t* ventanas[CONFIG_PLUGIN_LOTE_COMANDOS];
+    int clases[CONFIG_PLUGIN_LOTE_COMANDOS];
+    float confianzas[CONFIG_PLUGIN_LOTE_COMANDOS];
+
+    for (int i = 0; i < bloques; i += lote_comandos) {
+        int n = bloques - i < lote_comandos ? bloques - i : lote_comandos;
+        size_t num_muestras = MUESTRAS_BLOQUE;
+        for (int k = 0; k < n; k++) {
+            size_t bytes_leidos = 0;
+            int16_t* bloque = audio_lote + k * MUESTRAS_BLOQUE;
+            ESP_ERROR_CHECK(i2s_channel_read(rx_channel, bloque, MUESTRAS_BLOQUE * sizeof(int16_t), &bytes_leidos,
+                                             portMAX_DELAY));
+            if (bytes_leidos / sizeof(int16_t) < num_muestras) num_muestras = bytes_leidos / sizeof(int16_t);
+            ventanas[k] = bloque;
+        }
 
-    // Preprocesa el audio y lo copia al tensor de entrada
-    int8_t* input_data = input->data.int8;
-    preprocess_audio(audio_buffer, input_data, buffer_size);
+        xSemaphoreTake(modelo_mutex, portMAX_DELAY);
+        int procesadas = modelo_predecir_lote(&modelo_comandos, ventanas, n, num_muestras, clases, confianzas);
+        xSemaphoreGive(modelo_mutex);
 
-    // Ejecuta la inferencia
-    if (interpreter->Invoke() != kTfLiteOk) {  // Si la inferencia falla
-        ESP_LOGE(TAG, "Error en la inferencia");  // Log de error
-        return -1;  // Retorna error
+        for (int k = 0; k < procesadas; k++) {
+            if (clases[k] >= 0 && clases[k] != PALABRA_CLAVE_PLUGIN) {
+                ESP_LOGI(TAG, "Predicción: clase %d con score %.2f", clases[k], confianzas[k]);
+                return clases[k];
+            }
+        }
     }
+    return -1;  // Ventana agotada sin comando
+}
 
-    // Obtiene los resultados de la predicción
-    TfLiteTensor* output = interpreter->output(0);  // Puntero al tensor de salida
-    int8_t* output_data = output->data.int8;  // Datos de la salida
-
-    // Obtiene la escala y el punto cero del tensor de salida
-    float scale = output->params.scale;
-    int zero_point = output->params.zero_point;
-
-    int predicted_class = 0;
-    float max_score = (output_data[0] - zero_point) * scale;  // Calcula la puntuación máxima
-
-    // Recorre todas las clases posibles para encontrar la clase con la puntuación más alta
-    for (int i = 1; i < output->dims->data[1]; i++) {
-        float score = (output_data[i] - zero_point) * scale;
-        if (score > max_score) {
-            max_score = score;
-            predicted_class = i;
+// Ventana acotada tras la palabra clave: el modelo de comandos analiza bloques
+// nuevos hasta reconocer un comando o agotar CONFIG_PLUGIN_VENTANA_COMANDO_MS
+static int escuchar_comando(int16_t* buffer, size_t tam_buffer) {
+    int bloques = (CONFIG_PLUGIN_VENTANA_COMANDO_MS * (SAMPLE_RATE / 1000)) / MUESTRAS_BLOQUE;
+    if (bloques < 1) bloques = 1;
+
+    // Un modelo streaming arranca la ventana en silencio, sin la palabra clave
+    xSemaphoreTake(modelo_mutex, portMAX_DELAY);
+    modelo_reiniciar(&modelo_comandos);
+    xSemaphoreGive(modelo_mutex);
+
+    if (lote_comandos > 1) return escuchar_comando_lote(bloques);
+
+    for (int i = 0; i < bloques; i++) {
+        size_t bytes_leidos = 0;
+        ESP_ERROR_CHECK(i2s_channel_read(rx_channel, buffer, tam_buffer, &bytes_leidos, portMAX_DELAY));
+        float confianza = 0;
+        int clase = predecir_comando(buffer, bytes_leidos / sizeof(int16_t), &confianza);
+        if (clase >= 0 && clase != PALABRA_CLAVE_PLUGIN) {
+            ESP_LOGI(TAG, "Predicción: clase %d con score %.2f", clase, confianza);
+            return clase;
         }
     }
-
-    ESP_LOGI(TAG, "Predicción: clase %d con score %.2f", predicted_class, max_score);  // Log del resultado de la predicción
-    return predicted_class;  // Retorna la clase predicha
+    return -1;  // Ventana agotada sin comando
 }
 
 // Función para capturar el audio desde el micrófono
 void capturarAudio() {
     size_t bytes_leidos = 0;
-    int16_t buffer[1024];  // Buffer para almacenar los datos de audio capturados
+    int16_t buffer[MUESTRAS_BLOQUE];  // Buffer para almacenar los datos de audio capturados
 
     ESP_ERROR_CHECK(i2s_channel_read(rx_channel, buffer, sizeof(buffer), &bytes_leidos, portMAX_DELAY));  // Lee el audio del canal I2S
 
@@ -317,43 +428,32 @@ void capturarAudio() {
         return;  // Sale de la función
     }
 
-    ESP_LOGI(TAG, "✅ Audio capturado correctamente. Bytes leídos: %d", bytes_leidos);  // Log de éxito
-    // Calcular el RMS (Raíz Cuadrada Media) del audio capturado
-    float sum = 0;
-    for (int i = 0; i < bytes_leidos / sizeof(int16_t); i++) {
-        sum += buffer[i] * buffer[i];
+    // Etapa 1: sólo el modelo de despertar corre en cada bloque
+    size_t num_muestras = bytes_leidos / sizeof(int16_t);
+    if (!detectar_palabra_clave(buffer, num_muestras)) {
+        return;
     }
-    float rms = sqrtf(sum / (bytes_leidos / sizeof(int16_t)));  // Calcula el RMS
-    printf("🔊 RMS: %.2f\n", rms);  // Imprime el valor del RMS
 
-    // Realiza la predicción para la palabra clave
-    size_t num_muestras = bytes_leidos / sizeof(int16_t);
-    int prediccion_palabra_clave = predict_command(buffer, num_muestras);
-
-    // Si se detecta la palabra clave "plugin"
-    if (prediccion_palabra_clave == PALABRA_CLAVE_PLUGIN) {
-        ESP_LOGI(TAG, "Palabra clave 'plugin' detectada. Esperando comando...");  // Log de detección de palabra clave
-        
-        // Captura y procesa la siguiente palabra para el comando
-        bytes_leidos = 0;  // Limpiar el buffer de audio
-        ESP_ERROR_CHECK(i2s_channel_read(rx_channel, buffer, sizeof(buffer), &bytes_leidos, portMAX_DELAY));  // Lee el siguiente bloque de audio
-
-        // Realiza la predicción para el comando
-        int prediccion_comando = predict_command(buffer, num_muestras);
-
-        // Acciona el LED según el comando
-        if (prediccion_comando == COMANDO_ENCODER) {  // Comando "encender" detectado
-            gpio_set_level(LED_GPIO, 1);  // Enciende el LED
-            ESP_LOGI(TAG, "LED encendido");  // Log de encendido de LED
-        }
-        else if (prediccion_comando == COMANDO_APAGAR) {  // Comando "apagar" detectado
-            gpio_set_level(LED_GPIO, 0);  // Apaga el LED
-            ESP_LOGI(TAG, "LED apagado");  // Log de apagado de LED
-        } else {
-            ESP_LOGI(TAG, "Comando no reconocido");  // Log de comando no reconocido
-        }
+    ESP_LOGI(TAG, "Palabra clave 'plugin' detectada. Esperando comando...");  // Log de detección de palabra clave
+
+    // Etapa 2: el modelo de comandos escucha durante la ventana
+    int prediccion_comando = escuchar_comando(buffer, sizeof(buffer));
+
+    // Acciona el LED según el comando
+    if (prediccion_comando == COMANDO_ENCODER) {  // Comando "encender" detectado
+        aplicar_rele(true, "voz");
+    }
+    else if (prediccion_comando == COMANDO_APAGAR) {  // Comando "apagar" detectado
+        aplicar_rele(false, "voz");
     } else {
-        ESP_LOGI(TAG, "Palabra clave 'plugin' no detectada");  // Log si no se detectó la palabra clave
+        ESP_LOGI(TAG, "Comando no reconocido");  // Log de comando no reconocido
+    }
+
+    // El comando también es un evento para las reglas locales (voz_*)
+    if (prediccion_comando >= 0) {
+        regla_muestra_t muestra = obtener_muestra();
+        muestra.voz = prediccion_comando;
+        reglas_evaluar(&muestra);
     }
 }
 
@@ -433,8 +533,10 @@ void wifi_event_handler(void* arg, esp_event_base_t event_base,
                         int32_t event_id, void* event_data) {
     // Si el evento es de desconexión WiFi
     if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
-        ESP_LOGW(TAG, "WiFi desconectado, intentando reconectar...");
-        esp_wifi_connect();  // Intenta reconectar
+        if (reconexion_automatica) {
+            ESP_LOGW(TAG, "WiFi desconectado, intentando reconectar...");
+            esp_wifi_connect();  // Intenta reconectar
+        }
         xEventGroupClearBits(wifi_event_group, WIFI_CONNECTED_BIT);  // Limpia el bit de conexión
         xEventGroupSetBits(wifi_event_group, WIFI_FAIL_BIT);  // Establece el bit de fallo
     } 
@@ -446,10 +548,159 @@ void wifi_event_handler(void* arg, esp_event_base_t event_base,
     }
 }
 
+// ==== API LOCAL: TOKEN ====
+static char api_token[API_TOKEN_LEN + 1] = "";
+
+// Lee el token de NVS o genera uno nuevo la primera vez
+void cargar_token_api() {
+    nvs_handle_t nvs;
+    if (nvs_open("api", NVS_READWRITE, &nvs) != ESP_OK) {
+        ESP_LOGE(TAG, "No se pudo abrir NVS para el token");
+        return;
+    }
+
+    size_t len = sizeof(api_token);
+    if (nvs_get_str(nvs, "token", api_token, &len) != ESP_OK || strlen(api_token) != API_TOKEN_LEN) {
+        uint8_t aleatorio[API_TOKEN_LEN / 2];
+        esp_fill_random(aleatorio, sizeof(aleatorio));
+        for (int i = 0; i < (int) sizeof(aleatorio); i++) {
+            snprintf(&api_token[i * 2], 3, "%02x", aleatorio[i]);
+        }
+        nvs_set_str(nvs, "token", api_token);
+        nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+    ESP_LOGI(TAG, "Token de la API local: %s", api_token);
+}
+
+// Comparación en tiempo constante (no filtra el token por tiempos de respuesta)
+static bool token_igual(const char* recibido) {
+    if (strlen(recibido) != API_TOKEN_LEN || api_token[0] == '\0') return false;
+    uint8_t diferencia = 0;
+    for (int i = 0; i < API_TOKEN_LEN; i++) diferencia |= recibido[i] ^ api_token[i];
+    return diferencia == 0;
+}
+
+// Busca el token en "Authorization: Bearer <token>" o en ?token=
+// (los WebSocket del navegador no pueden enviar cabeceras)
+static bool token_valido(httpd_req_t *req) {
+    char valor[API_TOKEN_LEN + 8];
+    if (httpd_req_get_hdr_value_str(req, "Authorization", valor, sizeof(valor)) == ESP_OK &&
+        strncmp(valor, "Bearer ", 7) == 0 && token_igual(valor + 7)) {
+        return true;
+    }
+
+    char query[128];
+    return httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+           httpd_query_key_value(query, "token", valor, sizeof(valor)) == ESP_OK && token_igual(valor);
+}
+
+// True si el AP de configuración está activo y el cliente llegó por él (su dirección está
+// en la subred del AP). Con APSTA los clientes de la red de casa también ven el servidor,
+// así que el modo WiFi solo no alcanza.
+bool cliente_en_ap(httpd_req_t *req) {
+    wifi_mode_t modo;
+    if (esp_wifi_get_mode(&modo) != ESP_OK || (modo != WIFI_MODE_AP && modo != WIFI_MODE_APSTA)) {
+        return false;
+    }
+    esp_netif_t* netif = esp_netif_get_handle_from_ifkey("WIFI_AP_DEF");
+    esp_netif_ip_info_t ip_info;
+    if (!netif || esp_netif_get_ip_info(netif, &ip_info) != ESP_OK) return false;
+
+    struct sockaddr_storage origen;
+    socklen_t largo = sizeof(origen);
+    if (getpeername(httpd_req_to_sockfd(req), (struct sockaddr*)&origen, &largo) != 0) return false;
+
+    uint32_t ip;
+    if (origen.ss_family == AF_INET) {
+        ip = ((struct sockaddr_in*)&origen)->sin_addr.s_addr;
+#if CONFIG_LWIP_IPV6
+    } else if (origen.ss_family == AF_INET6) {
+        // httpd escucha en IPv6: los clientes IPv4 llegan como ::ffff:a.b.c.d
+        const struct sockaddr_in6* origen6 = (struct sockaddr_in6*)&origen;
+        const uint32_t* palabras = origen6->sin6_addr.un.u32_addr;
+        if (palabras[0] != 0 || palabras[1] != 0 || palabras[2] != htonl(0xffff)) return false;
+        ip = palabras[3];
+#endif
+    } else {
+        return false;
+    }
+    return (ip & ip_info.netmask.addr) == (ip_info.ip.addr & ip_info.netmask.addr);
+}
+
+// Con `libre_en_ap` las rutas de configuración no piden token a los clientes del AP
+// de configuración. Si no está autorizado responde 401.
+bool autorizado(httpd_req_t *req, bool libre_en_ap) {
+    if (libre_en_ap && cliente_en_ap(req)) return true;
+    if (token_valido(req)) return true;
+
+    httpd_resp_set_status(req, "401 Unauthorized");
+    httpd_resp_sendstr(req, "Token inválido");
+    return false;
+}
+
+// Lee el cuerpo completo de la petición (puede llegar en varios fragmentos)
+int leer_cuerpo(httpd_req_t *req, char* destino, size_t len) {
+    if (req->content_len >= len) return -1;
+
+    size_t recibido = 0;
+    while (recibido < req->content_len) {
+        int ret = httpd_req_recv(req, destino + recibido, req->content_len - recibido);
+        if (ret == HTTPD_SOCK_ERR_TIMEOUT) continue;
+        if (ret <= 0) return -1;
+        recibido += ret;
+    }
+    destino[recibido] = '\0';
+    return recibido;
+}
+
+// Anuncia el dispositivo como <nombre>.local con el servicio _http._tcp
+void iniciar_mdns() {
+    static bool iniciado = false;
+    if (iniciado) return;
+
+    char nombre[64];
+    obtener_nombre_dispositivo(nombre, sizeof(nombre));
+
+    // El hostname sólo admite letras, números y '-'
+    char hostname[32];
+    size_t j = 0;
+    for (size_t i = 0; nombre[i] != '\0' && j < sizeof(hostname) - 1; i++) {
+        char c = nombre[i];
+        if (isalnum((unsigned char) c)) hostname[j++] = tolower((unsigned char) c);
+        else if (c == '-' || c == '_' || c == ' ') hostname[j++] = '-';
+    }
+    hostname[j] = '\0';
+    if (j == 0) strcpy(hostname, "pluginout");
+
+    if (mdns_init() != ESP_OK) {
+        ESP_LOGE(TAG, "No se pudo iniciar mDNS");
+        return;
+    }
+    mdns_hostname_set(hostname);
+    mdns_instance_name_set(nombre);
+
+    mdns_txt_item_t txt[] = { { "api", "/api" }, { "ws", "/ws" } };
+    mdns_service_add(NULL, "_http", "_tcp", 80, txt, sizeof(txt) / sizeof(txt[0]));
+
+    iniciado = true;
+    ESP_LOGI(TAG, "mDNS: http://%s.local", hostname);
+}
+
 // Inicializa el servidor web y registra los handlers
 void start_web_server() {
+    if (server) return;  // Ya está corriendo (AP -> STA sin reiniciar)
+
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();  // Configuración por defecto del servidor HTTP
-    httpd_start(&server, &config);  // Inicia el servidor HTTP
+    config.max_uri_handlers = 16;  // Aprovisionamiento + reglas + historial + API local
+    config.lru_purge_enable = true;  // Los WebSocket no deben agotar los sockets
+    config.core_id = CONFIG_PLUGIN_CORE_RED;  // Lejos de la inferencia
+    config.task_priority = CONFIG_PLUGIN_PRIO_HTTPD;
+    if (httpd_start(&server, &config) != ESP_OK) {
+        ESP_LOGE(TAG, "No se pudo iniciar el servidor HTTP");
+        server = NULL;
+        return;
+    }
 
     // Registra los handlers para las diferentes rutas
     httpd_uri_t root_uri = { .uri = "/", .method = HTTP_GET, .handler = root_get_handler, .user_ctx = NULL };
@@ -468,6 +719,51 @@ void start_web_server() {
         .user_ctx = NULL
     };
     httpd_register_uri_handler(server, &ip_uri);
+
+    httpd_uri_t estado_uri = { .uri = "/estado", .method = HTTP_GET, .handler = estado_get_handler, .user_ctx = NULL };
+    httpd_register_uri_handler(server, &estado_uri);
+
+    httpd_uri_t reglas_get_uri = { .uri = "/reglas", .method = HTTP_GET, .handler = reglas_get_handler, .user_ctx = NULL };
+    httpd_register_uri_handler(server, &reglas_get_uri);
+
+    httpd_uri_t reglas_post_uri = { .uri = "/reglas", .method = HTTP_POST, .handler = reglas_post_handler, .user_ctx = NULL };
+    httpd_register_uri_handler(server, &reglas_post_uri);
+
+    httpd_uri_t historial_uri = { .uri = "/historial", .method = HTTP_GET, .handler = historial_api_handler, .user_ctx = NULL };
+    httpd_register_uri_handler(server, &historial_uri);
+
+    // API local (siempre requiere token)
+    httpd_uri_t api_estado_uri = { .uri = "/api/estado", .method = HTTP_GET, .handler = api_estado_handler, .user_ctx = NULL };
+    httpd_register_uri_handler(server, &api_estado_uri);
+
+    httpd_uri_t api_rele_uri = { .uri = "/api/rele", .method = HTTP_POST, .handler = api_rele_handler, .user_ctx = NULL };
+    httpd_register_uri_handler(server, &api_rele_uri);
+
+    httpd_uri_t api_comandos_uri = { .uri = "/api/comandos", .method = HTTP_GET, .handler = api_comandos_handler, .user_ctx = NULL };
+    httpd_register_uri_handler(server, &api_comandos_uri);
+
+    httpd_uri_t api_cpu_uri = { .uri = "/api/cpu", .method = HTTP_GET, .handler = api_cpu_handler, .user_ctx = NULL };
+    httpd_register_uri_handler(server, &api_cpu_uri);
+
+    httpd_uri_t api_modelo_get_uri = { .uri = "/api/modelo", .method = HTTP_GET, .handler = api_modelo_get_handler, .user_ctx = NULL };
+    httpd_register_uri_handler(server, &api_modelo_get_uri);
+
+    httpd_uri_t api_modelo_post_uri = { .uri = "/api/modelo", .method = HTTP_POST, .handler = api_modelo_post_handler, .user_ctx = NULL };
+    httpd_register_uri_handler(server, &api_modelo_post_uri);
+
+    httpd_uri_t ws_uri = { .uri = "/ws", .method = HTTP_GET, .handler = ws_handler, .user_ctx = NULL, .is_websocket = true };
+    httpd_register_uri_handler(server, &ws_uri);
+}
+
+// Crea (una sola vez) la interfaz STA, el grupo de eventos y los handlers de WiFi/IP
+void preparar_sta() {
+    if (sta_netif) return;  // Ya está preparada
+
+    wifi_event_group = xEventGroupCreate();  // Crea el grupo de eventos de WiFi
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_EVENT, ESP_EVENT_ANY_ID, &wifi_event_handler, NULL, NULL));  // Registra el handler de eventos WiFi
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(IP_EVENT, IP_EVENT_STA_GOT_IP, &wifi_event_handler, NULL, NULL));  // Registra el handler de eventos IP
+
+    sta_netif = esp_netif_create_default_wifi_sta();  // Crea la interfaz WiFi
 }
 
 // Función para conectar a WiFi usando credenciales guardadas en NVS
@@ -495,11 +791,8 @@ bool conectar_a_wifi_guardado() {
 
     ESP_LOGI(TAG, "Intentando conectar a red guardada: %s", sta_config.sta.ssid);
 
-    wifi_event_group = xEventGroupCreate();  // Crea el grupo de eventos de WiFi
-    ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_EVENT, ESP_EVENT_ANY_ID, &wifi_event_handler, NULL, NULL));  // Registra el handler de eventos WiFi
-    ESP_ERROR_CHECK(esp_event_handler_instance_register(IP_EVENT, IP_EVENT_STA_GOT_IP, &wifi_event_handler, NULL, NULL));  // Registra el handler de eventos IP
-
-    esp_netif_create_default_wifi_sta();  // Crea la interfaz WiFi
+    preparar_sta();  // Interfaz STA y handlers de eventos
+    reconexion_automatica = true;
     ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));  // Establece el modo WiFi a STA (cliente)
     ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &sta_config));  // Configura la interfaz WiFi con los valores leídos
     ESP_ERROR_CHECK(esp_wifi_start());  // Inicia WiFi
@@ -516,6 +809,7 @@ bool conectar_a_wifi_guardado() {
         return true;  // Conexión exitosa
     } else {
         ESP_LOGW(TAG, "Falló la conexión a WiFi");
+        reconexion_automatica = false;  // Evita que el handler reconecte mientras se escanea en modo AP
         esp_wifi_disconnect();  // Desconecta WiFi si falla
         esp_wifi_stop();  // Detiene WiFi
         return false;  // Conexión fallida
@@ -546,17 +840,79 @@ void iniciar_modo_ap() {
     ap_config.ap.sae_pwe_h2e = WPA3_SAE_PWE_BOTH;  // Configuración WPA3
     ap_config.ap.transition_disable = false;  // Habilita la transición de WPA3
 
+    preparar_sta();  // La STA se usa para escanear y para probar las credenciales sin reiniciar
     esp_netif_create_default_wifi_ap();  // Crea la interfaz de red en modo AP
-    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_AP));  // Establece el modo AP
+    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_APSTA));  // AP + STA: configuración y escaneo a la vez
     ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_AP, &ap_config));  // Configura el AP
     ESP_ERROR_CHECK(esp_wifi_start());  // Inicia el AP
 
     start_web_server();  // Inicia el servidor web
 }
 
+// Tarea que prueba las credenciales recibidas sin reiniciar el dispositivo.
+// Mantiene el AP activo (APSTA) para que el navegador siga consultando /estado.
+void tarea_aprovisionar(void* pvParameters) {
+    wifi_config_t sta_config = {};
+    strlcpy((char*)sta_config.sta.ssid, prov_ssid, sizeof(sta_config.sta.ssid));
+    strlcpy((char*)sta_config.sta.password, prov_pass, sizeof(sta_config.sta.password));
+
+    ESP_LOGI(TAG, "Aprovisionando: probando red %s", prov_ssid);
+
+    reconexion_automatica = false;  // Los reintentos los cuenta esta tarea
+    esp_wifi_disconnect();
+    xEventGroupClearBits(wifi_event_group, WIFI_CONNECTED_BIT | WIFI_FAIL_BIT);
+
+    // Si la pila WiFi no acepta la configuración no hay forma de aplicarla en caliente:
+    // las credenciales ya están en NVS, así que el reinicio las usará al arrancar
+    if (esp_wifi_set_mode(WIFI_MODE_APSTA) != ESP_OK ||
+        esp_wifi_set_config(WIFI_IF_STA, &sta_config) != ESP_OK) {
+        ESP_LOGE(TAG, "No se pudo reconfigurar la STA, reiniciando...");
+        esp_restart();
+    }
+
+    bool conectado = false;
+    for (int intento = 1; intento <= PROV_MAX_INTENTOS && !conectado; intento++) {
+        esp_wifi_connect();
+        EventBits_t bits = xEventGroupWaitBits(wifi_event_group,
+            WIFI_CONNECTED_BIT | WIFI_FAIL_BIT,
+            pdTRUE, pdFALSE,
+            pdMS_TO_TICKS(WIFI_CONNECT_TIMEOUT_MS));
+        conectado = bits & WIFI_CONNECTED_BIT;
+        if (!conectado) {
+            ESP_LOGW(TAG, "Intento %d/%d fallido", intento, PROV_MAX_INTENTOS);
+        }
+    }
+
+    if (!conectado) {
+        esp_wifi_disconnect();
+        estado_prov = PROV_FALLO;  // El AP sigue activo para corregir los datos
+        vTaskDelete(NULL);
+        return;
+    }
+
+    reconexion_automatica = true;
+    xEventGroupSetBits(wifi_event_group, WIFI_CONNECTED_BIT);  // Lo consumió la espera de arriba
+    estado_prov = PROV_CONECTADO;
+    ESP_LOGI(TAG, "Aprovisionamiento completado, iniciando reporte");
+
+    if (handle_reportar == NULL) {
+        xTaskCreatePinnedToCore(task_reportar, "Task Reportar", 8192, NULL, CONFIG_PLUGIN_PRIO_RED, &handle_reportar, CONFIG_PLUGIN_CORE_RED);  // Tarea de reporte de datos
+    }
+    iniciar_mdns();  // El servidor web sigue activo y pasa a atender la API local
+
+    // Deja tiempo al navegador para leer la IP antes de apagar el AP
+    vTaskDelay(pdMS_TO_TICKS(PROV_GRACIA_MS));
+    esp_wifi_set_mode(WIFI_MODE_STA);  // Sólo STA: reportar_datos y verificar_comando se activan
+    estado_prov = PROV_INACTIVO;  // Sin AP ya no hay a quién informar (ni mostrar el token)
+    ESP_LOGI(TAG, "AP de configuración apagado");
+    vTaskDelete(NULL);
+}
+
 // Handler para guardar las configuraciones WiFi
 esp_err_t guardar_get_handler(httpd_req_t *req) {
-    char ssid[32], pass[64], nombre[32], query[128];
+    if (!autorizado(req, true)) return ESP_OK;
+
+    char ssid[33], pass[65], nombre[32], query[256];
     
     // Obtiene la cadena de consulta (query string) de la URL
     if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
@@ -566,19 +922,36 @@ esp_err_t guardar_get_handler(httpd_req_t *req) {
             httpd_query_key_value(query, "pass", pass, sizeof(pass)) == ESP_OK &&
             httpd_query_key_value(query, "nombre", nombre, sizeof(nombre)) == ESP_OK) {
 
+            // Sólo se prueba una configuración a la vez
+            if (estado_prov == PROV_CONECTANDO) {
+                httpd_resp_set_status(req, "409 Conflict");
+                httpd_resp_sendstr(req, "Conexión en curso");
+                return ESP_OK;
+            }
+
             // Abre NVS para guardar los valores
             nvs_handle_t nvs;
-            nvs_open("wifi", NVS_READWRITE, &nvs);
+            if (nvs_open("wifi", NVS_READWRITE, &nvs) != ESP_OK) {
+                httpd_resp_send_500(req);
+                return ESP_FAIL;
+            }
             nvs_set_str(nvs, "ssid", ssid);  // Guarda el SSID
             nvs_set_str(nvs, "pass", pass);  // Guarda la contraseña
             nvs_set_str(nvs, "nombre", nombre);  // Guarda el nombre
             nvs_commit(nvs);  // Guarda los cambios
             nvs_close(nvs);  // Cierra el NVS
 
-            // Responde con mensaje de éxito y reinicia el dispositivo
-            httpd_resp_sendstr(req, "Guardado, reiniciando...");
-            vTaskDelay(pdMS_TO_TICKS(3000));  // Espera 3 segundos
-            esp_restart();  // Reinicia el dispositivo
+            // La conexión se prueba en otra tarea: el worker de httpd queda libre
+            strlcpy(prov_ssid, ssid, sizeof(prov_ssid));
+            strlcpy(prov_pass, pass, sizeof(prov_pass));
+            estado_prov = PROV_CONECTANDO;
+            if (xTaskCreatePinnedToCore(tarea_aprovisionar, "aprovisionar", 4096, NULL, CONFIG_PLUGIN_PRIO_RED, NULL, CONFIG_PLUGIN_CORE_RED) != pdPASS) {
+                estado_prov = PROV_FALLO;
+                httpd_resp_send_500(req);
+                return ESP_FAIL;
+            }
+
+            httpd_resp_sendstr(req, "Guardado, conectando...");
             return ESP_OK;
         }
 
@@ -592,6 +965,366 @@ esp_err_t guardar_get_handler(httpd_req_t *req) {
     return ESP_FAIL;  // Retornar fallo
 }
 
+// Handler que informa al navegador el resultado del aprovisionamiento
+esp_err_t estado_get_handler(httpd_req_t *req) {
+    static const char* nombres[] = { "inactivo", "conectando", "conectado", "fallo" };
+
+    char ip_str[16] = "";
+    if (estado_prov == PROV_CONECTADO && sta_netif) {
+        esp_netif_ip_info_t ip_info;
+        esp_netif_get_ip_info(sta_netif, &ip_info);
+        snprintf(ip_str, sizeof(ip_str), IPSTR, IP2STR(&ip_info.ip));
+    }
+
+    // cJSON escapa el SSID (puede contener comillas)
+    cJSON* estado = cJSON_CreateObject();
+    cJSON_AddStringToObject(estado, "estado", nombres[estado_prov]);
+    cJSON_AddStringToObject(estado, "ssid", prov_ssid);
+    cJSON_AddStringToObject(estado, "ip", ip_str);
+    if (estado_prov == PROV_CONECTADO && cliente_en_ap(req)) {
+        // Sólo se muestra en el AP de configuración, para que el usuario lo anote
+        cJSON_AddStringToObject(estado, "token", api_token);
+    }
+
+    char respuesta[200];
+    if (!cJSON_PrintPreallocated(estado, respuesta, sizeof(respuesta), false)) {
+        strcpy(respuesta, "{}");
+    }
+    cJSON_Delete(estado);
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, respuesta);
+    return ESP_OK;
+}
+
+// Handler que devuelve el texto de las reglas locales activas
+esp_err_t reglas_get_handler(httpd_req_t *req) {
+    if (!autorizado(req, true)) return ESP_OK;
+
+    char* fuente = (char*) malloc(REGLAS_MAX_FUENTE);
+    if (!fuente) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+    reglas_obtener_fuente(fuente, REGLAS_MAX_FUENTE);
+    httpd_resp_set_type(req, "text/plain");
+    httpd_resp_sendstr(req, fuente);
+    free(fuente);
+    return ESP_OK;
+}
+
+// Handler que recibe las reglas (una por línea), las compila y las guarda en NVS
+esp_err_t reglas_post_handler(httpd_req_t *req) {
+    if (!autorizado(req, true)) return ESP_OK;
+
+    if (req->content_len >= REGLAS_MAX_FUENTE) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Reglas demasiado largas");
+        return ESP_FAIL;
+    }
+
+    char* fuente = (char*) malloc(REGLAS_MAX_FUENTE);
+    if (!fuente) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+
+    if (leer_cuerpo(req, fuente, REGLAS_MAX_FUENTE) < 0) {
+        free(fuente);
+        return ESP_FAIL;
+    }
+
+    char error[64];
+    esp_err_t err = reglas_actualizar(fuente, error, sizeof(error));
+    free(fuente);
+
+    if (err != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, error);
+        return ESP_OK;
+    }
+    httpd_resp_sendstr(req, "Reglas guardadas");
+    return ESP_OK;
+}
+
+// /historial con el mismo control de acceso que el resto de rutas de datos
+esp_err_t historial_api_handler(httpd_req_t *req) {
+    if (!autorizado(req, true)) return ESP_OK;
+    return historial_get_handler(req);
+}
+
+// Estado del relé y última muestra del sensor
+static void agregar_estado_json(cJSON* json) {
+    regla_muestra_t muestra = obtener_muestra();
+    cJSON_AddBoolToObject(json, "rele", estado_rele);
+    cJSON_AddBoolToObject(json, "sensor_valido", muestra.sensor_valido);
+    cJSON_AddNumberToObject(json, "temperatura", muestra.temperatura);
+    cJSON_AddNumberToObject(json, "humedad", muestra.humedad);
+    cJSON_AddNumberToObject(json, "ahora", historial_ahora());
+}
+
+static esp_err_t enviar_json(httpd_req_t *req, cJSON* json) {
+    char* texto = cJSON_PrintUnformatted(json);
+    cJSON_Delete(json);
+    if (!texto) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+    httpd_resp_set_type(req, "application/json");
+    esp_err_t err = httpd_resp_sendstr(req, texto);
+    free(texto);
+    return err;
+}
+
+// Interpreta "encender", "apagar" o "alternar"; devuelve false si no es un comando
+static bool aplicar_accion_texto(const char* accion) {
+    if (strcmp(accion, "encender") == 0) aplicar_rele(true, "local");
+    else if (strcmp(accion, "apagar") == 0) aplicar_rele(false, "local");
+    else if (strcmp(accion, "alternar") == 0) aplicar_rele(!estado_rele, "local");
+    else return false;
+    return true;
+}
+
+// GET /api/estado
+esp_err_t api_estado_handler(httpd_req_t *req) {
+    if (!autorizado(req, false)) return ESP_OK;
+
+    cJSON* json = cJSON_CreateObject();
+    agregar_estado_json(json);
+    return enviar_json(req, json);
+}
+
+// POST /api/rele con {"accion":"encender"|"apagar"|"alternar"}
+esp_err_t api_rele_handler(httpd_req_t *req) {
+    if (!autorizado(req, false)) return ESP_OK;
+
+    char cuerpo[96];
+    if (leer_cuerpo(req, cuerpo, sizeof(cuerpo)) < 0) {
+        httpd_resp_send_400(req);
+        return ESP_FAIL;
+    }
+
+    cJSON* peticion = cJSON_Parse(cuerpo);
+    const cJSON* accion = cJSON_GetObjectItem(peticion, "accion");
+    bool ok = cJSON_IsString(accion) && aplicar_accion_texto(accion->valuestring);
+    cJSON_Delete(peticion);
+
+    if (!ok) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "accion debe ser encender, apagar o alternar");
+        return ESP_OK;
+    }
+
+    cJSON* json = cJSON_CreateObject();
+    agregar_estado_json(json);
+    return enviar_json(req, json);
+}
+
+// GET /api/comandos: últimos comandos aplicados, del más antiguo al más reciente
+esp_err_t api_comandos_handler(httpd_req_t *req) {
+    if (!autorizado(req, false)) return ESP_OK;
+
+    comando_reciente_t copia[MAX_COMANDOS_RECIENTES];
+    taskENTER_CRITICAL(&comandos_mux);
+    int n = comandos_n;
+    for (int i = 0; i < n; i++) copia[i] = comandos_recientes[(comandos_inicio + i) % MAX_COMANDOS_RECIENTES];
+    taskEXIT_CRITICAL(&comandos_mux);
+
+    cJSON* lista = cJSON_CreateArray();
+    for (int i = 0; i < n; i++) {
+        cJSON* item = cJSON_CreateObject();
+        cJSON_AddNumberToObject(item, "t", copia[i].t);
+        cJSON_AddBoolToObject(item, "encendido", copia[i].encendido);
+        cJSON_AddStringToObject(item, "origen", copia[i].origen);
+        cJSON_AddItemToArray(lista, item);
+    }
+
+    cJSON* json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(json, "ahora", historial_ahora());
+    cJSON_AddItemToObject(json, "comandos", lista);
+    return enviar_json(req, json);
+}
+
+// GET /api/cpu: último reporte de uso de CPU por tarea y latencia de inferencia.
+// Con CONFIG_PLUGIN_TIEMPOS_CAPAS agrega el tiempo por capa de cada modelo;
+// ?reiniciar=1 los pone en cero después de responder.
+esp_err_t api_cpu_handler(httpd_req_t *req) {
+    if (!autorizado(req, false)) return ESP_OK;
+
+    cJSON* json = cJSON_CreateObject();
+    uso_cpu_json(json);
+#if CONFIG_PLUGIN_TIEMPOS_CAPAS
+    char query[64], valor[4];
+    bool reiniciar = httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+                     httpd_query_key_value(query, "reiniciar", valor, sizeof(valor)) == ESP_OK &&
+                     strcmp(valor, "1") == 0;
+    cJSON* modelos = cJSON_AddObjectToObject(json, "modelos");
+    if (modelo_despertar.interprete) {
+        modelo_tiempos_json(&modelo_despertar, cJSON_AddObjectToObject(modelos, "despertar"));
+        if (reiniciar) modelo_tiempos_reiniciar(&modelo_despertar);
+    }
+    // El de comandos puede cambiarse en caliente mientras se lee
+    xSemaphoreTake(modelo_mutex, portMAX_DELAY);
+    if (modelo_comandos.interprete) {
+        modelo_tiempos_json(&modelo_comandos, cJSON_AddObjectToObject(modelos, "comandos"));
+        if (reiniciar) modelo_tiempos_reiniciar(&modelo_comandos);
+    }
+    xSemaphoreGive(modelo_mutex);
+#endif
+    return enviar_json(req, json);
+}
+
+// GET /api/modelo: ranura activa, estado de la última actualización y evaluación en sombra
+esp_err_t api_modelo_get_handler(httpd_req_t *req) {
+    if (!autorizado(req, false)) return ESP_OK;
+
+    cJSON* json = cJSON_CreateObject();
+    ota_modelo_json(json);
+    if (sombra_activa()) sombra_json(cJSON_AddObjectToObject(json, "sombra"));
+    return enviar_json(req, json);
+}
+
+// POST /api/modelo con {"url":"https://...","sha256":"<64 hex>"}: descarga en segundo plano
+esp_err_t api_modelo_post_handler(httpd_req_t *req) {
+    if (!autorizado(req, false)) return ESP_OK;
+
+    char cuerpo[384];
+    if (leer_cuerpo(req, cuerpo, sizeof(cuerpo)) < 0) {
+        httpd_resp_send_400(req);
+        return ESP_FAIL;
+    }
+
+    cJSON* peticion = cJSON_Parse(cuerpo);
+    const cJSON* url = cJSON_GetObjectItem(peticion, "url");
+    const cJSON* sha = cJSON_GetObjectItem(peticion, "sha256");
+    esp_err_t err = ESP_ERR_INVALID_ARG;
+    if (cJSON_IsString(url) && cJSON_IsString(sha)) {
+        err = ota_modelo_iniciar(url->valuestring, sha->valuestring);
+    }
+    cJSON_Delete(peticion);
+
+    if (err == ESP_ERR_INVALID_ARG) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Se requiere url https y sha256 en hexadecimal");
+        return ESP_OK;
+    }
+    if (err == ESP_ERR_INVALID_STATE) {
+        httpd_resp_set_status(req, "409 Conflict");
+        httpd_resp_sendstr(req, "Ya hay una actualización en curso");
+        return ESP_OK;
+    }
+
+    httpd_resp_set_status(req, err == ESP_OK ? "202 Accepted" : HTTPD_500);
+    cJSON* json = cJSON_CreateObject();
+    ota_modelo_json(json);
+    return enviar_json(req, json);
+}
+
+// WebSocket /ws?token=...: recibe "encender"/"apagar"/"alternar"/"estado" y
+// empuja cada cambio del relé a todos los clientes conectados
+esp_err_t ws_handler(httpd_req_t *req) {
+    if (req->method == HTTP_GET) {
+        // Handshake ya respondido por httpd: sin token válido sólo se cierra la conexión
+        if (!token_valido(req)) return ESP_FAIL;
+        ESP_LOGI(TAG, "Cliente WebSocket conectado");
+        return ESP_OK;
+    }
+
+    httpd_ws_frame_t trama = {};
+    trama.type = HTTPD_WS_TYPE_TEXT;
+    esp_err_t err = httpd_ws_recv_frame(req, &trama, 0);  // Sólo obtiene el largo
+    if (err != ESP_OK || trama.len == 0) return err;
+    // Ningún comando es tan largo. El cuerpo sin leer quedaría en el socket y se tomaría
+    // como la cabecera de la trama siguiente: se cierra la conexión
+    if (trama.len > 32) return ESP_FAIL;
+
+    char texto[33];
+    trama.payload = (uint8_t*) texto;
+    err = httpd_ws_recv_frame(req, &trama, trama.len);
+    if (err != ESP_OK) return err;
+    texto[trama.len] = '\0';
+
+    // Los comandos se confirman por la notificación de aplicar_rele; "estado" responde directo
+    if (!aplicar_accion_texto(texto) && strcmp(texto, "estado") == 0) {
+        cJSON* json = cJSON_CreateObject();
+        agregar_estado_json(json);
+        char respuesta[160];
+        bool ok = cJSON_PrintPreallocated(json, respuesta, sizeof(respuesta), false);
+        cJSON_Delete(json);
+        if (ok) {
+            httpd_ws_frame_t salida = {};
+            salida.type = HTTPD_WS_TYPE_TEXT;
+            salida.payload = (uint8_t*) respuesta;
+            salida.len = strlen(respuesta);
+            return httpd_ws_send_frame(req, &salida);
+        }
+    }
+    return ESP_OK;
+}
+
+// Se ejecuta en la tarea de httpd: envía el mensaje a cada socket WebSocket
+static void ws_difundir(void* arg) {
+    char* mensaje = (char*) arg;
+    int clientes[CONFIG_LWIP_MAX_SOCKETS];
+    size_t num_clientes = CONFIG_LWIP_MAX_SOCKETS;
+
+    if (server && httpd_get_client_list(server, &num_clientes, clientes) == ESP_OK) {
+        httpd_ws_frame_t trama = {};
+        trama.type = HTTPD_WS_TYPE_TEXT;
+        trama.payload = (uint8_t*) mensaje;
+        trama.len = strlen(mensaje);
+        for (size_t i = 0; i < num_clientes; i++) {
+            if (httpd_ws_get_fd_info(server, clientes[i]) == HTTPD_WS_CLIENT_WEBSOCKET) {
+                httpd_ws_send_frame_async(server, clientes[i], &trama);
+            }
+        }
+    }
+    free(mensaje);
+}
+
+// Publica un cambio del relé a los clientes WebSocket sin bloquear a quien lo accionó
+void notificar_clientes_ws(bool encendido, const char* origen) {
+    if (!server) return;
+
+    char* mensaje = (char*) malloc(64);
+    if (!mensaje) return;
+    snprintf(mensaje, 64, "{\"rele\":%s,\"origen\":\"%s\"}", encendido ? "true" : "false", origen);
+    if (httpd_queue_work(server, ws_difundir, mensaje) != ESP_OK) free(mensaje);
+}
+
+// Escanea las redes WiFi visibles y deja la lista de SSIDs en redes_json
+void escanear_redes() {
+    wifi_scan_config_t scan_config = {};  // Escaneo activo en todos los canales
+    esp_err_t err = esp_wifi_scan_start(&scan_config, true);  // Bloquea hasta terminar
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error al escanear redes: %s", esp_err_to_name(err));
+        return;
+    }
+
+    uint16_t num = MAX_REDES_ESCANEO;
+    wifi_ap_record_t* registros = (wifi_ap_record_t*) calloc(num, sizeof(wifi_ap_record_t));
+    if (!registros) {
+        esp_wifi_clear_ap_list();  // Libera la lista interna del escaneo
+        return;
+    }
+    esp_wifi_scan_get_ap_records(&num, registros);
+
+    // Lista de SSIDs sin repetidos ni redes ocultas
+    cJSON* lista = cJSON_CreateArray();
+    for (int i = 0; i < num; i++) {
+        const char* ssid = (const char*) registros[i].ssid;
+        if (ssid[0] == '\0') continue;
+
+        bool repetido = false;
+        for (int j = 0; j < i && !repetido; j++) {
+            repetido = strcmp(ssid, (const char*) registros[j].ssid) == 0;
+        }
+        if (!repetido) cJSON_AddItemToArray(lista, cJSON_CreateString(ssid));
+    }
+    free(registros);
+
+    if (!cJSON_PrintPreallocated(lista, redes_json, sizeof(redes_json), false)) {
+        strcpy(redes_json, "[]");
+    }
+    cJSON_Delete(lista);
+    ESP_LOGI(TAG, "Redes encontradas: %s", redes_json);
+}
 
 // Tarea que escanea las redes WiFi y luego elimina la tarea
 void tarea_escanear_redes(void* pvParameters) {
@@ -663,19 +1396,29 @@ void reportar_datos() {
 
         ESP_LOGI(TAG, "Nombre almacenado en NVS: %s", nombre);
 
-        float temperatura, humedad;
-        if (read_dht(&temperatura, &humedad) != ESP_OK) {  // Lee los valores de temperatura y humedad
+        // Usa la última lectura de task_sensor (el DHT11 no se lee desde dos tareas)
+        regla_muestra_t muestra = obtener_muestra();
+        if (!muestra.sensor_valido) {
             ESP_LOGE(TAG, "Error leyendo sensor DHT");
             return;
         }
+        float temperatura = muestra.temperatura;
+        float humedad = muestra.humedad;
 
-        char post_data[256];
         const char* tipo = "sensor";  // Tipo de dispositivo (sensor)
 
         // Crea un JSON con los datos obtenidos
-        snprintf(post_data, sizeof(post_data),
-            "{\"name\":\"%s\",\"temperature\":%.2f,\"humidity\":%.2f,\"type\":\"%s\"}",
-            nombre, temperatura, humedad, tipo);
+        cJSON* json = cJSON_CreateObject();
+        cJSON_AddStringToObject(json, "name", nombre);
+        cJSON_AddNumberToObject(json, "temperature", temperatura);
+        cJSON_AddNumberToObject(json, "humidity", humedad);
+        cJSON_AddStringToObject(json, "type", tipo);
+        if (sombra_activa()) {
+            sombra_json(cJSON_AddObjectToObject(json, "sombra"));  // Comparación del modelo candidato
+        }
+        char* post_data = cJSON_PrintUnformatted(json);
+        cJSON_Delete(json);
+        if (!post_data) return;
 
         ESP_LOGI(TAG, "Datos JSON: %s", post_data);
 
@@ -698,6 +1441,7 @@ void reportar_datos() {
         }
 
         esp_http_client_cleanup(client);  // Limpia el cliente HTTP
+        free(post_data);
     } else {
         ESP_LOGW(TAG, "No estamos en modo STA, no se reportan datos.");  // Aviso si no estamos en modo STA
     }
@@ -779,11 +1523,9 @@ void verificar_comando() {
 
         // Compara el comando recibido y realiza la acción correspondiente
         if (strcmp(buffer, "encender") == 0) {
-            ESP_LOGI(TAG, "Encendiendo LED...");
-            gpio_set_level(LED_GPIO, 1);  // Enciende el LED
+            aplicar_rele(true, "nube");
         } else if (strcmp(buffer, "apagar") == 0) {
-            ESP_LOGI(TAG, "Apagando LED...");
-            gpio_set_level(LED_GPIO, 0);  // Apaga el LED
+            aplicar_rele(false, "nube");
         } else {
             ESP_LOGW(TAG, "Comando desconocido: %s", buffer);  // Comando desconocido
         }
@@ -837,12 +1579,35 @@ void task_verificar(void *pvParameters) {
     }
 }
 
+// Lee el DHT11 periódicamente, publica la muestra y evalúa las reglas locales
+void task_sensor(void *pvParameters) {
+    ESP_LOGI(TAG, "🌡️ Iniciando tarea de sensor...");
+    while (1) {
+        float temperatura, humedad;
+        bool valida = read_dht(&temperatura, &humedad) == ESP_OK;
+
+        taskENTER_CRITICAL(&muestra_mux);
+        if (valida) {
+            ultima_muestra.temperatura = temperatura;
+            ultima_muestra.humedad = humedad;
+        }
+        ultima_muestra.sensor_valido = valida;
+        regla_muestra_t muestra = ultima_muestra;
+        taskEXIT_CRITICAL(&muestra_mux);
+
+        if (valida) historial_agregar(temperatura, humedad);
+        reglas_evaluar(&muestra);  // Acciona el relé sin esperar a la nube
+        vTaskDelay(pdMS_TO_TICKS(SENSOR_PERIODO_MS));
+    }
+}
+
 void task_escuchar(void *pvParameters) {
     // Inicia la tarea de escucha por voz
     ESP_LOGI(TAG, "🎤 Iniciando tarea de escucha por voz...");
     while (1) {
         capturarAudio();  // Función que contiene la inferencia de voz
-        vTaskDelay(pdMS_TO_TICKS(500)); // Espera 500ms entre detecciones
+        // Con el modelo de despertar se analiza cada bloque; sin él se deja respirar a la CPU
+        if (!modelo_despertar.interprete) vTaskDelay(pdMS_TO_TICKS(500));
     }
 }
 
@@ -921,7 +1686,11 @@ extern "C" void app_main() {
     // 4. Inicializa I2S para capturar datos del micrófono
     ESP_LOGI(TAG, "Inicializando I2S para el micrófono");
     setupI2S();
-    init_tflite_interpreter();  // Inicializa el intérprete de TensorFlow Lite
+    ota_modelo_init(instalar_modelo_comandos);  // Ranura de modelo activa (A/B) guardada en NVS
+    init_modelos();  // Carga los modelos de despertar y de comandos
+    reglas_init(accionar_por_regla);  // Carga las reglas locales desde NVS
+    cargar_token_api();  // Token de la API local
+    historial_init(SENSOR_PERIODO_MS / 1000);  // Serie temporal del sensor en PSRAM
 
     // 5. Configuración WiFi
     ESP_LOGI(TAG, "Inicializando WiFi");
@@ -931,13 +1700,16 @@ extern "C" void app_main() {
     // 6. Intento de conexión a red guardada
     bool conectado = conectar_a_wifi_guardado();  // Intenta conectarse a una red WiFi guardada
 
-    if (!conectado) {
+    if (conectado) {
+        start_web_server();  // API local en la LAN (mismos handlers que el modo AP)
+        iniciar_mdns();
+    } else {
         ESP_LOGI(TAG, "🛜 No se pudo conectar → Modo AP");
         iniciar_modo_ap();  // Si no se conecta, inicia el modo AP
 
         // 7. Escanear redes WiFi solo en modo AP
         ESP_LOGI(TAG, "Iniciando escaneo de redes...");
-        xTaskCreate(tarea_escanear_redes, "escanear_redes", 4096, NULL, 5, NULL);  // Crea la tarea de escaneo de redes
+        xTaskCreatePinnedToCore(tarea_escanear_redes, "escanear_redes", 4096, NULL, CONFIG_PLUGIN_PRIO_RED, NULL, CONFIG_PLUGIN_CORE_RED);  // Crea la tarea de escaneo de redes
     }
 
     // 8. Configuración de GPIO
@@ -952,14 +1724,21 @@ extern "C" void app_main() {
     ESP_ERROR_CHECK(gpio_config(&io_conf));  // Configura los pines GPIO
 
     // 9. Crear las tareas
-    xTaskCreate(task_escuchar, "Task Escuchar", 8192, NULL, 2, NULL);  // Tarea de escucha por voz
+    // Audio e inferencia en un núcleo; WiFi, lwIP, httpd y el resto de tareas en el otro
+    xTaskCreatePinnedToCore(task_escuchar, "Task Escuchar", 8192, NULL, CONFIG_PLUGIN_PRIO_AUDIO, NULL, CONFIG_PLUGIN_CORE_AUDIO);  // Tarea de escucha por voz
+    xTaskCreatePinnedToCore(task_sensor, "Task Sensor", 4096, NULL, CONFIG_PLUGIN_PRIO_SENSOR, NULL, CONFIG_PLUGIN_CORE_RED);  // Lectura del DHT11 y reglas locales
 
     if (conectado) {
-        xTaskCreate(task_reportar, "Task Reportar", 8192, NULL, 1, NULL);  // Tarea de reporte de datos
+        xTaskCreatePinnedToCore(task_reportar, "Task Reportar", 8192, NULL, CONFIG_PLUGIN_PRIO_RED, &handle_reportar, CONFIG_PLUGIN_CORE_RED);  // Tarea de reporte de datos
     } else {
         ESP_LOGI(TAG, "WiFi no conectado, no se inicia task_reportar");
     }
     
-    xTaskCreate(task_verificar, "Task Verificar", 8192, NULL, 1, NULL);  // Tarea de verificación de comandos
-    xTaskCreate(task_probar_microfono, "Probar Microfono", 8192, NULL, 1, NULL);  // Tarea de prueba de micrófono
+    xTaskCreatePinnedToCore(task_verificar, "Task Verificar", 8192, NULL, CONFIG_PLUGIN_PRIO_RED, NULL, CONFIG_PLUGIN_CORE_RED);  // Tarea de verificación de comandos
+#if CONFIG_PLUGIN_PRUEBA_MICROFONO
+    xTaskCreatePinnedToCore(task_probar_microfono, "Probar Microfono", 8192, NULL, 1, NULL, CONFIG_PLUGIN_CORE_AUDIO);  // Tarea de prueba de micrófono
+#endif
+#if CONFIG_PLUGIN_REPORTE_CPU_S > 0
+    xTaskCreatePinnedToCore(task_uso_cpu, "Uso CPU", 3072, (void*) (uintptr_t) CONFIG_PLUGIN_REPORTE_CPU_S, 1, NULL, CONFIG_PLUGIN_CORE_RED);  // Reporte periódico de CPU
+#endif
 }
@@ -0,0 +1,501 @@
+// reglas.cpp - Compilador y máquina virtual del motor de reglas locales
+
+#include "reglas.h"
+
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include "esp_log.h"
+#include "nvs.h"
+
+#include "clases_voz.h"
+
+static const char *TAG = "reglas";
+
+// ==== BYTECODE ====
+// Máquina de pila con enteros de 32 bits; las constantes y sensores van en décimas
+enum : uint8_t {
+    OP_FIN = 0,
+    OP_CONST,   // Sigue un int16 little-endian
+    OP_VAR,     // Sigue el índice de la variable
+    OP_LT, OP_LE, OP_GT, OP_GE, OP_EQ, OP_NE,
+    OP_AND, OP_OR, OP_NOT
+};
+
+// Variables disponibles para el bytecode
+enum : uint8_t {
+    VAR_TEMPERATURA = 0,
+    VAR_HUMEDAD,
+    VAR_VOZ,
+    NUM_VARS
+};
+
+#define USA_SENSOR ((1 << VAR_TEMPERATURA) | (1 << VAR_HUMEDAD))
+#define PILA_MAX 8                 // Profundidad máxima de la pila de evaluación
+#define MAX_LINEA 128              // Largo máximo de una regla (los buffers van en la pila del worker httpd)
+#define NVS_VERSION_CODIGO 1       // Cambia si cambia el formato del blob
+
+typedef struct {
+    uint8_t codigo[REGLAS_MAX_CODIGO];
+    uint8_t largo;
+    uint8_t accion;    // regla_accion_t
+    uint8_t usa;       // Máscara de variables que lee la condición
+    bool previo;       // Resultado de la última evaluación (disparo por flanco)
+} regla_t;
+
+static regla_t reglas[REGLAS_MAX];
+static int num_reglas = 0;
+static char fuente_activa[REGLAS_MAX_FUENTE] = "";
+static SemaphoreHandle_t mutex_reglas = NULL;
+static regla_accionar_t accionar_rele = NULL;
+
+// ==== COMPILADOR ====
+
+typedef struct {
+    const char* p;         // Posición actual en el texto de la condición
+    regla_t* regla;
+    int pila;              // Profundidad de pila en este punto del código
+    const char* error;
+} compilador_t;
+
+static const struct {
+    const char* nombre;
+    int clase;
+} eventos_voz[] = {
+    { "voz_apagar", COMANDO_APAGAR },
+    { "voz_encender", COMANDO_ENCODER },
+    { "voz_humedad", COMANDO_HUMEDAD },
+    { "voz_temperatura", COMANDO_TEMPERATURA },
+};
+
+static void saltar_espacios(compilador_t* c) {
+    while (isspace((unsigned char)*c->p)) c->p++;
+}
+
+// Consume `tok` si es lo siguiente en el texto
+static bool coincide(compilador_t* c, const char* tok) {
+    saltar_espacios(c);
+    size_t n = strlen(tok);
+    if (strncmp(c->p, tok, n) != 0) return false;
+    c->p += n;
+    return true;
+}
+
+static void emitir(compilador_t* c, uint8_t byte) {
+    if (c->regla->largo >= REGLAS_MAX_CODIGO) {
+        c->error = "regla demasiado larga";
+        return;
+    }
+    c->regla->codigo[c->regla->largo++] = byte;
+}
+
+// Ajusta la profundidad de pila tras emitir una instrucción
+static void apilar(compilador_t* c, int delta) {
+    c->pila += delta;
+    if (c->pila > PILA_MAX) c->error = "expresión demasiado anidada";
+}
+
+static void emitir_const(compilador_t* c, int32_t valor) {
+    if (valor < INT16_MIN || valor > INT16_MAX) {
+        c->error = "número fuera de rango";
+        return;
+    }
+    emitir(c, OP_CONST);
+    emitir(c, (uint8_t)(valor & 0xFF));
+    emitir(c, (uint8_t)((valor >> 8) & 0xFF));
+    apilar(c, 1);
+}
+
+static void emitir_var(compilador_t* c, uint8_t var) {
+    emitir(c, OP_VAR);
+    emitir(c, var);
+    c->regla->usa |= 1 << var;
+    apilar(c, 1);
+}
+
+// término := número | variable | evento de voz
+static void compilar_termino(compilador_t* c) {
+    saltar_espacios(c);
+
+    if (isdigit((unsigned char)*c->p) || *c->p == '-' || *c->p == '.') {
+        char* fin;
+        float valor = strtof(c->p, &fin);
+        if (fin == c->p) {
+            c->error = "número inválido";
+            return;
+        }
+        c->p = fin;
+        if (*c->p == '%') c->p++;  // "humedad < 10%" se acepta tal cual
+        emitir_const(c, (int32_t)lroundf(valor * 10.0f));
+        return;
+    }
+
+    char nombre[24];
+    size_t n = 0;
+    while ((isalnum((unsigned char)*c->p) || *c->p == '_') && n < sizeof(nombre) - 1) {
+        nombre[n++] = *c->p++;
+    }
+    nombre[n] = '\0';
+
+    if (strcmp(nombre, "temperatura") == 0) {
+        emitir_var(c, VAR_TEMPERATURA);
+        return;
+    }
+    if (strcmp(nombre, "humedad") == 0) {
+        emitir_var(c, VAR_HUMEDAD);
+        return;
+    }
+    for (size_t i = 0; i < sizeof(eventos_voz) / sizeof(eventos_voz[0]); i++) {
+        if (strcmp(nombre, eventos_voz[i].nombre) == 0) {
+            // Un evento de voz es "voz == clase" (la clase no va en décimas)
+            emitir_var(c, VAR_VOZ);
+            emitir(c, OP_CONST);
+            emitir(c, (uint8_t)(eventos_voz[i].clase & 0xFF));
+            emitir(c, (uint8_t)((eventos_voz[i].clase >> 8) & 0xFF));
+            apilar(c, 1);
+            emitir(c, OP_EQ);
+            apilar(c, -1);
+            return;
+        }
+    }
+    c->error = n ? "variable desconocida" : "se esperaba un valor";
+}
+
+static void compilar_o(compilador_t* c);
+
+// comparación := término [op término]
+static void compilar_comparacion(compilador_t* c) {
+    compilar_termino(c);
+    if (c->error) return;
+
+    // Los operadores de dos caracteres van antes que sus prefijos
+    static const struct { const char* tok; uint8_t op; } ops[] = {
+        { "<=", OP_LE }, { ">=", OP_GE }, { "==", OP_EQ }, { "!=", OP_NE },
+        { "<", OP_LT }, { ">", OP_GT },
+    };
+    for (size_t i = 0; i < sizeof(ops) / sizeof(ops[0]); i++) {
+        if (coincide(c, ops[i].tok)) {
+            compilar_termino(c);
+            emitir(c, ops[i].op);
+            apilar(c, -1);
+            return;
+        }
+    }
+}
+
+// unario := "!" unario | "(" o ")" | comparación
+static void compilar_unario(compilador_t* c) {
+    saltar_espacios(c);
+    if (c->p[0] == '!' && c->p[1] != '=') {
+        c->p++;
+        compilar_unario(c);
+        emitir(c, OP_NOT);
+        return;
+    }
+    if (coincide(c, "(")) {
+        compilar_o(c);
+        if (!c->error && !coincide(c, ")")) c->error = "falta ')'";
+        return;
+    }
+    compilar_comparacion(c);
+}
+
+// y := unario ("&&" unario)*
+static void compilar_y(compilador_t* c) {
+    compilar_unario(c);
+    while (!c->error && coincide(c, "&&")) {
+        compilar_unario(c);
+        emitir(c, OP_AND);
+        apilar(c, -1);
+    }
+}
+
+// o := y ("||" y)*
+static void compilar_o(compilador_t* c) {
+    compilar_y(c);
+    while (!c->error && coincide(c, "||")) {
+        compilar_y(c);
+        emitir(c, OP_OR);
+        apilar(c, -1);
+    }
+}
+
+// Compila una línea "<condición> -> <acción>"
+static const char* compilar_regla(const char* linea, regla_t* regla) {
+    memset(regla, 0, sizeof(*regla));
+
+    const char* flecha = strstr(linea, "->");
+    if (!flecha) return "falta '->'";
+
+    const char* accion = flecha + 2;
+    while (isspace((unsigned char)*accion)) accion++;
+    size_t largo_accion = strlen(accion);
+    while (largo_accion && isspace((unsigned char)accion[largo_accion - 1])) largo_accion--;
+
+    if (largo_accion == 8 && strncmp(accion, "encender", 8) == 0) regla->accion = REGLA_ENCENDER;
+    else if (largo_accion == 6 && strncmp(accion, "apagar", 6) == 0) regla->accion = REGLA_APAGAR;
+    else if (largo_accion == 8 && strncmp(accion, "alternar", 8) == 0) regla->accion = REGLA_ALTERNAR;
+    else return "acción desconocida";
+
+    // La condición se compila sobre una copia terminada en '\0'
+    char condicion[MAX_LINEA];
+    size_t largo = flecha - linea;
+    if (largo >= sizeof(condicion)) return "regla demasiado larga";
+    memcpy(condicion, linea, largo);
+    condicion[largo] = '\0';
+
+    compilador_t c = { .p = condicion, .regla = regla, .pila = 0, .error = NULL };
+    compilar_o(&c);
+    if (c.error) return c.error;
+
+    saltar_espacios(&c);
+    if (*c.p != '\0') return "texto inesperado en la condición";
+
+    emitir(&c, OP_FIN);
+    return c.error;
+}
+
+// Compila el texto completo (una regla por línea, '#' para comentarios)
+static int compilar_fuente(const char* fuente, regla_t* destino, char* error, size_t error_len) {
+    int n = 0;
+    int num_linea = 0;
+    const char* p = fuente;
+
+    while (*p) {
+        const char* fin = strchr(p, '\n');
+        size_t largo = fin ? (size_t)(fin - p) : strlen(p);
+        num_linea++;
+
+        char linea[MAX_LINEA];
+        if (largo >= sizeof(linea)) {
+            snprintf(error, error_len, "línea %d: regla demasiado larga", num_linea);
+            return -1;
+        }
+        memcpy(linea, p, largo);
+        linea[largo] = '\0';
+
+        char* comentario = strchr(linea, '#');
+        if (comentario) *comentario = '\0';
+
+        const char* q = linea;
+        while (isspace((unsigned char)*q)) q++;
+        if (*q != '\0') {
+            if (n >= REGLAS_MAX) {
+                snprintf(error, error_len, "línea %d: máximo %d reglas", num_linea, REGLAS_MAX);
+                return -1;
+            }
+            const char* err = compilar_regla(q, &destino[n]);
+            if (err) {
+                snprintf(error, error_len, "línea %d: %s", num_linea, err);
+                return -1;
+            }
+            n++;
+        }
+
+        if (!fin) break;
+        p = fin + 1;
+    }
+    return n;
+}
+
+// ==== MÁQUINA VIRTUAL ====
+
+// Ejecuta el bytecode; un código corrupto (p. ej. NVS dañado) evalúa a falso
+static bool ejecutar(const regla_t* regla, const int32_t* vars) {
+    int32_t pila[PILA_MAX];
+    int sp = 0;
+    const uint8_t* pc = regla->codigo;
+    const uint8_t* fin = regla->codigo + regla->largo;
+
+    while (pc < fin) {
+        uint8_t op = *pc++;
+        if (op == OP_FIN) return sp == 1 && pila[0] != 0;
+
+        if (op == OP_CONST) {
+            if (fin - pc < 2 || sp >= PILA_MAX) return false;
+            pila[sp++] = (int16_t)(pc[0] | (pc[1] << 8));
+            pc += 2;
+            continue;
+        }
+        if (op == OP_VAR) {
+            if (pc >= fin || *pc >= NUM_VARS || sp >= PILA_MAX) return false;
+            pila[sp++] = vars[*pc++];
+            continue;
+        }
+        if (op == OP_NOT) {
+            if (sp < 1) return false;
+            pila[sp - 1] = !pila[sp - 1];
+            continue;
+        }
+
+        if (sp < 2) return false;
+        int32_t b = pila[--sp];
+        int32_t a = pila[sp - 1];
+        switch (op) {
+            case OP_LT:  a = a < b; break;
+            case OP_LE:  a = a <= b; break;
+            case OP_GT:  a = a > b; break;
+            case OP_GE:  a = a >= b; break;
+            case OP_EQ:  a = a == b; break;
+            case OP_NE:  a = a != b; break;
+            case OP_AND: a = a && b; break;
+            case OP_OR:  a = a || b; break;
+            default: return false;
+        }
+        pila[sp - 1] = a;
+    }
+    return false;
+}
+
+void reglas_evaluar(const regla_muestra_t* muestra) {
+    int32_t vars[NUM_VARS];
+    vars[VAR_TEMPERATURA] = (int32_t)lroundf(muestra->temperatura * 10.0f);
+    vars[VAR_HUMEDAD] = (int32_t)lroundf(muestra->humedad * 10.0f);
+    vars[VAR_VOZ] = muestra->voz;
+
+    // Las acciones se ejecutan fuera del mutex
+    regla_accion_t disparadas[REGLAS_MAX];
+    int indices[REGLAS_MAX];
+    int num_disparadas = 0;
+
+    xSemaphoreTake(mutex_reglas, portMAX_DELAY);
+    for (int i = 0; i < num_reglas; i++) {
+        regla_t* regla = &reglas[i];
+        if ((regla->usa & USA_SENSOR) && !muestra->sensor_valido) continue;
+
+        bool valor = ejecutar(regla, vars);
+        if (valor && !regla->previo) {
+            disparadas[num_disparadas] = (regla_accion_t)regla->accion;
+            indices[num_disparadas++] = i;
+        }
+        regla->previo = valor;
+    }
+    xSemaphoreGive(mutex_reglas);
+
+    for (int i = 0; i < num_disparadas; i++) {
+        ESP_LOGI(TAG, "Regla %d disparada", indices[i]);
+        if (accionar_rele) accionar_rele(disparadas[i], indices[i]);
+    }
+}
+
+// ==== PERSISTENCIA ====
+
+// Guarda el texto y el bytecode; el blob es [versión, n, (acción, usa, largo, código)...]
+// Se llama con mutex_reglas tomado (el blob es estático)
+static esp_err_t guardar_en_nvs(const char* fuente, const regla_t* nuevas, int n) {
+    static uint8_t blob[2 + REGLAS_MAX * (3 + REGLAS_MAX_CODIGO)];
+    size_t largo = 0;
+    blob[largo++] = NVS_VERSION_CODIGO;
+    blob[largo++] = (uint8_t)n;
+    for (int i = 0; i < n; i++) {
+        blob[largo++] = nuevas[i].accion;
+        blob[largo++] = nuevas[i].usa;
+        blob[largo++] = nuevas[i].largo;
+        memcpy(&blob[largo], nuevas[i].codigo, nuevas[i].largo);
+        largo += nuevas[i].largo;
+    }
+
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open("reglas", NVS_READWRITE, &nvs);
+    if (err != ESP_OK) return err;
+    err = nvs_set_str(nvs, "fuente", fuente);
+    if (err == ESP_OK) err = nvs_set_blob(nvs, "codigo", blob, largo);
+    if (err == ESP_OK) err = nvs_commit(nvs);
+    nvs_close(nvs);
+    return err;
+}
+
+// Carga el bytecode guardado; devuelve false si no existe o el formato no coincide
+static bool cargar_codigo(nvs_handle_t nvs) {
+    static uint8_t blob[2 + REGLAS_MAX * (3 + REGLAS_MAX_CODIGO)];
+    size_t largo = sizeof(blob);
+    if (nvs_get_blob(nvs, "codigo", blob, &largo) != ESP_OK || largo < 2) return false;
+    if (blob[0] != NVS_VERSION_CODIGO || blob[1] > REGLAS_MAX) return false;
+
+    size_t pos = 2;
+    int n = blob[1];
+    for (int i = 0; i < n; i++) {
+        if (pos + 3 > largo) return false;
+        regla_t* regla = &reglas[i];
+        memset(regla, 0, sizeof(*regla));
+        regla->accion = blob[pos++];
+        regla->usa = blob[pos++];
+        regla->largo = blob[pos++];
+        if (regla->largo > REGLAS_MAX_CODIGO || pos + regla->largo > largo) return false;
+        memcpy(regla->codigo, &blob[pos], regla->largo);
+        pos += regla->largo;
+    }
+    num_reglas = n;
+    return true;
+}
+
+esp_err_t reglas_init(regla_accionar_t accionar) {
+    accionar_rele = accionar;
+    if (!mutex_reglas) mutex_reglas = xSemaphoreCreateMutex();
+
+    nvs_handle_t nvs;
+    if (nvs_open("reglas", NVS_READONLY, &nvs) != ESP_OK) {
+        ESP_LOGI(TAG, "No hay reglas guardadas");
+        return ESP_OK;
+    }
+
+    size_t largo = sizeof(fuente_activa);
+    if (nvs_get_str(nvs, "fuente", fuente_activa, &largo) != ESP_OK) {
+        fuente_activa[0] = '\0';
+    }
+
+    // Si el bytecode no sirve (otra versión del firmware) se recompila el texto
+    if (!cargar_codigo(nvs)) {
+        char error[64];
+        int n = compilar_fuente(fuente_activa, reglas, error, sizeof(error));
+        if (n < 0) {
+            ESP_LOGE(TAG, "Reglas guardadas inválidas: %s", error);
+            n = 0;
+        }
+        num_reglas = n;
+    }
+    nvs_close(nvs);
+
+    ESP_LOGI(TAG, "%d reglas cargadas", num_reglas);
+    return ESP_OK;
+}
+
+esp_err_t reglas_actualizar(const char* fuente, char* error, size_t error_len) {
+    if (strlen(fuente) >= REGLAS_MAX_FUENTE) {
+        snprintf(error, error_len, "texto demasiado largo");
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    static regla_t nuevas[REGLAS_MAX];  // Estática: no cabe cómodamente en la pila del worker httpd
+    xSemaphoreTake(mutex_reglas, portMAX_DELAY);
+    int n = compilar_fuente(fuente, nuevas, error, error_len);
+    if (n < 0) {
+        xSemaphoreGive(mutex_reglas);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t err = guardar_en_nvs(fuente, nuevas, n);
+    if (err == ESP_OK) {
+        memcpy(reglas, nuevas, sizeof(regla_t) * n);
+        num_reglas = n;
+        strlcpy(fuente_activa, fuente, sizeof(fuente_activa));
+    } else {
+        snprintf(error, error_len, "error NVS: %s", esp_err_to_name(err));
+    }
+    xSemaphoreGive(mutex_reglas);
+
+    ESP_LOGI(TAG, "%d reglas activas", num_reglas);
+    return err;
+}
+
+void reglas_obtener_fuente(char* destino, size_t len) {
+    xSemaphoreTake(mutex_reglas, portMAX_DELAY);
+    strlcpy(destino, fuente_activa, len);
+    xSemaphoreGive(mutex_reglas);
+}
@@ -0,0 +1,57 @@
+// reglas.h - Motor de reglas locales (automatización sin pasar por la nube)
+//
+// Cada regla tiene la forma "<condición> -> <acción>", por ejemplo:
+//
+//     humedad < 10 -> encender
+//     temperatura >= 30.5 && !voz_apagar -> encender
+//     voz_temperatura || humedad > 80% -> alternar
+//
+// Variables: temperatura, humedad (en unidades del DHT11) y los eventos de voz
+// voz_apagar, voz_encender, voz_humedad, voz_temperatura.
+// Operadores: < <= > >= == != && || ! y paréntesis. Acciones: encender, apagar, alternar.
+//
+// Las reglas se compilan a un bytecode de pila con enteros en décimas y se
+// disparan por flanco: la acción se ejecuta cuando la condición pasa de falsa
+// a verdadera, así no se pelea con los comandos manuales (voz o nube).
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#define REGLAS_MAX 16             // Reglas simultáneas
+#define REGLAS_MAX_CODIGO 64      // Bytes de bytecode por regla
+#define REGLAS_MAX_FUENTE 1024    // Texto completo de las reglas (una por línea)
+#define REGLAS_SIN_VOZ (-1)       // Muestra sin evento de voz
+
+// Acción que ejecuta una regla al dispararse
+typedef enum {
+    REGLA_ENCENDER,
+    REGLA_APAGAR,
+    REGLA_ALTERNAR
+} regla_accion_t;
+
+// Valores contra los que se evalúan las reglas
+typedef struct {
+    float temperatura;
+    float humedad;
+    bool sensor_valido;   // false si el DHT11 no ha dado lectura: las reglas que lo usan no se evalúan
+    int voz;              // Clase del comando de voz de este evento o REGLAS_SIN_VOZ
+} regla_muestra_t;
+
+// Función que acciona el relé (la implementa la aplicación)
+typedef void (*regla_accionar_t)(regla_accion_t accion, int indice_regla);
+
+// Carga las reglas guardadas en NVS (namespace "reglas") y registra el actuador
+esp_err_t reglas_init(regla_accionar_t accionar);
+
+// Compila el texto completo; si es válido lo guarda en NVS y lo aplica.
+// En caso de error deja en `error` un mensaje con la línea y no cambia nada.
+esp_err_t reglas_actualizar(const char* fuente, char* error, size_t error_len);
+
+// Copia el texto de las reglas activas en `destino`
+void reglas_obtener_fuente(char* destino, size_t len);
+
+// Evalúa todas las reglas contra una muestra (sensor o evento de voz)
+void reglas_evaluar(const regla_muestra_t* muestra);
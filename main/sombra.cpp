@@ -0,0 +1,187 @@
+// sombra.cpp - Modelo candidato evaluado en paralelo al activo
+
+#include "sombra.h"
+
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "sdkconfig.h"
+
+static const char *TAG = "sombra";
+
+#define SOMBRA_MUESTRAS 1024   // Una lectura I2S completa
+#define SOMBRA_COLA 2          // Ventanas pendientes; si el candidato se atrasa se descartan
+#define SOMBRA_MAX_CLASES 16
+
+typedef struct {
+    int16_t audio[SOMBRA_MUESTRAS];
+    uint16_t num_muestras;
+    int8_t clase_activa;
+    uint32_t latencia_activa_us;
+} ventana_t;
+
+typedef struct {
+    uint32_t n;
+    uint64_t suma_us;
+    uint32_t max_us;
+} latencia_t;
+
+static modelo_t candidato;
+static QueueHandle_t cola = NULL;
+static SemaphoreHandle_t candidato_mutex = NULL;  // Entre task_sombra y sombra_reiniciar
+static int muestreo = 0;
+static uint32_t contador = 0;
+
+// Estadísticas: las escriben task_sombra y la tarea de audio (descartadas), siempre bajo stats_mux
+static portMUX_TYPE stats_mux = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t evaluadas = 0;
+static uint32_t coincidencias = 0;
+static uint32_t descartadas = 0;
+static uint32_t desacuerdos[SOMBRA_MAX_CLASES];   // Por clase del modelo activo
+static latencia_t latencia_activo = {};
+static latencia_t latencia_sombra = {};
+
+static void sumar_latencia(latencia_t* l, uint32_t us) {
+    l->n++;
+    l->suma_us += us;
+    if (us > l->max_us) l->max_us = us;
+}
+
+static void task_sombra(void *pvParameters) {
+    ventana_t* v = (ventana_t*) pvParameters;  // Buffer propio: la ventana no vive en el stack
+    while (1) {
+        if (xQueueReceive(cola, v, portMAX_DELAY) != pdTRUE) continue;
+
+        xSemaphoreTake(candidato_mutex, portMAX_DELAY);
+        int clase = muestreo ? modelo_predecir(&candidato, v->audio, v->num_muestras, NULL) : -1;
+        xSemaphoreGive(candidato_mutex);
+        if (clase < 0) continue;
+
+        taskENTER_CRITICAL(&stats_mux);
+        evaluadas++;
+        if (clase == v->clase_activa) coincidencias++;
+        else if (v->clase_activa < SOMBRA_MAX_CLASES) desacuerdos[v->clase_activa]++;
+        sumar_latencia(&latencia_activo, v->latencia_activa_us);
+        sumar_latencia(&latencia_sombra, candidato.ultima_latencia_us);
+        taskEXIT_CRITICAL(&stats_mux);
+    }
+}
+
+void sombra_init(const char* ruta, const modelo_t* referencia, int cada) {
+    if (cada <= 0) return;
+
+    if (!modelo_cargar(&candidato, "sombra", ruta, CONFIG_PLUGIN_ARENA_SOMBRA_KB * 1024, MALLOC_CAP_SPIRAM)) {
+        ESP_LOGI(TAG, "Sin modelo candidato, evaluación en sombra apagada");
+        return;
+    }
+    // Sólo recibe 1 de cada `cada` bloques: un modelo streaming uniría audio que no es contiguo
+    if (candidato.salto) {
+        ESP_LOGW(TAG, "El candidato es un modelo streaming, no se puede evaluar en sombra");
+        modelo_liberar(&candidato);
+        return;
+    }
+    if (!modelo_autoprueba(&candidato, referencia)) {
+        ESP_LOGW(TAG, "El candidato no es compatible con el modelo activo");
+        modelo_liberar(&candidato);
+        return;
+    }
+
+    // La cola copia ventanas enteras (2 KB cada una): mejor en PSRAM
+    cola = xQueueCreateWithCaps(SOMBRA_COLA, sizeof(ventana_t), MALLOC_CAP_SPIRAM);
+    ventana_t* trabajo = (ventana_t*) heap_caps_malloc(sizeof(ventana_t), MALLOC_CAP_SPIRAM);
+    candidato_mutex = xSemaphoreCreateMutex();
+    if (!cola || !trabajo || !candidato_mutex ||
+        xTaskCreatePinnedToCore(task_sombra, "sombra", 4096, trabajo, CONFIG_PLUGIN_PRIO_SOMBRA, NULL,
+                                CONFIG_PLUGIN_CORE_RED) != pdPASS) {
+        ESP_LOGE(TAG, "Sin memoria para la cola de ventanas o la tarea");
+        if (cola) vQueueDeleteWithCaps(cola);
+        cola = NULL;
+        heap_caps_free(trabajo);
+        if (candidato_mutex) vSemaphoreDelete(candidato_mutex);
+        candidato_mutex = NULL;
+        modelo_liberar(&candidato);
+        return;
+    }
+
+    muestreo = cada;  // La tarea espera en la cola hasta que llegue la primera ventana
+    ESP_LOGI(TAG, "Evaluando candidato %s en 1 de cada %d ventanas", ruta, cada);
+}
+
+void sombra_reiniciar(const modelo_t* referencia) {
+    if (muestreo == 0) return;
+
+    xSemaphoreTake(candidato_mutex, portMAX_DELAY);
+    xQueueReset(cola);  // Las ventanas pendientes traen la clase del modelo anterior
+    if (!modelo_autoprueba(&candidato, referencia)) {
+        // El candidato queda cargado: sombra_json puede estar leyendo su salida
+        ESP_LOGW(TAG, "El candidato no es compatible con el nuevo modelo activo, evaluación en sombra apagada");
+        muestreo = 0;
+    }
+
+    taskENTER_CRITICAL(&stats_mux);
+    evaluadas = 0;
+    coincidencias = 0;
+    descartadas = 0;
+    memset(desacuerdos, 0, sizeof(desacuerdos));
+    latencia_activo = {};
+    latencia_sombra = {};
+    taskEXIT_CRITICAL(&stats_mux);
+    xSemaphoreGive(candidato_mutex);
+}
+
+bool sombra_activa() {
+    return muestreo > 0;
+}
+
+void sombra_ofrecer(const int16_t* audio, size_t num_muestras, int clase_activa, uint32_t latencia_us) {
+    if (muestreo == 0 || clase_activa < 0 || ++contador % muestreo != 0) return;
+
+    static ventana_t v;  // Sólo la tarea de audio llama aquí
+    v.num_muestras = num_muestras < SOMBRA_MUESTRAS ? num_muestras : SOMBRA_MUESTRAS;
+    memcpy(v.audio, audio, v.num_muestras * sizeof(int16_t));
+    v.clase_activa = clase_activa;
+    v.latencia_activa_us = latencia_us;
+
+    if (xQueueSend(cola, &v, 0) != pdTRUE) {
+        taskENTER_CRITICAL(&stats_mux);
+        descartadas++;
+        taskEXIT_CRITICAL(&stats_mux);
+    }
+}
+
+static void agregar_latencia_json(cJSON* destino, const char* nombre, const latencia_t* l) {
+    cJSON* lat = cJSON_AddObjectToObject(destino, nombre);
+    cJSON_AddNumberToObject(lat, "prom_us", l->n ? (double) l->suma_us / l->n : 0);
+    cJSON_AddNumberToObject(lat, "max_us", l->max_us);
+}
+
+void sombra_json(cJSON* destino) {
+    if (muestreo == 0) return;
+
+    int clases = candidato.salida->dims->data[candidato.salida->dims->size - 1];
+    if (clases > SOMBRA_MAX_CLASES) clases = SOMBRA_MAX_CLASES;
+
+    taskENTER_CRITICAL(&stats_mux);
+    uint32_t n = evaluadas;
+    uint32_t iguales = coincidencias;
+    uint32_t perdidas = descartadas;
+    uint32_t por_clase[SOMBRA_MAX_CLASES];
+    memcpy(por_clase, desacuerdos, sizeof(por_clase));
+    latencia_t activo = latencia_activo;
+    latencia_t sombra = latencia_sombra;
+    taskEXIT_CRITICAL(&stats_mux);
+
+    cJSON_AddNumberToObject(destino, "evaluadas", n);
+    cJSON_AddNumberToObject(destino, "descartadas", perdidas);
+    cJSON_AddNumberToObject(destino, "acuerdo", n ? (double) iguales / n : 0);
+    cJSON* lista = cJSON_AddArrayToObject(destino, "desacuerdos");
+    for (int i = 0; i < clases; i++) cJSON_AddItemToArray(lista, cJSON_CreateNumber(por_clase[i]));
+    agregar_latencia_json(destino, "activo", &activo);
+    agregar_latencia_json(destino, "candidato", &sombra);
+}
@@ -0,0 +1,34 @@
+// sombra.h - Evaluación en sombra de un modelo candidato con audio real
+//
+// Una de cada N ventanas que analiza el modelo de palabra clave activo se
+// copia a una cola; una tarea de baja prioridad en el otro núcleo pasa la
+// misma ventana por el modelo candidato y acumula cuántas veces coinciden,
+// los desacuerdos por clase y la latencia de cada modelo. El candidato nunca
+// acciona nada: sólo se mide.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cJSON.h"
+#include "modelo.h"
+
+// Carga el candidato de `ruta` y arranca la tarea. `referencia` es el modelo
+// activo contra el que se compara (misma entrada y clases). Con `cada` == 0,
+// sin candidato en SPIFFS o con un candidato streaming la evaluación queda apagada.
+void sombra_init(const char* ruta, const modelo_t* referencia, int cada);
+
+// Después de cambiar el modelo activo (OTA): vuelve a probar el candidato contra
+// `referencia`, apagando la evaluación si ya no es compatible, y pone los
+// contadores en cero para no mezclar resultados de dos modelos activos.
+void sombra_reiniciar(const modelo_t* referencia);
+
+bool sombra_activa();
+
+// Llamada por la tarea de audio después de cada inferencia del modelo activo.
+// No bloquea: si la cola está llena la ventana se descarta.
+void sombra_ofrecer(const int16_t* audio, size_t num_muestras, int clase_activa, uint32_t latencia_us);
+
+// Contadores acumulados desde el arranque o el último sombra_reiniciar (para la telemetría y /api/modelo)
+void sombra_json(cJSON* destino);
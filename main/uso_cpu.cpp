@@ -0,0 +1,183 @@
+// uso_cpu.cpp - Estadísticas de tiempo de ejecución de FreeRTOS por intervalo
+
+#include "uso_cpu.h"
+
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#include "esp_log.h"
+#include "sdkconfig.h"
+
+static const char *TAG = "uso_cpu";
+
+#define MAX_TAREAS 32   // Tareas que entran en cada instantánea
+
+// Latencia de inferencia acumulada en el intervalo actual
+typedef struct {
+    uint32_t n;
+    uint64_t suma_us;
+    uint32_t min_us;
+    uint32_t max_us;
+} latencia_t;
+
+static latencia_t latencia_actual = { 0, 0, UINT32_MAX, 0 };
+static latencia_t latencia_reporte = { 0, 0, 0, 0 };
+static portMUX_TYPE latencia_mux = portMUX_INITIALIZER_UNLOCKED;
+
+void uso_cpu_registrar_inferencia(uint32_t us) {
+    taskENTER_CRITICAL(&latencia_mux);
+    latencia_actual.n++;
+    latencia_actual.suma_us += us;
+    if (us < latencia_actual.min_us) latencia_actual.min_us = us;
+    if (us > latencia_actual.max_us) latencia_actual.max_us = us;
+    taskEXIT_CRITICAL(&latencia_mux);
+}
+
+// Cierra el intervalo de latencia y empieza uno nuevo
+static void cerrar_latencia() {
+    taskENTER_CRITICAL(&latencia_mux);
+    latencia_reporte = latencia_actual;
+    latencia_actual = { 0, 0, UINT32_MAX, 0 };
+    taskEXIT_CRITICAL(&latencia_mux);
+    if (latencia_reporte.n == 0) latencia_reporte.min_us = 0;
+}
+
+static void agregar_latencia_json(cJSON* destino) {
+    cJSON* lat = cJSON_AddObjectToObject(destino, "inferencia");
+    cJSON_AddNumberToObject(lat, "n", latencia_reporte.n);
+    cJSON_AddNumberToObject(lat, "prom_us", latencia_reporte.n ? (double) latencia_reporte.suma_us / latencia_reporte.n : 0);
+    cJSON_AddNumberToObject(lat, "min_us", latencia_reporte.min_us);
+    cJSON_AddNumberToObject(lat, "max_us", latencia_reporte.max_us);
+}
+
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS && CONFIG_FREERTOS_USE_TRACE_FACILITY
+
+// Uso de una tarea en el último intervalo
+typedef struct {
+    char nombre[configMAX_TASK_NAME_LEN];
+    int nucleo;              // -1 si no está fijada a un núcleo
+    UBaseType_t prioridad;
+    uint16_t uso_x10;        // Décimas de porcentaje de un núcleo
+    uint32_t stack_libre;    // Mínimo histórico de stack libre (bytes)
+} uso_tarea_t;
+
+static TaskStatus_t previas[MAX_TAREAS];
+static TaskStatus_t actuales[MAX_TAREAS];
+static UBaseType_t num_previas = 0;
+static configRUN_TIME_COUNTER_TYPE total_previo = 0;
+
+static uso_tarea_t reporte[MAX_TAREAS];
+static int num_reporte = 0;
+static uint16_t uso_nucleo_x10[configNUMBER_OF_CORES];
+static SemaphoreHandle_t mutex_reporte = NULL;
+
+// Tiempo de la tarea en la instantánea anterior (0 si es nueva)
+static configRUN_TIME_COUNTER_TYPE tiempo_previo(TaskHandle_t tarea) {
+    for (UBaseType_t i = 0; i < num_previas; i++) {
+        if (previas[i].xHandle == tarea) return previas[i].ulRunTimeCounter;
+    }
+    return 0;
+}
+
+void uso_cpu_reportar() {
+    if (!mutex_reporte) mutex_reporte = xSemaphoreCreateMutex();
+
+    configRUN_TIME_COUNTER_TYPE total;
+    UBaseType_t n = uxTaskGetSystemState(actuales, MAX_TAREAS, &total);
+    if (n == 0) {
+        ESP_LOGW(TAG, "Más de %d tareas, aumenta MAX_TAREAS", MAX_TAREAS);
+        return;
+    }
+
+    // El contador total avanza como el reloj; cada tarea suma sólo mientras corre
+    configRUN_TIME_COUNTER_TYPE intervalo = total - total_previo;
+    bool primero = num_previas == 0;
+
+    cerrar_latencia();
+    xSemaphoreTake(mutex_reporte, portMAX_DELAY);
+    num_reporte = 0;
+    for (UBaseType_t i = 0; i < n && intervalo > 0; i++) {
+        configRUN_TIME_COUNTER_TYPE usado = actuales[i].ulRunTimeCounter - tiempo_previo(actuales[i].xHandle);
+        BaseType_t nucleo = xTaskGetCoreID(actuales[i].xHandle);
+
+        uso_tarea_t* t = &reporte[num_reporte++];
+        strlcpy(t->nombre, actuales[i].pcTaskName, sizeof(t->nombre));
+        t->nucleo = nucleo == tskNO_AFFINITY ? -1 : (int) nucleo;
+        t->prioridad = actuales[i].uxCurrentPriority;
+        t->uso_x10 = (uint16_t) ((uint64_t) usado * 1000 / intervalo);
+        t->stack_libre = actuales[i].usStackHighWaterMark;
+
+        // Uso de cada núcleo = 100% - lo que corrió su tarea IDLE
+        for (int c = 0; c < configNUMBER_OF_CORES; c++) {
+            if (actuales[i].xHandle == xTaskGetIdleTaskHandleForCore(c)) {
+                uso_nucleo_x10[c] = t->uso_x10 >= 1000 ? 0 : 1000 - t->uso_x10;
+            }
+        }
+    }
+    xSemaphoreGive(mutex_reporte);
+
+    memcpy(previas, actuales, sizeof(TaskStatus_t) * n);
+    num_previas = n;
+    total_previo = total;
+    if (primero) return;  // La primera instantánea sólo fija la referencia
+
+    ESP_LOGI(TAG, "CPU0 %d.%d%%  CPU1 %d.%d%%  inferencia: %lu (prom %lu us, min %lu, max %lu)",
+             uso_nucleo_x10[0] / 10, uso_nucleo_x10[0] % 10,
+             uso_nucleo_x10[configNUMBER_OF_CORES - 1] / 10, uso_nucleo_x10[configNUMBER_OF_CORES - 1] % 10,
+             (unsigned long) latencia_reporte.n,
+             (unsigned long) (latencia_reporte.n ? latencia_reporte.suma_us / latencia_reporte.n : 0),
+             (unsigned long) latencia_reporte.min_us, (unsigned long) latencia_reporte.max_us);
+    for (int i = 0; i < num_reporte; i++) {
+        ESP_LOGI(TAG, "  %-16s núcleo %2d  prio %2u  %3d.%d%%  stack libre %lu",
+                 reporte[i].nombre, reporte[i].nucleo, (unsigned) reporte[i].prioridad,
+                 reporte[i].uso_x10 / 10, reporte[i].uso_x10 % 10, (unsigned long) reporte[i].stack_libre);
+    }
+}
+
+void uso_cpu_json(cJSON* destino) {
+    if (!mutex_reporte) return;
+
+    xSemaphoreTake(mutex_reporte, portMAX_DELAY);
+    cJSON* nucleos = cJSON_AddArrayToObject(destino, "nucleos");
+    for (int c = 0; c < configNUMBER_OF_CORES; c++) {
+        cJSON_AddItemToArray(nucleos, cJSON_CreateNumber(uso_nucleo_x10[c] / 10.0));
+    }
+    cJSON* tareas = cJSON_AddArrayToObject(destino, "tareas");
+    for (int i = 0; i < num_reporte; i++) {
+        cJSON* t = cJSON_CreateObject();
+        cJSON_AddStringToObject(t, "nombre", reporte[i].nombre);
+        cJSON_AddNumberToObject(t, "nucleo", reporte[i].nucleo);
+        cJSON_AddNumberToObject(t, "prioridad", reporte[i].prioridad);
+        cJSON_AddNumberToObject(t, "uso", reporte[i].uso_x10 / 10.0);
+        cJSON_AddNumberToObject(t, "stack_libre", reporte[i].stack_libre);
+        cJSON_AddItemToArray(tareas, t);
+    }
+    agregar_latencia_json(destino);
+    xSemaphoreGive(mutex_reporte);
+}
+
+#else  // Sin estadísticas de FreeRTOS: sólo latencia de inferencia
+
+void uso_cpu_reportar() {
+    cerrar_latencia();
+    ESP_LOGI(TAG, "Inferencia: %lu (min %lu us, max %lu us)", (unsigned long) latencia_reporte.n,
+             (unsigned long) latencia_reporte.min_us, (unsigned long) latencia_reporte.max_us);
+}
+
+void uso_cpu_json(cJSON* destino) {
+    agregar_latencia_json(destino);
+}
+
+#endif
+
+void task_uso_cpu(void *pvParameters) {
+    uint32_t periodo_s = (uint32_t) (uintptr_t) pvParameters;
+    uso_cpu_reportar();  // Referencia inicial
+    while (1) {
+        vTaskDelay(pdMS_TO_TICKS(periodo_s * 1000));
+        uso_cpu_reportar();
+    }
+}
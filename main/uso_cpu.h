@@ -0,0 +1,23 @@
+// uso_cpu.h - Reporte de uso de CPU por tarea y latencia de inferencia
+//
+// Compara dos instantáneas de las estadísticas de tiempo de ejecución de
+// FreeRTOS y calcula el porcentaje de un núcleo que usó cada tarea en el
+// intervalo. Sin CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS sólo se mide la
+// latencia de inferencia.
+
+#pragma once
+
+#include <stdint.h>
+#include "cJSON.h"
+
+// Registra la duración de un Invoke() (microsegundos)
+void uso_cpu_registrar_inferencia(uint32_t us);
+
+// Toma una instantánea, calcula el intervalo desde la anterior y lo registra en el log
+void uso_cpu_reportar();
+
+// Agrega el último reporte a `destino` (para /api/cpu)
+void uso_cpu_json(cJSON* destino);
+
+// Tarea que llama a uso_cpu_reportar() cada `pvParameters` segundos (uint32_t por valor)
+void task_uso_cpu(void *pvParameters);
@@ -0,0 +1,1015 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * Host (Linux) micro-benchmark of the esp-nn kernels.
+ *
+ * Every shape runs each variant of its kernel that builds on the host (ansi,
+ * the generic optimised one and, for conv, im2col and Winograd) and reports
+ * the time per call, the multiply-accumulates per second and the bytes the
+ * kernel has to move at least once. Outputs are compared with the ansi one.
+ *
+ * Shapes come from a built-in table and/or from a file (see README.md).
+ * Numbers are only meaningful to compare runs on the same machine: the ESP32
+ * targets use their own code paths and memories.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <esp_nn.h>
+
+#define BENCH_MAX_SHAPES    256
+#define BENCH_NAME_LEN      32
+
+typedef enum {
+    BENCH_CONV = 0,
+    BENCH_DEPTHWISE,
+    BENCH_FC,
+    BENCH_MAX_POOL,
+    BENCH_AVG_POOL,
+    BENCH_SOFTMAX,
+    BENCH_ADD,
+    BENCH_MUL,
+    BENCH_RELU,
+    BENCH_OP_COUNT
+} bench_op_t;
+
+static const char *bench_op_names[BENCH_OP_COUNT] = {
+    "conv", "depthwise", "fc", "max_pool", "avg_pool", "softmax", "add", "mul", "relu"
+};
+
+/**
+ * @brief one kernel call
+ *
+ * @note  activations are NHWC with N = 1. fc uses in_ht * in_wd * in_ch as
+ *        row length, softmax in_ch as row length and the rest as rows, and
+ *        the elementwise kernels the whole input.
+ *        `out_ch` is the output channels of conv and fc, the channel
+ *        multiplier of depthwise.
+ */
+typedef struct {
+    bench_op_t op;
+    char name[BENCH_NAME_LEN];
+    int32_t in_ht, in_wd, in_ch;
+    int32_t filter_ht, filter_wd;
+    int32_t out_ch;
+    int32_t stride_ht, stride_wd;
+    int32_t pad_ht, pad_wd;
+    int32_t out_ht, out_wd;     /* 0: derived from the rest */
+} bench_shape_t;
+
+#define CONV(n, h, w, c, fh, fw, oc, s, p) \
+    {BENCH_CONV, n, h, w, c, fh, fw, oc, s, s, p, p, 0, 0}
+#define DEPTHWISE(n, h, w, c, fh, fw, m, s, p) \
+    {BENCH_DEPTHWISE, n, h, w, c, fh, fw, m, s, s, p, p, 0, 0}
+#define FC(n, len, oc) \
+    {BENCH_FC, n, 1, 1, len, 1, 1, oc, 1, 1, 0, 0, 0, 0}
+#define POOL(op, n, h, w, c, f, s) \
+    {op, n, h, w, c, f, f, 0, s, s, 0, 0, 0, 0}
+#define ROWS(op, n, rows, len) \
+    {op, n, 1, rows, len, 1, 1, 0, 1, 1, 0, 0, 0, 0}
+
+/* the README tables, the layers of a small keyword spotting model and a few
+ * mobilenet-like ones */
+static const bench_shape_t bench_default_shapes[] = {
+    CONV("readme_1x1_64", 10, 10, 64, 1, 1, 64, 1, 0),
+    CONV("readme_1x1_16", 8, 8, 16, 1, 1, 16, 1, 0),
+    CONV("readme_3x3_3", 10, 10, 3, 3, 3, 64, 1, 0),
+    CONV("kws_conv1", 44, 13, 1, 3, 3, 32, 1, 0),
+    CONV("kws_conv2", 21, 5, 32, 3, 3, 64, 1, 0),
+    CONV("stem_3x3_s2", 48, 48, 3, 3, 3, 16, 2, 1),
+    CONV("pointwise_32_64", 12, 12, 32, 1, 1, 64, 1, 0),
+    CONV("conv_3x3_32_32", 12, 12, 32, 3, 3, 32, 1, 1),
+    DEPTHWISE("readme_3x3_16", 18, 18, 16, 3, 3, 1, 1, 0),
+    DEPTHWISE("readme_5x5_mult8", 12, 12, 4, 5, 5, 8, 1, 1),
+    DEPTHWISE("dw_3x3_32", 24, 24, 32, 3, 3, 1, 1, 1),
+    DEPTHWISE("dw_3x3_64_s2", 24, 24, 64, 3, 3, 1, 2, 1),
+    FC("readme_265_3", 265, 3),
+    FC("kws_fc1", 576, 128),
+    FC("kws_fc2", 128, 5),
+    FC("fc_1024_256", 1024, 256),
+    POOL(BENCH_MAX_POOL, "readme_3x3", 16, 16, 16, 3, 1),
+    POOL(BENCH_MAX_POOL, "kws_pool1", 42, 11, 32, 2, 2),
+    POOL(BENCH_AVG_POOL, "readme_3x3", 16, 16, 16, 3, 1),
+    POOL(BENCH_AVG_POOL, "global_6x6_64", 6, 6, 64, 6, 6),
+    ROWS(BENCH_SOFTMAX, "kws_5", 1, 5),
+    ROWS(BENCH_SOFTMAX, "rows_8x32", 8, 32),
+    ROWS(BENCH_SOFTMAX, "classes_1000", 1, 1000),
+    ROWS(BENCH_ADD, "readme_1615", 1, 1615),
+    ROWS(BENCH_ADD, "residual_4096", 1, 4096),
+    ROWS(BENCH_MUL, "readme_1615", 1, 1615),
+    ROWS(BENCH_MUL, "gate_4096", 1, 4096),
+    ROWS(BENCH_RELU, "readme_1615", 1, 1615),
+    ROWS(BENCH_RELU, "act_4096", 1, 4096),
+};
+
+/**
+ * @brief buffers and parameters of the shape being measured
+ */
+typedef struct {
+    const bench_shape_t *shape;
+    data_dims_t input_dims;
+    data_dims_t filter_dims;
+    data_dims_t output_dims;
+    conv_params_t conv_params;
+    dw_conv_params_t dw_params;
+    quant_data_t quant_data;
+    int8_t *input;
+    int8_t *input2;
+    int8_t *filter;
+    int8_t *output;
+    int32_t *bias;
+    int32_t *shift;
+    int32_t *mult;
+    void *scratch;
+    int32_t in_size;
+    int32_t filter_size;
+    int32_t out_size;
+    int32_t channels;           /* output channels, for the per channel data */
+} bench_ctx_t;
+
+typedef struct {
+    const char *name;
+    /* scratch bytes, -1 if the variant does not handle the shape */
+    int (*scratch_size)(const bench_ctx_t *ctx);
+    void (*run)(bench_ctx_t *ctx);
+} bench_variant_t;
+
+static int no_scratch(const bench_ctx_t *ctx)
+{
+    (void) ctx;
+    return 0;
+}
+
+/************************** Convolution *****************************/
+
+static int conv_scratch_ansi(const bench_ctx_t *ctx)
+{
+    return esp_nn_get_conv_scratch_size_ansi(&ctx->input_dims, &ctx->filter_dims,
+                                             &ctx->output_dims, &ctx->conv_params);
+}
+
+static int conv_scratch_opt(const bench_ctx_t *ctx)
+{
+    return esp_nn_get_conv_scratch_size_opt(&ctx->input_dims, &ctx->filter_dims,
+                                            &ctx->output_dims, &ctx->conv_params);
+}
+
+static int conv_scratch_im2col(const bench_ctx_t *ctx)
+{
+    return esp_nn_get_conv_im2col_scratch_size_opt(&ctx->input_dims, &ctx->filter_dims,
+                                                   &ctx->output_dims, &ctx->conv_params);
+}
+
+static int conv_scratch_winograd(const bench_ctx_t *ctx)
+{
+    /* 0 means the shape is not supported */
+    const int size = esp_nn_get_conv_winograd_scratch_size_opt(&ctx->input_dims, &ctx->filter_dims,
+                                                               &ctx->output_dims, &ctx->conv_params);
+    return size > 0 ? size : -1;
+}
+
+static void conv_run_ansi(bench_ctx_t *ctx)
+{
+    esp_nn_conv_s8_r_ansi(&ctx->input_dims, ctx->input, &ctx->filter_dims, ctx->filter, ctx->bias,
+                          &ctx->output_dims, ctx->output, &ctx->conv_params, &ctx->quant_data,
+                          ctx->scratch);
+}
+
+static void conv_run_opt(bench_ctx_t *ctx)
+{
+    esp_nn_conv_s8_r_opt(&ctx->input_dims, ctx->input, &ctx->filter_dims, ctx->filter, ctx->bias,
+                         &ctx->output_dims, ctx->output, &ctx->conv_params, &ctx->quant_data,
+                         ctx->scratch);
+}
+
+static void conv_run_im2col(bench_ctx_t *ctx)
+{
+    esp_nn_conv_im2col_s8_r_opt(&ctx->input_dims, ctx->input, &ctx->filter_dims, ctx->filter,
+                                ctx->bias, &ctx->output_dims, ctx->output, &ctx->conv_params,
+                                &ctx->quant_data, ctx->scratch);
+}
+
+static void conv_run_winograd(bench_ctx_t *ctx)
+{
+    esp_nn_conv_winograd_s8_r_opt(&ctx->input_dims, ctx->input, &ctx->filter_dims, ctx->filter,
+                                  ctx->bias, &ctx->output_dims, ctx->output, &ctx->conv_params,
+                                  &ctx->quant_data, ctx->scratch);
+}
+
+/************************** Depthwise convolution *****************************/
+
+static int depthwise_scratch_ansi(const bench_ctx_t *ctx)
+{
+    return esp_nn_get_depthwise_conv_scratch_size_ansi(&ctx->input_dims, &ctx->filter_dims,
+                                                       &ctx->output_dims, &ctx->dw_params);
+}
+
+static int depthwise_scratch_opt(const bench_ctx_t *ctx)
+{
+    return esp_nn_get_depthwise_conv_scratch_size_opt(&ctx->input_dims, &ctx->filter_dims,
+                                                      &ctx->output_dims, &ctx->dw_params);
+}
+
+static void depthwise_run_ansi(bench_ctx_t *ctx)
+{
+    esp_nn_depthwise_conv_s8_r_ansi(&ctx->input_dims, ctx->input, &ctx->filter_dims, ctx->filter,
+                                    ctx->bias, &ctx->output_dims, ctx->output, &ctx->dw_params,
+                                    &ctx->quant_data, ctx->scratch);
+}
+
+static void depthwise_run_opt(bench_ctx_t *ctx)
+{
+    esp_nn_depthwise_conv_s8_r_opt(&ctx->input_dims, ctx->input, &ctx->filter_dims, ctx->filter,
+                                   ctx->bias, &ctx->output_dims, ctx->output, &ctx->dw_params,
+                                   &ctx->quant_data, ctx->scratch);
+}
+
+/************************** Fully connected *****************************/
+
+static void fc_run_ansi(bench_ctx_t *ctx)
+{
+    esp_nn_fully_connected_s8_ansi(ctx->input, 3, ctx->in_size, ctx->filter, 0, ctx->bias,
+                                   ctx->output, ctx->channels, -5, ctx->shift[0], ctx->mult[0],
+                                   -128, 127);
+}
+
+static void fc_run_opt(bench_ctx_t *ctx)
+{
+    esp_nn_fully_connected_s8_opt(ctx->input, 3, ctx->in_size, ctx->filter, 0, ctx->bias,
+                                  ctx->output, ctx->channels, -5, ctx->shift[0], ctx->mult[0],
+                                  -128, 127);
+}
+
+/************************** Pooling *****************************/
+
+#define POOL_ARGS(ctx)  (ctx)->input, (ctx)->input_dims.width, (ctx)->input_dims.height,         \
+                        (ctx)->output, (ctx)->output_dims.width, (ctx)->output_dims.height,      \
+                        (ctx)->shape->stride_wd, (ctx)->shape->stride_ht,                        \
+                        (ctx)->shape->filter_wd, (ctx)->shape->filter_ht,                        \
+                        (ctx)->shape->pad_wd, (ctx)->shape->pad_ht, -128, 127,                   \
+                        (ctx)->input_dims.channels
+
+static void max_pool_run_ansi(bench_ctx_t *ctx)
+{
+    esp_nn_max_pool_s8_ansi(POOL_ARGS(ctx));
+}
+
+static void max_pool_run_opt(bench_ctx_t *ctx)
+{
+    esp_nn_max_pool_s8_opt(POOL_ARGS(ctx));
+}
+
+static void avg_pool_run_ansi(bench_ctx_t *ctx)
+{
+    esp_nn_avg_pool_s8_ansi(POOL_ARGS(ctx));
+}
+
+static void avg_pool_run_opt(bench_ctx_t *ctx)
+{
+    esp_nn_avg_pool_s8_opt(POOL_ARGS(ctx));
+}
+
+/************************** Softmax *****************************/
+
+static int softmax_scratch_ansi(const bench_ctx_t *ctx)
+{
+    return esp_nn_get_softmax_scratch_size_ansi(ctx->input_dims.channels,
+                                                ctx->in_size / ctx->input_dims.channels);
+}
+
+static int softmax_scratch_opt(const bench_ctx_t *ctx)
+{
+    return esp_nn_get_softmax_scratch_size_opt(ctx->input_dims.channels,
+                                               ctx->in_size / ctx->input_dims.channels);
+}
+
+static void softmax_run_ansi(bench_ctx_t *ctx)
+{
+    esp_nn_softmax_s8_r_ansi(ctx->input, ctx->in_size / ctx->input_dims.channels,
+                             ctx->input_dims.channels, INT32_MAX / 2, 7, -128, ctx->output,
+                             ctx->scratch);
+}
+
+static void softmax_run_opt(bench_ctx_t *ctx)
+{
+    esp_nn_softmax_s8_r_opt(ctx->input, ctx->in_size / ctx->input_dims.channels,
+                            ctx->input_dims.channels, INT32_MAX / 2, 7, -128, ctx->output,
+                            ctx->scratch);
+}
+
+/************************** Elementwise *****************************/
+
+/* add, mul and relu only have an ansi version and the ESP32-S3 assembly */
+
+static void add_run_ansi(bench_ctx_t *ctx)
+{
+    esp_nn_add_elementwise_s8_ansi(ctx->input, ctx->input2, 34, 35, INT32_MAX, INT32_MAX, -8, -8,
+                                   15, ctx->output, 36, INT32_MAX, -9, -128, 127, ctx->in_size);
+}
+
+static void mul_run_ansi(bench_ctx_t *ctx)
+{
+    esp_nn_mul_elementwise_s8_ansi(ctx->input, ctx->input2, 34, 35, ctx->output, 36, INT32_MAX, -7,
+                                   -128, 127, ctx->in_size);
+}
+
+static void relu_run_ansi(bench_ctx_t *ctx)
+{
+    /* in place: after the first call the data is already clamped, which does
+     * not change the work done */
+    esp_nn_relu6_s8_ansi(ctx->output, ctx->in_size);
+}
+
+/* the first variant of each op is the reference */
+static const bench_variant_t conv_variants[] = {
+    {"ansi", conv_scratch_ansi, conv_run_ansi},
+    {"opt", conv_scratch_opt, conv_run_opt},
+    {"im2col", conv_scratch_im2col, conv_run_im2col},
+    {"winograd", conv_scratch_winograd, conv_run_winograd},
+    {NULL},
+};
+
+static const bench_variant_t depthwise_variants[] = {
+    {"ansi", depthwise_scratch_ansi, depthwise_run_ansi},
+    {"opt", depthwise_scratch_opt, depthwise_run_opt},
+    {NULL},
+};
+
+static const bench_variant_t fc_variants[] = {
+    {"ansi", no_scratch, fc_run_ansi},
+    {"opt", no_scratch, fc_run_opt},
+    {NULL},
+};
+
+static const bench_variant_t max_pool_variants[] = {
+    {"ansi", no_scratch, max_pool_run_ansi},
+    {"opt", no_scratch, max_pool_run_opt},
+    {NULL},
+};
+
+static const bench_variant_t avg_pool_variants[] = {
+    {"ansi", no_scratch, avg_pool_run_ansi},
+    {"opt", no_scratch, avg_pool_run_opt},
+    {NULL},
+};
+
+static const bench_variant_t softmax_variants[] = {
+    {"ansi", softmax_scratch_ansi, softmax_run_ansi},
+    {"opt", softmax_scratch_opt, softmax_run_opt},
+    {NULL},
+};
+
+static const bench_variant_t add_variants[] = {
+    {"ansi", no_scratch, add_run_ansi},
+    {NULL},
+};
+
+static const bench_variant_t mul_variants[] = {
+    {"ansi", no_scratch, mul_run_ansi},
+    {NULL},
+};
+
+static const bench_variant_t relu_variants[] = {
+    {"ansi", no_scratch, relu_run_ansi},
+    {NULL},
+};
+
+static const bench_variant_t *bench_variants[BENCH_OP_COUNT] = {
+    conv_variants, depthwise_variants, fc_variants, max_pool_variants, avg_pool_variants,
+    softmax_variants, add_variants, mul_variants, relu_variants
+};
+
+/************************** Shapes *****************************/
+
+static int32_t out_dim(int32_t in, int32_t filter, int32_t stride, int32_t pad)
+{
+    return (in + 2 * pad - filter) / stride + 1;
+}
+
+/**
+ * @brief fill in the output size and check the limits of the kernel arguments
+ *
+ * @return NULL if the shape is valid, the reason otherwise
+ */
+static const char *shape_finish(bench_shape_t *s)
+{
+    if (s->in_ht <= 0 || s->in_wd <= 0 || s->in_ch <= 0 || s->filter_ht <= 0 ||
+            s->filter_wd <= 0 || s->stride_ht <= 0 || s->stride_wd <= 0 ||
+            s->pad_ht < 0 || s->pad_wd < 0) {
+        return "sizes must be positive";
+    }
+    switch (s->op) {
+    case BENCH_CONV:
+    case BENCH_DEPTHWISE:
+    case BENCH_MAX_POOL:
+    case BENCH_AVG_POOL:
+        if (s->out_ht == 0) {
+            s->out_ht = out_dim(s->in_ht, s->filter_ht, s->stride_ht, s->pad_ht);
+        }
+        if (s->out_wd == 0) {
+            s->out_wd = out_dim(s->in_wd, s->filter_wd, s->stride_wd, s->pad_wd);
+        }
+        if (s->out_ht <= 0 || s->out_wd <= 0) {
+            return "filter larger than the padded input";
+        }
+        if (s->op == BENCH_DEPTHWISE && s->out_ch <= 0) {
+            s->out_ch = 1;
+        }
+        if ((s->op == BENCH_CONV && s->out_ch <= 0) ||
+                (s->op >= BENCH_MAX_POOL && (s->in_ht > UINT16_MAX || s->in_wd > UINT16_MAX ||
+                                             s->in_ch > UINT16_MAX))) {
+            return "bad channels";
+        }
+        break;
+    case BENCH_FC:
+        if (s->out_ch <= 0 || s->out_ch > UINT16_MAX ||
+                (int64_t) s->in_ht * s->in_wd * s->in_ch > UINT16_MAX) {
+            return "fc row length and channels are limited to 65535";
+        }
+        break;
+    case BENCH_RELU:
+        if ((int64_t) s->in_ht * s->in_wd * s->in_ch > UINT16_MAX) {
+            return "relu size is limited to 65535";
+        }
+        break;
+    default:
+        break;
+    }
+    return NULL;
+}
+
+/* "12", "12x5" or "12x5x3" into `n` values, missing leading ones set to `fill` */
+static bool parse_dims(const char *text, int32_t *out, int n, int32_t fill)
+{
+    int32_t v[3];
+    int count = 0;
+    const char *p = text;
+    for (;;) {
+        char *end;
+        errno = 0;
+        const long x = strtol(p, &end, 10);
+        if (end == p || errno != 0 || x < 0 || x > INT32_MAX || count == n) {
+            return false;
+        }
+        v[count++] = (int32_t) x;
+        if (*end == '\0') {
+            break;
+        }
+        if (*end != 'x') {
+            return false;
+        }
+        p = end + 1;
+    }
+    for (int i = 0; i < n; i++) {
+        out[i] = i < n - count ? fill : v[i - (n - count)];
+    }
+    return true;
+}
+
+/**
+ * @brief read a shape file: one kernel per line, `#` starts a comment
+ *
+ *        <op> <name> [in=HxWxC] [filter=HxW] [out=N] [mult=N] [stride=HxW]
+ *                    [pad=HxW] [out_hw=HxW]
+ *
+ *        missing leading dims of `in` are 1, a single value for filter,
+ *        stride or pad is used for both
+ *
+ * @return number of shapes appended to `shapes`, -1 on error
+ */
+static int read_shapes(const char *path, bench_shape_t *shapes, int max)
+{
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    char line[512];
+    int count = 0;
+    int line_no = 0;
+    while (fgets(line, sizeof(line), f) != NULL) {
+        line_no++;
+        char *comment = strchr(line, '#');
+        if (comment) {
+            *comment = '\0';
+        }
+        char *save;
+        char *tok = strtok_r(line, " \t\r\n", &save);
+        if (tok == NULL) {
+            continue;
+        }
+        if (count == max) {
+            fprintf(stderr, "%s: more than %d shapes\n", path, max);
+            goto err;
+        }
+        bench_shape_t s = {.in_ht = 1, .in_wd = 1, .in_ch = 1, .filter_ht = 1, .filter_wd = 1,
+                           .stride_ht = 1, .stride_wd = 1};
+        int op;
+        for (op = 0; op < BENCH_OP_COUNT && strcmp(tok, bench_op_names[op]); op++);
+        if (op == BENCH_OP_COUNT) {
+            fprintf(stderr, "%s:%d: unknown op '%s'\n", path, line_no, tok);
+            goto err;
+        }
+        s.op = (bench_op_t) op;
+
+        tok = strtok_r(NULL, " \t\r\n", &save);
+        if (tok == NULL || strchr(tok, '=') != NULL) {
+            fprintf(stderr, "%s:%d: missing name\n", path, line_no);
+            goto err;
+        }
+        /* names go to the JSON output as they are */
+        for (int i = 0; i < BENCH_NAME_LEN - 1 && tok[i]; i++) {
+            const char c = tok[i];
+            const bool plain = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+                               (c >= '0' && c <= '9') || c == '_' || c == '-' || c == '.';
+            s.name[i] = plain ? c : '_';
+        }
+
+        while ((tok = strtok_r(NULL, " \t\r\n", &save)) != NULL) {
+            char *value = strchr(tok, '=');
+            bool ok = value != NULL;
+            if (ok) {
+                *value++ = '\0';
+                int32_t d[3];
+                if (!strcmp(tok, "in")) {
+                    ok = parse_dims(value, d, 3, 1);
+                    s.in_ht = d[0], s.in_wd = d[1], s.in_ch = d[2];
+                } else if (!strcmp(tok, "filter")) {
+                    ok = parse_dims(value, d, 2, -1);
+                    s.filter_ht = d[0] < 0 ? d[1] : d[0], s.filter_wd = d[1];
+                } else if (!strcmp(tok, "stride")) {
+                    ok = parse_dims(value, d, 2, -1);
+                    s.stride_ht = d[0] < 0 ? d[1] : d[0], s.stride_wd = d[1];
+                } else if (!strcmp(tok, "pad")) {
+                    ok = parse_dims(value, d, 2, -1);
+                    s.pad_ht = d[0] < 0 ? d[1] : d[0], s.pad_wd = d[1];
+                } else if (!strcmp(tok, "out_hw")) {
+                    ok = parse_dims(value, d, 2, -1) && d[0] >= 0;
+                    s.out_ht = d[0], s.out_wd = d[1];
+                } else if (!strcmp(tok, "out") || !strcmp(tok, "mult")) {
+                    ok = parse_dims(value, d, 1, 0);
+                    s.out_ch = d[0];
+                } else {
+                    ok = false;
+                }
+            }
+            if (!ok) {
+                fprintf(stderr, "%s:%d: bad parameter '%s'\n", path, line_no, tok);
+                goto err;
+            }
+        }
+        const char *reason = shape_finish(&s);
+        if (reason) {
+            fprintf(stderr, "%s:%d: %s\n", path, line_no, reason);
+            goto err;
+        }
+        shapes[count++] = s;
+    }
+    fclose(f);
+    return count;
+
+err:
+    fclose(f);
+    return -1;
+}
+
+static void shape_describe(const bench_shape_t *s, char *buf, size_t len)
+{
+    switch (s->op) {
+    case BENCH_CONV:
+    case BENCH_DEPTHWISE:
+        snprintf(buf, len, "%dx%dx%d f%dx%d s%dx%d p%dx%d %s%d", s->in_ht, s->in_wd, s->in_ch,
+                 s->filter_ht, s->filter_wd, s->stride_ht, s->stride_wd, s->pad_ht, s->pad_wd,
+                 s->op == BENCH_CONV ? "-> " : "* ", s->out_ch);
+        break;
+    case BENCH_MAX_POOL:
+    case BENCH_AVG_POOL:
+        snprintf(buf, len, "%dx%dx%d f%dx%d s%dx%d p%dx%d", s->in_ht, s->in_wd, s->in_ch,
+                 s->filter_ht, s->filter_wd, s->stride_ht, s->stride_wd, s->pad_ht, s->pad_wd);
+        break;
+    case BENCH_FC:
+        snprintf(buf, len, "%d -> %d", s->in_ht * s->in_wd * s->in_ch, s->out_ch);
+        break;
+    case BENCH_SOFTMAX:
+        snprintf(buf, len, "%d x %d", s->in_ht * s->in_wd, s->in_ch);
+        break;
+    default:
+        snprintf(buf, len, "%d", s->in_ht * s->in_wd * s->in_ch);
+        break;
+    }
+}
+
+/**
+ * @brief work of one call: multiply-accumulates for conv, depthwise and fc,
+ *        window elements for pooling, elements otherwise
+ */
+static uint64_t shape_macs(const bench_shape_t *s)
+{
+    const uint64_t in = (uint64_t) s->in_ht * s->in_wd * s->in_ch;
+    const uint64_t out_pixels = (uint64_t) s->out_ht * s->out_wd;
+    const uint64_t window = (uint64_t) s->filter_ht * s->filter_wd;
+    switch (s->op) {
+    case BENCH_CONV:
+        return out_pixels * s->out_ch * window * s->in_ch;
+    case BENCH_DEPTHWISE:
+        return out_pixels * s->in_ch * s->out_ch * window;
+    case BENCH_FC:
+        return in * s->out_ch;
+    case BENCH_MAX_POOL:
+    case BENCH_AVG_POOL:
+        return out_pixels * s->in_ch * window;
+    default:
+        return in;
+    }
+}
+
+/**
+ * @brief bytes a call has to read or write at least once: activations,
+ *        weights, bias and per channel quantisation
+ */
+static uint64_t shape_bytes(const bench_ctx_t *ctx)
+{
+    const bench_shape_t *s = ctx->shape;
+    switch (s->op) {
+    case BENCH_CONV:
+    case BENCH_DEPTHWISE:
+        return ctx->in_size + ctx->filter_size + ctx->out_size + 12 * ctx->channels;
+    case BENCH_FC:
+        return ctx->in_size + ctx->filter_size + ctx->out_size + 4 * ctx->channels;
+    case BENCH_ADD:
+    case BENCH_MUL:
+        return 3 * ctx->in_size;
+    case BENCH_RELU:
+        return 2 * ctx->in_size;
+    default:
+        return ctx->in_size + ctx->out_size;
+    }
+}
+
+/************************** Measurement *****************************/
+
+static void *bench_alloc(size_t size)
+{
+    /* 16 byte aligned, as the tests do */
+    return aligned_alloc(16, (size + 15) & ~(size_t) 15);
+}
+
+static void fill_s8(int8_t *data, int32_t size)
+{
+    for (int32_t i = 0; i < size; i++) {
+        data[i] = rand() % 256 - 128;
+    }
+}
+
+static void ctx_free(bench_ctx_t *ctx)
+{
+    free(ctx->input);
+    free(ctx->input2);
+    free(ctx->filter);
+    free(ctx->output);
+    free(ctx->bias);
+    free(ctx->shift);
+    free(ctx->mult);
+    free(ctx->scratch);
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+static bool ctx_init(bench_ctx_t *ctx, const bench_shape_t *s)
+{
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->shape = s;
+    ctx->in_size = s->in_ht * s->in_wd * s->in_ch;
+    ctx->input_dims = (data_dims_t) {.width = s->in_wd, .height = s->in_ht, .channels = s->in_ch, 1};
+    ctx->filter_dims = (data_dims_t) {.width = s->filter_wd, .height = s->filter_ht, 0, 0};
+
+    switch (s->op) {
+    case BENCH_CONV:
+        ctx->channels = s->out_ch;
+        ctx->filter_size = ctx->channels * s->filter_ht * s->filter_wd * s->in_ch;
+        break;
+    case BENCH_DEPTHWISE:
+        ctx->channels = s->in_ch * s->out_ch;
+        ctx->filter_size = ctx->channels * s->filter_ht * s->filter_wd;
+        break;
+    case BENCH_FC:
+        ctx->channels = s->out_ch;
+        ctx->filter_size = ctx->channels * ctx->in_size;
+        break;
+    default:
+        ctx->channels = s->in_ch;
+        break;
+    }
+    switch (s->op) {
+    case BENCH_CONV:
+    case BENCH_DEPTHWISE:
+    case BENCH_MAX_POOL:
+    case BENCH_AVG_POOL:
+        ctx->output_dims = (data_dims_t) {.width = s->out_wd, .height = s->out_ht,
+                                          .channels = ctx->channels, 1};
+        ctx->out_size = s->out_ht * s->out_wd * ctx->channels;
+        break;
+    case BENCH_FC:
+        ctx->out_size = ctx->channels;
+        break;
+    default:
+        ctx->out_size = ctx->in_size;
+        break;
+    }
+
+    ctx->conv_params = (conv_params_t) {.in_offset = 3, .out_offset = -5,
+                                        .stride = {s->stride_wd, s->stride_ht},
+                                        .padding = {s->pad_wd, s->pad_ht}, .dilation = {1, 1},
+                                        .activation = {-128, 127}};
+    ctx->dw_params = (dw_conv_params_t) {.in_offset = 3, .out_offset = -5, .ch_mult = s->out_ch,
+                                         .stride = {s->stride_wd, s->stride_ht},
+                                         .padding = {s->pad_wd, s->pad_ht}, .dilation = {1, 1},
+                                         .activation = {-128, 127}};
+
+    ctx->input = bench_alloc(ctx->in_size);
+    ctx->input2 = bench_alloc(ctx->in_size);
+    ctx->filter = bench_alloc(ctx->filter_size + 1);
+    ctx->output = bench_alloc(ctx->out_size);
+    ctx->bias = bench_alloc(sizeof(int32_t) * ctx->channels);
+    ctx->shift = bench_alloc(sizeof(int32_t) * ctx->channels);
+    ctx->mult = bench_alloc(sizeof(int32_t) * ctx->channels);
+    if (!ctx->input || !ctx->input2 || !ctx->filter || !ctx->output || !ctx->bias ||
+            !ctx->shift || !ctx->mult) {
+        return false;
+    }
+    fill_s8(ctx->input, ctx->in_size);
+    fill_s8(ctx->input2, ctx->in_size);
+    fill_s8(ctx->filter, ctx->filter_size);
+    if (s->op == BENCH_RELU) {
+        memcpy(ctx->output, ctx->input, ctx->in_size);
+    }
+    /* same ranges as the tests */
+    for (int32_t i = 0; i < ctx->channels; i++) {
+        ctx->bias[i] = (int32_t) rand() % UINT16_MAX + UINT8_MAX;
+        ctx->shift[i] = -10 + rand() % 2;
+        ctx->mult[i] = 0x7f67f4f8 + rand() % 50;
+    }
+    ctx->quant_data = (quant_data_t) {.shift = ctx->shift, .mult = ctx->mult};
+    return true;
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    const double x = *(const double *) a, y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief time `run`: the number of calls per batch doubles until a batch
+ *        lasts min_ms / reps, then `reps` batches are measured
+ *
+ * @return median time per call in ns; `*best` gets the fastest batch
+ */
+static double measure(const bench_variant_t *v, bench_ctx_t *ctx, double min_ms, int reps,
+                      double *best)
+{
+    const uint64_t target = (uint64_t) (min_ms * 1e6 / reps);
+    uint64_t calls = 1;
+    v->run(ctx);    /* warm up caches and branch predictors */
+    for (;;) {
+        const uint64_t start = now_ns();
+        for (uint64_t i = 0; i < calls; i++) {
+            v->run(ctx);
+        }
+        if (now_ns() - start >= target || calls >= (1u << 30)) {
+            break;
+        }
+        calls *= 2;
+    }
+
+    double per_call[reps];
+    for (int r = 0; r < reps; r++) {
+        const uint64_t start = now_ns();
+        for (uint64_t i = 0; i < calls; i++) {
+            v->run(ctx);
+        }
+        per_call[r] = (double) (now_ns() - start) / calls;
+    }
+    qsort(per_call, reps, sizeof(double), cmp_double);
+    *best = per_call[0];
+    return per_call[reps / 2];
+}
+
+typedef struct {
+    double min_ms;
+    int reps;
+    FILE *json;
+    bool table;
+    int op_filter;              /* -1: all */
+    int results;
+} bench_opts_t;
+
+static void json_result(bench_opts_t *o, const bench_shape_t *s, const char *shape_text,
+                        const char *variant, double ns, double ns_min, uint64_t macs,
+                        uint64_t bytes, bool match)
+{
+    fprintf(o->json, "%s\n    {\"op\": \"%s\", \"name\": \"%s\", \"shape\": \"%s\", "
+            "\"variant\": \"%s\", \"ns_per_op\": %.1f, \"ns_min\": %.1f, \"macs\": %llu, "
+            "\"macs_per_s\": %.4g, \"bytes\": %llu, \"bytes_per_s\": %.4g, \"match\": %s}",
+            o->results ? "," : "", bench_op_names[s->op], s->name, shape_text, variant, ns,
+            ns_min, (unsigned long long) macs, macs * 1e9 / ns, (unsigned long long) bytes,
+            bytes * 1e9 / ns, match ? "true" : "false");
+    o->results++;
+}
+
+/**
+ * @return number of variants whose output differs from the ansi one, -1 if
+ *         the buffers could not be allocated
+ */
+static int bench_shape(bench_opts_t *o, const bench_shape_t *s)
+{
+    bench_ctx_t ctx;
+    char shape_text[96];
+    int mismatches = 0;
+    int8_t *reference = NULL;
+    double ansi_ns = 0;
+
+    shape_describe(s, shape_text, sizeof(shape_text));
+    if (!ctx_init(&ctx, s) || (reference = malloc(ctx.out_size)) == NULL) {
+        fprintf(stderr, "%s %s: allocation failed\n", bench_op_names[s->op], s->name);
+        ctx_free(&ctx);
+        return -1;
+    }
+
+    const uint64_t macs = shape_macs(s);
+    const uint64_t bytes = shape_bytes(&ctx);
+    for (const bench_variant_t *v = bench_variants[s->op]; v->name; v++) {
+        const int scratch_size = v->scratch_size(&ctx);
+        if (scratch_size < 0) {
+            continue;
+        }
+        free(ctx.scratch);
+        ctx.scratch = scratch_size ? bench_alloc(scratch_size) : NULL;
+        if (scratch_size && ctx.scratch == NULL) {
+            fprintf(stderr, "%s %s: scratch allocation failed\n", bench_op_names[s->op], s->name);
+            mismatches = -1;
+            break;
+        }
+
+        const bool in_place = s->op == BENCH_RELU;
+        if (!in_place) {
+            memset(ctx.output, 0, ctx.out_size);
+        }
+        double ns_min;
+        const double ns = measure(v, &ctx, o->min_ms, o->reps, &ns_min);
+        bool match = true;
+        if (v == bench_variants[s->op]) {
+            memcpy(reference, ctx.output, ctx.out_size);
+            ansi_ns = ns;
+        } else {
+            match = in_place || memcmp(reference, ctx.output, ctx.out_size) == 0;
+        }
+        mismatches += !match;
+
+        if (o->table) {
+            printf("%-10s %-20s %-32s %-9s %12.1f %10.1f %10llu %7.2fx%s\n",
+                   bench_op_names[s->op], s->name, shape_text, v->name, ns, macs * 1e3 / ns,
+                   (unsigned long long) bytes, ansi_ns / ns, match ? "" : "  MISMATCH");
+        }
+        if (o->json) {
+            json_result(o, s, shape_text, v->name, ns, ns_min, macs, bytes, match);
+        }
+    }
+
+    free(reference);
+    ctx_free(&ctx);
+    return mismatches;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  --shapes FILE   add the shapes of FILE (see README.md)\n"
+            "  --no-builtin    skip the built-in shapes\n"
+            "  --op NAME       only this op (conv, depthwise, fc, max_pool, avg_pool,\n"
+            "                  softmax, add, mul, relu)\n"
+            "  --min-ms N      measuring time per variant, default 50\n"
+            "  --reps N        measured batches per variant (median reported), default 5\n"
+            "  --json FILE     write the results as JSON, '-' for stdout (no table)\n",
+            prog);
+}
+
+int main(int argc, char **argv)
+{
+    static bench_shape_t shapes[BENCH_MAX_SHAPES];
+    bench_opts_t opts = {.min_ms = 50, .reps = 5, .table = true, .op_filter = -1};
+    const char *json_path = NULL;
+    bool builtin = true;
+    int count = 0;
+    int ret = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *val = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!strcmp(arg, "--no-builtin")) {
+            builtin = false;
+            continue;
+        }
+        if (val == NULL) {
+            usage(argv[0]);
+            return 2;
+        }
+        i++;
+        if (!strcmp(arg, "--shapes")) {
+            const int n = read_shapes(val, shapes + count, BENCH_MAX_SHAPES - count);
+            if (n < 0) {
+                return 2;
+            }
+            count += n;
+        } else if (!strcmp(arg, "--op")) {
+            for (opts.op_filter = 0; opts.op_filter < BENCH_OP_COUNT &&
+                    strcmp(val, bench_op_names[opts.op_filter]); opts.op_filter++);
+            if (opts.op_filter == BENCH_OP_COUNT) {
+                usage(argv[0]);
+                return 2;
+            }
+        } else if (!strcmp(arg, "--min-ms")) {
+            opts.min_ms = atof(val);
+        } else if (!strcmp(arg, "--reps")) {
+            opts.reps = atoi(val);
+        } else if (!strcmp(arg, "--json")) {
+            json_path = val;
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (opts.min_ms <= 0 || opts.reps <= 0 || opts.reps > 1000) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    if (builtin) {
+        const int n = sizeof(bench_default_shapes) / sizeof(bench_default_shapes[0]);
+        if (count + n > BENCH_MAX_SHAPES) {
+            fprintf(stderr, "more than %d shapes\n", BENCH_MAX_SHAPES);
+            return 2;
+        }
+        /* built-in shapes go first */
+        memmove(shapes + n, shapes, count * sizeof(shapes[0]));
+        for (int i = 0; i < n; i++) {
+            shapes[i] = bench_default_shapes[i];
+            shape_finish(&shapes[i]);
+        }
+        count += n;
+    }
+
+    if (json_path) {
+        if (!strcmp(json_path, "-")) {
+            opts.json = stdout;
+            opts.table = false;
+        } else if ((opts.json = fopen(json_path, "w")) == NULL) {
+            fprintf(stderr, "%s: %s\n", json_path, strerror(errno));
+            return 2;
+        }
+        fprintf(opts.json, "{\n  \"min_ms\": %g,\n  \"reps\": %d,\n  \"compiler\": \"%s\",\n"
+                "  \"results\": [", opts.min_ms, opts.reps, __VERSION__);
+    }
+    if (opts.table) {
+        printf("%-10s %-20s %-32s %-9s %12s %10s %10s %8s\n", "op", "name", "shape", "variant",
+               "ns/op", "MMAC/s", "bytes", "vs ansi");
+    }
+
+    srand(1);
+    for (int i = 0; i < count; i++) {
+        if (opts.op_filter >= 0 && shapes[i].op != (bench_op_t) opts.op_filter) {
+            continue;
+        }
+        const int mismatches = bench_shape(&opts, &shapes[i]);
+        if (mismatches != 0) {
+            ret = 1;
+        }
+    }
+
+    if (opts.json) {
+        fprintf(opts.json, "\n  ]\n}\n");
+        if (opts.json != stdout) {
+            fclose(opts.json);
+        }
+    }
+    return ret;
+}
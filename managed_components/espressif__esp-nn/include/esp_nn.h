@@ -46,6 +46,12 @@ extern "C" {
 #include "esp_nn_ansi_c.h"
 #endif
 
+/* fused kernels, on top of the selection above */
+#include "esp_nn_fused.h"
+
+/* explicit variant selection, for per layer tuning */
+#include "esp_nn_variants.h"
+
 #ifdef __cplusplus
 }
 #endif
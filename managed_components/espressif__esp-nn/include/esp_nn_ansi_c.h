@@ -24,10 +24,17 @@
 
 #define esp_nn_add_elementwise_s8 esp_nn_add_elementwise_s8_ansi
 #define esp_nn_mul_elementwise_s8 esp_nn_mul_elementwise_s8_ansi
+#define esp_nn_quantize_s16_s8 esp_nn_quantize_s16_s8_ansi
 
 #define esp_nn_depthwise_conv_s8 esp_nn_depthwise_conv_s8_ansi
+#define esp_nn_depthwise_conv_s8_r esp_nn_depthwise_conv_s8_r_ansi
 
 #define esp_nn_conv_s8 esp_nn_conv_s8_ansi
+#define esp_nn_conv_s8_r esp_nn_conv_s8_r_ansi
+
+#define esp_nn_conv_s16_s8 esp_nn_conv_s16_s8_ansi
+#define esp_nn_conv_sparse_s8 esp_nn_conv_sparse_s8_ansi
+#define esp_nn_depthwise_conv_s16_s8 esp_nn_depthwise_conv_s16_s8_ansi
 
 #define esp_nn_get_conv_scratch_size esp_nn_get_conv_scratch_size_ansi
 #define esp_nn_set_conv_scratch_buf esp_nn_set_conv_scratch_buf_ansi
@@ -42,7 +49,10 @@
 
 #define esp_nn_fully_connected_s8 esp_nn_fully_connected_s8_ansi
 #define esp_nn_fully_connected_per_ch_s8 esp_nn_fully_connected_per_ch_s8_ansi
+#define esp_nn_fully_connected_s16_s8 esp_nn_fully_connected_s16_s8_ansi
+#define esp_nn_fully_connected_sparse_s8 esp_nn_fully_connected_sparse_s8_ansi
 
 #define esp_nn_get_softmax_scratch_size esp_nn_get_softmax_scratch_size_ansi
 #define esp_nn_set_softmax_scratch_buf esp_nn_set_softmax_scratch_buf_ansi
 #define esp_nn_softmax_s8 esp_nn_softmax_s8_ansi
+#define esp_nn_softmax_s8_r esp_nn_softmax_s8_r_ansi
@@ -65,6 +65,20 @@ void esp_nn_mul_elementwise_s8_ansi(const int8_t *input1_data,
                                     const int32_t activation_max,
                                     const int32_t size);
 
+/**
+ * @brief       quantize 16 bit samples to int8
+ *
+ * @note        inputs type: int16_t, output: int8_t
+ *              operation: out = sat8(multiply_by_quantized_mult(in) + out_offset)
+ *
+ *              out_shift is expected to be in [-31, 15]
+ */
+void esp_nn_quantize_s16_s8_ansi(const int16_t *input_data,
+                                 int8_t *output,
+                                 const int32_t out_offset,
+                                 const int32_t out_mult,
+                                 const int32_t out_shift,
+                                 const int32_t size);
 
 /************************** Convolution functions *****************************/
 
@@ -120,6 +134,83 @@ int esp_nn_get_depthwise_conv_scratch_size_ansi(const data_dims_t *input_dims,
                                                 const dw_conv_params_t *conv_params);
 void esp_nn_set_depthwise_conv_scratch_buf_ansi(const void *buf);
 
+/**
+ * @brief       reentrant versions of the convolutions
+ *
+ * @note        same as the functions above, but `scratch` (of the size given
+ *              by the get_*_scratch_size function) is used instead of the
+ *              buffer set with the set_*_scratch_buf function, so that several
+ *              interpreters can run them at the same time.
+ */
+void esp_nn_conv_s8_r_ansi(const data_dims_t *input_dims,
+                           const int8_t *input_data,
+                           const data_dims_t *filter_dims,
+                           const int8_t *filter_data,
+                           const int32_t *bias,
+                           const data_dims_t *output_dims,
+                           int8_t *out_data,
+                           const conv_params_t *conv_params,
+                           const quant_data_t *quant_data,
+                           void *scratch);
+
+void esp_nn_depthwise_conv_s8_r_ansi(const data_dims_t *input_dims,
+                                     const int8_t *input_data,
+                                     const data_dims_t *filter_dims,
+                                     const int8_t *filter_data,
+                                     const int32_t *bias,
+                                     const data_dims_t *output_dims,
+                                     int8_t *out_data,
+                                     const dw_conv_params_t *conv_params,
+                                     const quant_data_t *quant_data,
+                                     void *scratch);
+
+/**
+ * @brief       2d-convolution and depthwise convolution with 16 bit activations
+ *
+ * @note        inputs type: int16_t, filter: int8_t, bias: int64_t, output: int16_t
+ *              16 bit activations are symmetric: in_offset and out_offset are
+ *              not used. Requantization is done on a 64 bit accumulator, as
+ *              tflite does for 16x8 models.
+ */
+void esp_nn_conv_s16_s8_ansi(const data_dims_t *input_dims,
+                             const int16_t *input_data,
+                             const data_dims_t *filter_dims,
+                             const int8_t *filter_data,
+                             const int64_t *bias,
+                             const data_dims_t *output_dims,
+                             int16_t *out_data,
+                             const conv_params_t *conv_params,
+                             const quant_data_t *quant_data);
+
+void esp_nn_depthwise_conv_s16_s8_ansi(const data_dims_t *input_dims,
+                                       const int16_t *input_data,
+                                       const data_dims_t *filter_dims,
+                                       const int8_t *filter_data,
+                                       const int64_t *bias,
+                                       const data_dims_t *output_dims,
+                                       int16_t *out_data,
+                                       const dw_conv_params_t *conv_params,
+                                       const quant_data_t *quant_data);
+
+/**
+ * @brief       2d-convolution with a block-sparse filter
+ *
+ * @note        inputs type: int8_t, output: int8_t
+ *              the filter rows are [filter_ht][filter_wd][in_channels]; blocks
+ *              of zero values are skipped. in_channels must be a multiple of
+ *              filter->block_len, so that a block does not span two taps.
+ *              The filter is symmetric: there is no filter offset.
+ */
+void esp_nn_conv_sparse_s8_ansi(const data_dims_t *input_dims,
+                                const int8_t *input_data,
+                                const data_dims_t *filter_dims,
+                                const sparse_filter_t *filter,
+                                const int32_t *bias,
+                                const data_dims_t *output_dims,
+                                int8_t *out_data,
+                                const conv_params_t *conv_params,
+                                const quant_data_t *quant_data);
+
 /************************** Activation functions *****************************/
 
 /**
@@ -220,6 +311,43 @@ void esp_nn_fully_connected_per_ch_s8_ansi(const int8_t *input_data,
                                     const int32_t activation_min,
                                     const int32_t activation_max);
 
+/**
+ * @brief       fully connected with 16 bit activations
+ *
+ * @note        inputs type: int16_t, filter: int8_t, bias: int64_t, output: int16_t
+ *              symmetric input, filter and output: no offsets
+ */
+void esp_nn_fully_connected_s16_s8_ansi(const int16_t *input_data,
+                                        const uint16_t row_len,
+                                        const int8_t *filter_data,
+                                        const int64_t *bias,
+                                        int16_t *out_data,
+                                        const uint16_t out_channels,
+                                        const int32_t out_shift,
+                                        const int32_t out_mult,
+                                        const int32_t activation_min,
+                                        const int32_t activation_max);
+
+/**
+ * @brief       fully connected with a block-sparse filter
+ *
+ * @note        inputs type: int8_t, output: int8_t
+ *              blocks of zero values are skipped. The filter is symmetric:
+ *              there is no filter offset.
+ */
+void esp_nn_fully_connected_sparse_s8_ansi(const int8_t *input_data,
+                                           const int32_t input_offset,
+                                           const uint16_t row_len,
+                                           const sparse_filter_t *filter,
+                                           const int32_t *bias,
+                                           int8_t *out_data,
+                                           const uint16_t out_channels,
+                                           const int32_t out_offset,
+                                           const int32_t out_shift,
+                                           const int32_t out_mult,
+                                           const int32_t activation_min,
+                                           const int32_t activation_max);
+
 /**
  * @brief   Get scratch buffer size needed by softmax function
  *
@@ -255,6 +383,20 @@ void esp_nn_softmax_s8_ansi(const int8_t *input_data,
                             const int32_t diff_min,
                             int8_t *output_data);
 
+/**
+ * @brief       reentrant version of softmax: uses `scratch` (of the size given
+ *              by esp_nn_get_softmax_scratch_size) instead of the buffer set
+ *              with esp_nn_set_softmax_scratch_buf
+ */
+void esp_nn_softmax_s8_r_ansi(const int8_t *input_data,
+                              const int32_t height,
+                              const int32_t width,
+                              const int32_t mult,
+                              const int32_t shift,
+                              const int32_t diff_min,
+                              int8_t *output_data,
+                              void *scratch);
+
 
 //////////////////////////// Generic optimisations /////////////////////////////
 
@@ -312,6 +454,244 @@ int esp_nn_get_depthwise_conv_scratch_size_opt(const data_dims_t *input_dims,
                                                const dw_conv_params_t *conv_params);
 void esp_nn_set_depthwise_conv_scratch_buf_opt(const void *buf);
 
+/* reentrant versions, see esp_nn_conv_s8_r_ansi */
+void esp_nn_conv_s8_r_opt(const data_dims_t *input_dims,
+                          const int8_t *input_data,
+                          const data_dims_t *filter_dims,
+                          const int8_t *filter_data,
+                          const int32_t *bias,
+                          const data_dims_t *output_dims,
+                          int8_t *out_data,
+                          const conv_params_t *conv_params,
+                          const quant_data_t *quant_data,
+                          void *scratch);
+
+void esp_nn_depthwise_conv_s8_r_opt(const data_dims_t *input_dims,
+                                    const int8_t *input_data,
+                                    const data_dims_t *filter_dims,
+                                    const int8_t *filter_data,
+                                    const int32_t *bias,
+                                    const data_dims_t *output_dims,
+                                    int8_t *out_data,
+                                    const dw_conv_params_t *conv_params,
+                                    const quant_data_t *quant_data,
+                                    void *scratch);
+
+/**
+ * @brief       conv backends behind esp_nn_conv_s8_r_opt, which picks one
+ *              from the layer shape. Both are bit exact with the ansi version.
+ *
+ * @note        im2col: the patches of 4 output pixels are copied into the
+ *              scratch buffer and multiplied with the filter as a GEMM, 2
+ *              output channels x 4 pixels at a time. Any filter and stride.
+ *
+ *              winograd: F(2x2, 3x3) on 4x4 input tiles. Only 3x3 filters,
+ *              stride 1 and up to 128 input channels;
+ *              esp_nn_get_conv_winograd_scratch_size_opt returns 0 otherwise.
+ *
+ *              `scratch` is of the size given by the matching
+ *              get_*_scratch_size function and may not be NULL.
+ */
+int esp_nn_get_conv_im2col_scratch_size_opt(const data_dims_t *input_dims,
+                                            const data_dims_t *filter_dims,
+                                            const data_dims_t *output_dims,
+                                            const conv_params_t *conv_params);
+
+void esp_nn_conv_im2col_s8_r_opt(const data_dims_t *input_dims,
+                                 const int8_t *input_data,
+                                 const data_dims_t *filter_dims,
+                                 const int8_t *filter_data,
+                                 const int32_t *bias,
+                                 const data_dims_t *output_dims,
+                                 int8_t *out_data,
+                                 const conv_params_t *conv_params,
+                                 const quant_data_t *quant_data,
+                                 void *scratch);
+
+int esp_nn_get_conv_winograd_scratch_size_opt(const data_dims_t *input_dims,
+                                              const data_dims_t *filter_dims,
+                                              const data_dims_t *output_dims,
+                                              const conv_params_t *conv_params);
+
+void esp_nn_conv_winograd_s8_r_opt(const data_dims_t *input_dims,
+                                   const int8_t *input_data,
+                                   const data_dims_t *filter_dims,
+                                   const int8_t *filter_data,
+                                   const int32_t *bias,
+                                   const data_dims_t *output_dims,
+                                   int8_t *out_data,
+                                   const conv_params_t *conv_params,
+                                   const quant_data_t *quant_data,
+                                   void *scratch);
+
+/**
+ * @brief       16 bit activation convolutions, optimized versions
+ *
+ * @note        bit exact with the ansi versions; the products are summed in
+ *              32 bits in runs that cannot overflow, and only those sums go
+ *              to the 64 bit accumulator. 4 output channels per pass.
+ */
+void esp_nn_conv_s16_s8_opt(const data_dims_t *input_dims,
+                            const int16_t *input_data,
+                            const data_dims_t *filter_dims,
+                            const int8_t *filter_data,
+                            const int64_t *bias,
+                            const data_dims_t *output_dims,
+                            int16_t *out_data,
+                            const conv_params_t *conv_params,
+                            const quant_data_t *quant_data);
+
+void esp_nn_depthwise_conv_s16_s8_opt(const data_dims_t *input_dims,
+                                      const int16_t *input_data,
+                                      const data_dims_t *filter_dims,
+                                      const int8_t *filter_data,
+                                      const int64_t *bias,
+                                      const data_dims_t *output_dims,
+                                      int16_t *out_data,
+                                      const dw_conv_params_t *conv_params,
+                                      const quant_data_t *quant_data);
+
+/**
+ * @brief       2d-convolution with a block-sparse filter, optimized version
+ *
+ * @note        bit exact with the ansi version; the set bits of the bitmap
+ *              are found a byte at a time, so a zero byte skips 8 blocks,
+ *              and input_offset is folded into one correction per output.
+ */
+void esp_nn_conv_sparse_s8_opt(const data_dims_t *input_dims,
+                               const int8_t *input_data,
+                               const data_dims_t *filter_dims,
+                               const sparse_filter_t *filter,
+                               const int32_t *bias,
+                               const data_dims_t *output_dims,
+                               int8_t *out_data,
+                               const conv_params_t *conv_params,
+                               const quant_data_t *quant_data);
+
+/************************** Fully connected functions ***********************/
+
+/**
+ * @brief       fully connected optimized version
+ *
+ * @note        bit exact with the ansi version;
+ *              4 output rows are computed per pass, sharing each input load,
+ *              and filter_offset is folded into one correction per call.
+ */
+void esp_nn_fully_connected_s8_opt(const int8_t *input_data,
+                                   const int32_t input_offset,
+                                   const uint16_t row_len,
+                                   const int8_t *filter_data,
+                                   const int32_t filter_offset,
+                                   const int32_t *bias,
+                                   int8_t *out_data,
+                                   const uint16_t out_channels,
+                                   const int32_t out_offset,
+                                   const int32_t out_shift,
+                                   const int32_t out_mult,
+                                   const int32_t activation_min,
+                                   const int32_t activation_max);
+
+/**
+ * @brief       fully connected optimized version, per channel requantization
+ *
+ * @note        see esp_nn_fully_connected_s8_opt
+ */
+void esp_nn_fully_connected_per_ch_s8_opt(const int8_t *input_data,
+                                          const int32_t input_offset,
+                                          const uint16_t row_len,
+                                          const int8_t *filter_data,
+                                          const int32_t filter_offset,
+                                          const int32_t *bias,
+                                          int8_t *out_data,
+                                          const uint16_t out_channels,
+                                          const int32_t out_offset,
+                                          const int32_t* out_shift,
+                                          const int32_t* out_mult,
+                                          const int32_t activation_min,
+                                          const int32_t activation_max);
+
+/**
+ * @brief       fully connected with 16 bit activations, optimized version
+ *
+ * @note        bit exact with the ansi version, see esp_nn_conv_s16_s8_opt
+ */
+void esp_nn_fully_connected_s16_s8_opt(const int16_t *input_data,
+                                       const uint16_t row_len,
+                                       const int8_t *filter_data,
+                                       const int64_t *bias,
+                                       int16_t *out_data,
+                                       const uint16_t out_channels,
+                                       const int32_t out_shift,
+                                       const int32_t out_mult,
+                                       const int32_t activation_min,
+                                       const int32_t activation_max);
+
+/**
+ * @brief       fully connected with a block-sparse filter, optimized version
+ *
+ * @note        bit exact with the ansi version, see esp_nn_conv_sparse_s8_opt
+ */
+void esp_nn_fully_connected_sparse_s8_opt(const int8_t *input_data,
+                                          const int32_t input_offset,
+                                          const uint16_t row_len,
+                                          const sparse_filter_t *filter,
+                                          const int32_t *bias,
+                                          int8_t *out_data,
+                                          const uint16_t out_channels,
+                                          const int32_t out_offset,
+                                          const int32_t out_shift,
+                                          const int32_t out_mult,
+                                          const int32_t activation_min,
+                                          const int32_t activation_max);
+
+/************************** Pooling functions *******************************/
+
+/**
+ * @brief       max_pool optimized version
+ *
+ * @note        bit exact with the ansi version, any number of channels;
+ *              windows inside the input skip the clamping, channels are
+ *              processed 8 and 4 at a time.
+ */
+void esp_nn_max_pool_s8_opt(const int8_t *input,
+                            const uint16_t input_wd,
+                            const uint16_t input_ht,
+                            int8_t *output,
+                            const uint16_t output_wd,
+                            const uint16_t output_ht,
+                            const uint16_t stride_wd,
+                            const uint16_t stride_ht,
+                            const uint16_t filter_wd,
+                            const uint16_t filter_ht,
+                            const uint16_t pad_wd,
+                            const uint16_t pad_ht,
+                            const int32_t activation_min,
+                            const int32_t activation_max,
+                            const uint16_t channels);
+
+/**
+ * @brief       avg_pool optimized version
+ *
+ * @note        see esp_nn_max_pool_s8_opt
+ */
+void esp_nn_avg_pool_s8_opt(const int8_t *input,
+                            const uint16_t input_wd,
+                            const uint16_t input_ht,
+                            int8_t *output,
+                            const uint16_t output_wd,
+                            const uint16_t output_ht,
+                            const uint16_t stride_wd,
+                            const uint16_t stride_ht,
+                            const uint16_t filter_wd,
+                            const uint16_t filter_ht,
+                            const uint16_t pad_wd,
+                            const uint16_t pad_ht,
+                            const int32_t activation_min,
+                            const int32_t activation_max,
+                            const uint16_t channels);
+
+/************************** Softmax functions *******************************/
+
 /* ANSI C function to be hooked up when optimised version needed */
 void esp_nn_set_softmax_scratch_buf_opt(void *buffer);
 
@@ -328,3 +708,50 @@ void esp_nn_softmax_s8_opt(const int8_t *input_data,
                            const int32_t shift,
                            const int32_t diff_min,
                            int8_t *output_data);
+
+/* reentrant version, see esp_nn_softmax_s8_r_ansi */
+void esp_nn_softmax_s8_r_opt(const int8_t *input_data,
+                             const int32_t height,
+                             const int32_t width,
+                             const int32_t mult,
+                             const int32_t shift,
+                             const int32_t diff_min,
+                             int8_t *output_data,
+                             void *scratch);
+
+/************************** Basic math functions ****************************/
+
+/**
+ * @brief       optimised version of int16 to int8 quantization
+ *
+ * @note        bit exact with the ansi version;
+ *              4 outputs are computed per iteration and stored as one word.
+ */
+void esp_nn_quantize_s16_s8_opt(const int16_t *input_data,
+                                int8_t *output,
+                                const int32_t out_offset,
+                                const int32_t out_mult,
+                                const int32_t out_shift,
+                                const int32_t size);
+
+/************************** Sparse filters **********************************/
+
+/**
+ * @brief       block-sparse copy of a dense int8 filter
+ *
+ * @param       filter_data dense filter, `rows` rows of `row_len` values
+ * @param       bitmap      rows * ESP_NN_SPARSE_BITMAP_BYTES(row_len, block_len) bytes
+ * @param       values      output for the non-zero blocks, NULL to only count them
+ *
+ * @return      bytes written (or needed) in `values`
+ *
+ * @note        models normally carry the sparse filter already (the tflite
+ *              converter builds the same layout); this is for tests and for
+ *              weights made on the target.
+ */
+int32_t esp_nn_sparse_filter_encode(const int8_t *filter_data,
+                                    const int32_t rows,
+                                    const int32_t row_len,
+                                    const int32_t block_len,
+                                    uint8_t *bitmap,
+                                    int8_t *values);
@@ -81,3 +81,34 @@ typedef struct dw_conv_params {
     data_2d_t dilation;
     act_params_t activation;
 } dw_conv_params_t;
+
+/**
+ * @brief params specific to pooling 2d
+ *
+ */
+typedef struct pool_params {
+    data_2d_t stride;
+    data_2d_t filter;
+    act_params_t activation;
+} pool_params_t;
+
+/**
+ * @brief block-sparse int8 filter
+ *
+ * Each row of the filter (the values of one output channel, in the order of
+ * the dense filter) is split in blocks of `block_len` values, the last one
+ * padded with zeros. `bitmap` has one bit per block, set if the block has a
+ * non-zero value: block `i` of a row is bit (i % 8) of byte (i / 8), and every
+ * row starts on a new byte. `values` holds the blocks whose bit is set, row
+ * after row.
+ */
+typedef struct sparse_filter {
+    const uint8_t *bitmap;
+    const int8_t *values;
+    int32_t block_len;      /* 4 or 8 */
+} sparse_filter_t;
+
+/* blocks and bitmap bytes of one sparse filter row of `row_len` values */
+#define ESP_NN_SPARSE_BLOCKS(row_len, block_len)    (((row_len) + (block_len) - 1) / (block_len))
+#define ESP_NN_SPARSE_BITMAP_BYTES(row_len, block_len) \
+    ((ESP_NN_SPARSE_BLOCKS(row_len, block_len) + 7) / 8)
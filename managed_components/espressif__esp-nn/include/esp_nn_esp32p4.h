@@ -38,16 +38,35 @@ int esp_nn_get_conv_scratch_size_esp32p4(const data_dims_t *input_dims,
                                          const conv_params_t *conv_params);
 void esp_nn_set_conv_scratch_buf_esp32p4(const void *buf);
 
+/* reentrant version, see esp_nn_conv_s8_r_ansi */
+void esp_nn_conv_s8_r_esp32p4(const data_dims_t *input_dims,
+                              const int8_t *input_data,
+                              const data_dims_t *filter_dims,
+                              const int8_t *filter_data,
+                              const int32_t *bias,
+                              const data_dims_t *output_dims,
+                              int8_t *out_data,
+                              const conv_params_t *conv_params,
+                              const quant_data_t *quant_data,
+                              void *scratch);
+
 /********************** function defines ***************************/
 
 
 
 #define esp_nn_add_elementwise_s8 esp_nn_add_elementwise_s8_ansi
 #define esp_nn_mul_elementwise_s8 esp_nn_mul_elementwise_s8_ansi
+#define esp_nn_quantize_s16_s8 esp_nn_quantize_s16_s8_opt
 
 #define esp_nn_depthwise_conv_s8 esp_nn_depthwise_conv_s8_opt
+#define esp_nn_depthwise_conv_s8_r esp_nn_depthwise_conv_s8_r_opt
 
 #define esp_nn_conv_s8 esp_nn_conv_s8_esp32p4
+#define esp_nn_conv_s8_r esp_nn_conv_s8_r_esp32p4
+
+#define esp_nn_conv_s16_s8 esp_nn_conv_s16_s8_opt
+#define esp_nn_conv_sparse_s8 esp_nn_conv_sparse_s8_opt
+#define esp_nn_depthwise_conv_s16_s8 esp_nn_depthwise_conv_s16_s8_opt
 
 #define esp_nn_get_conv_scratch_size esp_nn_get_conv_scratch_size_esp32p4
 #define esp_nn_set_conv_scratch_buf esp_nn_set_conv_scratch_buf_esp32p4
@@ -57,12 +76,15 @@ void esp_nn_set_conv_scratch_buf_esp32p4(const void *buf);
 
 #define esp_nn_relu6_s8 esp_nn_relu6_s8_ansi
 
-#define esp_nn_avg_pool_s8 esp_nn_avg_pool_s8_ansi
-#define esp_nn_max_pool_s8 esp_nn_max_pool_s8_ansi
+#define esp_nn_avg_pool_s8 esp_nn_avg_pool_s8_opt
+#define esp_nn_max_pool_s8 esp_nn_max_pool_s8_opt
 
-#define esp_nn_fully_connected_s8 esp_nn_fully_connected_s8_ansi
-#define esp_nn_fully_connected_per_ch_s8 esp_nn_fully_connected_per_ch_s8_ansi
+#define esp_nn_fully_connected_s8 esp_nn_fully_connected_s8_opt
+#define esp_nn_fully_connected_per_ch_s8 esp_nn_fully_connected_per_ch_s8_opt
+#define esp_nn_fully_connected_s16_s8 esp_nn_fully_connected_s16_s8_opt
+#define esp_nn_fully_connected_sparse_s8 esp_nn_fully_connected_sparse_s8_opt
 
 #define esp_nn_get_softmax_scratch_size esp_nn_get_softmax_scratch_size_opt
 #define esp_nn_set_softmax_scratch_buf esp_nn_set_softmax_scratch_buf_opt
 #define esp_nn_softmax_s8 esp_nn_softmax_s8_opt
+#define esp_nn_softmax_s8_r esp_nn_softmax_s8_r_opt
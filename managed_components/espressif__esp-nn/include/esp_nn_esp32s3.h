@@ -125,6 +125,29 @@ int esp_nn_get_depthwise_conv_scratch_size_esp32s3(const data_dims_t *input_dims
                                                    const dw_conv_params_t *conv_params);
 void esp_nn_set_depthwise_conv_scratch_buf_esp32s3(const void *buf);
 
+/* reentrant versions, see esp_nn_conv_s8_r_ansi */
+void esp_nn_conv_s8_r_esp32s3(const data_dims_t *input_dims,
+                              const int8_t *input_data,
+                              const data_dims_t *filter_dims,
+                              const int8_t *filter_data,
+                              const int32_t *bias,
+                              const data_dims_t *output_dims,
+                              int8_t *out_data,
+                              const conv_params_t *conv_params,
+                              const quant_data_t *quant_data,
+                              void *scratch);
+
+void esp_nn_depthwise_conv_s8_r_esp32s3(const data_dims_t *input_dims,
+                                        const int8_t *input_data,
+                                        const data_dims_t *filter_dims,
+                                        const int8_t *filter_data,
+                                        const int32_t *bias,
+                                        const data_dims_t *output_dims,
+                                        int8_t *out_data,
+                                        const dw_conv_params_t *conv_params,
+                                        const quant_data_t *quant_data,
+                                        void *scratch);
+
 /************************** Pooling functions *****************************/
 
 /**
@@ -232,8 +255,10 @@ void esp_nn_relu6_s8_esp32s3(int8_t *data, uint16_t size);
 
 #define esp_nn_add_elementwise_s8 esp_nn_add_elementwise_s8_esp32s3
 #define esp_nn_mul_elementwise_s8 esp_nn_mul_elementwise_s8_esp32s3
+#define esp_nn_quantize_s16_s8 esp_nn_quantize_s16_s8_opt
 
 #define esp_nn_depthwise_conv_s8 esp_nn_depthwise_conv_s8_esp32s3
+#define esp_nn_depthwise_conv_s8_r esp_nn_depthwise_conv_s8_r_esp32s3
 
 #define esp_nn_get_conv_scratch_size esp_nn_get_conv_scratch_size_esp32s3
 #define esp_nn_set_conv_scratch_buf esp_nn_set_conv_scratch_buf_esp32s3
@@ -242,6 +267,11 @@ void esp_nn_relu6_s8_esp32s3(int8_t *data, uint16_t size);
 #define esp_nn_set_depthwise_conv_scratch_buf esp_nn_set_depthwise_conv_scratch_buf_esp32s3
 
 #define esp_nn_conv_s8 esp_nn_conv_s8_esp32s3
+#define esp_nn_conv_s8_r esp_nn_conv_s8_r_esp32s3
+
+#define esp_nn_conv_s16_s8 esp_nn_conv_s16_s8_opt
+#define esp_nn_conv_sparse_s8 esp_nn_conv_sparse_s8_opt
+#define esp_nn_depthwise_conv_s16_s8 esp_nn_depthwise_conv_s16_s8_opt
 
 #define esp_nn_relu6_s8 esp_nn_relu6_s8_esp32s3
 
@@ -250,7 +280,10 @@ void esp_nn_relu6_s8_esp32s3(int8_t *data, uint16_t size);
 
 #define esp_nn_fully_connected_s8 esp_nn_fully_connected_s8_esp32s3
 #define esp_nn_fully_connected_per_ch_s8 esp_nn_fully_connected_per_ch_s8_esp32s3
+#define esp_nn_fully_connected_s16_s8 esp_nn_fully_connected_s16_s8_opt
+#define esp_nn_fully_connected_sparse_s8 esp_nn_fully_connected_sparse_s8_opt
 
 #define esp_nn_get_softmax_scratch_size esp_nn_get_softmax_scratch_size_opt
 #define esp_nn_set_softmax_scratch_buf esp_nn_set_softmax_scratch_buf_opt
 #define esp_nn_softmax_s8 esp_nn_softmax_s8_opt
+#define esp_nn_softmax_s8_r esp_nn_softmax_s8_r_opt
@@ -0,0 +1,67 @@
+// Copyright 2025 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * @file        Fused kernels. They are built on top of the dispatched
+ *              esp_nn_* functions, so the same code serves every target.
+ */
+
+#pragma once
+
+#include "esp_nn_defs.h"
+
+/**
+ * @brief       2d-convolution followed by max_pool, without the conv output
+ *
+ * @note        The convolution (whose activation range can hold a fused relu)
+ *              is computed `pool_params->filter.height` rows at a time into
+ *              `conv_rows`, and each band is pooled into one output row right
+ *              away, so the full conv output is never stored. Conv rows that
+ *              no pooling window reads are skipped.
+ *
+ *              Both ops must be VALID (conv_params->padding is ignored) and
+ *              without dilation, and pooling rows must not overlap
+ *              (pool stride height >= pool filter height).
+ *
+ *              `output_dims` are those of the pooled output; its channels are
+ *              the conv output channels.
+ *              `conv_rows` holds pool filter height * conv output width *
+ *              channels bytes, see esp_nn_get_conv_max_pool_rows_size.
+ *              `scratch` is of the size given by
+ *              esp_nn_get_conv_max_pool_scratch_size.
+ */
+void esp_nn_conv_max_pool_s8_r(const data_dims_t *input_dims,
+                               const int8_t *input_data,
+                               const data_dims_t *filter_dims,
+                               const int8_t *filter_data,
+                               const int32_t *bias,
+                               const conv_params_t *conv_params,
+                               const quant_data_t *quant_data,
+                               const pool_params_t *pool_params,
+                               const data_dims_t *output_dims,
+                               int8_t *out_data,
+                               int8_t *conv_rows,
+                               void *scratch);
+
+int esp_nn_get_conv_max_pool_rows_size(const data_dims_t *input_dims,
+                                       const data_dims_t *filter_dims,
+                                       const conv_params_t *conv_params,
+                                       const pool_params_t *pool_params,
+                                       const data_dims_t *output_dims);
+
+int esp_nn_get_conv_max_pool_scratch_size(const data_dims_t *input_dims,
+                                          const data_dims_t *filter_dims,
+                                          const conv_params_t *conv_params,
+                                          const pool_params_t *pool_params,
+                                          const data_dims_t *output_dims);
@@ -24,10 +24,17 @@
 
 #define esp_nn_add_elementwise_s8 esp_nn_add_elementwise_s8_ansi
 #define esp_nn_mul_elementwise_s8 esp_nn_mul_elementwise_s8_ansi
+#define esp_nn_quantize_s16_s8 esp_nn_quantize_s16_s8_opt
 
 #define esp_nn_depthwise_conv_s8 esp_nn_depthwise_conv_s8_opt
+#define esp_nn_depthwise_conv_s8_r esp_nn_depthwise_conv_s8_r_opt
 
 #define esp_nn_conv_s8 esp_nn_conv_s8_opt
+#define esp_nn_conv_s8_r esp_nn_conv_s8_r_opt
+
+#define esp_nn_conv_s16_s8 esp_nn_conv_s16_s8_opt
+#define esp_nn_conv_sparse_s8 esp_nn_conv_sparse_s8_opt
+#define esp_nn_depthwise_conv_s16_s8 esp_nn_depthwise_conv_s16_s8_opt
 
 #define esp_nn_get_conv_scratch_size esp_nn_get_conv_scratch_size_opt
 #define esp_nn_set_conv_scratch_buf esp_nn_set_conv_scratch_buf_opt
@@ -37,12 +44,15 @@
 
 #define esp_nn_relu6_s8 esp_nn_relu6_s8_ansi
 
-#define esp_nn_avg_pool_s8 esp_nn_avg_pool_s8_ansi
-#define esp_nn_max_pool_s8 esp_nn_max_pool_s8_ansi
+#define esp_nn_avg_pool_s8 esp_nn_avg_pool_s8_opt
+#define esp_nn_max_pool_s8 esp_nn_max_pool_s8_opt
 
-#define esp_nn_fully_connected_s8 esp_nn_fully_connected_s8_ansi
-#define esp_nn_fully_connected_per_ch_s8 esp_nn_fully_connected_per_ch_s8_ansi
+#define esp_nn_fully_connected_s8 esp_nn_fully_connected_s8_opt
+#define esp_nn_fully_connected_per_ch_s8 esp_nn_fully_connected_per_ch_s8_opt
+#define esp_nn_fully_connected_s16_s8 esp_nn_fully_connected_s16_s8_opt
+#define esp_nn_fully_connected_sparse_s8 esp_nn_fully_connected_sparse_s8_opt
 
 #define esp_nn_get_softmax_scratch_size esp_nn_get_softmax_scratch_size_opt
 #define esp_nn_set_softmax_scratch_buf esp_nn_set_softmax_scratch_buf_opt
 #define esp_nn_softmax_s8 esp_nn_softmax_s8_opt
+#define esp_nn_softmax_s8_r esp_nn_softmax_s8_r_opt
@@ -0,0 +1,134 @@
+// Copyright 2025 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * @file        Explicit selection of the kernel variants, for callers that
+ *              measure them and pick one per layer instead of relying on the
+ *              compile time selection of esp_nn.h.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+
+#include "esp_nn_defs.h"
+
+/**
+ * @brief       kernel variants
+ *
+ * @note        ESP_NN_VARIANT_DEFAULT is what the esp_nn_* functions dispatch
+ *              to for this build (target specific, generic optimised or ansi).
+ *              The values are stable, so that they can be stored.
+ */
+typedef enum {
+    ESP_NN_VARIANT_DEFAULT = 0,
+    ESP_NN_VARIANT_ANSI = 1,
+    ESP_NN_VARIANT_OPT = 2,         /* generic optimised, with its own backend heuristic */
+    ESP_NN_VARIANT_IM2COL = 3,      /* conv only: generic im2col + GEMM */
+    ESP_NN_VARIANT_WINOGRAD = 4,    /* conv only: generic Winograd F(2x2, 3x3) */
+    ESP_NN_VARIANT_COUNT
+} esp_nn_variant_t;
+
+/**
+ * @brief       short name of a variant, for logs
+ */
+const char *esp_nn_variant_name(esp_nn_variant_t variant);
+
+/**
+ * @brief       scratch size of a conv variant
+ *
+ * @return      size in bytes, or -1 if the variant does not handle this shape
+ *              or is the same code as another one in this build (OPT in a
+ *              generic optimised build, DEFAULT in an ansi build), so that
+ *              each candidate is measured once.
+ *              ESP_NN_VARIANT_ANSI handles every shape and is the reference
+ *              for the others.
+ */
+int esp_nn_get_conv_variant_scratch_size(esp_nn_variant_t variant,
+                                         const data_dims_t *input_dims,
+                                         const data_dims_t *filter_dims,
+                                         const data_dims_t *output_dims,
+                                         const conv_params_t *conv_params);
+
+/**
+ * @brief       2d-convolution with the given variant
+ *
+ * @note        `scratch` is of the size given by
+ *              esp_nn_get_conv_variant_scratch_size for the same variant.
+ *              A variant that is only a duplicate still runs.
+ */
+void esp_nn_conv_s8_variant_r(esp_nn_variant_t variant,
+                              const data_dims_t *input_dims,
+                              const int8_t *input_data,
+                              const data_dims_t *filter_dims,
+                              const int8_t *filter_data,
+                              const int32_t *bias,
+                              const data_dims_t *output_dims,
+                              int8_t *out_data,
+                              const conv_params_t *conv_params,
+                              const quant_data_t *quant_data,
+                              void *scratch);
+
+/**
+ * @brief       scratch size of a depthwise conv variant
+ *
+ * @return      size in bytes, or -1 as for esp_nn_get_conv_variant_scratch_size.
+ *              Only DEFAULT, ANSI and OPT exist for depthwise.
+ */
+int esp_nn_get_depthwise_conv_variant_scratch_size(esp_nn_variant_t variant,
+                                                   const data_dims_t *input_dims,
+                                                   const data_dims_t *filter_dims,
+                                                   const data_dims_t *output_dims,
+                                                   const dw_conv_params_t *conv_params);
+
+/**
+ * @brief       depthwise 2d-convolution with the given variant
+ */
+void esp_nn_depthwise_conv_s8_variant_r(esp_nn_variant_t variant,
+                                        const data_dims_t *input_dims,
+                                        const int8_t *input_data,
+                                        const data_dims_t *filter_dims,
+                                        const int8_t *filter_data,
+                                        const int32_t *bias,
+                                        const data_dims_t *output_dims,
+                                        int8_t *out_data,
+                                        const dw_conv_params_t *conv_params,
+                                        const quant_data_t *quant_data,
+                                        void *scratch);
+
+/**
+ * @brief       whether a fully connected variant is a distinct candidate
+ *
+ * @note        same rules as the conv ones, without scratch.
+ *              Only DEFAULT, ANSI and OPT exist for fully connected.
+ */
+bool esp_nn_fully_connected_variant_available(esp_nn_variant_t variant);
+
+/**
+ * @brief       fully connected (per tensor quantisation) with the given variant
+ */
+void esp_nn_fully_connected_s8_variant(esp_nn_variant_t variant,
+                                       const int8_t *input_data,
+                                       const int32_t input_offset,
+                                       const uint16_t row_len,
+                                       const int8_t *filter_data,
+                                       const int32_t filter_offset,
+                                       const int32_t *bias,
+                                       int8_t *out_data,
+                                       const uint16_t out_channels,
+                                       const int32_t out_offset,
+                                       const int32_t out_shift,
+                                       const int32_t out_mult,
+                                       const int32_t activation_min,
+                                       const int32_t activation_max);
@@ -0,0 +1,33 @@
+// Copyright 2020-2021 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdint.h>
+
+#include <common_functions.h>
+
+void esp_nn_quantize_s16_s8_ansi(const int16_t *input_data,
+                                 int8_t *output,
+                                 const int32_t out_offset,
+                                 const int32_t out_mult,
+                                 const int32_t out_shift,
+                                 const int32_t size)
+{
+    for (int i = 0; i < size; i++) {
+        int32_t out = esp_nn_multiply_by_quantized_mult(input_data[i], out_mult, out_shift);
+        out = out + out_offset;
+
+        out = max(INT8_MIN, min(out, INT8_MAX));
+        output[i] = (int8_t) out;
+    }
+}
@@ -0,0 +1,59 @@
+// Copyright 2020-2021 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdint.h>
+
+#include <common_functions.h>
+
+/**
+ * Input is 16 bits, so `(in << left_shift) * mult` can never hit the
+ * saturation cases of the exact multiply: the fast version is bit exact here.
+ */
+__NN_FORCE_INLINE__ int32_t esp_nn_quantize_one(int32_t in, const int32_t left_shift,
+                                                const int32_t right_shift,
+                                                const int32_t out_mult,
+                                                const int32_t out_offset)
+{
+    int64_t prod = (int64_t) (in * (1 << left_shift)) * out_mult + (1 << 30);
+    int32_t out = (int32_t) (prod >> 31);
+    if (right_shift) {
+        out = esp_nn_div_by_power_of_two_fast(out, right_shift);
+    }
+    return esp_nn_saturate8(out + out_offset);
+}
+
+void esp_nn_quantize_s16_s8_opt(const int16_t *input_data,
+                                int8_t *output,
+                                const int32_t out_offset,
+                                const int32_t out_mult,
+                                const int32_t out_shift,
+                                const int32_t size)
+{
+    const int32_t left_shift = max(out_shift, 0);
+    const int32_t right_shift = left_shift - out_shift;
+    int i = 0;
+
+    /* 4 samples per iteration, stored as a single word */
+    for (; i < size - 3; i += 4) {
+        uint32_t out0 = (uint8_t) esp_nn_quantize_one(input_data[i + 0], left_shift, right_shift, out_mult, out_offset);
+        uint32_t out1 = (uint8_t) esp_nn_quantize_one(input_data[i + 1], left_shift, right_shift, out_mult, out_offset);
+        uint32_t out2 = (uint8_t) esp_nn_quantize_one(input_data[i + 2], left_shift, right_shift, out_mult, out_offset);
+        uint32_t out3 = (uint8_t) esp_nn_quantize_one(input_data[i + 3], left_shift, right_shift, out_mult, out_offset);
+        uint32_t packed = out0 | (out1 << 8) | (out2 << 16) | (out3 << 24);
+        memcpy(output + i, &packed, sizeof(packed));
+    }
+    for (; i < size; i++) {
+        output[i] = (int8_t) esp_nn_quantize_one(input_data[i], left_shift, right_shift, out_mult, out_offset);
+    }
+}
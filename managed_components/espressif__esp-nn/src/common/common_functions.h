@@ -170,6 +170,19 @@ __NN_FORCE_INLINE__ int32_t esp_nn_multiply_by_quantized_mult_fast(int32_t x, in
     return result;
 }
 
+/**
+ * requantization of a 64 bit accumulator, used for 16 bit activations.
+ * Same as tflite: the multiplier is rounded to 16 bits and applied with a
+ * single rounding. Expects x in [-(1 << 47), 1 << 47) and shift in [-31, 7].
+ */
+__NN_FORCE_INLINE__ int32_t esp_nn_multiply_by_quantized_mult_s64(int64_t x, int32_t mult, int32_t shift)
+{
+    const int32_t reduced_mult = mult < 0x7FFF0000 ? (mult + (1 << 15)) >> 16 : 0x7FFF;
+    const int32_t total_shift = 15 - shift;
+    const int64_t result = x * reduced_mult + ((int64_t) 1 << (total_shift - 1));
+    return (int32_t) (result >> total_shift);
+}
+
 static void esp_nn_aligned_s8_pad_with_value(const int8_t *src, int8_t *dst,
                                              const uint16_t input_wd,
                                              const uint16_t input_ht,
@@ -253,3 +266,100 @@ __NN_FORCE_INLINE__ void esp_nn_s8_to_s16(const int8_t *src, int16_t *dst, const
         dst[i] = src[i];
     }
 }
+
+/**
+ * An int16 x int8 product is within +/-(1 << 22), so this many of them can be
+ * summed in 32 bits. The s16 kernels sum runs of this length in 32 bits and
+ * only add the partial sums to the 64 bit accumulator.
+ */
+#define ESP_NN_S16_S8_ACC32_LEN     256
+
+/**
+ * @brief       64 bit accumulator to a 16 bit output
+ */
+__NN_FORCE_INLINE__ int16_t esp_nn_requantize_s64_s16(int64_t acc, const int32_t mult, const int32_t shift,
+                                                      const int32_t activation_min,
+                                                      const int32_t activation_max)
+{
+    int32_t result = esp_nn_multiply_by_quantized_mult_s64(acc, mult, shift);
+    result = max(result, activation_min);
+    result = min(result, activation_max);
+    return (int16_t) result;
+}
+
+/**
+ * @brief       acc += dot(input, filter), for int16 input and int8 filter
+ */
+__NN_FORCE_INLINE__ int64_t esp_nn_dot_s16_s8(const int16_t *input, const int8_t *filter,
+                                              int32_t len, int64_t acc)
+{
+    while (len > 0) {
+        const int32_t n = min(len, ESP_NN_S16_S8_ACC32_LEN);
+        int32_t sum = 0;
+        int32_t i = 0;
+        for (; i < n - 1; i += 2) {
+            sum += input[i] * filter[i] + input[i + 1] * filter[i + 1];
+        }
+        if (i < n) {
+            sum += input[i] * filter[i];
+        }
+        acc += sum;
+        input += n;
+        filter += n;
+        len -= n;
+    }
+    return acc;
+}
+
+/**
+ * @brief       acc[0..3] += dot(input, filter row 0..3), the rows being
+ *              `row_stride` apart: each input value is loaded once for 4 rows
+ */
+__NN_FORCE_INLINE__ void esp_nn_dot_s16_s8_4rows(const int16_t *input, const int8_t *filter,
+                                                 const int32_t row_stride, int32_t len, int64_t *acc)
+{
+    const int8_t *filter0 = filter;
+    const int8_t *filter1 = filter0 + row_stride;
+    const int8_t *filter2 = filter1 + row_stride;
+    const int8_t *filter3 = filter2 + row_stride;
+    while (len > 0) {
+        const int32_t n = min(len, ESP_NN_S16_S8_ACC32_LEN);
+        int32_t sum0 = 0, sum1 = 0, sum2 = 0, sum3 = 0;
+        for (int32_t i = 0; i < n; i++) {
+            const int32_t in = input[i];
+            sum0 += in * filter0[i];
+            sum1 += in * filter1[i];
+            sum2 += in * filter2[i];
+            sum3 += in * filter3[i];
+        }
+        acc[0] += sum0;
+        acc[1] += sum1;
+        acc[2] += sum2;
+        acc[3] += sum3;
+        input += n;
+        filter0 += n;
+        filter1 += n;
+        filter2 += n;
+        filter3 += n;
+        len -= n;
+    }
+}
+
+/**
+ * @brief       dot product of a full block of a sparse filter with the input,
+ *              block_len being 4 or 8. The sum of the filter values is added
+ *              to `*filter_sum`, for the input offset.
+ */
+__NN_FORCE_INLINE__ int32_t esp_nn_sparse_block_dot_s8(const int8_t *input, const int8_t *values,
+                                                       const int32_t block_len, int32_t *filter_sum)
+{
+    int32_t sum = 0;
+    int32_t values_sum = 0;
+    for (int32_t i = 0; i < block_len; i += 4) {
+        sum += input[i] * values[i] + input[i + 1] * values[i + 1] +
+               input[i + 2] * values[i + 2] + input[i + 3] * values[i + 3];
+        values_sum += values[i] + values[i + 1] + values[i + 2] + values[i + 3];
+    }
+    *filter_sum += values_sum;
+    return sum;
+}
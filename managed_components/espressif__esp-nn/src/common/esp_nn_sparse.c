@@ -0,0 +1,56 @@
+// Copyright 2025 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <esp_nn_defs.h>
+
+#include <common_functions.h>
+
+int32_t esp_nn_sparse_filter_encode(const int8_t *filter_data,
+                                    const int32_t rows,
+                                    const int32_t row_len,
+                                    const int32_t block_len,
+                                    uint8_t *bitmap,
+                                    int8_t *values)
+{
+    const int32_t blocks = ESP_NN_SPARSE_BLOCKS(row_len, block_len);
+    const int32_t bitmap_bytes = ESP_NN_SPARSE_BITMAP_BYTES(row_len, block_len);
+    int32_t values_len = 0;
+
+    for (int32_t row = 0; row < rows; row++) {
+        const int8_t *row_data = filter_data + row * row_len;
+        memset(bitmap, 0, bitmap_bytes);
+        for (int32_t block = 0; block < blocks; block++) {
+            const int32_t start = block * block_len;
+            const int32_t len = min(block_len, row_len - start);
+            bool zero = true;
+            for (int32_t i = 0; i < len; i++) {
+                if (row_data[start + i] != 0) {
+                    zero = false;
+                    break;
+                }
+            }
+            if (zero) {
+                continue;
+            }
+            bitmap[block >> 3] |= 1 << (block & 7);
+            if (values) {
+                memcpy(values + values_len, row_data + start, len);
+                memset(values + values_len + len, 0, block_len - len);
+            }
+            values_len += block_len;
+        }
+        bitmap += bitmap_bytes;
+    }
+    return values_len;
+}
@@ -0,0 +1,239 @@
+// Copyright 2025 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * ESP_NN_VARIANT_DEFAULT goes through the esp_nn_* names, so it follows the
+ * selection made in esp_nn.h. A variant that is the same code as the default
+ * in this build is not offered as a candidate:
+ *
+ *  > ansi build: DEFAULT is ANSI
+ *  > generic optimised build: DEFAULT is OPT
+ *  > esp32p4: DEFAULT is OPT for depthwise and fully connected
+ */
+
+#include <esp_nn.h>
+
+#if !defined(CONFIG_NN_OPTIMIZED)
+#define ESP_NN_DEFAULT_IS_ANSI          1
+#define ESP_NN_CONV_DEFAULT_IS_OPT      0
+#define ESP_NN_OTHERS_DEFAULT_IS_OPT    0
+#elif defined(ARCH_ESP32_S3)
+#define ESP_NN_DEFAULT_IS_ANSI          0
+#define ESP_NN_CONV_DEFAULT_IS_OPT      0
+#define ESP_NN_OTHERS_DEFAULT_IS_OPT    0
+#elif defined(ARCH_ESP32_P4)
+#define ESP_NN_DEFAULT_IS_ANSI          0
+#define ESP_NN_CONV_DEFAULT_IS_OPT      0
+#define ESP_NN_OTHERS_DEFAULT_IS_OPT    1
+#else
+#define ESP_NN_DEFAULT_IS_ANSI          0
+#define ESP_NN_CONV_DEFAULT_IS_OPT      1
+#define ESP_NN_OTHERS_DEFAULT_IS_OPT    1
+#endif
+
+const char *esp_nn_variant_name(esp_nn_variant_t variant)
+{
+    switch (variant) {
+    case ESP_NN_VARIANT_DEFAULT:
+        return "default";
+    case ESP_NN_VARIANT_ANSI:
+        return "ansi";
+    case ESP_NN_VARIANT_OPT:
+        return "opt";
+    case ESP_NN_VARIANT_IM2COL:
+        return "im2col";
+    case ESP_NN_VARIANT_WINOGRAD:
+        return "winograd";
+    default:
+        return "?";
+    }
+}
+
+/************************** Convolution *****************************/
+
+int esp_nn_get_conv_variant_scratch_size(esp_nn_variant_t variant,
+                                         const data_dims_t *input_dims,
+                                         const data_dims_t *filter_dims,
+                                         const data_dims_t *output_dims,
+                                         const conv_params_t *conv_params)
+{
+    switch (variant) {
+    case ESP_NN_VARIANT_DEFAULT:
+        if (ESP_NN_DEFAULT_IS_ANSI) {
+            return -1;
+        }
+        return esp_nn_get_conv_scratch_size(input_dims, filter_dims, output_dims, conv_params);
+    case ESP_NN_VARIANT_ANSI:
+        return esp_nn_get_conv_scratch_size_ansi(input_dims, filter_dims, output_dims, conv_params);
+    case ESP_NN_VARIANT_OPT:
+        if (ESP_NN_CONV_DEFAULT_IS_OPT) {
+            return -1;
+        }
+        return esp_nn_get_conv_scratch_size_opt(input_dims, filter_dims, output_dims, conv_params);
+    case ESP_NN_VARIANT_IM2COL:
+        return esp_nn_get_conv_im2col_scratch_size_opt(input_dims, filter_dims,
+                                                       output_dims, conv_params);
+    case ESP_NN_VARIANT_WINOGRAD: {
+        /* 0 means the shape is not supported */
+        const int size = esp_nn_get_conv_winograd_scratch_size_opt(input_dims, filter_dims,
+                                                                   output_dims, conv_params);
+        return size > 0 ? size : -1;
+    }
+    default:
+        return -1;
+    }
+}
+
+void esp_nn_conv_s8_variant_r(esp_nn_variant_t variant,
+                              const data_dims_t *input_dims,
+                              const int8_t *input_data,
+                              const data_dims_t *filter_dims,
+                              const int8_t *filter_data,
+                              const int32_t *bias,
+                              const data_dims_t *output_dims,
+                              int8_t *out_data,
+                              const conv_params_t *conv_params,
+                              const quant_data_t *quant_data,
+                              void *scratch)
+{
+    switch (variant) {
+    case ESP_NN_VARIANT_ANSI:
+        esp_nn_conv_s8_r_ansi(input_dims, input_data, filter_dims, filter_data, bias,
+                              output_dims, out_data, conv_params, quant_data, scratch);
+        break;
+    case ESP_NN_VARIANT_OPT:
+        esp_nn_conv_s8_r_opt(input_dims, input_data, filter_dims, filter_data, bias,
+                             output_dims, out_data, conv_params, quant_data, scratch);
+        break;
+    case ESP_NN_VARIANT_IM2COL:
+        esp_nn_conv_im2col_s8_r_opt(input_dims, input_data, filter_dims, filter_data, bias,
+                                    output_dims, out_data, conv_params, quant_data, scratch);
+        break;
+    case ESP_NN_VARIANT_WINOGRAD:
+        esp_nn_conv_winograd_s8_r_opt(input_dims, input_data, filter_dims, filter_data, bias,
+                                      output_dims, out_data, conv_params, quant_data, scratch);
+        break;
+    default:
+        esp_nn_conv_s8_r(input_dims, input_data, filter_dims, filter_data, bias,
+                         output_dims, out_data, conv_params, quant_data, scratch);
+        break;
+    }
+}
+
+/************************** Depthwise convolution *****************************/
+
+int esp_nn_get_depthwise_conv_variant_scratch_size(esp_nn_variant_t variant,
+                                                   const data_dims_t *input_dims,
+                                                   const data_dims_t *filter_dims,
+                                                   const data_dims_t *output_dims,
+                                                   const dw_conv_params_t *conv_params)
+{
+    switch (variant) {
+    case ESP_NN_VARIANT_DEFAULT:
+        if (ESP_NN_DEFAULT_IS_ANSI) {
+            return -1;
+        }
+        return esp_nn_get_depthwise_conv_scratch_size(input_dims, filter_dims,
+                                                      output_dims, conv_params);
+    case ESP_NN_VARIANT_ANSI:
+        return esp_nn_get_depthwise_conv_scratch_size_ansi(input_dims, filter_dims,
+                                                           output_dims, conv_params);
+    case ESP_NN_VARIANT_OPT:
+        if (ESP_NN_OTHERS_DEFAULT_IS_OPT) {
+            return -1;
+        }
+        return esp_nn_get_depthwise_conv_scratch_size_opt(input_dims, filter_dims,
+                                                          output_dims, conv_params);
+    default:
+        return -1;
+    }
+}
+
+void esp_nn_depthwise_conv_s8_variant_r(esp_nn_variant_t variant,
+                                        const data_dims_t *input_dims,
+                                        const int8_t *input_data,
+                                        const data_dims_t *filter_dims,
+                                        const int8_t *filter_data,
+                                        const int32_t *bias,
+                                        const data_dims_t *output_dims,
+                                        int8_t *out_data,
+                                        const dw_conv_params_t *conv_params,
+                                        const quant_data_t *quant_data,
+                                        void *scratch)
+{
+    switch (variant) {
+    case ESP_NN_VARIANT_ANSI:
+        esp_nn_depthwise_conv_s8_r_ansi(input_dims, input_data, filter_dims, filter_data, bias,
+                                        output_dims, out_data, conv_params, quant_data, scratch);
+        break;
+    case ESP_NN_VARIANT_OPT:
+        esp_nn_depthwise_conv_s8_r_opt(input_dims, input_data, filter_dims, filter_data, bias,
+                                       output_dims, out_data, conv_params, quant_data, scratch);
+        break;
+    default:
+        esp_nn_depthwise_conv_s8_r(input_dims, input_data, filter_dims, filter_data, bias,
+                                   output_dims, out_data, conv_params, quant_data, scratch);
+        break;
+    }
+}
+
+/************************** Fully connected *****************************/
+
+bool esp_nn_fully_connected_variant_available(esp_nn_variant_t variant)
+{
+    switch (variant) {
+    case ESP_NN_VARIANT_DEFAULT:
+        return !ESP_NN_DEFAULT_IS_ANSI;
+    case ESP_NN_VARIANT_ANSI:
+        return true;
+    case ESP_NN_VARIANT_OPT:
+        return !ESP_NN_OTHERS_DEFAULT_IS_OPT;
+    default:
+        return false;
+    }
+}
+
+void esp_nn_fully_connected_s8_variant(esp_nn_variant_t variant,
+                                       const int8_t *input_data,
+                                       const int32_t input_offset,
+                                       const uint16_t row_len,
+                                       const int8_t *filter_data,
+                                       const int32_t filter_offset,
+                                       const int32_t *bias,
+                                       int8_t *out_data,
+                                       const uint16_t out_channels,
+                                       const int32_t out_offset,
+                                       const int32_t out_shift,
+                                       const int32_t out_mult,
+                                       const int32_t activation_min,
+                                       const int32_t activation_max)
+{
+    switch (variant) {
+    case ESP_NN_VARIANT_ANSI:
+        esp_nn_fully_connected_s8_ansi(input_data, input_offset, row_len, filter_data,
+                                       filter_offset, bias, out_data, out_channels, out_offset,
+                                       out_shift, out_mult, activation_min, activation_max);
+        break;
+    case ESP_NN_VARIANT_OPT:
+        esp_nn_fully_connected_s8_opt(input_data, input_offset, row_len, filter_data,
+                                      filter_offset, bias, out_data, out_channels, out_offset,
+                                      out_shift, out_mult, activation_min, activation_max);
+        break;
+    default:
+        esp_nn_fully_connected_s8(input_data, input_offset, row_len, filter_data,
+                                  filter_offset, bias, out_data, out_channels, out_offset,
+                                  out_shift, out_mult, activation_min, activation_max);
+        break;
+    }
+}
@@ -177,3 +177,165 @@ void esp_nn_conv_s8_ansi(const data_dims_t *input_dims,
         }
     }
 }
+
+void esp_nn_conv_s8_r_ansi(const data_dims_t *input_dims,
+                           const int8_t *input_data,
+                           const data_dims_t *filter_dims,
+                           const int8_t *filter_data,
+                           const int32_t *bias,
+                           const data_dims_t *output_dims,
+                           int8_t *out_data,
+                           const conv_params_t *conv_params,
+                           const quant_data_t *quant_data,
+                           void *scratch)
+{
+    (void) scratch;
+    esp_nn_conv_s8_ansi(input_dims, input_data, filter_dims, filter_data, bias,
+                        output_dims, out_data, conv_params, quant_data);
+}
+
+/**
+ * 16 bit activations: symmetric, so in_offset and out_offset are not used.
+ * The accumulator is 64 bit, as in tflite.
+ */
+void esp_nn_conv_s16_s8_ansi(const data_dims_t *input_dims,
+                             const int16_t *input_data,
+                             const data_dims_t *filter_dims,
+                             const int8_t *filter_data,
+                             const int64_t *bias,
+                             const data_dims_t *output_dims,
+                             int16_t *out_data,
+                             const conv_params_t *conv_params,
+                             const quant_data_t *quant_data)
+{
+    const uint16_t input_wd = input_dims->width;
+    const uint16_t input_ht = input_dims->height;
+    const uint16_t in_channels = input_dims->channels;
+    const uint16_t pad_wd = conv_params->padding.width;
+    const uint16_t pad_ht = conv_params->padding.height;
+    const uint16_t stride_wd = conv_params->stride.width;
+    const uint16_t stride_ht = conv_params->stride.height;
+    const uint16_t filter_wd = filter_dims->width;
+    const uint16_t filter_ht = filter_dims->height;
+    const uint16_t out_wd = output_dims->width;
+    const uint16_t out_ht = output_dims->height;
+    const uint16_t out_channels = output_dims->channels;
+    const int32_t *out_shift = quant_data->shift;
+    const int32_t *out_mult = quant_data->mult;
+    const int32_t activation_min = conv_params->activation.min;
+    const int32_t activation_max = conv_params->activation.max;
+
+    int32_t out_ch_idx, out_y, out_x, in_ch_idx, filter_y_idx, filter_x_idx;
+
+    for (out_y = 0; out_y < out_ht; out_y++) {
+        for (out_x = 0; out_x < out_wd; out_x++) {
+            for (out_ch_idx = 0; out_ch_idx < out_channels; out_ch_idx++) {
+                int64_t conv_out = 0;
+
+                const int32_t base_y = stride_ht * out_y - pad_ht;
+                const int32_t base_x = stride_wd * out_x - pad_wd;
+
+                const int32_t filter_y_start = max(0, -base_y);
+                const int32_t filter_x_start = max(0, -base_x);
+
+                const int32_t filter_y_end = min(filter_ht, input_ht - base_y);
+                const int32_t filter_x_end = min(filter_wd, input_wd - base_x);
+
+                for (filter_y_idx = filter_y_start; filter_y_idx < filter_y_end; filter_y_idx++) {
+                    for (filter_x_idx = filter_x_start; filter_x_idx < filter_x_end; filter_x_idx++) {
+                        const int32_t in_row = base_y + filter_y_idx;
+                        const int32_t in_col = base_x + filter_x_idx;
+                        int32_t input_base_offset = (in_row * input_wd + in_col) * in_channels;
+                        int32_t filter_base_offset = out_ch_idx * in_channels * filter_ht * filter_wd +
+                                                       (filter_y_idx * filter_wd + filter_x_idx) * in_channels;
+                        for (in_ch_idx = 0; in_ch_idx < in_channels; in_ch_idx++) {
+                            conv_out += (int64_t) input_data[input_base_offset + in_ch_idx] *
+                                        filter_data[filter_base_offset + in_ch_idx];
+                        }
+                    }
+                }
+                if (bias) {
+                    conv_out += bias[out_ch_idx];
+                }
+                int32_t result = esp_nn_multiply_by_quantized_mult_s64(conv_out, out_mult[out_ch_idx],
+                                                                       out_shift[out_ch_idx]);
+                result = max(result, activation_min);
+                result = min(result, activation_max);
+                *out_data++ = (int16_t) result;
+            }
+        }
+    }
+}
+
+void esp_nn_conv_sparse_s8_ansi(const data_dims_t *input_dims,
+                                const int8_t *input_data,
+                                const data_dims_t *filter_dims,
+                                const sparse_filter_t *filter,
+                                const int32_t *bias,
+                                const data_dims_t *output_dims,
+                                int8_t *out_data,
+                                const conv_params_t *conv_params,
+                                const quant_data_t *quant_data)
+{
+    const uint16_t input_wd = input_dims->width;
+    const uint16_t input_ht = input_dims->height;
+    const uint16_t in_channels = input_dims->channels;
+    const int32_t input_offset = conv_params->in_offset;
+    const int32_t out_offset = conv_params->out_offset;
+    const uint16_t pad_wd = conv_params->padding.width;
+    const uint16_t pad_ht = conv_params->padding.height;
+    const uint16_t stride_wd = conv_params->stride.width;
+    const uint16_t stride_ht = conv_params->stride.height;
+    const uint16_t filter_wd = filter_dims->width;
+    const uint16_t filter_ht = filter_dims->height;
+    const uint16_t out_wd = output_dims->width;
+    const uint16_t out_ht = output_dims->height;
+    const uint16_t out_channels = output_dims->channels;
+    const int32_t *out_shift = quant_data->shift;
+    const int32_t *out_mult = quant_data->mult;
+    const int32_t activation_min = conv_params->activation.min;
+    const int32_t activation_max = conv_params->activation.max;
+    const int32_t block_len = filter->block_len;
+    const int32_t row_len = filter_wd * filter_ht * in_channels;
+    const int32_t blocks = ESP_NN_SPARSE_BLOCKS(row_len, block_len);
+    const int32_t bitmap_bytes = ESP_NN_SPARSE_BITMAP_BYTES(row_len, block_len);
+
+    for (int32_t out_y = 0; out_y < out_ht; out_y++) {
+        for (int32_t out_x = 0; out_x < out_wd; out_x++) {
+            const int32_t base_y = stride_ht * out_y - pad_ht;
+            const int32_t base_x = stride_wd * out_x - pad_wd;
+            const uint8_t *bitmap = filter->bitmap;
+            const int8_t *values = filter->values;
+
+            for (int32_t out_ch_idx = 0; out_ch_idx < out_channels; out_ch_idx++) {
+                int32_t conv_out = 0;
+                for (int32_t block = 0; block < blocks; block++) {
+                    if ((bitmap[block >> 3] & (1 << (block & 7))) == 0) {
+                        continue;
+                    }
+                    /* in_channels is a multiple of block_len: the block is in one tap */
+                    const int32_t tap = block * block_len / in_channels;
+                    const int32_t in_ch_start = block * block_len - tap * in_channels;
+                    const int32_t in_row = base_y + tap / filter_wd;
+                    const int32_t in_col = base_x + tap % filter_wd;
+                    if (in_row >= 0 && in_row < input_ht && in_col >= 0 && in_col < input_wd) {
+                        const int8_t *input = input_data + (in_row * input_wd + in_col) * in_channels + in_ch_start;
+                        for (int32_t i = 0; i < block_len; i++) {
+                            conv_out += (input[i] + input_offset) * values[i];
+                        }
+                    }
+                    values += block_len;
+                }
+                bitmap += bitmap_bytes;
+                if (bias) {
+                    conv_out += bias[out_ch_idx];
+                }
+                conv_out = esp_nn_multiply_by_quantized_mult(conv_out, out_mult[out_ch_idx], out_shift[out_ch_idx]);
+                conv_out += out_offset;
+                conv_out = max(conv_out, activation_min);
+                conv_out = min(conv_out, activation_max);
+                *out_data++ = (int8_t) conv_out;
+            }
+        }
+    }
+}
@@ -52,7 +52,8 @@
 
 #include <common_functions.h>
 
-static int16_t *scratch_buffer = NULL;
+/* used by esp_nn_conv_s8_esp32p4, set with esp_nn_set_conv_scratch_buf_esp32p4 */
+static int16_t *legacy_scratch_buffer = NULL;
 
 __attribute__ ((noinline))
 static void esp_nn_conv_s8_1x1(const data_dims_t *input_dims,
@@ -357,9 +358,8 @@ int esp_nn_get_conv_scratch_size_esp32p4(const data_dims_t *input_dims,
     return align_buf_size;
 }
 
-void esp_nn_set_conv_scratch_buf_esp32p4(void *buf)
+static inline void esp_nn_enable_vector_ext(void)
 {
-    // We are going to use the vector extensions
     asm volatile (
         "csrsi 0x7f2, 0b01      \n\t" // enable `esp` vector extension
         "li x29, 0b10           \n\t"
@@ -368,24 +368,33 @@ void esp_nn_set_conv_scratch_buf_esp32p4(void *buf)
         :
         : "x29"
     );
+}
 
-    scratch_buffer = (int16_t *) buf;
+void esp_nn_set_conv_scratch_buf_esp32p4(void *buf)
+{
+    // We are going to use the vector extensions
+    esp_nn_enable_vector_ext();
+    legacy_scratch_buffer = (int16_t *) buf;
 }
 
-void esp_nn_conv_s8_esp32p4(const data_dims_t *input_dims,
-                            const int8_t *input,
-                            const data_dims_t *filter_dims,
-                            const int8_t *filter_data,
-                            const int32_t *bias,
-                            const data_dims_t *output_dims,
-                            int8_t *out_data,
-                            const conv_params_t *conv_params,
-                            const quant_data_t *quant_data)
+void esp_nn_conv_s8_r_esp32p4(const data_dims_t *input_dims,
+                              const int8_t *input,
+                              const data_dims_t *filter_dims,
+                              const int8_t *filter_data,
+                              const int32_t *bias,
+                              const data_dims_t *output_dims,
+                              int8_t *out_data,
+                              const conv_params_t *conv_params,
+                              const quant_data_t *quant_data,
+                              void *scratch)
 {
+    int16_t *scratch_buffer = (int16_t *) scratch;
     if (scratch_buffer == NULL) {
         printf("esp_nn_conv error! scratch_buffer not set!\n");
         return;
     }
+    // The vector extensions are enabled per core, not by the caller of the setter
+    esp_nn_enable_vector_ext();
 
     const uint16_t filter_wd = filter_dims->width;
     const uint16_t filter_ht = filter_dims->height;
@@ -408,3 +417,17 @@ void esp_nn_conv_s8_esp32p4(const data_dims_t *input_dims,
                            output_dims, out_data, conv_params, quant_data);
     }
 }
+
+void esp_nn_conv_s8_esp32p4(const data_dims_t *input_dims,
+                            const int8_t *input,
+                            const data_dims_t *filter_dims,
+                            const int8_t *filter_data,
+                            const int32_t *bias,
+                            const data_dims_t *output_dims,
+                            int8_t *out_data,
+                            const conv_params_t *conv_params,
+                            const quant_data_t *quant_data)
+{
+    esp_nn_conv_s8_r_esp32p4(input_dims, input, filter_dims, filter_data, bias,
+                             output_dims, out_data, conv_params, quant_data, legacy_scratch_buffer);
+}
@@ -51,7 +51,8 @@
 
 #include <common_functions.h>
 
-static int16_t *scratch_buffer = NULL;
+/* used by esp_nn_conv_s8_esp32s3, set with esp_nn_set_conv_scratch_buf_esp32s3 */
+static int16_t *legacy_scratch_buffer = NULL;
 
 extern void esp_nn_conv_s8_mult8_1x1_esp32s3(
                 const int8_t *input_data,
@@ -146,19 +147,21 @@ int esp_nn_get_conv_scratch_size_esp32s3(const data_dims_t *input_dims,
 
 void esp_nn_set_conv_scratch_buf_esp32s3(void *buf)
 {
-    scratch_buffer = (int16_t *) buf;
+    legacy_scratch_buffer = (int16_t *) buf;
 }
 
-void esp_nn_conv_s8_esp32s3(const data_dims_t *input_dims,
-                            const int8_t *input,
-                            const data_dims_t *filter_dims,
-                            const int8_t *filter_data,
-                            const int32_t *bias,
-                            const data_dims_t *output_dims,
-                            int8_t *out_data,
-                            const conv_params_t *conv_params,
-                            const quant_data_t *quant_data)
+void esp_nn_conv_s8_r_esp32s3(const data_dims_t *input_dims,
+                              const int8_t *input,
+                              const data_dims_t *filter_dims,
+                              const int8_t *filter_data,
+                              const int32_t *bias,
+                              const data_dims_t *output_dims,
+                              int8_t *out_data,
+                              const conv_params_t *conv_params,
+                              const quant_data_t *quant_data,
+                              void *scratch)
 {
+    int16_t *scratch_buffer = (int16_t *) scratch;
     if (scratch_buffer == NULL) {
         printf("esp_nn_conv error! scratch_buffer not set!\n");
         return;
@@ -267,3 +270,17 @@ void esp_nn_conv_s8_esp32s3(const data_dims_t *input_dims,
             out_shift, out_mult, activation_min, activation_max, scratch_data);
     }
 }
+
+void esp_nn_conv_s8_esp32s3(const data_dims_t *input_dims,
+                            const int8_t *input,
+                            const data_dims_t *filter_dims,
+                            const int8_t *filter_data,
+                            const int32_t *bias,
+                            const data_dims_t *output_dims,
+                            int8_t *out_data,
+                            const conv_params_t *conv_params,
+                            const quant_data_t *quant_data)
+{
+    esp_nn_conv_s8_r_esp32s3(input_dims, input, filter_dims, filter_data, bias,
+                             output_dims, out_data, conv_params, quant_data, legacy_scratch_buffer);
+}
@@ -0,0 +1,231 @@
+// Copyright 2025 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * im2col + GEMM convolution:
+ *
+ *  > The patches of ESP_NN_IM2COL_PIXELS output pixels are copied into
+ *      columns of `filter_ht * filter_wd * in_ch` bytes, in the order of the
+ *      filter data, so each output is a dot product of two contiguous rows,
+ *      whatever the channel count. Padding is filled with -input_offset.
+ *  > The input offset is taken out of the inner loop:
+ *          sum((input + input_offset) * filter)
+ *              = sum(input * filter) + input_offset * sum(filter)
+ *      and the second term is added along with the bias.
+ *  > The GEMM computes 2 output channels for the 4 pixels of a block at
+ *      once, so each filter byte is loaded once for 4 pixels and each column
+ *      byte once for 2 channels.
+ */
+
+#include <esp_nn_defs.h>
+
+#include <common_functions.h>
+
+#define ESP_NN_IM2COL_PIXELS    4
+
+int esp_nn_get_conv_im2col_scratch_size_opt(const data_dims_t *input_dims,
+                                            const data_dims_t *filter_dims,
+                                            const data_dims_t *output_dims,
+                                            const conv_params_t *conv_params)
+{
+    const int32_t col_len = filter_dims->width * filter_dims->height * input_dims->channels;
+    /* bias terms, columns; 4 bytes for the alignment of the bias terms */
+    return output_dims->channels * sizeof(int32_t) + ESP_NN_IM2COL_PIXELS * col_len + 4;
+}
+
+/* copy the patch of output pixel (out_x, out_y) into `col` */
+static inline void esp_nn_im2col_s8(const int8_t *input_data,
+                                    const uint16_t input_wd,
+                                    const uint16_t input_ht,
+                                    const uint16_t in_channels,
+                                    const int8_t pad_val,
+                                    const int32_t base_x,
+                                    const int32_t base_y,
+                                    const uint16_t filter_wd,
+                                    const uint16_t filter_ht,
+                                    int8_t *col)
+{
+    const int32_t row_len = filter_wd * in_channels;
+    const bool x_inside = base_x >= 0 && base_x + filter_wd <= input_wd;
+
+    for (int32_t filter_y_idx = 0; filter_y_idx < filter_ht; filter_y_idx++) {
+        const int32_t in_row = base_y + filter_y_idx;
+        if (in_row < 0 || in_row >= input_ht) {
+            memset(col, pad_val, row_len);
+        } else if (x_inside) {
+            memcpy(col, input_data + (in_row * input_wd + base_x) * in_channels, row_len);
+        } else {
+            for (int32_t filter_x_idx = 0; filter_x_idx < filter_wd; filter_x_idx++) {
+                const int32_t in_col = base_x + filter_x_idx;
+                if (in_col < 0 || in_col >= input_wd) {
+                    memset(col + filter_x_idx * in_channels, pad_val, in_channels);
+                } else {
+                    memcpy(col + filter_x_idx * in_channels,
+                           input_data + (in_row * input_wd + in_col) * in_channels, in_channels);
+                }
+            }
+        }
+        col += row_len;
+    }
+}
+
+__NN_FORCE_INLINE__ int8_t esp_nn_im2col_requant(int32_t conv_out,
+                                                 const int32_t mult,
+                                                 const int32_t shift,
+                                                 const int32_t out_offset,
+                                                 const int32_t activation_min,
+                                                 const int32_t activation_max)
+{
+    conv_out = esp_nn_multiply_by_quantized_mult_fast(conv_out, mult, shift);
+    conv_out += out_offset;
+    conv_out = max(conv_out, activation_min);
+    conv_out = min(conv_out, activation_max);
+    return (int8_t) conv_out;
+}
+
+void esp_nn_conv_im2col_s8_r_opt(const data_dims_t *input_dims,
+                                 const int8_t *input_data,
+                                 const data_dims_t *filter_dims,
+                                 const int8_t *filter_data,
+                                 const int32_t *bias,
+                                 const data_dims_t *output_dims,
+                                 int8_t *out_data,
+                                 const conv_params_t *conv_params,
+                                 const quant_data_t *quant_data,
+                                 void *scratch)
+{
+    const uint16_t input_wd = input_dims->width;
+    const uint16_t input_ht = input_dims->height;
+    const uint16_t in_channels = input_dims->channels;
+    const int32_t input_offset = conv_params->in_offset;
+    const int32_t out_offset = conv_params->out_offset;
+    const uint16_t pad_wd = conv_params->padding.width;
+    const uint16_t pad_ht = conv_params->padding.height;
+    const uint16_t stride_wd = conv_params->stride.width;
+    const uint16_t stride_ht = conv_params->stride.height;
+    const uint16_t filter_wd = filter_dims->width;
+    const uint16_t filter_ht = filter_dims->height;
+    const uint16_t out_wd = output_dims->width;
+    const uint16_t out_ht = output_dims->height;
+    const uint16_t out_channels = output_dims->channels;
+    const int32_t *out_shift = quant_data->shift;
+    const int32_t *out_mult = quant_data->mult;
+    const int32_t activation_min = conv_params->activation.min;
+    const int32_t activation_max = conv_params->activation.max;
+
+    const int32_t col_len = filter_wd * filter_ht * in_channels;
+    const int8_t pad_val = (int8_t) -input_offset;
+
+    int32_t *bias_terms = (int32_t *) (((uintptr_t) scratch + 3) & ~3);
+    int8_t *cols = (int8_t *) (bias_terms + out_channels);
+
+    /* bias + input_offset * sum(filter), per output channel */
+    const int8_t *filter_ptr = filter_data;
+    for (int32_t out_ch_idx = 0; out_ch_idx < out_channels; out_ch_idx++) {
+        int32_t filter_sum = 0;
+        for (int32_t k = 0; k < col_len; k++) {
+            filter_sum += *filter_ptr++;
+        }
+        bias_terms[out_ch_idx] = filter_sum * input_offset + (bias ? bias[out_ch_idx] : 0);
+    }
+
+    const int32_t out_pixels = out_wd * out_ht;
+    for (int32_t pixel = 0; pixel < out_pixels; pixel += ESP_NN_IM2COL_PIXELS) {
+        const int32_t block = min(out_pixels - pixel, ESP_NN_IM2COL_PIXELS);
+
+        for (int32_t i = 0; i < block; i++) {
+            const int32_t out_y = (pixel + i) / out_wd;
+            const int32_t out_x = (pixel + i) % out_wd;
+            esp_nn_im2col_s8(input_data, input_wd, input_ht, in_channels, pad_val,
+                             out_x * stride_wd - pad_wd, out_y * stride_ht - pad_ht,
+                             filter_wd, filter_ht, cols + i * col_len);
+        }
+
+        int8_t *out_ptr = out_data + pixel * out_channels;
+        int32_t out_ch_idx = 0;
+        if (block == ESP_NN_IM2COL_PIXELS) {
+            for (; out_ch_idx < out_channels - 1; out_ch_idx += 2) {
+                const int8_t *filter0 = filter_data + out_ch_idx * col_len;
+                const int8_t *filter1 = filter0 + col_len;
+                const int8_t *col0 = cols;
+                const int8_t *col1 = col0 + col_len;
+                const int8_t *col2 = col1 + col_len;
+                const int8_t *col3 = col2 + col_len;
+                int32_t acc00 = 0, acc01 = 0, acc02 = 0, acc03 = 0;
+                int32_t acc10 = 0, acc11 = 0, acc12 = 0, acc13 = 0;
+                for (int32_t k = 0; k < col_len; k++) {
+                    const int32_t f0 = filter0[k];
+                    const int32_t f1 = filter1[k];
+                    const int32_t c0 = col0[k];
+                    const int32_t c1 = col1[k];
+                    const int32_t c2 = col2[k];
+                    const int32_t c3 = col3[k];
+                    acc00 += c0 * f0;
+                    acc01 += c1 * f0;
+                    acc02 += c2 * f0;
+                    acc03 += c3 * f0;
+                    acc10 += c0 * f1;
+                    acc11 += c1 * f1;
+                    acc12 += c2 * f1;
+                    acc13 += c3 * f1;
+                }
+                const int32_t mult0 = out_mult[out_ch_idx], shift0 = out_shift[out_ch_idx];
+                const int32_t mult1 = out_mult[out_ch_idx + 1], shift1 = out_shift[out_ch_idx + 1];
+                const int32_t bias0 = bias_terms[out_ch_idx], bias1 = bias_terms[out_ch_idx + 1];
+                int8_t *out0 = out_ptr + out_ch_idx;
+                out0[0] = esp_nn_im2col_requant(acc00 + bias0, mult0, shift0, out_offset,
+                                                activation_min, activation_max);
+                out0[1] = esp_nn_im2col_requant(acc10 + bias1, mult1, shift1, out_offset,
+                                                activation_min, activation_max);
+                out0 += out_channels;
+                out0[0] = esp_nn_im2col_requant(acc01 + bias0, mult0, shift0, out_offset,
+                                                activation_min, activation_max);
+                out0[1] = esp_nn_im2col_requant(acc11 + bias1, mult1, shift1, out_offset,
+                                                activation_min, activation_max);
+                out0 += out_channels;
+                out0[0] = esp_nn_im2col_requant(acc02 + bias0, mult0, shift0, out_offset,
+                                                activation_min, activation_max);
+                out0[1] = esp_nn_im2col_requant(acc12 + bias1, mult1, shift1, out_offset,
+                                                activation_min, activation_max);
+                out0 += out_channels;
+                out0[0] = esp_nn_im2col_requant(acc03 + bias0, mult0, shift0, out_offset,
+                                                activation_min, activation_max);
+                out0[1] = esp_nn_im2col_requant(acc13 + bias1, mult1, shift1, out_offset,
+                                                activation_min, activation_max);
+            }
+        }
+        /* leftover channel, or last block of less than ESP_NN_IM2COL_PIXELS pixels */
+        for (; out_ch_idx < out_channels; out_ch_idx++) {
+            const int8_t *filter0 = filter_data + out_ch_idx * col_len;
+            for (int32_t i = 0; i < block; i++) {
+                const int8_t *col = cols + i * col_len;
+                int32_t acc = 0;
+                int32_t k = 0;
+                for (; k < col_len - 3; k += 4) {
+                    acc += col[k] * filter0[k];
+                    acc += col[k + 1] * filter0[k + 1];
+                    acc += col[k + 2] * filter0[k + 2];
+                    acc += col[k + 3] * filter0[k + 3];
+                }
+                for (; k < col_len; k++) {
+                    acc += col[k] * filter0[k];
+                }
+                out_ptr[i * out_channels + out_ch_idx] =
+                    esp_nn_im2col_requant(acc + bias_terms[out_ch_idx], out_mult[out_ch_idx],
+                                          out_shift[out_ch_idx], out_offset,
+                                          activation_min, activation_max);
+            }
+        }
+    }
+}
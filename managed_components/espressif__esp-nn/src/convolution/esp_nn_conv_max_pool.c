@@ -0,0 +1,122 @@
+// Copyright 2025 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdint.h>
+
+#include <esp_nn.h>
+
+/**
+ * Dims and params of the convolution of one band: the input rows that feed
+ * `pool_params->filter.height` conv output rows.
+ */
+static void esp_nn_conv_max_pool_band(const data_dims_t *input_dims,
+                                      const data_dims_t *filter_dims,
+                                      const conv_params_t *conv_params,
+                                      const pool_params_t *pool_params,
+                                      const data_dims_t *output_dims,
+                                      data_dims_t *band_in_dims,
+                                      data_dims_t *band_out_dims,
+                                      conv_params_t *band_params)
+{
+    const int32_t conv_out_wd =
+        (input_dims->width - filter_dims->width) / conv_params->stride.width + 1;
+
+    *band_in_dims = *input_dims;
+    band_in_dims->height = (pool_params->filter.height - 1) * conv_params->stride.height +
+                           filter_dims->height;
+
+    band_out_dims->width = conv_out_wd;
+    band_out_dims->height = pool_params->filter.height;
+    band_out_dims->channels = output_dims->channels;
+    band_out_dims->extra = 1;
+
+    *band_params = *conv_params;
+    band_params->padding.width = 0;
+    band_params->padding.height = 0;
+}
+
+int esp_nn_get_conv_max_pool_rows_size(const data_dims_t *input_dims,
+                                       const data_dims_t *filter_dims,
+                                       const conv_params_t *conv_params,
+                                       const pool_params_t *pool_params,
+                                       const data_dims_t *output_dims)
+{
+    data_dims_t band_in_dims, band_out_dims;
+    conv_params_t band_params;
+    esp_nn_conv_max_pool_band(input_dims, filter_dims, conv_params, pool_params, output_dims,
+                              &band_in_dims, &band_out_dims, &band_params);
+    return band_out_dims.width * band_out_dims.height * band_out_dims.channels;
+}
+
+int esp_nn_get_conv_max_pool_scratch_size(const data_dims_t *input_dims,
+                                          const data_dims_t *filter_dims,
+                                          const conv_params_t *conv_params,
+                                          const pool_params_t *pool_params,
+                                          const data_dims_t *output_dims)
+{
+    data_dims_t band_in_dims, band_out_dims;
+    conv_params_t band_params;
+    esp_nn_conv_max_pool_band(input_dims, filter_dims, conv_params, pool_params, output_dims,
+                              &band_in_dims, &band_out_dims, &band_params);
+    return esp_nn_get_conv_scratch_size(&band_in_dims, filter_dims, &band_out_dims, &band_params);
+}
+
+void esp_nn_conv_max_pool_s8_r(const data_dims_t *input_dims,
+                               const int8_t *input_data,
+                               const data_dims_t *filter_dims,
+                               const int8_t *filter_data,
+                               const int32_t *bias,
+                               const conv_params_t *conv_params,
+                               const quant_data_t *quant_data,
+                               const pool_params_t *pool_params,
+                               const data_dims_t *output_dims,
+                               int8_t *out_data,
+                               int8_t *conv_rows,
+                               void *scratch)
+{
+    data_dims_t band_in_dims, band_out_dims;
+    conv_params_t band_params;
+    esp_nn_conv_max_pool_band(input_dims, filter_dims, conv_params, pool_params, output_dims,
+                              &band_in_dims, &band_out_dims, &band_params);
+
+    const int32_t channels = output_dims->channels;
+    const int32_t in_row_size = input_dims->width * input_dims->channels;
+    const int32_t out_row_size = output_dims->width * channels;
+    /* input rows between the first rows of two consecutive bands */
+    const int32_t band_step = pool_params->stride.height * conv_params->stride.height;
+
+    for (int32_t out_y = 0; out_y < output_dims->height; out_y++) {
+        esp_nn_conv_s8_r(&band_in_dims, input_data + out_y * band_step * in_row_size,
+                         filter_dims, filter_data, bias,
+                         &band_out_dims, conv_rows, &band_params, quant_data, scratch);
+#if defined(ARCH_ESP32_S3)
+        /* the S3 assembly kernel only takes channel counts multiple of 4 */
+        if (channels % 4 != 0) {
+            esp_nn_max_pool_s8_ansi(conv_rows, band_out_dims.width, band_out_dims.height,
+                                    out_data + out_y * out_row_size, output_dims->width, 1,
+                                    pool_params->stride.width, pool_params->stride.height,
+                                    pool_params->filter.width, pool_params->filter.height,
+                                    0, 0, pool_params->activation.min,
+                                    pool_params->activation.max, channels);
+            continue;
+        }
+#endif
+        esp_nn_max_pool_s8(conv_rows, band_out_dims.width, band_out_dims.height,
+                           out_data + out_y * out_row_size, output_dims->width, 1,
+                           pool_params->stride.width, pool_params->stride.height,
+                           pool_params->filter.width, pool_params->filter.height,
+                           0, 0, pool_params->activation.min,
+                           pool_params->activation.max, channels);
+    }
+}
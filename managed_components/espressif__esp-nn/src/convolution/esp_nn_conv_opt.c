@@ -13,20 +13,68 @@
 // limitations under the License.
 
 #include <esp_nn_defs.h>
+#include <esp_nn_ansi_headers.h>
 
 #include <common_functions.h>
 
+/**
+ * Backends, picked from the layer shape:
+ *  - 1x1 filters: direct loop, the channels are already contiguous.
+ *  - 3x3 stride 1 with at least ESP_NN_WINOGRAD_MIN_IN_CH input channels:
+ *      Winograd F(2x2, 3x3), see esp_nn_conv_winograd_opt.c. Below that the
+ *      transforms cost more than the multiplies they save.
+ *  - all other filters: im2col + GEMM, see esp_nn_conv_im2col_opt.c.
+ *  - no scratch buffer given: direct loop.
+ */
+#define ESP_NN_WINOGRAD_MIN_IN_CH       8
+/* the transformed filters take 32 bytes per filter channel */
+#define ESP_NN_WINOGRAD_MAX_SCRATCH     (32 * 1024)
+
+typedef enum {
+    CONV_OPT_DIRECT,
+    CONV_OPT_IM2COL,
+    CONV_OPT_WINOGRAD,
+} conv_opt_backend_t;
+
+/* used by esp_nn_conv_s8_opt, set with esp_nn_set_conv_scratch_buf_opt */
+static void *legacy_scratch_buffer = NULL;
+
+static conv_opt_backend_t esp_nn_conv_opt_backend(const data_dims_t *input_dims,
+                                                  const data_dims_t *filter_dims,
+                                                  const data_dims_t *output_dims,
+                                                  const conv_params_t *conv_params,
+                                                  int *scratch_size)
+{
+    *scratch_size = 0;
+    if (filter_dims->width == 1 && filter_dims->height == 1) {
+        return CONV_OPT_DIRECT;
+    }
+    if (input_dims->channels >= ESP_NN_WINOGRAD_MIN_IN_CH) {
+        int size = esp_nn_get_conv_winograd_scratch_size_opt(input_dims, filter_dims,
+                                                             output_dims, conv_params);
+        if (size > 0 && size <= ESP_NN_WINOGRAD_MAX_SCRATCH) {
+            *scratch_size = size;
+            return CONV_OPT_WINOGRAD;
+        }
+    }
+    *scratch_size = esp_nn_get_conv_im2col_scratch_size_opt(input_dims, filter_dims,
+                                                           output_dims, conv_params);
+    return CONV_OPT_IM2COL;
+}
+
 int esp_nn_get_conv_scratch_size_opt(const data_dims_t *input_dims,
                                      const data_dims_t *filter_dims,
                                      const data_dims_t *output_dims,
                                      const conv_params_t *conv_params)
 {
-    return 0;
+    int scratch_size;
+    esp_nn_conv_opt_backend(input_dims, filter_dims, output_dims, conv_params, &scratch_size);
+    return scratch_size;
 }
 
 void esp_nn_set_conv_scratch_buf_opt(const void *buf)
 {
-
+    legacy_scratch_buffer = (void *) buf;
 }
 
 __attribute__ ((noinline))
@@ -91,25 +139,19 @@ static void esp_nn_conv_s8_1x1(const data_dims_t *input_dims,
  * Assumption 2: Pointers are valid
  * Assumption 3: dialation width = 1
  */
-void esp_nn_conv_s8_opt(const data_dims_t *input_dims,
-                        const int8_t *input_data,
-                        const data_dims_t *filter_dims,
-                        const int8_t *filter_data,
-                        const int32_t *bias,
-                        const data_dims_t *output_dims,
-                        int8_t *out_data,
-                        const conv_params_t *conv_params,
-                        const quant_data_t *quant_data)
+__attribute__ ((noinline))
+static void esp_nn_conv_s8_direct(const data_dims_t *input_dims,
+                                  const int8_t *input_data,
+                                  const data_dims_t *filter_dims,
+                                  const int8_t *filter_data,
+                                  const int32_t *bias,
+                                  const data_dims_t *output_dims,
+                                  int8_t *out_data,
+                                  const conv_params_t *conv_params,
+                                  const quant_data_t *quant_data)
 {
     const uint16_t filter_wd = filter_dims->width;
     const uint16_t filter_ht = filter_dims->height;
-
-    if (filter_wd == 1 && filter_ht == 1) {
-        esp_nn_conv_s8_1x1(input_dims, input_data, filter_data, bias,
-                           output_dims, out_data, conv_params, quant_data);
-        return;
-    }
-
     const uint16_t input_wd = input_dims->width;
     const uint16_t input_ht = input_dims->height;
     const uint16_t in_channels = input_dims->channels;
@@ -177,3 +219,239 @@ void esp_nn_conv_s8_opt(const data_dims_t *input_dims,
         }
     }
 }
+
+void esp_nn_conv_s8_r_opt(const data_dims_t *input_dims,
+                          const int8_t *input_data,
+                          const data_dims_t *filter_dims,
+                          const int8_t *filter_data,
+                          const int32_t *bias,
+                          const data_dims_t *output_dims,
+                          int8_t *out_data,
+                          const conv_params_t *conv_params,
+                          const quant_data_t *quant_data,
+                          void *scratch)
+{
+    if (filter_dims->width == 1 && filter_dims->height == 1) {
+        esp_nn_conv_s8_1x1(input_dims, input_data, filter_data, bias,
+                           output_dims, out_data, conv_params, quant_data);
+        return;
+    }
+
+    int scratch_size;
+    conv_opt_backend_t backend = esp_nn_conv_opt_backend(input_dims, filter_dims, output_dims,
+                                                         conv_params, &scratch_size);
+    if (scratch == NULL) {
+        backend = CONV_OPT_DIRECT;
+    }
+    switch (backend) {
+    case CONV_OPT_WINOGRAD:
+        esp_nn_conv_winograd_s8_r_opt(input_dims, input_data, filter_dims, filter_data, bias,
+                                      output_dims, out_data, conv_params, quant_data, scratch);
+        break;
+    case CONV_OPT_IM2COL:
+        esp_nn_conv_im2col_s8_r_opt(input_dims, input_data, filter_dims, filter_data, bias,
+                                    output_dims, out_data, conv_params, quant_data, scratch);
+        break;
+    default:
+        esp_nn_conv_s8_direct(input_dims, input_data, filter_dims, filter_data, bias,
+                              output_dims, out_data, conv_params, quant_data);
+        break;
+    }
+}
+
+void esp_nn_conv_s8_opt(const data_dims_t *input_dims,
+                        const int8_t *input_data,
+                        const data_dims_t *filter_dims,
+                        const int8_t *filter_data,
+                        const int32_t *bias,
+                        const data_dims_t *output_dims,
+                        int8_t *out_data,
+                        const conv_params_t *conv_params,
+                        const quant_data_t *quant_data)
+{
+    esp_nn_conv_s8_r_opt(input_dims, input_data, filter_dims, filter_data, bias,
+                         output_dims, out_data, conv_params, quant_data, legacy_scratch_buffer);
+}
+
+/**
+ * 16 bit activations. With the filter window clipped to the image, each
+ * filter row covers a contiguous run of input, so a row is one dot product
+ * per output channel. 4 output channels are done per pass, sharing the
+ * input loads, with the products summed in 32 bits over runs of
+ * ESP_NN_S16_S8_ACC32_LEN.
+ */
+void esp_nn_conv_s16_s8_opt(const data_dims_t *input_dims,
+                            const int16_t *input_data,
+                            const data_dims_t *filter_dims,
+                            const int8_t *filter_data,
+                            const int64_t *bias,
+                            const data_dims_t *output_dims,
+                            int16_t *out_data,
+                            const conv_params_t *conv_params,
+                            const quant_data_t *quant_data)
+{
+    const uint16_t input_wd = input_dims->width;
+    const uint16_t input_ht = input_dims->height;
+    const uint16_t in_channels = input_dims->channels;
+    const uint16_t pad_wd = conv_params->padding.width;
+    const uint16_t pad_ht = conv_params->padding.height;
+    const uint16_t stride_wd = conv_params->stride.width;
+    const uint16_t stride_ht = conv_params->stride.height;
+    const uint16_t filter_wd = filter_dims->width;
+    const uint16_t filter_ht = filter_dims->height;
+    const uint16_t out_wd = output_dims->width;
+    const uint16_t out_ht = output_dims->height;
+    const uint16_t out_channels = output_dims->channels;
+    const int32_t *out_shift = quant_data->shift;
+    const int32_t *out_mult = quant_data->mult;
+    const int32_t activation_min = conv_params->activation.min;
+    const int32_t activation_max = conv_params->activation.max;
+    const int32_t filter_size = filter_wd * filter_ht * in_channels;
+
+    for (int32_t out_y = 0; out_y < out_ht; out_y++) {
+        const int32_t base_y = stride_ht * out_y - pad_ht;
+        const int32_t filter_y_start = max(0, -base_y);
+        const int32_t filter_y_end = min(filter_ht, input_ht - base_y);
+        for (int32_t out_x = 0; out_x < out_wd; out_x++) {
+            const int32_t base_x = stride_wd * out_x - pad_wd;
+            const int32_t filter_x_start = max(0, -base_x);
+            const int32_t filter_x_end = min(filter_wd, input_wd - base_x);
+            const int32_t run_len = (filter_x_end - filter_x_start) * in_channels;
+            const int16_t *input_start = input_data +
+                ((base_y + filter_y_start) * input_wd + base_x + filter_x_start) * in_channels;
+            const int32_t filter_start = (filter_y_start * filter_wd + filter_x_start) * in_channels;
+
+            int32_t out_ch_idx = 0;
+            for (; out_ch_idx < out_channels - 3; out_ch_idx += 4) {
+                int64_t acc[4] = {0, 0, 0, 0};
+                const int16_t *input_row = input_start;
+                const int8_t *filter_row = filter_data + out_ch_idx * filter_size + filter_start;
+                for (int32_t filter_y_idx = filter_y_start; filter_y_idx < filter_y_end; filter_y_idx++) {
+                    esp_nn_dot_s16_s8_4rows(input_row, filter_row, filter_size, run_len, acc);
+                    input_row += input_wd * in_channels;
+                    filter_row += filter_wd * in_channels;
+                }
+                for (int32_t r = 0; r < 4; r++) {
+                    if (bias) {
+                        acc[r] += bias[out_ch_idx + r];
+                    }
+                    out_data[out_ch_idx + r] =
+                        esp_nn_requantize_s64_s16(acc[r], out_mult[out_ch_idx + r], out_shift[out_ch_idx + r],
+                                                  activation_min, activation_max);
+                }
+            }
+            for (; out_ch_idx < out_channels; out_ch_idx++) {
+                int64_t acc = 0;
+                const int16_t *input_row = input_start;
+                const int8_t *filter_row = filter_data + out_ch_idx * filter_size + filter_start;
+                for (int32_t filter_y_idx = filter_y_start; filter_y_idx < filter_y_end; filter_y_idx++) {
+                    acc = esp_nn_dot_s16_s8(input_row, filter_row, run_len, acc);
+                    input_row += input_wd * in_channels;
+                    filter_row += filter_wd * in_channels;
+                }
+                if (bias) {
+                    acc += bias[out_ch_idx];
+                }
+                out_data[out_ch_idx] = esp_nn_requantize_s64_s16(acc, out_mult[out_ch_idx], out_shift[out_ch_idx],
+                                                                 activation_min, activation_max);
+            }
+            out_data += out_channels;
+        }
+    }
+}
+
+/**
+ * Sparse filter: the blocks of a row are visited in order with ctz, as in
+ * esp_nn_fully_connected_sparse_s8_opt, and the tap of each block is tracked
+ * by stepping forward instead of dividing. Taps outside the input (padding)
+ * are skipped; the input offset is applied once per output through the sum of
+ * the filter values used.
+ */
+void esp_nn_conv_sparse_s8_opt(const data_dims_t *input_dims,
+                               const int8_t *input_data,
+                               const data_dims_t *filter_dims,
+                               const sparse_filter_t *filter,
+                               const int32_t *bias,
+                               const data_dims_t *output_dims,
+                               int8_t *out_data,
+                               const conv_params_t *conv_params,
+                               const quant_data_t *quant_data)
+{
+    const uint16_t input_wd = input_dims->width;
+    const uint16_t input_ht = input_dims->height;
+    const uint16_t in_channels = input_dims->channels;
+    const int32_t input_offset = conv_params->in_offset;
+    const int32_t out_offset = conv_params->out_offset;
+    const uint16_t pad_wd = conv_params->padding.width;
+    const uint16_t pad_ht = conv_params->padding.height;
+    const uint16_t stride_wd = conv_params->stride.width;
+    const uint16_t stride_ht = conv_params->stride.height;
+    const uint16_t filter_wd = filter_dims->width;
+    const uint16_t filter_ht = filter_dims->height;
+    const uint16_t out_wd = output_dims->width;
+    const uint16_t out_ht = output_dims->height;
+    const uint16_t out_channels = output_dims->channels;
+    const int32_t *out_shift = quant_data->shift;
+    const int32_t *out_mult = quant_data->mult;
+    const int32_t activation_min = conv_params->activation.min;
+    const int32_t activation_max = conv_params->activation.max;
+    const int32_t block_len = filter->block_len;
+    const int32_t blocks_per_tap = in_channels / block_len;
+    const int32_t row_len = filter_wd * filter_ht * in_channels;
+    const int32_t bitmap_bytes = ESP_NN_SPARSE_BITMAP_BYTES(row_len, block_len);
+
+    for (int32_t out_y = 0; out_y < out_ht; out_y++) {
+        const int32_t base_y = stride_ht * out_y - pad_ht;
+        const int32_t filter_y_start = max(0, -base_y);
+        const int32_t filter_y_end = min(filter_ht, input_ht - base_y);
+        for (int32_t out_x = 0; out_x < out_wd; out_x++) {
+            const int32_t base_x = stride_wd * out_x - pad_wd;
+            const int32_t filter_x_start = max(0, -base_x);
+            const int32_t filter_x_end = min(filter_wd, input_wd - base_x);
+            /* input index of tap (0, 0), which may be outside the image */
+            const int32_t input_base = (base_y * input_wd + base_x) * in_channels;
+            const uint8_t *bitmap = filter->bitmap;
+            const int8_t *values = filter->values;
+
+            for (int32_t out_ch_idx = 0; out_ch_idx < out_channels; out_ch_idx++) {
+                int32_t conv_out = 0;
+                int32_t filter_sum = 0;
+                int32_t tap_first_block = 0;
+                int32_t filter_y_idx = 0;
+                int32_t filter_x_idx = 0;
+                for (int32_t byte = 0; byte < bitmap_bytes; byte++) {
+                    uint32_t bits = bitmap[byte];
+                    while (bits) {
+                        const int32_t block = (byte << 3) + __builtin_ctz(bits);
+                        bits &= bits - 1;
+                        while (block >= tap_first_block + blocks_per_tap) {
+                            tap_first_block += blocks_per_tap;
+                            if (++filter_x_idx == filter_wd) {
+                                filter_x_idx = 0;
+                                filter_y_idx++;
+                            }
+                        }
+                        if (filter_y_idx >= filter_y_start && filter_y_idx < filter_y_end &&
+                                filter_x_idx >= filter_x_start && filter_x_idx < filter_x_end) {
+                            const int8_t *input = input_data + input_base +
+                                (filter_y_idx * input_wd + filter_x_idx) * in_channels +
+                                (block - tap_first_block) * block_len;
+                            conv_out += esp_nn_sparse_block_dot_s8(input, values, block_len, &filter_sum);
+                        }
+                        values += block_len;
+                    }
+                }
+                bitmap += bitmap_bytes;
+                conv_out += filter_sum * input_offset;
+                if (bias) {
+                    conv_out += bias[out_ch_idx];
+                }
+                conv_out = esp_nn_multiply_by_quantized_mult(conv_out, out_mult[out_ch_idx], out_shift[out_ch_idx]);
+                conv_out += out_offset;
+                conv_out = max(conv_out, activation_min);
+                conv_out = min(conv_out, activation_max);
+                *out_data++ = (int8_t) conv_out;
+            }
+        }
+    }
+}
@@ -0,0 +1,235 @@
+// Copyright 2025 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * Winograd F(2x2, 3x3) convolution, for 3x3 filters with stride 1:
+ *
+ *  > Each 2x2 output tile is computed from a 4x4 input tile d as
+ *          Y = A^T [ (G g G^T) . (B^T d B) ] A
+ *      with 16 multiplies per channel instead of 36.
+ *  > G has halves in it; 2G is used instead, so everything stays in
+ *      integers and Y comes out 4 times the exact convolution sum, which is
+ *      then divided back exactly. The result is bit exact with the direct
+ *      convolution.
+ *  > Transformed filters (<= 9 * 128) and input tiles (<= 4 * 255) fit in
+ *      int16. The sums fit in int32 up to ESP_NN_WINOGRAD_MAX_IN_CH input
+ *      channels.
+ *  > Input tiles are taken with the input offset added and 0 outside of the
+ *      input, which is what padding contributes to the direct convolution.
+ *
+ * Scratch holds the transformed filters, 16 * in_ch * out_ch int16 values,
+ * and one transformed input tile, 16 * in_ch int16 values.
+ */
+
+#include <esp_nn_defs.h>
+
+#include <common_functions.h>
+
+#define ESP_NN_WINOGRAD_MAX_IN_CH   128
+
+int esp_nn_get_conv_winograd_scratch_size_opt(const data_dims_t *input_dims,
+                                              const data_dims_t *filter_dims,
+                                              const data_dims_t *output_dims,
+                                              const conv_params_t *conv_params)
+{
+    if (filter_dims->width != 3 || filter_dims->height != 3 ||
+            conv_params->stride.width != 1 || conv_params->stride.height != 1 ||
+            input_dims->channels > ESP_NN_WINOGRAD_MAX_IN_CH) {
+        return 0;
+    }
+    const int32_t in_ch = input_dims->channels;
+    /* 4 bytes for alignment */
+    return 16 * in_ch * (output_dims->channels + 1) * sizeof(int16_t) + 4;
+}
+
+/* U = (2G) g (2G)^T, laid out as [16][in_ch] for one output channel */
+static void esp_nn_winograd_filter_transform(const int8_t *filter_data,
+                                             const uint16_t in_channels,
+                                             int16_t *u)
+{
+    for (int32_t ch = 0; ch < in_channels; ch++) {
+        int32_t g[3][3], s[4][3];
+        for (int32_t i = 0; i < 3; i++) {
+            for (int32_t j = 0; j < 3; j++) {
+                g[i][j] = filter_data[(i * 3 + j) * in_channels + ch];
+            }
+        }
+        for (int32_t j = 0; j < 3; j++) {
+            s[0][j] = 2 * g[0][j];
+            s[1][j] = g[0][j] + g[1][j] + g[2][j];
+            s[2][j] = g[0][j] - g[1][j] + g[2][j];
+            s[3][j] = 2 * g[2][j];
+        }
+        for (int32_t i = 0; i < 4; i++) {
+            u[(i * 4 + 0) * in_channels + ch] = 2 * s[i][0];
+            u[(i * 4 + 1) * in_channels + ch] = s[i][0] + s[i][1] + s[i][2];
+            u[(i * 4 + 2) * in_channels + ch] = s[i][0] - s[i][1] + s[i][2];
+            u[(i * 4 + 3) * in_channels + ch] = 2 * s[i][2];
+        }
+    }
+}
+
+/* V = B^T d B of the 4x4 tile at (base_x, base_y), laid out as [16][in_ch] */
+static void esp_nn_winograd_input_transform(const int8_t *input_data,
+                                            const uint16_t input_wd,
+                                            const uint16_t input_ht,
+                                            const uint16_t in_channels,
+                                            const int32_t input_offset,
+                                            const int32_t base_x,
+                                            const int32_t base_y,
+                                            int16_t *v)
+{
+    const bool inside = base_x >= 0 && base_x + 4 <= input_wd &&
+                        base_y >= 0 && base_y + 4 <= input_ht;
+
+    for (int32_t ch = 0; ch < in_channels; ch++) {
+        int32_t d[4][4], t[4][4];
+        if (inside) {
+            for (int32_t i = 0; i < 4; i++) {
+                const int8_t *row_ptr = input_data +
+                                        ((base_y + i) * input_wd + base_x) * in_channels + ch;
+                d[i][0] = row_ptr[0] + input_offset;
+                d[i][1] = row_ptr[in_channels] + input_offset;
+                d[i][2] = row_ptr[2 * in_channels] + input_offset;
+                d[i][3] = row_ptr[3 * in_channels] + input_offset;
+            }
+        } else {
+            for (int32_t i = 0; i < 4; i++) {
+                const int32_t in_row = base_y + i;
+                for (int32_t j = 0; j < 4; j++) {
+                    const int32_t in_col = base_x + j;
+                    if (in_row < 0 || in_row >= input_ht || in_col < 0 || in_col >= input_wd) {
+                        d[i][j] = 0;
+                    } else {
+                        d[i][j] = input_data[(in_row * input_wd + in_col) * in_channels + ch] +
+                                  input_offset;
+                    }
+                }
+            }
+        }
+        for (int32_t j = 0; j < 4; j++) {
+            t[0][j] = d[0][j] - d[2][j];
+            t[1][j] = d[1][j] + d[2][j];
+            t[2][j] = d[2][j] - d[1][j];
+            t[3][j] = d[1][j] - d[3][j];
+        }
+        for (int32_t i = 0; i < 4; i++) {
+            v[(i * 4 + 0) * in_channels + ch] = t[i][0] - t[i][2];
+            v[(i * 4 + 1) * in_channels + ch] = t[i][1] + t[i][2];
+            v[(i * 4 + 2) * in_channels + ch] = t[i][2] - t[i][1];
+            v[(i * 4 + 3) * in_channels + ch] = t[i][1] - t[i][3];
+        }
+    }
+}
+
+__NN_FORCE_INLINE__ int32_t esp_nn_winograd_dot(const int16_t *u,
+                                                const int16_t *v,
+                                                const uint16_t in_channels)
+{
+    int32_t acc = 0;
+    int32_t ch = 0;
+    for (; ch < in_channels - 3; ch += 4) {
+        acc += u[ch] * v[ch];
+        acc += u[ch + 1] * v[ch + 1];
+        acc += u[ch + 2] * v[ch + 2];
+        acc += u[ch + 3] * v[ch + 3];
+    }
+    for (; ch < in_channels; ch++) {
+        acc += u[ch] * v[ch];
+    }
+    return acc;
+}
+
+void esp_nn_conv_winograd_s8_r_opt(const data_dims_t *input_dims,
+                                   const int8_t *input_data,
+                                   const data_dims_t *filter_dims,
+                                   const int8_t *filter_data,
+                                   const int32_t *bias,
+                                   const data_dims_t *output_dims,
+                                   int8_t *out_data,
+                                   const conv_params_t *conv_params,
+                                   const quant_data_t *quant_data,
+                                   void *scratch)
+{
+    const uint16_t input_wd = input_dims->width;
+    const uint16_t input_ht = input_dims->height;
+    const uint16_t in_channels = input_dims->channels;
+    const int32_t input_offset = conv_params->in_offset;
+    const int32_t out_offset = conv_params->out_offset;
+    const uint16_t pad_wd = conv_params->padding.width;
+    const uint16_t pad_ht = conv_params->padding.height;
+    const uint16_t out_wd = output_dims->width;
+    const uint16_t out_ht = output_dims->height;
+    const uint16_t out_channels = output_dims->channels;
+    const int32_t *out_shift = quant_data->shift;
+    const int32_t *out_mult = quant_data->mult;
+    const int32_t activation_min = conv_params->activation.min;
+    const int32_t activation_max = conv_params->activation.max;
+
+    const int32_t tile_size = 16 * in_channels;
+    int16_t *u = (int16_t *) (((uintptr_t) scratch + 3) & ~3);
+    int16_t *v = u + tile_size * out_channels;
+
+    for (int32_t out_ch_idx = 0; out_ch_idx < out_channels; out_ch_idx++) {
+        esp_nn_winograd_filter_transform(filter_data + out_ch_idx * 9 * in_channels,
+                                         in_channels, u + out_ch_idx * tile_size);
+    }
+
+    for (int32_t out_y = 0; out_y < out_ht; out_y += 2) {
+        const int32_t rows = min(out_ht - out_y, 2);
+        for (int32_t out_x = 0; out_x < out_wd; out_x += 2) {
+            const int32_t cols = min(out_wd - out_x, 2);
+            esp_nn_winograd_input_transform(input_data, input_wd, input_ht, in_channels,
+                                            input_offset, out_x - pad_wd, out_y - pad_ht, v);
+
+            int8_t *out_ptr = out_data + (out_y * out_wd + out_x) * out_channels;
+            const int16_t *u_ptr = u;
+            for (int32_t out_ch_idx = 0; out_ch_idx < out_channels; out_ch_idx++) {
+                int32_t m[16];
+                for (int32_t k = 0; k < 16; k++) {
+                    m[k] = esp_nn_winograd_dot(u_ptr + k * in_channels, v + k * in_channels,
+                                               in_channels);
+                }
+                u_ptr += tile_size;
+
+                /* Y = A^T m A */
+                int32_t p0[4], p1[4];
+                for (int32_t j = 0; j < 4; j++) {
+                    p0[j] = m[j] + m[4 + j] + m[8 + j];
+                    p1[j] = m[4 + j] - m[8 + j] - m[12 + j];
+                }
+                int32_t y[4];
+                y[0] = p0[0] + p0[1] + p0[2];
+                y[1] = p0[1] - p0[2] - p0[3];
+                y[2] = p1[0] + p1[1] + p1[2];
+                y[3] = p1[1] - p1[2] - p1[3];
+
+                const int32_t bias_val = bias ? bias[out_ch_idx] : 0;
+                for (int32_t i = 0; i < rows; i++) {
+                    for (int32_t j = 0; j < cols; j++) {
+                        /* exact: y is 4 times the convolution sum */
+                        int32_t conv_out = (y[i * 2 + j] >> 2) + bias_val;
+                        conv_out = esp_nn_multiply_by_quantized_mult_fast(conv_out,
+                                                                          out_mult[out_ch_idx],
+                                                                          out_shift[out_ch_idx]);
+                        conv_out += out_offset;
+                        conv_out = max(conv_out, activation_min);
+                        conv_out = min(conv_out, activation_max);
+                        out_ptr[(i * out_wd + j) * out_channels + out_ch_idx] = (int8_t) conv_out;
+                    }
+                }
+            }
+        }
+    }
+}
@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #include <esp_nn_defs.h>
+#include <esp_nn_ansi_headers.h>
 #include <common_functions.h>
 
 int esp_nn_get_depthwise_conv_scratch_size_opt(const data_dims_t *input_dims,
@@ -289,3 +290,134 @@ void esp_nn_depthwise_conv_s8_opt(const data_dims_t *input_dims,
         }
     }
 }
+
+void esp_nn_depthwise_conv_s8_r_opt(const data_dims_t *input_dims,
+                                    const int8_t *input_data,
+                                    const data_dims_t *filter_dims,
+                                    const int8_t *filter_data,
+                                    const int32_t *bias,
+                                    const data_dims_t *output_dims,
+                                    int8_t *out_data,
+                                    const dw_conv_params_t *conv_params,
+                                    const quant_data_t *quant_data,
+                                    void *scratch)
+{
+    (void) scratch;
+    esp_nn_depthwise_conv_s8_opt(input_dims, input_data, filter_dims, filter_data, bias,
+                                 output_dims, out_data, conv_params, quant_data);
+}
+
+/**
+ * 16 bit activations. The products of one filter row are summed in 32 bits
+ * (a row is never longer than ESP_NN_S16_S8_ACC32_LEN taps, else the ansi
+ * version is used) and added to the 64 bit accumulator once per row. With
+ * ch_mult 1, 4 channels are done per pass on contiguous input and filter.
+ */
+void esp_nn_depthwise_conv_s16_s8_opt(const data_dims_t *input_dims,
+                                      const int16_t *input_data,
+                                      const data_dims_t *filter_dims,
+                                      const int8_t *filter_data,
+                                      const int64_t *bias,
+                                      const data_dims_t *output_dims,
+                                      int16_t *out_data,
+                                      const dw_conv_params_t *conv_params,
+                                      const quant_data_t *quant_data)
+{
+    const uint16_t input_wd = input_dims->width;
+    const uint16_t input_ht = input_dims->height;
+    const uint16_t channels = input_dims->channels;
+    const uint16_t pad_wd = conv_params->padding.width;
+    const uint16_t pad_ht = conv_params->padding.height;
+    const uint16_t stride_wd = conv_params->stride.width;
+    const uint16_t stride_ht = conv_params->stride.height;
+    const uint16_t filter_wd = filter_dims->width;
+    const uint16_t filter_ht = filter_dims->height;
+    const uint16_t out_wd = output_dims->width;
+    const uint16_t out_ht = output_dims->height;
+    const int32_t *out_shift = quant_data->shift;
+    const int32_t *out_mult = quant_data->mult;
+    const int32_t activation_min = conv_params->activation.min;
+    const int32_t activation_max = conv_params->activation.max;
+    const uint16_t ch_mult = conv_params->ch_mult;
+    const int32_t out_channels = channels * ch_mult;
+
+    if (filter_wd > ESP_NN_S16_S8_ACC32_LEN) {
+        esp_nn_depthwise_conv_s16_s8_ansi(input_dims, input_data, filter_dims, filter_data, bias,
+                                          output_dims, out_data, conv_params, quant_data);
+        return;
+    }
+
+    for (int32_t out_y = 0; out_y < out_ht; out_y++) {
+        const int32_t base_y = stride_ht * out_y - pad_ht;
+        const int32_t filter_y_start = max(0, -base_y);
+        const int32_t filter_y_end = min(filter_ht, input_ht - base_y);
+        for (int32_t out_x = 0; out_x < out_wd; out_x++) {
+            const int32_t base_x = stride_wd * out_x - pad_wd;
+            const int32_t filter_x_start = max(0, -base_x);
+            const int32_t filter_x_end = min(filter_wd, input_wd - base_x);
+
+            int32_t out_ch_idx = 0;
+            if (ch_mult == 1) {
+                for (; out_ch_idx < channels - 3; out_ch_idx += 4) {
+                    int64_t acc0 = 0, acc1 = 0, acc2 = 0, acc3 = 0;
+                    for (int32_t filter_y_idx = filter_y_start; filter_y_idx < filter_y_end; filter_y_idx++) {
+                        const int32_t idx_y = base_y + filter_y_idx;
+                        int32_t sum0 = 0, sum1 = 0, sum2 = 0, sum3 = 0;
+                        for (int32_t filter_x_idx = filter_x_start; filter_x_idx < filter_x_end; filter_x_idx++) {
+                            const int32_t idx_x = base_x + filter_x_idx;
+                            const int16_t *in = input_data + (idx_y * input_wd + idx_x) * channels + out_ch_idx;
+                            const int8_t *filter = filter_data +
+                                (filter_y_idx * filter_wd + filter_x_idx) * channels + out_ch_idx;
+                            sum0 += in[0] * filter[0];
+                            sum1 += in[1] * filter[1];
+                            sum2 += in[2] * filter[2];
+                            sum3 += in[3] * filter[3];
+                        }
+                        acc0 += sum0;
+                        acc1 += sum1;
+                        acc2 += sum2;
+                        acc3 += sum3;
+                    }
+                    if (bias) {
+                        acc0 += bias[out_ch_idx];
+                        acc1 += bias[out_ch_idx + 1];
+                        acc2 += bias[out_ch_idx + 2];
+                        acc3 += bias[out_ch_idx + 3];
+                    }
+                    out_data[out_ch_idx] = esp_nn_requantize_s64_s16(acc0, out_mult[out_ch_idx],
+                                                                     out_shift[out_ch_idx],
+                                                                     activation_min, activation_max);
+                    out_data[out_ch_idx + 1] = esp_nn_requantize_s64_s16(acc1, out_mult[out_ch_idx + 1],
+                                                                         out_shift[out_ch_idx + 1],
+                                                                         activation_min, activation_max);
+                    out_data[out_ch_idx + 2] = esp_nn_requantize_s64_s16(acc2, out_mult[out_ch_idx + 2],
+                                                                         out_shift[out_ch_idx + 2],
+                                                                         activation_min, activation_max);
+                    out_data[out_ch_idx + 3] = esp_nn_requantize_s64_s16(acc3, out_mult[out_ch_idx + 3],
+                                                                         out_shift[out_ch_idx + 3],
+                                                                         activation_min, activation_max);
+                }
+            }
+            for (; out_ch_idx < out_channels; out_ch_idx++) {
+                const int32_t ch_idx = out_ch_idx / ch_mult;
+                int64_t acc = 0;
+                for (int32_t filter_y_idx = filter_y_start; filter_y_idx < filter_y_end; filter_y_idx++) {
+                    const int32_t idx_y = base_y + filter_y_idx;
+                    int32_t sum = 0;
+                    for (int32_t filter_x_idx = filter_x_start; filter_x_idx < filter_x_end; filter_x_idx++) {
+                        const int32_t idx_x = base_x + filter_x_idx;
+                        sum += input_data[(idx_y * input_wd + idx_x) * channels + ch_idx] *
+                               filter_data[(filter_y_idx * filter_wd + filter_x_idx) * out_channels + out_ch_idx];
+                    }
+                    acc += sum;
+                }
+                if (bias) {
+                    acc += bias[out_ch_idx];
+                }
+                out_data[out_ch_idx] = esp_nn_requantize_s64_s16(acc, out_mult[out_ch_idx], out_shift[out_ch_idx],
+                                                                 activation_min, activation_max);
+            }
+            out_data += out_channels;
+        }
+    }
+}
@@ -17,7 +17,8 @@
 
 #include <common_functions.h>
 
-static int16_t *scratch_buffer = NULL;
+/* used by esp_nn_depthwise_conv_s8_esp32s3, set with esp_nn_set_depthwise_conv_scratch_buf_esp32s3 */
+static int16_t *legacy_scratch_buffer = NULL;
 
 extern void esp_nn_depthwise_conv_s16_mult8_3x3_esp32s3(const int16_t *input_data,
                                                         const uint16_t input_wd,
@@ -410,7 +411,7 @@ int esp_nn_get_depthwise_conv_scratch_size_esp32s3(const data_dims_t *input_dims
 
 void esp_nn_set_depthwise_conv_scratch_buf_esp32s3(void *buf)
 {
-    scratch_buffer = (int16_t *) buf;
+    legacy_scratch_buffer = (int16_t *) buf;
 }
 
 /**
@@ -421,16 +422,18 @@ void esp_nn_set_depthwise_conv_scratch_buf_esp32s3(void *buf)
 
 
 
-void esp_nn_depthwise_conv_s8_esp32s3(const data_dims_t *input_dims,
-                                      const int8_t *input_data,
-                                      const data_dims_t *filter_dims,
-                                      const int8_t *filter_data,
-                                      const int32_t *bias,
-                                      const data_dims_t *output_dims,
-                                      int8_t *out_data,
-                                      const dw_conv_params_t *conv_params,
-                                      const quant_data_t *quant_data)
+void esp_nn_depthwise_conv_s8_r_esp32s3(const data_dims_t *input_dims,
+                                        const int8_t *input_data,
+                                        const data_dims_t *filter_dims,
+                                        const int8_t *filter_data,
+                                        const int32_t *bias,
+                                        const data_dims_t *output_dims,
+                                        int8_t *out_data,
+                                        const dw_conv_params_t *conv_params,
+                                        const quant_data_t *quant_data,
+                                        void *scratch)
 {
+    int16_t *scratch_buffer = (int16_t *) scratch;
     const uint16_t input_wd = input_dims->width;
     const uint16_t input_ht = input_dims->height;
     const uint16_t channels = input_dims->channels;
@@ -541,3 +544,17 @@ void esp_nn_depthwise_conv_s8_esp32s3(const data_dims_t *input_dims,
                                           out_mult, activation_min, activation_max);
     }
 }
+
+void esp_nn_depthwise_conv_s8_esp32s3(const data_dims_t *input_dims,
+                                      const int8_t *input_data,
+                                      const data_dims_t *filter_dims,
+                                      const int8_t *filter_data,
+                                      const int32_t *bias,
+                                      const data_dims_t *output_dims,
+                                      int8_t *out_data,
+                                      const dw_conv_params_t *conv_params,
+                                      const quant_data_t *quant_data)
+{
+    esp_nn_depthwise_conv_s8_r_esp32s3(input_dims, input_data, filter_dims, filter_data, bias,
+                                       output_dims, out_data, conv_params, quant_data, legacy_scratch_buffer);
+}
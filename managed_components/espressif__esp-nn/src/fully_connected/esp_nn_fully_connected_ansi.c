@@ -14,6 +14,8 @@
 
 #include <stdint.h>
 
+#include <esp_nn_defs.h>
+
 #include <common_functions.h>
 
 void esp_nn_fully_connected_s8_ansi(const int8_t *input_data,
@@ -81,3 +83,73 @@ void esp_nn_fully_connected_per_ch_s8_ansi(const int8_t *input_data,
         out_data[out_c] = (int8_t) result;
     }
 }
+
+void esp_nn_fully_connected_s16_s8_ansi(const int16_t *input_data,
+                                        const uint16_t row_len,
+                                        const int8_t *filter_data,
+                                        const int64_t *bias,
+                                        int16_t *out_data,
+                                        const uint16_t out_channels,
+                                        const int32_t out_shift,
+                                        const int32_t out_mult,
+                                        const int32_t activation_min,
+                                        const int32_t activation_max)
+{
+    for (int32_t out_c = 0; out_c < out_channels; ++out_c) {
+        int64_t acc = 0;
+        for (int32_t data_idx = 0; data_idx < row_len; data_idx++) {
+            int32_t filter_index = row_len * out_c + data_idx;
+            acc += (int64_t) input_data[data_idx] * filter_data[filter_index];
+        }
+        if (bias) {
+            acc += bias[out_c];
+        }
+        int32_t result = esp_nn_multiply_by_quantized_mult_s64(acc, out_mult, out_shift);
+        result = max(result, activation_min);
+        result = min(result, activation_max);
+        out_data[out_c] = (int16_t) result;
+    }
+}
+
+void esp_nn_fully_connected_sparse_s8_ansi(const int8_t *input_data,
+                                           const int32_t input_offset,
+                                           const uint16_t row_len,
+                                           const sparse_filter_t *filter,
+                                           const int32_t *bias,
+                                           int8_t *out_data,
+                                           const uint16_t out_channels,
+                                           const int32_t out_offset,
+                                           const int32_t out_shift,
+                                           const int32_t out_mult,
+                                           const int32_t activation_min,
+                                           const int32_t activation_max)
+{
+    const int32_t block_len = filter->block_len;
+    const int32_t blocks = ESP_NN_SPARSE_BLOCKS(row_len, block_len);
+    const uint8_t *bitmap = filter->bitmap;
+    const int8_t *values = filter->values;
+
+    for (int32_t out_c = 0; out_c < out_channels; ++out_c) {
+        int32_t result = 0;
+        for (int32_t block = 0; block < blocks; block++) {
+            if ((bitmap[block >> 3] & (1 << (block & 7))) == 0) {
+                continue;
+            }
+            const int32_t start = block * block_len;
+            const int32_t len = min(block_len, row_len - start);
+            for (int32_t i = 0; i < len; i++) {
+                result += values[i] * (input_data[start + i] + input_offset);
+            }
+            values += block_len;
+        }
+        bitmap += ESP_NN_SPARSE_BITMAP_BYTES(row_len, block_len);
+        if (bias) {
+            result += bias[out_c];
+        }
+        result = esp_nn_multiply_by_quantized_mult(result, out_mult, out_shift);
+        result += out_offset;
+        result = max(result, activation_min);
+        result = min(result, activation_max);
+        out_data[out_c] = (int8_t) result;
+    }
+}
@@ -0,0 +1,279 @@
+// Copyright 2025 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdint.h>
+
+#include <esp_nn_defs.h>
+
+#include <common_functions.h>
+
+/**
+ * sum((filter + filter_offset) * (input + input_offset)) is split into
+ * sum(filter * (input + input_offset)) + filter_offset * sum(input + input_offset).
+ * The second term is the same for every output row, so it is computed once
+ * per call and added like the bias. The first is done 4 rows per pass: each
+ * input value is loaded and offset once and feeds 4 accumulators.
+ */
+__NN_FORCE_INLINE__ int32_t esp_nn_fc_filter_offset_corr(const int8_t *input_data,
+                                                         const int32_t input_offset,
+                                                         const uint16_t row_len,
+                                                         const int32_t filter_offset)
+{
+    if (filter_offset == 0) {
+        return 0;
+    }
+    int32_t sum = 0;
+    for (int32_t i = 0; i < row_len; i++) {
+        sum += input_data[i] + input_offset;
+    }
+    return sum * filter_offset;
+}
+
+__NN_FORCE_INLINE__ void esp_nn_fc_dot_4rows(const int8_t *input_data,
+                                             const int32_t input_offset,
+                                             const uint16_t row_len,
+                                             const int8_t *filter_data,
+                                             int32_t *acc)
+{
+    const int8_t *filter0 = filter_data;
+    const int8_t *filter1 = filter0 + row_len;
+    const int8_t *filter2 = filter1 + row_len;
+    const int8_t *filter3 = filter2 + row_len;
+    int32_t acc0 = 0, acc1 = 0, acc2 = 0, acc3 = 0;
+
+    int32_t i = 0;
+    for (; i < row_len - 1; i += 2) {
+        const int32_t in0 = input_data[i] + input_offset;
+        const int32_t in1 = input_data[i + 1] + input_offset;
+        acc0 += in0 * filter0[i] + in1 * filter0[i + 1];
+        acc1 += in0 * filter1[i] + in1 * filter1[i + 1];
+        acc2 += in0 * filter2[i] + in1 * filter2[i + 1];
+        acc3 += in0 * filter3[i] + in1 * filter3[i + 1];
+    }
+    if (i < row_len) {
+        const int32_t in0 = input_data[i] + input_offset;
+        acc0 += in0 * filter0[i];
+        acc1 += in0 * filter1[i];
+        acc2 += in0 * filter2[i];
+        acc3 += in0 * filter3[i];
+    }
+    acc[0] = acc0;
+    acc[1] = acc1;
+    acc[2] = acc2;
+    acc[3] = acc3;
+}
+
+__NN_FORCE_INLINE__ int32_t esp_nn_fc_dot_1row(const int8_t *input_data,
+                                               const int32_t input_offset,
+                                               const uint16_t row_len,
+                                               const int8_t *filter_data)
+{
+    int32_t acc = 0;
+    for (int32_t i = 0; i < row_len; i++) {
+        acc += (input_data[i] + input_offset) * filter_data[i];
+    }
+    return acc;
+}
+
+__NN_FORCE_INLINE__ int8_t esp_nn_fc_requantize(int32_t result,
+                                                const int32_t out_mult,
+                                                const int32_t out_shift,
+                                                const int32_t out_offset,
+                                                const int32_t activation_min,
+                                                const int32_t activation_max)
+{
+    result = esp_nn_multiply_by_quantized_mult(result, out_mult, out_shift);
+    result += out_offset;
+    result = max(result, activation_min);
+    result = min(result, activation_max);
+    return (int8_t) result;
+}
+
+void esp_nn_fully_connected_s8_opt(const int8_t *input_data,
+                                   const int32_t input_offset,
+                                   const uint16_t row_len,
+                                   const int8_t *filter_data,
+                                   const int32_t filter_offset,
+                                   const int32_t *bias,
+                                   int8_t *out_data,
+                                   const uint16_t out_channels,
+                                   const int32_t out_offset,
+                                   const int32_t out_shift,
+                                   const int32_t out_mult,
+                                   const int32_t activation_min,
+                                   const int32_t activation_max)
+{
+    const int32_t corr = esp_nn_fc_filter_offset_corr(input_data, input_offset,
+                                                      row_len, filter_offset);
+    int32_t out_c = 0;
+    for (; out_c < out_channels - 3; out_c += 4) {
+        int32_t acc[4];
+        esp_nn_fc_dot_4rows(input_data, input_offset, row_len,
+                            filter_data + out_c * row_len, acc);
+        for (int32_t r = 0; r < 4; r++) {
+            int32_t result = acc[r] + corr;
+            if (bias) {
+                result += bias[out_c + r];
+            }
+            out_data[out_c + r] = esp_nn_fc_requantize(result, out_mult, out_shift, out_offset,
+                                                       activation_min, activation_max);
+        }
+    }
+    for (; out_c < out_channels; out_c++) {
+        int32_t result = esp_nn_fc_dot_1row(input_data, input_offset, row_len,
+                                            filter_data + out_c * row_len) + corr;
+        if (bias) {
+            result += bias[out_c];
+        }
+        out_data[out_c] = esp_nn_fc_requantize(result, out_mult, out_shift, out_offset,
+                                               activation_min, activation_max);
+    }
+}
+
+void esp_nn_fully_connected_per_ch_s8_opt(const int8_t *input_data,
+                                          const int32_t input_offset,
+                                          const uint16_t row_len,
+                                          const int8_t *filter_data,
+                                          const int32_t filter_offset,
+                                          const int32_t *bias,
+                                          int8_t *out_data,
+                                          const uint16_t out_channels,
+                                          const int32_t out_offset,
+                                          const int32_t* out_shift,
+                                          const int32_t* out_mult,
+                                          const int32_t activation_min,
+                                          const int32_t activation_max)
+{
+    const int32_t corr = esp_nn_fc_filter_offset_corr(input_data, input_offset,
+                                                      row_len, filter_offset);
+    int32_t out_c = 0;
+    for (; out_c < out_channels - 3; out_c += 4) {
+        int32_t acc[4];
+        esp_nn_fc_dot_4rows(input_data, input_offset, row_len,
+                            filter_data + out_c * row_len, acc);
+        for (int32_t r = 0; r < 4; r++) {
+            int32_t result = acc[r] + corr;
+            if (bias) {
+                result += bias[out_c + r];
+            }
+            out_data[out_c + r] = esp_nn_fc_requantize(result, out_mult[out_c + r],
+                                                       out_shift[out_c + r], out_offset,
+                                                       activation_min, activation_max);
+        }
+    }
+    for (; out_c < out_channels; out_c++) {
+        int32_t result = esp_nn_fc_dot_1row(input_data, input_offset, row_len,
+                                            filter_data + out_c * row_len) + corr;
+        if (bias) {
+            result += bias[out_c];
+        }
+        out_data[out_c] = esp_nn_fc_requantize(result, out_mult[out_c], out_shift[out_c],
+                                               out_offset, activation_min, activation_max);
+    }
+}
+
+/**
+ * 16 bit activations: 4 output rows per pass as above. The products are
+ * summed in 32 bits over runs of ESP_NN_S16_S8_ACC32_LEN and only those sums
+ * go to the 64 bit accumulators.
+ */
+void esp_nn_fully_connected_s16_s8_opt(const int16_t *input_data,
+                                       const uint16_t row_len,
+                                       const int8_t *filter_data,
+                                       const int64_t *bias,
+                                       int16_t *out_data,
+                                       const uint16_t out_channels,
+                                       const int32_t out_shift,
+                                       const int32_t out_mult,
+                                       const int32_t activation_min,
+                                       const int32_t activation_max)
+{
+    int32_t out_c = 0;
+    for (; out_c < out_channels - 3; out_c += 4) {
+        int64_t acc[4] = {0, 0, 0, 0};
+        esp_nn_dot_s16_s8_4rows(input_data, filter_data + out_c * row_len, row_len, row_len, acc);
+        for (int32_t r = 0; r < 4; r++) {
+            if (bias) {
+                acc[r] += bias[out_c + r];
+            }
+            out_data[out_c + r] = esp_nn_requantize_s64_s16(acc[r], out_mult, out_shift,
+                                                            activation_min, activation_max);
+        }
+    }
+    for (; out_c < out_channels; out_c++) {
+        int64_t acc = esp_nn_dot_s16_s8(input_data, filter_data + out_c * row_len, row_len, 0);
+        if (bias) {
+            acc += bias[out_c];
+        }
+        out_data[out_c] = esp_nn_requantize_s64_s16(acc, out_mult, out_shift,
+                                                    activation_min, activation_max);
+    }
+}
+
+/**
+ * Only the set bits of the bitmap are visited: a zero byte skips 8 blocks at
+ * once and the others are walked with ctz. The input offset is applied once
+ * per row, through the sum of the filter values used.
+ */
+void esp_nn_fully_connected_sparse_s8_opt(const int8_t *input_data,
+                                          const int32_t input_offset,
+                                          const uint16_t row_len,
+                                          const sparse_filter_t *filter,
+                                          const int32_t *bias,
+                                          int8_t *out_data,
+                                          const uint16_t out_channels,
+                                          const int32_t out_offset,
+                                          const int32_t out_shift,
+                                          const int32_t out_mult,
+                                          const int32_t activation_min,
+                                          const int32_t activation_max)
+{
+    const int32_t block_len = filter->block_len;
+    const int32_t full_blocks = row_len / block_len;
+    const int32_t bitmap_bytes = ESP_NN_SPARSE_BITMAP_BYTES(row_len, block_len);
+    const uint8_t *bitmap = filter->bitmap;
+    const int8_t *values = filter->values;
+
+    for (int32_t out_c = 0; out_c < out_channels; ++out_c) {
+        int32_t result = 0;
+        int32_t filter_sum = 0;
+        for (int32_t byte = 0; byte < bitmap_bytes; byte++) {
+            uint32_t bits = bitmap[byte];
+            while (bits) {
+                const int32_t block = (byte << 3) + __builtin_ctz(bits);
+                const int8_t *input = input_data + block * block_len;
+                bits &= bits - 1;
+                if (block < full_blocks) {
+                    result += esp_nn_sparse_block_dot_s8(input, values, block_len, &filter_sum);
+                } else {
+                    for (int32_t i = 0; i < row_len - block * block_len; i++) {
+                        result += input[i] * values[i];
+                        filter_sum += values[i];
+                    }
+                }
+                values += block_len;
+            }
+        }
+        bitmap += bitmap_bytes;
+        result += filter_sum * input_offset;
+        if (bias) {
+            result += bias[out_c];
+        }
+        result = esp_nn_multiply_by_quantized_mult(result, out_mult, out_shift);
+        result += out_offset;
+        result = max(result, activation_min);
+        result = min(result, activation_max);
+        out_data[out_c] = (int8_t) result;
+    }
+}
@@ -0,0 +1,127 @@
+// Copyright 2025 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdint.h>
+
+#include <common_functions.h>
+
+/**
+ * Rounded average of a `win_wd` x `win_ht` window (`filter_cnt` elements)
+ * for `width` (8, 4 or 1) consecutive channels. `width` is a constant after
+ * inlining, so the sums stay in registers and the channel loop is unrolled.
+ */
+__NN_FORCE_INLINE__ void esp_nn_avg_pool_chunk_s8(const int8_t *window,
+                                                  int8_t *out,
+                                                  const int32_t win_wd,
+                                                  const int32_t win_ht,
+                                                  const int32_t filter_cnt,
+                                                  const int32_t row_stride,
+                                                  const int32_t channels,
+                                                  const int32_t activation_min,
+                                                  const int32_t activation_max,
+                                                  const int32_t width)
+{
+    int32_t acc[8];
+    for (int32_t k = 0; k < width; k++) {
+        acc[k] = 0;
+    }
+    const int8_t *row = window;
+    for (int32_t y = 0; y < win_ht; y++, row += row_stride) {
+        const int8_t *in = row;
+        for (int32_t x = 0; x < win_wd; x++, in += channels) {
+            for (int32_t k = 0; k < width; k++) {
+                acc[k] += in[k];
+            }
+        }
+    }
+    const int32_t half_cnt = filter_cnt / 2;
+    for (int32_t k = 0; k < width; k++) {
+        int32_t result = acc[k] > 0 ? (acc[k] + half_cnt) / filter_cnt
+                                    : (acc[k] - half_cnt) / filter_cnt;
+        result = max(result, activation_min);
+        out[k] = (int8_t) min(result, activation_max);
+    }
+}
+
+__NN_FORCE_INLINE__ void esp_nn_avg_pool_pixel_s8(const int8_t *window,
+                                                  int8_t *out,
+                                                  const int32_t win_wd,
+                                                  const int32_t win_ht,
+                                                  const int32_t row_stride,
+                                                  const int32_t channels,
+                                                  const int32_t activation_min,
+                                                  const int32_t activation_max)
+{
+    const int32_t filter_cnt = win_wd * win_ht;
+    int32_t ch_idx = 0;
+    for (; ch_idx < channels - 7; ch_idx += 8) {
+        esp_nn_avg_pool_chunk_s8(window + ch_idx, out + ch_idx, win_wd, win_ht, filter_cnt,
+                                 row_stride, channels, activation_min, activation_max, 8);
+    }
+    for (; ch_idx < channels - 3; ch_idx += 4) {
+        esp_nn_avg_pool_chunk_s8(window + ch_idx, out + ch_idx, win_wd, win_ht, filter_cnt,
+                                 row_stride, channels, activation_min, activation_max, 4);
+    }
+    for (; ch_idx < channels; ch_idx++) {
+        esp_nn_avg_pool_chunk_s8(window + ch_idx, out + ch_idx, win_wd, win_ht, filter_cnt,
+                                 row_stride, channels, activation_min, activation_max, 1);
+    }
+}
+
+/**
+ * Output pixels whose window lies inside the input use the full filter with
+ * no clamping; only the border ones compute the clipped window and count.
+ */
+void esp_nn_avg_pool_s8_opt(const int8_t *input,
+                            const uint16_t input_wd,
+                            const uint16_t input_ht,
+                            int8_t *output,
+                            const uint16_t output_wd,
+                            const uint16_t output_ht,
+                            const uint16_t stride_wd,
+                            const uint16_t stride_ht,
+                            const uint16_t filter_wd,
+                            const uint16_t filter_ht,
+                            const uint16_t pad_wd,
+                            const uint16_t pad_ht,
+                            const int32_t activation_min,
+                            const int32_t activation_max,
+                            const uint16_t channels)
+{
+    const int32_t row_stride = input_wd * channels;
+    int32_t base_y = -pad_ht;
+    for (int32_t out_y = 0; out_y < output_ht; out_y++, base_y += stride_ht) {
+        const int32_t filter_y_start = max(0, -base_y);
+        const int32_t filter_y_end = min(filter_ht, input_ht - base_y);
+        const bool rows_inside = filter_y_start == 0 && filter_y_end == filter_ht;
+        int8_t *out = output + out_y * output_wd * channels;
+
+        int32_t base_x = -pad_wd;
+        for (int32_t out_x = 0; out_x < output_wd; out_x++, base_x += stride_wd, out += channels) {
+            if (rows_inside && base_x >= 0 && base_x + filter_wd <= input_wd) {
+                const int8_t *window = input + (base_y * input_wd + base_x) * channels;
+                esp_nn_avg_pool_pixel_s8(window, out, filter_wd, filter_ht, row_stride,
+                                         channels, activation_min, activation_max);
+            } else {
+                const int32_t filter_x_start = max(0, -base_x);
+                const int32_t filter_x_end = min(filter_wd, input_wd - base_x);
+                const int8_t *window = input + ((base_y + filter_y_start) * input_wd +
+                                                base_x + filter_x_start) * channels;
+                esp_nn_avg_pool_pixel_s8(window, out, filter_x_end - filter_x_start,
+                                         filter_y_end - filter_y_start, row_stride,
+                                         channels, activation_min, activation_max);
+            }
+        }
+    }
+}
@@ -15,7 +15,8 @@
 #include "softmax_common.h"
 #include <stdio.h>
 
-static int32_t *scratch_buf = NULL;
+/* used by esp_nn_softmax_s8_opt, set with esp_nn_set_softmax_scratch_buf_opt */
+static int32_t *legacy_scratch_buf = NULL;
 
 /**
  * @brief   Get scratch buffer size needed by softmax function
@@ -40,17 +41,19 @@ int32_t esp_nn_get_softmax_scratch_size_opt(const int32_t width, const int32_t h
  */
 void esp_nn_set_softmax_scratch_buf_opt(void *buffer)
 {
-    scratch_buf = (int32_t *) buffer;
+    legacy_scratch_buf = (int32_t *) buffer;
 }
 
-void esp_nn_softmax_s8_opt(const int8_t *input_data,
-                           const int32_t height,
-                           const int32_t width,
-                           const int32_t mult,
-                           const int32_t shift,
-                           const int32_t diff_min,
-                           int8_t *output_data)
+void esp_nn_softmax_s8_r_opt(const int8_t *input_data,
+                             const int32_t height,
+                             const int32_t width,
+                             const int32_t mult,
+                             const int32_t shift,
+                             const int32_t diff_min,
+                             int8_t *output_data,
+                             void *scratch)
 {
+    int32_t *scratch_buf = (int32_t *) scratch;
     if (scratch_buf == NULL) {
         printf("%s error! scratch buffer not set\n", __FUNCTION__);
         return;
@@ -106,3 +109,15 @@ void esp_nn_softmax_s8_opt(const int8_t *input_data,
         out_ptr += width;
     }
 }
+
+void esp_nn_softmax_s8_opt(const int8_t *input_data,
+                           const int32_t height,
+                           const int32_t width,
+                           const int32_t mult,
+                           const int32_t shift,
+                           const int32_t diff_min,
+                           int8_t *output_data)
+{
+    esp_nn_softmax_s8_r_opt(input_data, height, width, mult, shift, diff_min,
+                            output_data, legacy_scratch_buf);
+}
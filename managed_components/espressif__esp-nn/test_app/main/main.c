@@ -61,8 +61,13 @@ void app_main()
     printf("add, c %"PRIu32" opt %"PRIu32"\n", total_c, total_opt);
     esp_nn_mul_elementwise_s8_test();
     printf("mul, c %"PRIu32" opt %"PRIu32"\n", total_c, total_opt);
+    esp_nn_quantize_s16_s8_test();
+    printf("quantize, c %"PRIu32" opt %"PRIu32"\n", total_c, total_opt);
     esp_nn_depthwise_conv_s8_test();
     esp_nn_conv_s8_test();
+    esp_nn_conv_s8_backends_test();
+    esp_nn_conv_s8_variants_test();
+    esp_nn_conv_max_pool_s8_test();
 
     esp_nn_relu6_s8_test();
     printf("relu, c %"PRIu32" opt %"PRIu32"\n", total_c, total_opt);
@@ -76,6 +81,19 @@ void app_main()
     printf("softmax, c %"PRIu32" opt %"PRIu32"\n", total_c, total_opt);
     ESP_LOGI(TAG, "s8 tests done!\n");
 
+    /* s16 activation, s8 filter tests */
+    ESP_LOGI(TAG, "Running s16 x s8 tests...");
+    esp_nn_conv_s16_s8_test();
+    esp_nn_depthwise_conv_s16_s8_test();
+    esp_nn_fully_connected_s16_s8_test();
+    ESP_LOGI(TAG, "s16 x s8 tests done!\n");
+
+    /* sparse filter tests */
+    ESP_LOGI(TAG, "Running sparse tests...");
+    esp_nn_conv_sparse_s8_test();
+    esp_nn_fully_connected_sparse_s8_test();
+    ESP_LOGI(TAG, "sparse tests done!\n");
+
     /* u8 tests */
     //ESP_LOGI(TAG, "Running u8 tests...");
     //esp_nn_add_elementwise_u8_test();
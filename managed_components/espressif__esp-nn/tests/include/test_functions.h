@@ -16,9 +16,13 @@
 /* int8_t ops tests */
 void esp_nn_add_elementwise_s8_test();
 void esp_nn_mul_elementwise_s8_test();
+void esp_nn_quantize_s16_s8_test();
 
 void esp_nn_depthwise_conv_s8_test();
 void esp_nn_conv_s8_test();
+void esp_nn_conv_s8_backends_test();
+void esp_nn_conv_s8_variants_test();
+void esp_nn_conv_max_pool_s8_test();
 
 void esp_nn_avg_pool_s8_test();
 void esp_nn_max_pool_s8_test();
@@ -30,6 +34,15 @@ void esp_nn_relu6_s8_test();
 
 void esp_nn_softmax_s8_test();
 
+/* int16_t activation, int8_t filter ops tests */
+void esp_nn_conv_s16_s8_test();
+void esp_nn_depthwise_conv_s16_s8_test();
+void esp_nn_fully_connected_s16_s8_test();
+
+/* sparse filter tests */
+void esp_nn_conv_sparse_s8_test();
+void esp_nn_fully_connected_sparse_s8_test();
+
 /* uint8_t ops tests */
 void esp_nn_add_elementwise_u8_test();
 
@@ -8,6 +8,7 @@
 #include <stdbool.h>
 #include <common_functions.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 /* mult value range */
 #define MULT_MAX    INT32_MAX
@@ -107,3 +108,21 @@ uint32_t profile_opt_end();
 #include <malloc.h>
 #define ESP_NN_TEST_ALLOC(SIZE) malloc(SIZE)
 #endif
+
+/**
+ * @brief prune a dense filter for the sparse kernel tests: each block of
+ *        `block_len` values of a row is zeroed with probability `zero_pct` %
+ */
+static inline void esp_nn_test_prune_blocks(int8_t *filter_data, int32_t rows, int32_t row_len,
+                                            int32_t block_len, int zero_pct)
+{
+    for (int32_t r = 0; r < rows; r++) {
+        for (int32_t start = 0; start < row_len; start += block_len) {
+            if (rand() % 100 < zero_pct) {
+                for (int32_t i = start; i < start + block_len && i < row_len; i++) {
+                    filter_data[r * row_len + i] = 0;
+                }
+            }
+        }
+    }
+}
@@ -10,6 +10,7 @@
 #include <stdlib.h>
 #include <malloc.h>
 #include <inttypes.h>
+#include <math.h>
 
 #include <common_functions.h>
 #include <esp_nn.h>
@@ -377,3 +378,125 @@ elementwise_mult_test_cleanup:
         }
     }
 }
+
+void esp_nn_quantize_s16_s8_test()
+{
+    /* prepare data */
+    int size = 1024 + 8 + 3; /* odd len to test leftover */
+    int16_t *input;
+    int8_t *out_data_c;
+    int8_t *out_data_opt;
+    int16_t *input_orig = NULL;
+    int8_t *out_c_orig = NULL;
+    int8_t *out_opt_orig = NULL;
+    int32_t output_offset = 0;
+    int32_t output_mult = MULT_MAX;
+    int32_t output_shift = -8;
+
+    for (int itr = 0; itr < 10; itr++) {
+        switch (itr) {
+        case 0: // all zeros
+            output_offset = 0;
+            output_mult = 0;
+            output_shift = 0;
+        break;
+        case 1: // hit min
+            output_offset = -128;
+            output_mult = MULT_MAX;
+            output_shift = 15;
+        break;
+        case 2: // smallest scale
+            output_offset = 127;
+            output_mult = MULT_MAX;
+            output_shift = SHIFT_MIN;
+        break;
+        case 3: // [-1, 1) audio with scale 1/128: x / 256
+            output_offset = 0;
+            output_mult = 1 << 30;
+            output_shift = -7;
+        break;
+        default:  // practical random input
+            output_offset = rand() % 256 - 128; // range [-128, 127]
+            output_mult = MULT_MAX / 2 + rand() % INT16_MAX;
+            output_shift = -20 + rand() % 20;
+            size = 4 + rand() % 64;
+        }
+
+        input_orig = (int16_t *) ESP_NN_TEST_ALLOC(size * sizeof(int16_t) + 16);
+        out_c_orig = (int8_t *) ESP_NN_TEST_ALLOC(size + 16);
+        out_opt_orig = (int8_t *) ESP_NN_TEST_ALLOC(size + 16);
+
+        if (input_orig == NULL || out_c_orig == NULL || out_opt_orig == NULL) {
+            printf(ANSI_COLOR_RED"%s error allocating buffers\n"ANSI_COLOR_RESET, __FUNCTION__);
+            goto quantize_test_cleanup;
+        }
+
+        input = (int16_t *) (((uint32_t) input_orig + 15) & ~15);
+        out_data_c = (int8_t *) (((uint32_t) out_c_orig + 15) & ~15);
+        out_data_opt = (int8_t *) (((uint32_t) out_opt_orig + 15) & ~15);
+        if (itr == 4 || itr == 5) {
+            out_data_opt = out_opt_orig + 1; // unaligned output
+        }
+
+        for (int i = 0; i < size; ++i) {
+            input[i] = rand() % 65536 - 32768;
+        }
+        input[0] = INT16_MIN;
+        input[size - 1] = INT16_MAX;
+
+        if (itr == 0) {
+            /* enable profiler */
+            profile_c_start();
+        }
+        /* C function */
+        esp_nn_quantize_s16_s8_ansi(input, out_data_c, output_offset, output_mult, output_shift, size);
+
+        if (itr == 0) {
+            profile_c_end();
+            profile_opt_start();
+        }
+        /* Optimized function */
+        esp_nn_quantize_s16_s8(input, out_data_opt, output_offset, output_mult, output_shift, size);
+
+        if (itr == 0) {
+            /* disable profiler */
+            profile_opt_end();
+        }
+
+        bool ret = CHECK_EQUAL(out_data_c, out_data_opt, size);
+
+        /* float reference: round(in * mult * 2^(shift - 31)) + offset, off by at most one on ties */
+        double real_mult = ldexp((double) output_mult, output_shift - 31);
+        for (int i = 0; ret && i < size; i++) {
+            double ref = round(input[i] * real_mult) + output_offset;
+            ref = ref < INT8_MIN ? INT8_MIN : (ref > INT8_MAX ? INT8_MAX : ref);
+            if (fabs(ref - out_data_c[i]) > 1) {
+                printf(ANSI_COLOR_RED"%s[%d] in %d: float %d, got %d\n"ANSI_COLOR_RESET, __FUNCTION__, itr,
+                       input[i], (int) ref, out_data_c[i]);
+                ret = false;
+            }
+        }
+        if (ret == false) {
+            printf(ANSI_COLOR_RED"%s[%d] failed\n"ANSI_COLOR_RESET, __FUNCTION__, itr);
+            printf("Output: \n");
+            PRINT_ARRAY_INT8(out_data_opt, size, 1);
+            printf("Expected: \n");
+            PRINT_ARRAY_INT8(out_data_c, size, 1);
+            printf("out_mult %"PRIi32", out_shift %"PRIi32", out_offset %"PRIi32"\n",
+                   output_mult, output_shift, output_offset);
+            goto quantize_test_cleanup;
+        }
+        printf(ANSI_COLOR_GREEN"%s[%d] passed\n"ANSI_COLOR_RESET, __FUNCTION__, itr);
+
+quantize_test_cleanup:
+        if (input_orig) {
+            free(input_orig);
+        }
+        if (out_c_orig) {
+            free(out_c_orig);
+        }
+        if (out_opt_orig) {
+            free(out_opt_orig);
+        }
+    }
+}
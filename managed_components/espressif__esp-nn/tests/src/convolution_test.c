@@ -237,6 +237,7 @@ void esp_nn_depthwise_conv_s8_test()
 
         int scratch_buf_size = esp_nn_get_depthwise_conv_scratch_size(&input_dims, &filter_dims,
                                                                       &output_dims, &conv_params);
+        void *scratch_aligned = NULL;
         if (scratch_buf_size > 0) {
             scratch_buf = ESP_NN_TEST_ALLOC(scratch_buf_size + 16);
             if (scratch_buf == NULL) {
@@ -245,7 +246,8 @@ void esp_nn_depthwise_conv_s8_test()
                 goto dc_s8_cleanup;
             }
             int align_sz = 16 - (((int32_t) scratch_buf) & 0xf);
-            esp_nn_set_depthwise_conv_scratch_buf(scratch_buf + align_sz);
+            scratch_aligned = scratch_buf + align_sz;
+            esp_nn_set_depthwise_conv_scratch_buf(scratch_aligned);
         }
 
         /* enable profiler */
@@ -285,6 +287,17 @@ void esp_nn_depthwise_conv_s8_test()
 #endif
             goto dc_s8_cleanup;
         }
+
+        /* Reentrant version, with the scratch buffer passed per call */
+        esp_nn_set_depthwise_conv_scratch_buf(NULL);
+        memset(out_data_opt, 0, out_size);
+        esp_nn_depthwise_conv_s8_r(&input_dims, input, &filter_dims, filter_data + 4,
+                                   bias + 1, &output_dims, out_data_opt, &conv_params, &quant_data,
+                                   scratch_aligned);
+        if (CHECK_EQUAL(out_data_c, out_data_opt, out_size) == false) {
+            printf(ANSI_COLOR_RED"[%3d] failed (reentrant version)\n"ANSI_COLOR_RESET, itr);
+            goto dc_s8_cleanup;
+        }
         printf(ANSI_COLOR_GREEN"[%3d] passed [pad: (%d, %d), stride: (%d, %d)"
                " out: (%3d,%3d), filter: (%d, %d,%3d), ch_mult %d]"ANSI_COLOR_RESET,
                itr, pad_wd, pad_ht, stride_wd, stride_ht, out_wd,
@@ -542,6 +555,7 @@ void esp_nn_conv_s8_test()
 
         int scratch_buf_size = esp_nn_get_conv_scratch_size(&input_dims, &filter_dims,
                                                             &output_dims, &conv_params);
+        void *scratch_aligned = NULL;
         if (scratch_buf_size > 0) {
 #if IDF_HEAP_CAPS
             void *scratch_buf = heap_caps_malloc(scratch_buf_size + 16, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
@@ -553,7 +567,8 @@ void esp_nn_conv_s8_test()
                 goto conv_s8_cleanup;
             }
             int align_sz = 16 - (((int32_t) scratch_buf) & 0xf);
-            esp_nn_set_conv_scratch_buf(scratch_buf + align_sz);
+            scratch_aligned = scratch_buf + align_sz;
+            esp_nn_set_conv_scratch_buf(scratch_aligned);
         }
 
         /* enable profiler */
@@ -593,6 +608,16 @@ void esp_nn_conv_s8_test()
 #endif
             goto conv_s8_cleanup;
         }
+
+        /* Reentrant version, with the scratch buffer passed per call */
+        esp_nn_set_conv_scratch_buf(NULL);
+        memset(out_data_opt, 0, out_size);
+        esp_nn_conv_s8_r(&input_dims, input, &filter_dims, filter_data,
+                         bias, &output_dims, out_data_opt, &conv_params, &quant_data, scratch_aligned);
+        if (CHECK_EQUAL(out_data_c, out_data_opt, out_size) == false) {
+            printf(ANSI_COLOR_RED"[%3d] failed (reentrant version)\n"ANSI_COLOR_RESET, itr);
+            goto conv_s8_cleanup;
+        }
         printf(ANSI_COLOR_GREEN"[%3d] passed [pad: (%d, %d), stride: (%d, %d)"
                " out: (%3d,%3d,%3d), filter: (%d, %d,%3d)]"ANSI_COLOR_RESET,
                itr, pad_wd, pad_ht, stride_wd, stride_ht, out_wd, out_ht,
@@ -626,3 +651,1097 @@ void esp_nn_conv_s8_test()
         }
     }
 }
+
+void esp_nn_conv_max_pool_s8_test()
+{
+    uint32_t total_c = 0, total_opt = 0;
+    const int32_t input_offset = 5; /* some number in [-128, 127] */
+    const int32_t out_offset = -3;
+    /* relu fused in the conv, then a narrower range for the pool */
+    const int32_t activation_min = out_offset;
+    const int32_t activation_max = 127;
+    const int32_t pool_act_min = -2;
+    const int32_t pool_act_max = 100;
+
+    /* independent variables */
+    int in_wd, in_ht, in_channels, out_channels;
+    uint16_t filter_wd, filter_ht, stride_wd, stride_ht;
+    uint16_t pool_wd, pool_ht, pool_stride_wd, pool_stride_ht;
+
+    printf("\n######## Running %s ##########\n", __FUNCTION__);
+    for (int itr = 0; itr < 4; itr++) {
+        switch (itr) {
+        case 0: // conv 3x3, pool 2x2 stride 2
+            in_wd = 12;
+            in_ht = 12;
+            in_channels = 3;
+            out_channels = 8;
+            filter_wd = 3;
+            filter_ht = 3;
+            stride_wd = 1;
+            stride_ht = 1;
+            pool_wd = 2;
+            pool_ht = 2;
+            pool_stride_wd = 2;
+            pool_stride_ht = 2;
+            break;
+        case 1: // conv stride 2, last conv row not pooled
+            in_wd = 16;
+            in_ht = 11;
+            in_channels = 8;
+            out_channels = 16;
+            filter_wd = 3;
+            filter_ht = 3;
+            stride_wd = 2;
+            stride_ht = 2;
+            pool_wd = 2;
+            pool_ht = 2;
+            pool_stride_wd = 2;
+            pool_stride_ht = 2;
+            break;
+        case 2: // conv 1x1, pool 3x3 stride 3, channels % 4 != 0
+            in_wd = 10;
+            in_ht = 10;
+            in_channels = 5;
+            out_channels = 6;
+            filter_wd = 1;
+            filter_ht = 1;
+            stride_wd = 1;
+            stride_ht = 1;
+            pool_wd = 3;
+            pool_ht = 3;
+            pool_stride_wd = 3;
+            pool_stride_ht = 3;
+            break;
+        default: // pool (2, 3) stride (2, 4): conv rows skipped between bands
+            in_wd = 9;
+            in_ht = 14;
+            in_channels = 16;
+            out_channels = 16;
+            filter_wd = 3;
+            filter_ht = 3;
+            stride_wd = 1;
+            stride_ht = 1;
+            pool_wd = 2;
+            pool_ht = 3;
+            pool_stride_wd = 2;
+            pool_stride_ht = 4;
+            break;
+        }
+
+        const int conv_wd = (in_wd - filter_wd) / stride_wd + 1;
+        const int conv_ht = (in_ht - filter_ht) / stride_ht + 1;
+        const int out_wd = (conv_wd - pool_wd) / pool_stride_wd + 1;
+        const int out_ht = (conv_ht - pool_ht) / pool_stride_ht + 1;
+
+        const int in_size = in_wd * in_ht * in_channels;
+        const int filter_size = filter_wd * filter_ht * in_channels * out_channels;
+        const int conv_size = conv_wd * conv_ht * out_channels;
+        const int out_size = out_wd * out_ht * out_channels;
+
+        int8_t *input = ESP_NN_TEST_ALLOC(in_size);
+        int8_t *filter_data = ESP_NN_TEST_ALLOC(filter_size);
+        int8_t *conv_out = ESP_NN_TEST_ALLOC(conv_size);
+        int8_t *out_data_c = ESP_NN_TEST_ALLOC(out_size);
+        int8_t *out_data_opt = ESP_NN_TEST_ALLOC(out_size);
+        int32_t *bias = ESP_NN_TEST_ALLOC(sizeof (int32_t) * out_channels);
+        int32_t *out_shift = ESP_NN_TEST_ALLOC(sizeof (int32_t) * out_channels);
+        int32_t *out_mult = ESP_NN_TEST_ALLOC(sizeof (int32_t) * out_channels);
+        int8_t *conv_rows = NULL;
+        void *scratch = NULL;
+
+        if (input == NULL || filter_data == NULL || conv_out == NULL ||
+                out_data_c == NULL || out_data_opt == NULL ||
+                bias == NULL || out_shift == NULL || out_mult == NULL) {
+            printf(ANSI_COLOR_RED"allocations failed\n"ANSI_COLOR_RESET);
+            goto conv_max_pool_s8_cleanup;
+        }
+
+        for (int i = 0; i < in_size; ++i) {
+            input[i] = rand() % 255 - 128;
+        }
+        for (int i = 0; i < filter_size; ++i) {
+            filter_data[i] = rand() % 256 - 128;
+        }
+        for (int i = 0; i < out_channels; ++i) {
+            bias[i] = (int32_t)rand() % UINT16_MAX - INT16_MAX;
+            out_shift[i] = -10 + rand() % 2;
+            out_mult[i] = 0x7f67f4f8 + rand() % 50;
+        }
+
+        data_dims_t input_dims = {.width = in_wd, .height = in_ht, .channels = in_channels, 1};
+        data_dims_t conv_dims = {.width = conv_wd, .height = conv_ht, .channels = out_channels, 1};
+        data_dims_t output_dims = {.width = out_wd, .height = out_ht, .channels = out_channels, 1};
+        data_dims_t filter_dims = {.width = filter_wd, .height = filter_ht, 0, 0};
+        conv_params_t conv_params = {.in_offset = input_offset, .out_offset = out_offset,
+                                    .stride = {stride_wd, stride_ht}, .padding = {0, 0},
+                                    .dilation = {0, 0}, .activation = {activation_min, activation_max}};
+        quant_data_t quant_data = {.shift = out_shift, .mult = out_mult};
+        pool_params_t pool_params = {.stride = {pool_stride_wd, pool_stride_ht},
+                                     .filter = {pool_wd, pool_ht},
+                                     .activation = {pool_act_min, pool_act_max}};
+
+        int rows_size = esp_nn_get_conv_max_pool_rows_size(&input_dims, &filter_dims, &conv_params,
+                                                           &pool_params, &output_dims);
+        int scratch_size = esp_nn_get_conv_max_pool_scratch_size(&input_dims, &filter_dims,
+                                                                 &conv_params, &pool_params,
+                                                                 &output_dims);
+        conv_rows = ESP_NN_TEST_ALLOC(rows_size);
+        scratch = ESP_NN_TEST_ALLOC(scratch_size > 0 ? scratch_size : 1);
+        if (conv_rows == NULL || scratch == NULL) {
+            printf(ANSI_COLOR_RED"conv_rows/scratch allocations failed\n"ANSI_COLOR_RESET);
+            goto conv_max_pool_s8_cleanup;
+        }
+
+        /* reference: full conv output, then pooled */
+        profile_c_start();
+        esp_nn_conv_s8_ansi(&input_dims, input, &filter_dims, filter_data,
+                            bias, &conv_dims, conv_out, &conv_params, &quant_data);
+        esp_nn_max_pool_s8_ansi(conv_out, conv_wd, conv_ht, out_data_c, out_wd, out_ht,
+                                pool_stride_wd, pool_stride_ht, pool_wd, pool_ht, 0, 0,
+                                pool_act_min, pool_act_max, out_channels);
+        total_c = profile_c_end();
+
+        profile_opt_start();
+        esp_nn_conv_max_pool_s8_r(&input_dims, input, &filter_dims, filter_data, bias,
+                                  &conv_params, &quant_data, &pool_params,
+                                  &output_dims, out_data_opt, conv_rows, scratch);
+        total_opt = profile_opt_end();
+
+        if (CHECK_EQUAL(out_data_c, out_data_opt, out_size) == false) {
+            printf(ANSI_COLOR_RED"[%3d] failed [conv: (%d, %d) stride (%d, %d),"
+                   " pool: (%d, %d) stride (%d, %d), out: (%3d,%3d,%3d)]\n"ANSI_COLOR_RESET,
+                   itr, filter_wd, filter_ht, stride_wd, stride_ht, pool_wd, pool_ht,
+                   pool_stride_wd, pool_stride_ht, out_wd, out_ht, out_channels);
+            goto conv_max_pool_s8_cleanup;
+        }
+        printf(ANSI_COLOR_GREEN"[%3d] passed [conv: (%d, %d) stride (%d, %d),"
+               " pool: (%d, %d) stride (%d, %d), out: (%3d,%3d,%3d)]"ANSI_COLOR_RESET,
+               itr, filter_wd, filter_ht, stride_wd, stride_ht, pool_wd, pool_ht,
+               pool_stride_wd, pool_stride_ht, out_wd, out_ht, out_channels);
+        printf("\tcycles: c %8"PRIu32", opt %8"PRIu32"\n", total_c, total_opt);
+
+    conv_max_pool_s8_cleanup:
+        if (input) {
+            free(input);
+        }
+        if (filter_data) {
+            free(filter_data);
+        }
+        if (conv_out) {
+            free(conv_out);
+        }
+        if (out_data_c) {
+            free(out_data_c);
+        }
+        if (out_data_opt) {
+            free(out_data_opt);
+        }
+        if (bias) {
+            free(bias);
+        }
+        if (out_shift) {
+            free(out_shift);
+        }
+        if (out_mult) {
+            free(out_mult);
+        }
+        if (conv_rows) {
+            free(conv_rows);
+        }
+        if (scratch) {
+            free(scratch);
+        }
+    }
+}
+
+void esp_nn_conv_s8_backends_test()
+{
+    uint32_t total_c = 0, total_opt = 0;
+    const int32_t input_offset = 7; /* some number in [-128, 127] */
+    const int32_t out_offset = -5;
+    const int32_t activation_min = -128;
+    const int32_t activation_max = 127;
+
+    /* independent variables */
+    int in_wd, in_ht, in_channels, out_channels;
+    uint16_t filter_wd, filter_ht, pad_wd, pad_ht, stride_wd, stride_ht;
+
+    printf("\n######## Running %s ##########\n", __FUNCTION__);
+    for (int itr = 0; itr < 6; itr++) {
+        switch (itr) {
+        case 0: // 3x3 pad (1, 1), odd output: partial winograd tiles
+            in_wd = 9;
+            in_ht = 7;
+            in_channels = 16;
+            out_channels = 16;
+            filter_wd = 3;
+            filter_ht = 3;
+            pad_wd = 1;
+            pad_ht = 1;
+            stride_wd = 1;
+            stride_ht = 1;
+            break;
+        case 1: // 3x3 pad (0, 0), channels % 4 != 0
+            in_wd = 12;
+            in_ht = 10;
+            in_channels = 5;
+            out_channels = 7;
+            filter_wd = 3;
+            filter_ht = 3;
+            pad_wd = 0;
+            pad_ht = 0;
+            stride_wd = 1;
+            stride_ht = 1;
+            break;
+        case 2: // 3x3 with the largest winograd input depth
+            in_wd = 6;
+            in_ht = 6;
+            in_channels = 128;
+            out_channels = 8;
+            filter_wd = 3;
+            filter_ht = 3;
+            pad_wd = 1;
+            pad_ht = 1;
+            stride_wd = 1;
+            stride_ht = 1;
+            break;
+        case 3: // 3x3 stride (2, 2), im2col only
+            in_wd = 15;
+            in_ht = 15;
+            in_channels = 8;
+            out_channels = 13;
+            filter_wd = 3;
+            filter_ht = 3;
+            pad_wd = 1;
+            pad_ht = 1;
+            stride_wd = 2;
+            stride_ht = 2;
+            break;
+        case 4: // single input channel, like the first layer of a keyword model
+            in_wd = 40;
+            in_ht = 49;
+            in_channels = 1;
+            out_channels = 8;
+            filter_wd = 10;
+            filter_ht = 8;
+            pad_wd = 4;
+            pad_ht = 4;
+            stride_wd = 2;
+            stride_ht = 2;
+            break;
+        default: // 5x3 filter, output width not a multiple of the pixel block
+            in_wd = 11;
+            in_ht = 6;
+            in_channels = 12;
+            out_channels = 3;
+            filter_wd = 5;
+            filter_ht = 3;
+            pad_wd = 0;
+            pad_ht = 0;
+            stride_wd = 1;
+            stride_ht = 1;
+            break;
+        }
+
+        const int out_wd = (in_wd + 2 * pad_wd - filter_wd) / stride_wd + 1;
+        const int out_ht = (in_ht + 2 * pad_ht - filter_ht) / stride_ht + 1;
+        const int in_size = in_wd * in_ht * in_channels;
+        const int filter_size = filter_wd * filter_ht * in_channels * out_channels;
+        const int out_size = out_wd * out_ht * out_channels;
+
+        int8_t *input = ESP_NN_TEST_ALLOC(in_size);
+        int8_t *filter_data = ESP_NN_TEST_ALLOC(filter_size);
+        int8_t *out_data_c = ESP_NN_TEST_ALLOC(out_size);
+        int8_t *out_data_opt = ESP_NN_TEST_ALLOC(out_size);
+        int32_t *bias = ESP_NN_TEST_ALLOC(sizeof (int32_t) * out_channels);
+        int32_t *out_shift = ESP_NN_TEST_ALLOC(sizeof (int32_t) * out_channels);
+        int32_t *out_mult = ESP_NN_TEST_ALLOC(sizeof (int32_t) * out_channels);
+        void *scratch = NULL;
+
+        if (input == NULL || filter_data == NULL || out_data_c == NULL || out_data_opt == NULL ||
+                bias == NULL || out_shift == NULL || out_mult == NULL) {
+            printf(ANSI_COLOR_RED"allocations failed\n"ANSI_COLOR_RESET);
+            goto conv_s8_backends_cleanup;
+        }
+
+        for (int i = 0; i < in_size; ++i) {
+            input[i] = rand() % 256 - 128;
+        }
+        for (int i = 0; i < filter_size; ++i) {
+            filter_data[i] = rand() % 256 - 128;
+        }
+        for (int i = 0; i < out_channels; ++i) {
+            bias[i] = (int32_t)rand() % UINT16_MAX - INT16_MAX;
+            out_shift[i] = -10 + rand() % 4;
+            out_mult[i] = 0x7f67f4f8 + rand() % 50;
+        }
+
+        data_dims_t input_dims = {.width = in_wd, .height = in_ht, .channels = in_channels, 1};
+        data_dims_t output_dims = {.width = out_wd, .height = out_ht, .channels = out_channels, 1};
+        data_dims_t filter_dims = {.width = filter_wd, .height = filter_ht, 0, 0};
+        conv_params_t conv_params = {.in_offset = input_offset, .out_offset = out_offset,
+                                    .stride = {stride_wd, stride_ht}, .padding = {pad_wd, pad_ht},
+                                    .dilation = {0, 0}, .activation = {activation_min, activation_max}};
+        quant_data_t quant_data = {.shift = out_shift, .mult = out_mult};
+
+        int im2col_size = esp_nn_get_conv_im2col_scratch_size_opt(&input_dims, &filter_dims,
+                                                                  &output_dims, &conv_params);
+        int winograd_size = esp_nn_get_conv_winograd_scratch_size_opt(&input_dims, &filter_dims,
+                                                                      &output_dims, &conv_params);
+        scratch = ESP_NN_TEST_ALLOC(max(im2col_size, winograd_size));
+        if (scratch == NULL) {
+            printf(ANSI_COLOR_RED"scratch alloc failed\n"ANSI_COLOR_RESET);
+            goto conv_s8_backends_cleanup;
+        }
+
+        profile_c_start();
+        esp_nn_conv_s8_ansi(&input_dims, input, &filter_dims, filter_data,
+                            bias, &output_dims, out_data_c, &conv_params, &quant_data);
+        total_c = profile_c_end();
+
+        profile_opt_start();
+        esp_nn_conv_im2col_s8_r_opt(&input_dims, input, &filter_dims, filter_data, bias,
+                                    &output_dims, out_data_opt, &conv_params, &quant_data, scratch);
+        total_opt = profile_opt_end();
+        if (CHECK_EQUAL(out_data_c, out_data_opt, out_size) == false) {
+            printf(ANSI_COLOR_RED"[%3d] failed (im2col)\n"ANSI_COLOR_RESET, itr);
+            goto conv_s8_backends_cleanup;
+        }
+        printf(ANSI_COLOR_GREEN"[%3d] passed [pad: (%d, %d), stride: (%d, %d)"
+               " out: (%3d,%3d,%3d), filter: (%d, %d,%3d)] im2col"ANSI_COLOR_RESET,
+               itr, pad_wd, pad_ht, stride_wd, stride_ht, out_wd, out_ht,
+               out_channels, filter_wd, filter_ht, in_channels);
+        printf("\tcycles: c %8"PRIu32", opt %8"PRIu32"\n", total_c, total_opt);
+
+        if (winograd_size > 0) {
+            memset(out_data_opt, 0, out_size);
+            profile_opt_start();
+            esp_nn_conv_winograd_s8_r_opt(&input_dims, input, &filter_dims, filter_data, bias,
+                                          &output_dims, out_data_opt, &conv_params, &quant_data,
+                                          scratch);
+            total_opt = profile_opt_end();
+            if (CHECK_EQUAL(out_data_c, out_data_opt, out_size) == false) {
+                printf(ANSI_COLOR_RED"[%3d] failed (winograd)\n"ANSI_COLOR_RESET, itr);
+                goto conv_s8_backends_cleanup;
+            }
+            printf(ANSI_COLOR_GREEN"[%3d] passed winograd"ANSI_COLOR_RESET, itr);
+            printf("\tcycles: c %8"PRIu32", opt %8"PRIu32"\n", total_c, total_opt);
+        }
+
+    conv_s8_backends_cleanup:
+        if (input) {
+            free(input);
+        }
+        if (filter_data) {
+            free(filter_data);
+        }
+        if (out_data_c) {
+            free(out_data_c);
+        }
+        if (out_data_opt) {
+            free(out_data_opt);
+        }
+        if (bias) {
+            free(bias);
+        }
+        if (out_shift) {
+            free(out_shift);
+        }
+        if (out_mult) {
+            free(out_mult);
+        }
+        if (scratch) {
+            free(scratch);
+        }
+    }
+}
+
+void esp_nn_conv_s8_variants_test()
+{
+    const int32_t input_offset = -3; /* some number in [-128, 127] */
+    const int32_t out_offset = 9;
+    const int32_t activation_min = -128;
+    const int32_t activation_max = 127;
+
+    /* independent variables */
+    int in_wd, in_ht, in_channels, out_channels, ch_mult;
+    uint16_t filter_wd, filter_ht, pad_wd, pad_ht, stride_wd, stride_ht;
+
+    printf("\n######## Running %s ##########\n", __FUNCTION__);
+    for (int itr = 0; itr < 5; itr++) {
+        /* first three are convolutions, then depthwise */
+        const bool depthwise = itr >= 3;
+        ch_mult = 1;
+        switch (itr) {
+        case 0: // 3x3 stride 1: every conv variant
+            in_wd = 10;
+            in_ht = 8;
+            in_channels = 16;
+            out_channels = 12;
+            filter_wd = 3;
+            filter_ht = 3;
+            pad_wd = 1;
+            pad_ht = 1;
+            stride_wd = 1;
+            stride_ht = 1;
+            break;
+        case 1: // 1x1
+            in_wd = 7;
+            in_ht = 5;
+            in_channels = 24;
+            out_channels = 10;
+            filter_wd = 1;
+            filter_ht = 1;
+            pad_wd = 0;
+            pad_ht = 0;
+            stride_wd = 1;
+            stride_ht = 1;
+            break;
+        case 2: // 4x3 stride (2, 2)
+            in_wd = 13;
+            in_ht = 11;
+            in_channels = 3;
+            out_channels = 8;
+            filter_wd = 4;
+            filter_ht = 3;
+            pad_wd = 1;
+            pad_ht = 1;
+            stride_wd = 2;
+            stride_ht = 2;
+            break;
+        case 3: // depthwise 3x3, ch_mult 1
+            in_wd = 12;
+            in_ht = 9;
+            in_channels = 16;
+            filter_wd = 3;
+            filter_ht = 3;
+            pad_wd = 1;
+            pad_ht = 1;
+            stride_wd = 1;
+            stride_ht = 1;
+            break;
+        default: // depthwise 5x5, ch_mult 2, stride (2, 2)
+            in_wd = 14;
+            in_ht = 10;
+            in_channels = 6;
+            ch_mult = 2;
+            filter_wd = 5;
+            filter_ht = 5;
+            pad_wd = 2;
+            pad_ht = 2;
+            stride_wd = 2;
+            stride_ht = 2;
+            break;
+        }
+        if (depthwise) {
+            out_channels = in_channels * ch_mult;
+        }
+
+        const int out_wd = (in_wd + 2 * pad_wd - filter_wd) / stride_wd + 1;
+        const int out_ht = (in_ht + 2 * pad_ht - filter_ht) / stride_ht + 1;
+        const int in_size = in_wd * in_ht * in_channels;
+        const int filter_size = depthwise ? filter_wd * filter_ht * out_channels :
+                                filter_wd * filter_ht * in_channels * out_channels;
+        const int out_size = out_wd * out_ht * out_channels;
+
+        int8_t *input = ESP_NN_TEST_ALLOC(in_size);
+        int8_t *filter_data = ESP_NN_TEST_ALLOC(filter_size);
+        int8_t *out_data_c = ESP_NN_TEST_ALLOC(out_size);
+        int8_t *out_data_opt = ESP_NN_TEST_ALLOC(out_size);
+        int32_t *bias = ESP_NN_TEST_ALLOC(sizeof (int32_t) * out_channels);
+        int32_t *out_shift = ESP_NN_TEST_ALLOC(sizeof (int32_t) * out_channels);
+        int32_t *out_mult = ESP_NN_TEST_ALLOC(sizeof (int32_t) * out_channels);
+
+        if (input == NULL || filter_data == NULL || out_data_c == NULL || out_data_opt == NULL ||
+                bias == NULL || out_shift == NULL || out_mult == NULL) {
+            printf(ANSI_COLOR_RED"allocations failed\n"ANSI_COLOR_RESET);
+            goto conv_s8_variants_cleanup;
+        }
+
+        for (int i = 0; i < in_size; ++i) {
+            input[i] = rand() % 256 - 128;
+        }
+        for (int i = 0; i < filter_size; ++i) {
+            filter_data[i] = rand() % 256 - 128;
+        }
+        for (int i = 0; i < out_channels; ++i) {
+            bias[i] = (int32_t)rand() % UINT16_MAX - INT16_MAX;
+            out_shift[i] = -10 + rand() % 4;
+            out_mult[i] = 0x7f67f4f8 + rand() % 50;
+        }
+
+        data_dims_t input_dims = {.width = in_wd, .height = in_ht, .channels = in_channels, 1};
+        data_dims_t output_dims = {.width = out_wd, .height = out_ht, .channels = out_channels, 1};
+        data_dims_t filter_dims = {.width = filter_wd, .height = filter_ht, 0, 0};
+        conv_params_t conv_params = {.in_offset = input_offset, .out_offset = out_offset,
+                                    .stride = {stride_wd, stride_ht}, .padding = {pad_wd, pad_ht},
+                                    .dilation = {0, 0}, .activation = {activation_min, activation_max}};
+        dw_conv_params_t dw_conv_params = {.in_offset = input_offset, .out_offset = out_offset,
+                                           .ch_mult = ch_mult,
+                                           .stride = {stride_wd, stride_ht}, .padding = {pad_wd, pad_ht},
+                                           .dilation = {0, 0}, .activation = {activation_min, activation_max}};
+        quant_data_t quant_data = {.shift = out_shift, .mult = out_mult};
+
+        if (depthwise) {
+            esp_nn_depthwise_conv_s8_ansi(&input_dims, input, &filter_dims, filter_data, bias,
+                                          &output_dims, out_data_c, &dw_conv_params, &quant_data);
+        } else {
+            esp_nn_conv_s8_ansi(&input_dims, input, &filter_dims, filter_data, bias,
+                                &output_dims, out_data_c, &conv_params, &quant_data);
+        }
+
+        for (int variant = 0; variant < ESP_NN_VARIANT_COUNT; variant++) {
+            const int size = depthwise ?
+                esp_nn_get_depthwise_conv_variant_scratch_size(variant, &input_dims, &filter_dims,
+                                                               &output_dims, &dw_conv_params) :
+                esp_nn_get_conv_variant_scratch_size(variant, &input_dims, &filter_dims,
+                                                     &output_dims, &conv_params);
+            if (size < 0) {
+                continue;
+            }
+            void *scratch = size > 0 ? ESP_NN_TEST_ALLOC(size) : NULL;
+            if (size > 0 && scratch == NULL) {
+                printf(ANSI_COLOR_RED"scratch alloc failed\n"ANSI_COLOR_RESET);
+                goto conv_s8_variants_cleanup;
+            }
+            memset(out_data_opt, 0, out_size);
+            if (depthwise) {
+                esp_nn_depthwise_conv_s8_variant_r(variant, &input_dims, input, &filter_dims,
+                                                   filter_data, bias, &output_dims, out_data_opt,
+                                                   &dw_conv_params, &quant_data, scratch);
+            } else {
+                esp_nn_conv_s8_variant_r(variant, &input_dims, input, &filter_dims, filter_data,
+                                         bias, &output_dims, out_data_opt, &conv_params,
+                                         &quant_data, scratch);
+            }
+            if (scratch) {
+                free(scratch);
+            }
+            if (CHECK_EQUAL(out_data_c, out_data_opt, out_size) == false) {
+                printf(ANSI_COLOR_RED"[%3d] failed (%s)\n"ANSI_COLOR_RESET, itr,
+                       esp_nn_variant_name(variant));
+                goto conv_s8_variants_cleanup;
+            }
+            printf(ANSI_COLOR_GREEN"[%3d] passed [%s, filter: (%d, %d), out: (%3d,%3d,%3d)] %s"
+                   ANSI_COLOR_RESET"\n", itr, depthwise ? "depthwise" : "conv", filter_wd, filter_ht,
+                   out_wd, out_ht, out_channels, esp_nn_variant_name(variant));
+        }
+
+    conv_s8_variants_cleanup:
+        if (input) {
+            free(input);
+        }
+        if (filter_data) {
+            free(filter_data);
+        }
+        if (out_data_c) {
+            free(out_data_c);
+        }
+        if (out_data_opt) {
+            free(out_data_opt);
+        }
+        if (bias) {
+            free(bias);
+        }
+        if (out_shift) {
+            free(out_shift);
+        }
+        if (out_mult) {
+            free(out_mult);
+        }
+    }
+}
+
+/* int16 input and output, int8 filter, int64 bias */
+void esp_nn_conv_s16_s8_test()
+{
+    uint32_t total_c = 0, total_opt = 0;
+
+    /* independent variables */
+    int in_wd, in_ht, in_channels, out_channels;
+    uint16_t filter_wd, filter_ht, pad_wd, pad_ht, stride_wd, stride_ht;
+    int32_t activation_min, activation_max;
+    bool extreme;
+
+    printf("\n######## Running %s ##########\n", __FUNCTION__);
+    for (int itr = 0; itr < 5; itr++) {
+        activation_min = INT16_MIN;
+        activation_max = INT16_MAX;
+        extreme = false;
+        switch (itr) {
+        case 0: // 3x3 pad (1, 1)
+            in_wd = 9;
+            in_ht = 7;
+            in_channels = 16;
+            out_channels = 16;
+            filter_wd = 3;
+            filter_ht = 3;
+            pad_wd = 1;
+            pad_ht = 1;
+            stride_wd = 1;
+            stride_ht = 1;
+            break;
+        case 1: // 1x1, channels % 4 != 0, relu range
+            in_wd = 6;
+            in_ht = 5;
+            in_channels = 13;
+            out_channels = 7;
+            filter_wd = 1;
+            filter_ht = 1;
+            pad_wd = 0;
+            pad_ht = 0;
+            stride_wd = 1;
+            stride_ht = 1;
+            activation_min = 0;
+            break;
+        case 2: // single input channel, like the first layer of a keyword model
+            in_wd = 40;
+            in_ht = 49;
+            in_channels = 1;
+            out_channels = 8;
+            filter_wd = 10;
+            filter_ht = 8;
+            pad_wd = 4;
+            pad_ht = 4;
+            stride_wd = 2;
+            stride_ht = 2;
+            break;
+        case 3: // 5x3 stride (2, 1)
+            in_wd = 11;
+            in_ht = 6;
+            in_channels = 12;
+            out_channels = 5;
+            filter_wd = 5;
+            filter_ht = 3;
+            pad_wd = 2;
+            pad_ht = 0;
+            stride_wd = 2;
+            stride_ht = 1;
+            break;
+        default: // full scale input and filter: the sums overflow 32 bits
+            in_wd = 5;
+            in_ht = 5;
+            in_channels = 128;
+            out_channels = 6;
+            filter_wd = 3;
+            filter_ht = 3;
+            pad_wd = 0;
+            pad_ht = 0;
+            stride_wd = 1;
+            stride_ht = 1;
+            extreme = true;
+            break;
+        }
+
+        const int out_wd = (in_wd + 2 * pad_wd - filter_wd) / stride_wd + 1;
+        const int out_ht = (in_ht + 2 * pad_ht - filter_ht) / stride_ht + 1;
+        const int in_size = in_wd * in_ht * in_channels;
+        const int filter_size = filter_wd * filter_ht * in_channels * out_channels;
+        const int out_size = out_wd * out_ht * out_channels;
+
+        int16_t *input = ESP_NN_TEST_ALLOC(in_size * sizeof(int16_t));
+        int8_t *filter_data = ESP_NN_TEST_ALLOC(filter_size);
+        int16_t *out_data_c = ESP_NN_TEST_ALLOC(out_size * sizeof(int16_t));
+        int16_t *out_data_opt = ESP_NN_TEST_ALLOC(out_size * sizeof(int16_t));
+        int64_t *bias = ESP_NN_TEST_ALLOC(sizeof (int64_t) * out_channels);
+        int32_t *out_shift = ESP_NN_TEST_ALLOC(sizeof (int32_t) * out_channels);
+        int32_t *out_mult = ESP_NN_TEST_ALLOC(sizeof (int32_t) * out_channels);
+
+        if (input == NULL || filter_data == NULL || out_data_c == NULL || out_data_opt == NULL ||
+                bias == NULL || out_shift == NULL || out_mult == NULL) {
+            printf(ANSI_COLOR_RED"allocations failed\n"ANSI_COLOR_RESET);
+            goto conv_s16_s8_cleanup;
+        }
+
+        for (int i = 0; i < in_size; ++i) {
+            input[i] = extreme ? INT16_MIN : rand() % 65536 - 32768;
+        }
+        for (int i = 0; i < filter_size; ++i) {
+            filter_data[i] = extreme ? INT8_MIN : rand() % 256 - 128;
+        }
+        for (int i = 0; i < out_channels; ++i) {
+            bias[i] = (int64_t) (rand() % (1 << 21)) - (1 << 20);
+            out_shift[i] = extreme ? -18 - rand() % 4 : -8 - rand() % 6;
+            out_mult[i] = 0x40000000 + rand() % 0x3fffffff;
+        }
+
+        data_dims_t input_dims = {.width = in_wd, .height = in_ht, .channels = in_channels, 1};
+        data_dims_t output_dims = {.width = out_wd, .height = out_ht, .channels = out_channels, 1};
+        data_dims_t filter_dims = {.width = filter_wd, .height = filter_ht, 0, 0};
+        conv_params_t conv_params = {.in_offset = 0, .out_offset = 0,
+                                    .stride = {stride_wd, stride_ht}, .padding = {pad_wd, pad_ht},
+                                    .dilation = {0, 0}, .activation = {activation_min, activation_max}};
+        quant_data_t quant_data = {.shift = out_shift, .mult = out_mult};
+
+        profile_c_start();
+        esp_nn_conv_s16_s8_ansi(&input_dims, input, &filter_dims, filter_data,
+                                bias, &output_dims, out_data_c, &conv_params, &quant_data);
+        total_c = profile_c_end();
+
+        profile_opt_start();
+        esp_nn_conv_s16_s8(&input_dims, input, &filter_dims, filter_data,
+                           bias, &output_dims, out_data_opt, &conv_params, &quant_data);
+        total_opt = profile_opt_end();
+
+        if (CHECK_EQUAL(out_data_c, out_data_opt, out_size) == false) {
+            printf(ANSI_COLOR_RED"[%3d] failed\n"ANSI_COLOR_RESET, itr);
+            goto conv_s16_s8_cleanup;
+        }
+        printf(ANSI_COLOR_GREEN"[%3d] passed [pad: (%d, %d), stride: (%d, %d)"
+               " out: (%3d,%3d,%3d), filter: (%d, %d,%3d)]"ANSI_COLOR_RESET,
+               itr, pad_wd, pad_ht, stride_wd, stride_ht, out_wd, out_ht,
+               out_channels, filter_wd, filter_ht, in_channels);
+        printf("\tcycles: c %8"PRIu32", opt %8"PRIu32"\n", total_c, total_opt);
+
+    conv_s16_s8_cleanup:
+        if (input) {
+            free(input);
+        }
+        if (filter_data) {
+            free(filter_data);
+        }
+        if (out_data_c) {
+            free(out_data_c);
+        }
+        if (out_data_opt) {
+            free(out_data_opt);
+        }
+        if (bias) {
+            free(bias);
+        }
+        if (out_shift) {
+            free(out_shift);
+        }
+        if (out_mult) {
+            free(out_mult);
+        }
+    }
+}
+
+/* int16 input and output, int8 filter, int64 bias */
+void esp_nn_depthwise_conv_s16_s8_test()
+{
+    uint32_t total_c = 0, total_opt = 0;
+
+    /* independent variables */
+    int in_wd, in_ht, channels;
+    uint16_t filter_wd, filter_ht, ch_mult, pad_wd, pad_ht, stride_wd, stride_ht;
+
+    printf("\n######## Running %s ##########\n", __FUNCTION__);
+    for (int itr = 0; itr < 5; itr++) {
+        switch (itr) {
+        case 0: // ch_mult 1, 3x3 pad (1, 1)
+            in_wd = 10;
+            in_ht = 10;
+            channels = 16;
+            ch_mult = 1;
+            filter_wd = 3;
+            filter_ht = 3;
+            pad_wd = 1;
+            pad_ht = 1;
+            stride_wd = 1;
+            stride_ht = 1;
+            break;
+        case 1: // ch_mult 1, channels % 4 != 0, stride (2, 2)
+            in_wd = 11;
+            in_ht = 9;
+            channels = 10;
+            ch_mult = 1;
+            filter_wd = 3;
+            filter_ht = 3;
+            pad_wd = 0;
+            pad_ht = 0;
+            stride_wd = 2;
+            stride_ht = 2;
+            break;
+        case 2: // ch_mult 4
+            in_wd = 6;
+            in_ht = 6;
+            channels = 4;
+            ch_mult = 4;
+            filter_wd = 3;
+            filter_ht = 3;
+            pad_wd = 1;
+            pad_ht = 1;
+            stride_wd = 1;
+            stride_ht = 1;
+            break;
+        case 3: // ch_mult 3, 5x5
+            in_wd = 12;
+            in_ht = 8;
+            channels = 5;
+            ch_mult = 3;
+            filter_wd = 5;
+            filter_ht = 5;
+            pad_wd = 2;
+            pad_ht = 2;
+            stride_wd = 1;
+            stride_ht = 1;
+            break;
+        default: // 1x1 input with a filter wider than the image
+            in_wd = 1;
+            in_ht = 1;
+            channels = 8;
+            ch_mult = 1;
+            filter_wd = 3;
+            filter_ht = 3;
+            pad_wd = 1;
+            pad_ht = 1;
+            stride_wd = 1;
+            stride_ht = 1;
+            break;
+        }
+
+        const int out_channels = channels * ch_mult;
+        const int out_wd = (in_wd + 2 * pad_wd - filter_wd) / stride_wd + 1;
+        const int out_ht = (in_ht + 2 * pad_ht - filter_ht) / stride_ht + 1;
+        const int in_size = in_wd * in_ht * channels;
+        const int filter_size = filter_wd * filter_ht * out_channels;
+        const int out_size = out_wd * out_ht * out_channels;
+
+        int16_t *input = ESP_NN_TEST_ALLOC(in_size * sizeof(int16_t));
+        int8_t *filter_data = ESP_NN_TEST_ALLOC(filter_size);
+        int16_t *out_data_c = ESP_NN_TEST_ALLOC(out_size * sizeof(int16_t));
+        int16_t *out_data_opt = ESP_NN_TEST_ALLOC(out_size * sizeof(int16_t));
+        int64_t *bias = ESP_NN_TEST_ALLOC(sizeof (int64_t) * out_channels);
+        int32_t *out_shift = ESP_NN_TEST_ALLOC(sizeof (int32_t) * out_channels);
+        int32_t *out_mult = ESP_NN_TEST_ALLOC(sizeof (int32_t) * out_channels);
+
+        if (input == NULL || filter_data == NULL || out_data_c == NULL || out_data_opt == NULL ||
+                bias == NULL || out_shift == NULL || out_mult == NULL) {
+            printf(ANSI_COLOR_RED"allocations failed\n"ANSI_COLOR_RESET);
+            goto depthwise_conv_s16_s8_cleanup;
+        }
+
+        for (int i = 0; i < in_size; ++i) {
+            input[i] = rand() % 65536 - 32768;
+        }
+        for (int i = 0; i < filter_size; ++i) {
+            filter_data[i] = rand() % 256 - 128;
+        }
+        for (int i = 0; i < out_channels; ++i) {
+            bias[i] = (int64_t) (rand() % (1 << 21)) - (1 << 20);
+            out_shift[i] = -6 - rand() % 6;
+            out_mult[i] = 0x40000000 + rand() % 0x3fffffff;
+        }
+
+        data_dims_t input_dims = {.width = in_wd, .height = in_ht, .channels = channels, 1};
+        data_dims_t output_dims = {.width = out_wd, .height = out_ht, .channels = out_channels, 1};
+        data_dims_t filter_dims = {.width = filter_wd, .height = filter_ht, 0, 0};
+        dw_conv_params_t conv_params = {.in_offset = 0, .out_offset = 0, .ch_mult = ch_mult,
+                                        .stride = {stride_wd, stride_ht}, .padding = {pad_wd, pad_ht},
+                                        .dilation = {0, 0}, .activation = {INT16_MIN, INT16_MAX}};
+        quant_data_t quant_data = {.shift = out_shift, .mult = out_mult};
+
+        profile_c_start();
+        esp_nn_depthwise_conv_s16_s8_ansi(&input_dims, input, &filter_dims, filter_data,
+                                          bias, &output_dims, out_data_c, &conv_params, &quant_data);
+        total_c = profile_c_end();
+
+        profile_opt_start();
+        esp_nn_depthwise_conv_s16_s8(&input_dims, input, &filter_dims, filter_data,
+                                     bias, &output_dims, out_data_opt, &conv_params, &quant_data);
+        total_opt = profile_opt_end();
+
+        if (CHECK_EQUAL(out_data_c, out_data_opt, out_size) == false) {
+            printf(ANSI_COLOR_RED"[%3d] failed\n"ANSI_COLOR_RESET, itr);
+            goto depthwise_conv_s16_s8_cleanup;
+        }
+        printf(ANSI_COLOR_GREEN"[%3d] passed [pad: (%d, %d), stride: (%d, %d)"
+               " out: (%3d,%3d,%3d), filter: (%d, %d), ch_mult %d]"ANSI_COLOR_RESET,
+               itr, pad_wd, pad_ht, stride_wd, stride_ht, out_wd, out_ht,
+               out_channels, filter_wd, filter_ht, ch_mult);
+        printf("\tcycles: c %8"PRIu32", opt %8"PRIu32"\n", total_c, total_opt);
+
+    depthwise_conv_s16_s8_cleanup:
+        if (input) {
+            free(input);
+        }
+        if (filter_data) {
+            free(filter_data);
+        }
+        if (out_data_c) {
+            free(out_data_c);
+        }
+        if (out_data_opt) {
+            free(out_data_opt);
+        }
+        if (bias) {
+            free(bias);
+        }
+        if (out_shift) {
+            free(out_shift);
+        }
+        if (out_mult) {
+            free(out_mult);
+        }
+    }
+}
+
+void esp_nn_conv_sparse_s8_test()
+{
+    uint32_t total_c = 0, total_opt = 0, total_dense = 0;
+
+    /* independent variables */
+    int in_wd, in_ht, in_channels, out_channels, block_len, zero_pct;
+    uint16_t filter_wd, filter_ht, pad_wd, pad_ht, stride_wd, stride_ht;
+
+    printf("\n######## Running %s ##########\n", __FUNCTION__);
+    for (int itr = 0; itr < 6; itr++) {
+        block_len = itr & 1 ? 8 : 4;
+        zero_pct = 70;
+        switch (itr) {
+        case 0:
+        case 1: // 1x1, model sized
+            in_wd = 10;
+            in_ht = 12;
+            in_channels = 64;
+            out_channels = 32;
+            filter_wd = 1;
+            filter_ht = 1;
+            pad_wd = 0;
+            pad_ht = 0;
+            stride_wd = 1;
+            stride_ht = 1;
+            break;
+        case 2:
+        case 3: // 3x3 pad (1, 1), 90 % zero blocks
+            in_wd = 9;
+            in_ht = 7;
+            in_channels = 16;
+            out_channels = 13;
+            filter_wd = 3;
+            filter_ht = 3;
+            pad_wd = 1;
+            pad_ht = 1;
+            stride_wd = 1;
+            stride_ht = 1;
+            zero_pct = 90;
+            break;
+        default: // 5x3 stride (2, 1), dense
+            in_wd = 11;
+            in_ht = 6;
+            in_channels = 8;
+            out_channels = 5;
+            filter_wd = 5;
+            filter_ht = 3;
+            pad_wd = 2;
+            pad_ht = 1;
+            stride_wd = 2;
+            stride_ht = 1;
+            zero_pct = 0;
+            break;
+        }
+
+        const int out_wd = (in_wd + 2 * pad_wd - filter_wd) / stride_wd + 1;
+        const int out_ht = (in_ht + 2 * pad_ht - filter_ht) / stride_ht + 1;
+        const int in_size = in_wd * in_ht * in_channels;
+        const int row_len = filter_wd * filter_ht * in_channels;
+        const int filter_size = row_len * out_channels;
+        const int out_size = out_wd * out_ht * out_channels;
+        const int bitmap_size = ESP_NN_SPARSE_BITMAP_BYTES(row_len, block_len) * out_channels;
+        const int32_t input_offset = rand() % 256 - 128;
+
+        int8_t *input = ESP_NN_TEST_ALLOC(in_size);
+        int8_t *filter_data = ESP_NN_TEST_ALLOC(filter_size);
+        uint8_t *bitmap = ESP_NN_TEST_ALLOC(bitmap_size);
+        int8_t *values = ESP_NN_TEST_ALLOC(filter_size);
+        int8_t *out_data_c = ESP_NN_TEST_ALLOC(out_size);
+        int8_t *out_data_opt = ESP_NN_TEST_ALLOC(out_size);
+        int8_t *out_data_dense = ESP_NN_TEST_ALLOC(out_size);
+        int32_t *bias = ESP_NN_TEST_ALLOC(sizeof (int32_t) * out_channels);
+        int32_t *out_shift = ESP_NN_TEST_ALLOC(sizeof (int32_t) * out_channels);
+        int32_t *out_mult = ESP_NN_TEST_ALLOC(sizeof (int32_t) * out_channels);
+
+        if (input == NULL || filter_data == NULL || bitmap == NULL || values == NULL ||
+                out_data_c == NULL || out_data_opt == NULL || out_data_dense == NULL ||
+                bias == NULL || out_shift == NULL || out_mult == NULL) {
+            printf(ANSI_COLOR_RED"allocations failed\n"ANSI_COLOR_RESET);
+            goto conv_sparse_s8_cleanup;
+        }
+
+        for (int i = 0; i < in_size; ++i) {
+            input[i] = rand() % 256 - 128;
+        }
+        for (int i = 0; i < filter_size; ++i) {
+            filter_data[i] = rand() % 256 - 128;
+        }
+        for (int i = 0; i < out_channels; ++i) {
+            bias[i] = rand() % 4096 - 2048;
+            out_shift[i] = -8 + rand() % 3;
+            out_mult[i] = 0x7eb0e200 + rand() % 50;
+        }
+        esp_nn_test_prune_blocks(filter_data, out_channels, row_len, block_len, zero_pct);
+        const int32_t values_len = esp_nn_sparse_filter_encode(filter_data, out_channels, row_len,
+                                                               block_len, bitmap, values);
+        const sparse_filter_t sparse = {.bitmap = bitmap, .values = values, .block_len = block_len};
+
+        data_dims_t input_dims = {.width = in_wd, .height = in_ht, .channels = in_channels, 1};
+        data_dims_t output_dims = {.width = out_wd, .height = out_ht, .channels = out_channels, 1};
+        data_dims_t filter_dims = {.width = filter_wd, .height = filter_ht, 0, 0};
+        conv_params_t conv_params = {.in_offset = input_offset, .out_offset = 5,
+                                    .stride = {stride_wd, stride_ht}, .padding = {pad_wd, pad_ht},
+                                    .dilation = {0, 0}, .activation = {-128, 127}};
+        quant_data_t quant_data = {.shift = out_shift, .mult = out_mult};
+
+        profile_c_start();
+        esp_nn_conv_s8_ansi(&input_dims, input, &filter_dims, filter_data, bias,
+                            &output_dims, out_data_dense, &conv_params, &quant_data);
+        total_dense = profile_c_end();
+
+        profile_c_start();
+        esp_nn_conv_sparse_s8_ansi(&input_dims, input, &filter_dims, &sparse, bias,
+                                   &output_dims, out_data_c, &conv_params, &quant_data);
+        total_c = profile_c_end();
+
+        profile_opt_start();
+        esp_nn_conv_sparse_s8(&input_dims, input, &filter_dims, &sparse, bias,
+                              &output_dims, out_data_opt, &conv_params, &quant_data);
+        total_opt = profile_opt_end();
+
+        if (CHECK_EQUAL(out_data_dense, out_data_c, out_size) == false ||
+                CHECK_EQUAL(out_data_dense, out_data_opt, out_size) == false) {
+            printf(ANSI_COLOR_RED"[%3d] failed\n"ANSI_COLOR_RESET, itr);
+            goto conv_sparse_s8_cleanup;
+        }
+        printf(ANSI_COLOR_GREEN"[%3d] passed [pad: (%d, %d), stride: (%d, %d)"
+               " out: (%3d,%3d,%3d), filter: (%d, %d,%3d), block %d, values %5"PRIi32"/%5d]"
+               ANSI_COLOR_RESET, itr, pad_wd, pad_ht, stride_wd, stride_ht, out_wd, out_ht,
+               out_channels, filter_wd, filter_ht, in_channels, block_len, values_len, filter_size);
+        printf("\tcycles: c %8"PRIu32", opt %8"PRIu32", dense ansi %8"PRIu32"\n",
+               total_c, total_opt, total_dense);
+
+    conv_sparse_s8_cleanup:
+        if (input) {
+            free(input);
+        }
+        if (filter_data) {
+            free(filter_data);
+        }
+        if (bitmap) {
+            free(bitmap);
+        }
+        if (values) {
+            free(values);
+        }
+        if (out_data_c) {
+            free(out_data_c);
+        }
+        if (out_data_opt) {
+            free(out_data_opt);
+        }
+        if (out_data_dense) {
+            free(out_data_dense);
+        }
+        if (bias) {
+            free(bias);
+        }
+        if (out_shift) {
+            free(out_shift);
+        }
+        if (out_mult) {
+            free(out_mult);
+        }
+    }
+}
@@ -19,10 +19,13 @@ void esp_nn_fully_connected_s8_test()
     uint32_t total_c = 0, total_opt = 0;
     /* prepare data */
     uint16_t row_len = 256 + 8 + 7; /* odd len to test unaligned+left-over */
+    const uint16_t max_row_len = row_len;
+    const int32_t max_out_ch = 16;
     uint16_t out_channels = 3;
     int8_t input[row_len];
-    int8_t filter_data[row_len * out_channels];
-    int8_t output_c[out_channels], output_opt[out_channels];
+    int8_t filter_data[row_len * max_out_ch];
+    int32_t bias[max_out_ch];
+    int8_t output_c[max_out_ch], output_opt[max_out_ch];
     int32_t activation_min = -128;
     int32_t activation_max = 127;
     int32_t input_offset = 0;
@@ -30,8 +33,9 @@ void esp_nn_fully_connected_s8_test()
     int32_t out_shift = -10;
     int32_t out_offset = 5;
     int32_t out_mult = 0x59e492c4;
+    int32_t *bias_ptr = NULL;
     printf("\n######## Running %s ##########\n", __FUNCTION__);
-    for (int itr = 0; itr < 15; itr++) {
+    for (int itr = 0; itr < 18; itr++) {
         out_mult = INT32_MAX / row_len + rand() % INT16_MAX;
         switch (itr) {
         case 0:
@@ -71,6 +75,18 @@ void esp_nn_fully_connected_s8_test()
             out_channels = 1;
             out_shift = -10 + rand() % 5;
             break;
+        case 15:
+        case 16:
+        case 17:
+            /* model sized layer: benchmark, with offsets and bias */
+            row_len = max_row_len;
+            out_channels = max_out_ch - (itr - 15);
+            out_mult = INT32_MAX / row_len + rand() % INT16_MAX;
+            out_shift = -5 + rand() % 3;
+            input_offset = rand() % 256 - 128;
+            filter_offset = itr == 17 ? rand() % 256 - 128 : 0;
+            bias_ptr = bias;
+            break;
         default:
             row_len = rand() % 7 + 1;
             out_channels = 8;
@@ -80,6 +96,9 @@ void esp_nn_fully_connected_s8_test()
         if (itr == 0) {
             out_shift = SHIFT_MAX;
         }
+        for (int i = 0; i < out_channels; ++i) {
+            bias[i] = rand() % 4096 - 2048;
+        }
         /* Generate input and filter data */
         for (int i = 0; i < row_len; ++i) {
             input[i] = rand() % 256 - 128;
@@ -93,7 +112,7 @@ void esp_nn_fully_connected_s8_test()
 
         /* C function */
         esp_nn_fully_connected_s8_ansi(input, input_offset, row_len, filter_data, filter_offset,
-                                    NULL, output_c, out_channels, out_offset, out_shift, out_mult,
+                                    bias_ptr, output_c, out_channels, out_offset, out_shift, out_mult,
                                     activation_min, activation_max);
 
         total_c = profile_c_end();
@@ -101,7 +120,7 @@ void esp_nn_fully_connected_s8_test()
 
         /* Optimized function */
         esp_nn_fully_connected_s8(input, input_offset, row_len, filter_data, filter_offset,
-                                NULL, output_opt, out_channels, out_offset, out_shift, out_mult,
+                                bias_ptr, output_opt, out_channels, out_offset, out_shift, out_mult,
                                 activation_min, activation_max);
 
         /* disable profiler */
@@ -124,6 +143,23 @@ void esp_nn_fully_connected_s8_test()
 #endif
             return;
         }
+
+        /* the variants selectable at run time must agree too */
+        for (int variant = 0; variant < ESP_NN_VARIANT_COUNT; variant++) {
+            if (!esp_nn_fully_connected_variant_available(variant)) {
+                continue;
+            }
+            memset(output_opt, 0, out_channels);
+            esp_nn_fully_connected_s8_variant(variant, input, input_offset, row_len, filter_data,
+                                              filter_offset, bias_ptr, output_opt, out_channels,
+                                              out_offset, out_shift, out_mult,
+                                              activation_min, activation_max);
+            if (CHECK_EQUAL(output_c, output_opt, out_channels) == false) {
+                printf(ANSI_COLOR_RED"[%3d] failed (%s)\n"ANSI_COLOR_RESET, itr,
+                       esp_nn_variant_name(variant));
+                return;
+            }
+        }
         printf(ANSI_COLOR_GREEN"[%3d] passed [row_len %"PRIu16", out_ch %"PRIu16"]"ANSI_COLOR_RESET,
                itr, row_len, out_channels);
         printf("\tcycles: c %8"PRIu32", opt %8"PRIu32"\n", total_c, total_opt);
@@ -135,10 +171,12 @@ void esp_nn_fully_connected_per_ch_s8_test()
     uint32_t total_c = 0, total_opt = 0;
     /* prepare data */
     uint16_t row_len = 256 + 8 + 7; /* odd len to test unaligned+left-over */
+    const uint16_t max_row_len = row_len;
     const int32_t max_out_ch = 16;
     uint16_t out_channels = 3;
     int8_t input[row_len];
     int8_t filter_data[row_len * max_out_ch];
+    int32_t bias[max_out_ch];
     int8_t output_c[max_out_ch], output_opt[max_out_ch];
     int32_t activation_min = -128;
     int32_t activation_max = 127;
@@ -148,9 +186,10 @@ void esp_nn_fully_connected_per_ch_s8_test()
 
     int32_t* out_mult = NULL;
     int32_t* out_shift = NULL;
+    int32_t* bias_ptr = NULL;
 
     printf("\n######## Running %s ##########\n", __FUNCTION__);
-    for (int itr = 0;  itr < 15; itr++) {
+    for (int itr = 0;  itr < 18; itr++) {
         int32_t out_shift_val = 0;
         switch (itr) {
         case 0:
@@ -185,11 +224,25 @@ void esp_nn_fully_connected_per_ch_s8_test()
             row_len = 8;
             out_channels = 1;
             break;
+        case 15:
+        case 16:
+        case 17:
+            /* model sized layer: benchmark, with offsets and bias */
+            row_len = max_row_len;
+            out_channels = max_out_ch - (itr - 15);
+            out_shift_val = -5 + rand() % 3;
+            input_offset = rand() % 256 - 128;
+            filter_offset = itr == 17 ? rand() % 256 - 128 : 0;
+            bias_ptr = bias;
+            break;
         default:
             row_len = rand() % 7 + 1;
             out_channels = 8;
             break;
         }
+        for (int i = 0; i < out_channels; ++i) {
+            bias[i] = rand() % 4096 - 2048;
+        }
 
         out_mult = ESP_NN_TEST_ALLOC(out_channels * sizeof(int32_t));
         out_shift = ESP_NN_TEST_ALLOC(out_channels * sizeof(int32_t));
@@ -221,7 +274,7 @@ void esp_nn_fully_connected_per_ch_s8_test()
 
         /* C function */
         esp_nn_fully_connected_per_ch_s8_ansi(input, input_offset, row_len, filter_data, filter_offset,
-                                    NULL, output_c, out_channels, out_offset, out_shift, out_mult,
+                                    bias_ptr, output_c, out_channels, out_offset, out_shift, out_mult,
                                     activation_min, activation_max);
 
         total_c = profile_c_end();
@@ -229,7 +282,7 @@ void esp_nn_fully_connected_per_ch_s8_test()
 
         /* Optimized function */
         esp_nn_fully_connected_per_ch_s8(input, input_offset, row_len, filter_data, filter_offset,
-                                NULL, output_opt, out_channels, out_offset, out_shift, out_mult,
+                                bias_ptr, output_opt, out_channels, out_offset, out_shift, out_mult,
                                 activation_min, activation_max);
 
         /* disable profiler */
@@ -274,3 +327,173 @@ void esp_nn_fully_connected_per_ch_s8_test()
         }
     }
 }
+
+/* int16 input and output, int8 filter, int64 bias */
+void esp_nn_fully_connected_s16_s8_test()
+{
+    uint32_t total_c = 0, total_opt = 0;
+    const uint16_t max_row_len = 1024 + 8 + 3; /* longer than one 32 bit run */
+    const uint16_t max_out_ch = 16;
+    uint16_t row_len, out_channels;
+    int32_t out_shift, out_mult;
+    int16_t input[max_row_len];
+    int8_t filter_data[max_row_len * max_out_ch];
+    int64_t bias[max_out_ch];
+    int16_t output_c[max_out_ch], output_opt[max_out_ch];
+    int64_t *bias_ptr;
+
+    printf("\n######## Running %s ##########\n", __FUNCTION__);
+    for (int itr = 0; itr < 8; itr++) {
+        bias_ptr = bias;
+        out_shift = -8 - rand() % 8;
+        out_mult = 0x40000000 + rand() % 0x3fffffff;
+        switch (itr) {
+        case 0:
+            row_len = 1;
+            out_channels = 16;
+            break;
+        case 1:
+            row_len = 7;
+            out_channels = 3;
+            bias_ptr = NULL;
+            break;
+        case 2:
+            row_len = 64;
+            out_channels = 12;
+            break;
+        case 3:
+            row_len = 256;
+            out_channels = 15;
+            break;
+        case 4: // full scale: the sums overflow 32 bits
+            row_len = max_row_len;
+            out_channels = max_out_ch;
+            out_shift = -24;
+            break;
+        default:
+            row_len = max_row_len - rand() % 300;
+            out_channels = max_out_ch - rand() % 5;
+            break;
+        }
+        for (int i = 0; i < out_channels; ++i) {
+            bias[i] = (int64_t) (rand() % (1 << 21)) - (1 << 20);
+        }
+        for (int i = 0; i < row_len; ++i) {
+            input[i] = itr == 4 ? INT16_MIN : rand() % 65536 - 32768;
+        }
+        for (int i = 0; i < row_len * out_channels; ++i) {
+            filter_data[i] = itr == 4 ? INT8_MIN : rand() % 256 - 128;
+        }
+
+        profile_c_start();
+        esp_nn_fully_connected_s16_s8_ansi(input, row_len, filter_data, bias_ptr, output_c,
+                                           out_channels, out_shift, out_mult,
+                                           INT16_MIN, INT16_MAX);
+        total_c = profile_c_end();
+
+        profile_opt_start();
+        esp_nn_fully_connected_s16_s8(input, row_len, filter_data, bias_ptr, output_opt,
+                                      out_channels, out_shift, out_mult,
+                                      INT16_MIN, INT16_MAX);
+        total_opt = profile_opt_end();
+
+        if (CHECK_EQUAL(output_c, output_opt, out_channels) == false) {
+            printf(ANSI_COLOR_RED"[%3d] failed\n"ANSI_COLOR_RESET, itr);
+            return;
+        }
+        printf(ANSI_COLOR_GREEN"[%3d] passed [row_len %"PRIu16", out_ch %"PRIu16"]"ANSI_COLOR_RESET,
+               itr, row_len, out_channels);
+        printf("\tcycles: c %8"PRIu32", opt %8"PRIu32"\n", total_c, total_opt);
+    }
+}
+
+void esp_nn_fully_connected_sparse_s8_test()
+{
+    uint32_t total_c = 0, total_opt = 0, total_dense = 0;
+    const uint16_t max_row_len = 256 + 8 + 7;
+    const uint16_t max_out_ch = 16;
+    uint16_t row_len, out_channels;
+    int32_t block_len, zero_pct;
+    int8_t input[max_row_len];
+    int8_t filter_data[max_row_len * max_out_ch];
+    uint8_t bitmap[ESP_NN_SPARSE_BITMAP_BYTES(max_row_len, 4) * max_out_ch];
+    int8_t values[(max_row_len + 8) * max_out_ch];
+    int32_t bias[max_out_ch];
+    int8_t output_c[max_out_ch], output_opt[max_out_ch], output_dense[max_out_ch];
+    const int32_t out_offset = 3;
+
+    printf("\n######## Running %s ##########\n", __FUNCTION__);
+    for (int itr = 0; itr < 10; itr++) {
+        block_len = itr & 1 ? 8 : 4;
+        zero_pct = 70;
+        switch (itr) {
+        case 0:
+        case 1:
+            row_len = 1;
+            out_channels = 5;
+            zero_pct = 0;
+            break;
+        case 2:
+        case 3:
+            row_len = 13;
+            out_channels = 7;
+            break;
+        case 4:
+        case 5: // all zero
+            row_len = 64;
+            out_channels = 4;
+            zero_pct = 100;
+            break;
+        default: // model sized layer: benchmark
+            row_len = max_row_len - (itr > 7 ? 7 : 0);
+            out_channels = max_out_ch;
+            zero_pct = itr > 7 ? 90 : 70;
+            break;
+        }
+        const int32_t input_offset = rand() % 256 - 128;
+        const int32_t out_shift = -5 + rand() % 3;
+        const int32_t out_mult = INT32_MAX / row_len - rand() % INT16_MAX; // row_len 1 must not overflow
+        for (int i = 0; i < out_channels; ++i) {
+            bias[i] = rand() % 4096 - 2048;
+        }
+        for (int i = 0; i < row_len; ++i) {
+            input[i] = rand() % 256 - 128;
+        }
+        for (int i = 0; i < row_len * out_channels; ++i) {
+            filter_data[i] = rand() % 256 - 128;
+        }
+        esp_nn_test_prune_blocks(filter_data, out_channels, row_len, block_len, zero_pct);
+        const int32_t values_len = esp_nn_sparse_filter_encode(filter_data, out_channels, row_len,
+                                                               block_len, bitmap, values);
+        const sparse_filter_t sparse = {.bitmap = bitmap, .values = values, .block_len = block_len};
+
+        profile_c_start();
+        esp_nn_fully_connected_s8(input, input_offset, row_len, filter_data, 0, bias,
+                                  output_dense, out_channels, out_offset, out_shift, out_mult,
+                                  -128, 127);
+        total_dense = profile_c_end();
+
+        profile_c_start();
+        esp_nn_fully_connected_sparse_s8_ansi(input, input_offset, row_len, &sparse, bias,
+                                              output_c, out_channels, out_offset, out_shift,
+                                              out_mult, -128, 127);
+        total_c = profile_c_end();
+
+        profile_opt_start();
+        esp_nn_fully_connected_sparse_s8(input, input_offset, row_len, &sparse, bias,
+                                         output_opt, out_channels, out_offset, out_shift,
+                                         out_mult, -128, 127);
+        total_opt = profile_opt_end();
+
+        if (CHECK_EQUAL(output_dense, output_c, out_channels) == false ||
+                CHECK_EQUAL(output_dense, output_opt, out_channels) == false) {
+            printf(ANSI_COLOR_RED"[%3d] failed\n"ANSI_COLOR_RESET, itr);
+            return;
+        }
+        printf(ANSI_COLOR_GREEN"[%3d] passed [row_len %3"PRIu16", out_ch %2"PRIu16", block %"PRIi32
+               ", values %4"PRIi32"/%4d]"ANSI_COLOR_RESET, itr, row_len, out_channels, block_len,
+               values_len, row_len * out_channels);
+        printf("\tcycles: c %8"PRIu32", opt %8"PRIu32", dense %8"PRIu32"\n",
+               total_c, total_opt, total_dense);
+    }
+}
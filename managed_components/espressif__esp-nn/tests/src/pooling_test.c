@@ -19,24 +19,14 @@ void esp_nn_avg_pool_s8_test()
     /* prepare data */
     const uint16_t input_wd = 16;
     const uint16_t input_ht = 16;
-    const uint16_t channels = 16; /* With TFLite example, I have seen it 256 */
-    const int size = input_wd * input_ht * channels;
+    const uint16_t max_channels = 21;
+    const int size = input_wd * input_ht * max_channels;
+    const int max_out_size = input_wd * input_ht * max_channels;
     int8_t *input = NULL, *output_c = NULL, *output_opt = NULL;
-    const int32_t activation_min = -128;
-    const int32_t activation_max = 127;
-    const uint16_t pad_wd = 1;
-    const uint16_t pad_ht = 1;
-    const uint16_t stride_wd = 1;
-    const uint16_t stride_ht = 1;
-    const uint16_t filter_ht = 3;
-    const uint16_t filter_wd = 3;
-    const uint16_t out_wd = input_wd / stride_wd;
-    const uint16_t out_ht = input_ht / stride_ht;
-    const int out_size = out_wd * out_ht * channels;
 
     int8_t *input_orig = malloc(size + 16);
-    int8_t *out_c_orig = malloc(out_size + 16);
-    int8_t *out_opt_orig = malloc(out_size + 16);
+    int8_t *out_c_orig = malloc(max_out_size + 16);
+    int8_t *out_opt_orig = malloc(max_out_size + 16);
     if (input_orig == NULL || out_c_orig == NULL || out_opt_orig == NULL) {
         printf(ANSI_COLOR_RED"%s allocations failed\n"ANSI_COLOR_RESET, __FUNCTION__);
         goto avg_pool_s8_cleanup;
@@ -56,38 +46,84 @@ void esp_nn_avg_pool_s8_test()
         input[i] = rand() % 256 - 128;
     }
 
-    /* enable profiler */
-    profile_c_start();
-
-    /* C function */
-    esp_nn_avg_pool_s8_ansi(input, input_wd, input_ht, output_c, out_wd, out_ht,
-                            stride_wd, stride_ht, filter_wd, filter_ht, pad_wd, pad_ht,
-                            activation_min, activation_max, channels);
-
-    profile_c_end();
-    profile_opt_start();
-
-    /* Optimized function */
-    esp_nn_avg_pool_s8(input, input_wd, input_ht, output_opt, out_wd, out_ht,
-                       stride_wd, stride_ht, filter_wd, filter_ht, pad_wd, pad_ht,
-                       activation_min, activation_max, channels);
-
-    /* disable profiler */
-    profile_opt_end();
-
-
-    bool ret = CHECK_EQUAL(output_c, output_opt, out_size);
-    if (ret == false) {
-        printf(ANSI_COLOR_RED"%s failed\n"ANSI_COLOR_RESET, __FUNCTION__);
-        printf("Output: \n");
-        PRINT_ARRAY_HEX(output_opt, out_wd * channels, out_ht);
-        printf("Expected: \n");
-        PRINT_ARRAY_HEX(output_c, out_wd * channels, out_ht);
-        printf("Input:\n");
-        PRINT_ARRAY_HEX(input, input_wd * channels, input_ht);
-        goto avg_pool_s8_cleanup;
+    for (int itr = 0; itr < 5; itr++) {
+        /* 0: SAME 3x3, 1: odd channels with stride 2, 2: VALID 2x2 (model),
+         * 3: 1x3 window with stride 2 in height, 4: clamped activation */
+        uint16_t channels = 16; /* With TFLite example, I have seen it 256 */
+        int32_t activation_min = -128;
+        int32_t activation_max = 127;
+        uint16_t pad_wd = 1, pad_ht = 1;
+        uint16_t stride_wd = 1, stride_ht = 1;
+        uint16_t filter_wd = 3, filter_ht = 3;
+        uint16_t out_wd = input_wd, out_ht = input_ht;
+        switch (itr) {
+        case 1:
+            channels = 13;
+            stride_wd = stride_ht = 2;
+            out_wd = out_ht = 8;
+            break;
+        case 2:
+            channels = 8;
+            pad_wd = pad_ht = 0;
+            stride_wd = stride_ht = 2;
+            filter_wd = filter_ht = 2;
+            out_wd = out_ht = 8;
+            break;
+        case 3:
+            channels = max_channels;
+            pad_wd = pad_ht = 0;
+            stride_ht = 2;
+            filter_wd = 1;
+            out_ht = (input_ht - filter_ht) / stride_ht + 1;
+            break;
+        case 4:
+            activation_min = -20;
+            activation_max = 40;
+            break;
+        default:
+            break;
+        }
+#if defined(ARCH_ESP32_S3)
+        if (channels % 4) {
+            continue; /* S3 assembly version only supports channels multiple of 4 */
+        }
+#endif
+        const int out_size = out_wd * out_ht * channels;
+
+        /* enable profiler */
+        profile_c_start();
+
+        /* C function */
+        esp_nn_avg_pool_s8_ansi(input, input_wd, input_ht, output_c, out_wd, out_ht,
+                                stride_wd, stride_ht, filter_wd, filter_ht, pad_wd, pad_ht,
+                                activation_min, activation_max, channels);
+
+        profile_c_end();
+        profile_opt_start();
+
+        /* Optimized function */
+        esp_nn_avg_pool_s8(input, input_wd, input_ht, output_opt, out_wd, out_ht,
+                           stride_wd, stride_ht, filter_wd, filter_ht, pad_wd, pad_ht,
+                           activation_min, activation_max, channels);
+
+        /* disable profiler */
+        profile_opt_end();
+
+
+        bool ret = CHECK_EQUAL(output_c, output_opt, out_size);
+        if (ret == false) {
+            printf(ANSI_COLOR_RED"%s [%d] failed\n"ANSI_COLOR_RESET, __FUNCTION__, itr);
+            printf("Output: \n");
+            PRINT_ARRAY_HEX(output_opt, out_wd * channels, out_ht);
+            printf("Expected: \n");
+            PRINT_ARRAY_HEX(output_c, out_wd * channels, out_ht);
+            printf("Input:\n");
+            PRINT_ARRAY_HEX(input, input_wd * channels, input_ht);
+            goto avg_pool_s8_cleanup;
+        }
+        printf(ANSI_COLOR_GREEN"%s [%d] passed [ch %d, filter %dx%d, stride %d]"ANSI_COLOR_RESET"\n",
+               __FUNCTION__, itr, channels, filter_wd, filter_ht, stride_ht);
     }
-    printf(ANSI_COLOR_GREEN"%s passed\n"ANSI_COLOR_RESET, __FUNCTION__);
 
 avg_pool_s8_cleanup:
     if (input_orig) {
@@ -106,24 +142,14 @@ void esp_nn_max_pool_s8_test()
     /* prepare data */
     const uint16_t input_wd = 16;
     const uint16_t input_ht = 16;
-    const uint16_t channels = 16; /* With TFLite example, I have seen it 256 */
+    const uint16_t max_channels = 21;
+    const int size = input_wd * input_ht * max_channels;
+    const int max_out_size = input_wd * input_ht * max_channels;
     int8_t *input = NULL, *output_c = NULL, *output_opt = NULL;
-    const int size = input_wd * input_ht * channels;
-    const int32_t activation_min = -128;
-    const int32_t activation_max = 127;
-    const uint16_t pad_wd = 1;
-    const uint16_t pad_ht = 1;
-    const uint16_t stride_wd = 1;
-    const uint16_t stride_ht = 1;
-    const uint16_t filter_ht = 3;
-    const uint16_t filter_wd = 3;
-    const uint16_t out_wd = input_wd / stride_wd;
-    const uint16_t out_ht = input_ht / stride_ht;
-    const int out_size = out_wd * out_ht * channels;
 
     int8_t *input_orig = malloc(size + 16);
-    int8_t *out_c_orig = malloc(out_size + 16);
-    int8_t *out_opt_orig = malloc(out_size + 16);
+    int8_t *out_c_orig = malloc(max_out_size + 16);
+    int8_t *out_opt_orig = malloc(max_out_size + 16);
     if (input_orig == NULL || out_c_orig == NULL || out_opt_orig == NULL) {
         printf(ANSI_COLOR_RED"%s allocations failed\n"ANSI_COLOR_RESET, __FUNCTION__);
         goto max_pool_s8_cleanup;
@@ -137,38 +163,84 @@ void esp_nn_max_pool_s8_test()
         input[i] = rand() % 256 - 128;
     }
 
-    /* enable profiler */
-    profile_c_start();
-
-    /* C function */
-    esp_nn_max_pool_s8_ansi(input, input_wd, input_ht, output_c, out_wd, out_ht,
-                            stride_wd, stride_ht, filter_wd, filter_ht, pad_wd, pad_ht,
-                            activation_min, activation_max, channels);
-
-    profile_c_end();
-    profile_opt_start();
-
-    /* Optimized function */
-    esp_nn_max_pool_s8(input, input_wd, input_ht, output_opt, out_wd, out_ht,
-                       stride_wd, stride_ht, filter_wd, filter_ht, pad_wd, pad_ht,
-                       activation_min, activation_max, channels);
-
-    /* disable profiler */
-    profile_opt_end();
-
-
-    bool ret = CHECK_EQUAL(output_c, output_opt, out_wd * out_ht * channels);
-    if (ret == false) {
-        printf(ANSI_COLOR_RED"%s failed\n"ANSI_COLOR_RESET, __FUNCTION__);
-        printf("Output: \n");
-        PRINT_ARRAY_HEX(output_opt, out_wd * out_ht * channels, 1);
-        printf("Expected: \n");
-        PRINT_ARRAY_HEX(output_c, out_wd * out_ht * channels, 1);
-        printf("Input:\n");
-        PRINT_ARRAY_HEX(input, 8, size / 8);
-        goto max_pool_s8_cleanup;
+    for (int itr = 0; itr < 5; itr++) {
+        /* 0: SAME 3x3, 1: odd channels with stride 2, 2: VALID 2x2 (model),
+         * 3: 1x3 window with stride 2 in height, 4: clamped activation */
+        uint16_t channels = 16; /* With TFLite example, I have seen it 256 */
+        int32_t activation_min = -128;
+        int32_t activation_max = 127;
+        uint16_t pad_wd = 1, pad_ht = 1;
+        uint16_t stride_wd = 1, stride_ht = 1;
+        uint16_t filter_wd = 3, filter_ht = 3;
+        uint16_t out_wd = input_wd, out_ht = input_ht;
+        switch (itr) {
+        case 1:
+            channels = 13;
+            stride_wd = stride_ht = 2;
+            out_wd = out_ht = 8;
+            break;
+        case 2:
+            channels = 8;
+            pad_wd = pad_ht = 0;
+            stride_wd = stride_ht = 2;
+            filter_wd = filter_ht = 2;
+            out_wd = out_ht = 8;
+            break;
+        case 3:
+            channels = max_channels;
+            pad_wd = pad_ht = 0;
+            stride_ht = 2;
+            filter_wd = 1;
+            out_ht = (input_ht - filter_ht) / stride_ht + 1;
+            break;
+        case 4:
+            activation_min = -20;
+            activation_max = 40;
+            break;
+        default:
+            break;
+        }
+#if defined(ARCH_ESP32_S3)
+        if (channels % 4) {
+            continue; /* S3 assembly version only supports channels multiple of 4 */
+        }
+#endif
+        const int out_size = out_wd * out_ht * channels;
+
+        /* enable profiler */
+        profile_c_start();
+
+        /* C function */
+        esp_nn_max_pool_s8_ansi(input, input_wd, input_ht, output_c, out_wd, out_ht,
+                                stride_wd, stride_ht, filter_wd, filter_ht, pad_wd, pad_ht,
+                                activation_min, activation_max, channels);
+
+        profile_c_end();
+        profile_opt_start();
+
+        /* Optimized function */
+        esp_nn_max_pool_s8(input, input_wd, input_ht, output_opt, out_wd, out_ht,
+                           stride_wd, stride_ht, filter_wd, filter_ht, pad_wd, pad_ht,
+                           activation_min, activation_max, channels);
+
+        /* disable profiler */
+        profile_opt_end();
+
+
+        bool ret = CHECK_EQUAL(output_c, output_opt, out_size);
+        if (ret == false) {
+            printf(ANSI_COLOR_RED"%s [%d] failed\n"ANSI_COLOR_RESET, __FUNCTION__, itr);
+            printf("Output: \n");
+            PRINT_ARRAY_HEX(output_opt, out_wd * out_ht * channels, 1);
+            printf("Expected: \n");
+            PRINT_ARRAY_HEX(output_c, out_wd * out_ht * channels, 1);
+            printf("Input:\n");
+            PRINT_ARRAY_HEX(input, 8, size / 8);
+            goto max_pool_s8_cleanup;
+        }
+        printf(ANSI_COLOR_GREEN"%s [%d] passed [ch %d, filter %dx%d, stride %d]"ANSI_COLOR_RESET"\n",
+               __FUNCTION__, itr, channels, filter_wd, filter_ht, stride_ht);
     }
-    printf(ANSI_COLOR_GREEN"%s passed\n"ANSI_COLOR_RESET, __FUNCTION__);
 
 max_pool_s8_cleanup:
     if (input_orig) {
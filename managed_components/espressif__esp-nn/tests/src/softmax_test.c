@@ -81,6 +81,15 @@ void esp_nn_softmax_s8_test()
         PRINT_ARRAY_HEX(input, width, height);
         goto softmax_s8_cleanup;
     }
+
+    /* Reentrant version, with the scratch buffer passed per call */
+    esp_nn_set_softmax_scratch_buf(NULL);
+    memset(out_opt, 0, size);
+    esp_nn_softmax_s8_r(input, height, width, mult, shift, diff_min, out_opt, scratch_buf);
+    if (CHECK_EQUAL(out_ansi, out_opt, size) == false) {
+        printf(ANSI_COLOR_RED"%s failed (reentrant version)\n"ANSI_COLOR_RESET, __FUNCTION__);
+        goto softmax_s8_cleanup;
+    }
     printf(ANSI_COLOR_GREEN"%s passed\n"ANSI_COLOR_RESET, __FUNCTION__);
 
 softmax_s8_cleanup:
@@ -22,6 +22,7 @@ limitations under the License.
 #include "tensorflow/lite/micro/micro_interpreter.h"
 #include "tensorflow/lite/micro/micro_log.h"
 #include "tensorflow/lite/micro/micro_mutable_op_resolver.h"
+#include "tensorflow/lite/micro/micro_timing_registry.h"
 #include "tensorflow/lite/schema/schema_generated.h"
 
 #include "freertos/FreeRTOS.h"
@@ -37,6 +38,10 @@ namespace {
 const tflite::Model* model = nullptr;
 tflite::MicroInterpreter* interpreter = nullptr;
 TfLiteTensor* input = nullptr;
+#if defined(COLLECT_CPU_STATS)
+// Per-operator timings, printed and reset after every inference.
+tflite::MicroTimingRegistry timing_registry;
+#endif
 
 // In order to use optimized tensorflow lite kernels, a signed int8_t quantized
 // model is preferred over the legacy unsigned model format. This means that
@@ -92,8 +97,14 @@ void setup() {
 
   // Build an interpreter to run the model with.
   // NOLINTNEXTLINE(runtime-global-variables)
+#if defined(COLLECT_CPU_STATS)
+  static tflite::MicroInterpreter static_interpreter(
+      model, micro_op_resolver, tensor_arena, kTensorArenaSize,
+      /*resource_variables=*/nullptr, &timing_registry);
+#else
   static tflite::MicroInterpreter static_interpreter(
       model, micro_op_resolver, tensor_arena, kTensorArenaSize);
+#endif
   interpreter = &static_interpreter;
 
   // Allocate memory from the tensor_arena for the model's tensors.
@@ -146,18 +157,6 @@ void loop() {
 }
 #endif
 
-#if defined(COLLECT_CPU_STATS)
-  long long total_time = 0;
-  long long start_time = 0;
-  extern long long softmax_total_time;
-  extern long long dc_total_time;
-  extern long long conv_total_time;
-  extern long long fc_total_time;
-  extern long long pooling_total_time;
-  extern long long add_total_time;
-  extern long long mul_total_time;
-#endif
-
 void run_inference(void *ptr) {
   /* Convert from uint8 picture data to int8 */
   for (int i = 0; i < kNumCols * kNumRows; i++) {
@@ -175,23 +174,8 @@ void run_inference(void *ptr) {
 #if defined(COLLECT_CPU_STATS)
   long long total_time = (esp_timer_get_time() - start_time);
   printf("Total time = %lld\n", total_time / 1000);
-  //printf("Softmax time = %lld\n", softmax_total_time / 1000);
-  printf("FC time = %lld\n", fc_total_time / 1000);
-  printf("DC time = %lld\n", dc_total_time / 1000);
-  printf("conv time = %lld\n", conv_total_time / 1000);
-  printf("Pooling time = %lld\n", pooling_total_time / 1000);
-  printf("add time = %lld\n", add_total_time / 1000);
-  printf("mul time = %lld\n", mul_total_time / 1000);
-
-  /* Reset times */
-  total_time = 0;
-  //softmax_total_time = 0;
-  dc_total_time = 0;
-  conv_total_time = 0;
-  fc_total_time = 0;
-  pooling_total_time = 0;
-  add_total_time = 0;
-  mul_total_time = 0;
+  timing_registry.Log();
+  timing_registry.Reset();
 #endif
 
   TfLiteTensor* output = interpreter->output(0);
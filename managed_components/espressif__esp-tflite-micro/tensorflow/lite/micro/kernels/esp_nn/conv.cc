@@ -22,16 +22,25 @@ limitations under the License.
 #include "tensorflow/lite/kernels/kernel_util.h"
 #include "tensorflow/lite/micro/micro_common.h"
 #include "tensorflow/lite/micro/kernels/kernel_util.h"
+#include "tensorflow/lite/micro/kernels/pooling.h"
 #include "tensorflow/lite/micro/micro_log.h"
 
-#include <esp_timer.h>
+#ifdef USE_TFLM_COMPRESSION
+
+#include <algorithm>
+#include <cstring>
+
+#include "tensorflow/lite/micro/kernels/esp_nn/decompress_tiles.h"
+
+#endif  // USE_TFLM_COMPRESSION
 
 #if ESP_NN
 #include <esp_nn.h>
-#endif
 
+#include "tensorflow/lite/micro/kernels/esp_nn/kernel_variants.h"
+#include "tensorflow/lite/micro/micro_sparse_weights.h"
+#endif
 
-long long conv_total_time = 0;
 
 namespace tflite {
 namespace {
@@ -40,14 +49,88 @@ struct NodeData {
   OpDataConv op_data;
 #if ESP_NN
   int buffer_idx;
+  // MAX_POOL_2D fused into this conv, or nullptr. The output tensor then holds
+  // the pooled values and the conv rows of one pooling band live in the
+  // scratch buffer rows_buffer_idx.
+  TfLiteNode* pool_node;
+  int rows_buffer_idx;
+  // esp_nn_variant_t picked by the kernel tuner, or kKernelVariantPending
+  int variant;
+  // block-sparse copy of the filter from the model, run instead of it
+  SparseWeights sparse;
 #endif
 };
 
 static void* Init(TfLiteContext* context, const char* buffer, size_t length) {
   TFLITE_DCHECK(context->AllocatePersistentBuffer != nullptr);
-  return context->AllocatePersistentBuffer(context, sizeof(OpDataConv));
+  return context->AllocatePersistentBuffer(context, sizeof(NodeData));
 }
 
+#if ESP_NN
+// Returns the MAX_POOL_2D node that can be computed together with this int8
+// conv, or nullptr. It must be the only reader of the conv output, which must
+// not be a subgraph output, and both ops must be VALID with pooling windows
+// that do not overlap vertically, so that each band of conv rows is pooled
+// once and then discarded.
+TfLiteNode* FindMaxPoolToFuse(TfLiteContext* context, TfLiteNode* node,
+                              const TfLiteConvParams& params,
+                              const TfLiteTensor* input) {
+  if (params.padding != kTfLitePaddingValid ||
+      params.dilation_width_factor != 1 || params.dilation_height_factor != 1 ||
+      input->dims->data[0] != 1) {
+    return nullptr;
+  }
+  MicroContext* micro_context = GetMicroContext(context);
+#ifdef USE_TFLM_COMPRESSION
+  if (micro_context->IsTensorCompressed(node, kConvWeightsTensor)) {
+    return nullptr;
+  }
+#endif  // USE_TFLM_COMPRESSION
+
+  MicroGraph& graph = micro_context->graph();
+  const int subgraph_idx = graph.GetCurrentSubgraphIndex();
+  const int output_idx = node->outputs->data[kConvOutputTensor];
+  const TfLiteEvalTensor* output = micro_context->GetEvalTensor(output_idx);
+  for (size_t i = 0; i < graph.NumSubgraphOutputs(subgraph_idx); i++) {
+    if (graph.GetSubgraphOutput(subgraph_idx, i) == output) {
+      return nullptr;
+    }
+  }
+
+  TfLiteNode* pool_node = nullptr;
+  const TFLMRegistration* pool_registration = nullptr;
+  const int num_operators = graph.NumOperatorsInSubgraph(subgraph_idx);
+  for (int op = graph.GetCurrentOperatorIndex() + 1; op < num_operators;
+       op++) {
+    const TFLMRegistration* registration = nullptr;
+    TfLiteNode* other =
+        graph.GetSubgraphOperator(subgraph_idx, op, &registration);
+    for (int i = 0; i < other->inputs->size; i++) {
+      if (other->inputs->data[i] != output_idx) {
+        continue;
+      }
+      if (pool_node != nullptr) {
+        return nullptr;  // more than one reader
+      }
+      pool_node = other;
+      pool_registration = registration;
+    }
+  }
+  if (pool_node == nullptr ||
+      pool_registration->builtin_code != BuiltinOperator_MAX_POOL_2D) {
+    return nullptr;
+  }
+
+  const auto* pool_params =
+      static_cast<const TfLitePoolParams*>(pool_node->builtin_data);
+  if (pool_params->padding != kTfLitePaddingValid ||
+      pool_params->stride_height < pool_params->filter_height) {
+    return nullptr;
+  }
+  return pool_node;
+}
+#endif
+
 static TfLiteStatus Prepare(TfLiteContext* context, TfLiteNode* node) {
   TFLITE_DCHECK(node->user_data != nullptr);
   TFLITE_DCHECK(node->builtin_data != nullptr);
@@ -130,6 +213,8 @@ static TfLiteStatus Prepare(TfLiteContext* context, TfLiteNode* node) {
   }
 
 #if ESP_NN
+  data->pool_node = nullptr;
+  data->variant = ESP_NN_VARIANT_DEFAULT;
   if (input->type == kTfLiteInt8) {
     data_dims_t input_dims =  {
                                 .width = input_width, .height = input_height,
@@ -150,8 +235,83 @@ static TfLiteStatus Prepare(TfLiteContext* context, TfLiteNode* node) {
                                   .dilation = {0, 0}, .activation = {-128, 127}
                                 };
 
-    int scratch_buf_size = esp_nn_get_conv_scratch_size(
-        &input_dims, &filter_dims, &output_dims, &conv_params);
+    data->sparse = SparseWeights();
+#ifdef USE_TFLM_COMPRESSION
+    const bool filter_compressed =
+        micro_context->IsTensorCompressed(node, kConvWeightsTensor);
+#else
+    const bool filter_compressed = false;
+#endif
+    // A block of the sparse kernel must stay within the channels of one tap
+    SparseWeights sparse;
+    if (filter->type == kTfLiteInt8 && !filter_compressed &&
+        params.dilation_width_factor == 1 &&
+        params.dilation_height_factor == 1 &&
+        input_channels == filter_input_channels &&
+        micro_context->GetSparseWeights(node, kConvWeightsTensor, &sparse) &&
+        input_channels % sparse.block_len == 0) {
+      data->sparse = sparse;
+    }
+
+    if (filter->type == kTfLiteInt8 && data->sparse.block_len == 0) {
+      data->pool_node = FindMaxPoolToFuse(context, node, params, input);
+    }
+
+    int scratch_buf_size;
+    if (data->sparse.block_len > 0) {
+      // the sparse kernel needs no scratch and is not tuned
+      scratch_buf_size = 0;
+    } else if (data->pool_node != nullptr) {
+      // The output tensor shrinks to the pooled shape, so the planner never
+      // allocates the full conv output; MAX_POOL_2D just copies it.
+      const auto* pool_params =
+          static_cast<const TfLitePoolParams*>(data->pool_node->builtin_data);
+      pool_params_t fused_pool_params = {
+                                 .stride = {pool_params->stride_width,
+                                            pool_params->stride_height},
+                                 .filter = {pool_params->filter_width,
+                                            pool_params->filter_height},
+                                 .activation = {-128, 127}
+                               };
+      output_dims.width = (output_width - pool_params->filter_width) /
+                              pool_params->stride_width + 1;
+      output_dims.height = (output_height - pool_params->filter_height) /
+                               pool_params->stride_height + 1;
+
+      TF_LITE_ENSURE_STATUS(micro::CreateWritableTensorDimsWithCopy(
+          context, output, micro_context->GetEvalTensor(
+                               node->outputs->data[kConvOutputTensor])));
+      output->dims->data[1] = output_dims.height;
+      output->dims->data[2] = output_dims.width;
+
+      static_cast<OpDataPooling*>(data->pool_node->user_data)
+          ->computed_by_input_op = true;
+
+      TF_LITE_ENSURE_STATUS(context->RequestScratchBufferInArena(
+          context,
+          esp_nn_get_conv_max_pool_rows_size(&input_dims, &filter_dims,
+                                             &conv_params, &fused_pool_params,
+                                             &output_dims),
+          &data->rows_buffer_idx));
+      scratch_buf_size = esp_nn_get_conv_max_pool_scratch_size(
+          &input_dims, &filter_dims, &conv_params, &fused_pool_params,
+          &output_dims);
+    } else {
+      scratch_buf_size = esp_nn_get_conv_scratch_size(
+          &input_dims, &filter_dims, &output_dims, &conv_params);
+      const bool tunable = filter->type == kTfLiteInt8 && !filter_compressed;
+      if (tunable && params.dilation_width_factor == 1 &&
+          params.dilation_height_factor == 1) {
+        data->variant = PrepareKernelVariant(
+            context,
+            [&](esp_nn_variant_t variant) {
+              return esp_nn_get_conv_variant_scratch_size(
+                  variant, &input_dims, &filter_dims, &output_dims,
+                  &conv_params);
+            },
+            &scratch_buf_size);
+      }
+    }
     if (scratch_buf_size > 0) {
       TF_LITE_ENSURE_STATUS(context->RequestScratchBufferInArena(
         context, scratch_buf_size, &data->buffer_idx));
@@ -161,6 +321,45 @@ static TfLiteStatus Prepare(TfLiteContext* context, TfLiteNode* node) {
   }
 #endif
 
+#ifdef USE_TFLM_COMPRESSION
+
+  // Only the ESP-NN int8 path reads compressed tensors. The bias is small and
+  // is decompressed whole. The weights are decompressed a block of output
+  // channels at a time; each block is convolved into a compact output tile
+  // that is then copied into its channels of the NHWC output.
+  const bool weights_compressed =
+      micro_context->IsTensorCompressed(node, kConvWeightsTensor);
+  if (weights_compressed ||
+      micro_context->IsTensorCompressed(node, kConvBiasTensor)) {
+#if ESP_NN
+    const bool supported = input->type == kTfLiteInt8 &&
+                           filter->type == kTfLiteInt8 &&
+                           params.dilation_width_factor == 1 &&
+                           params.dilation_height_factor == 1;
+#else
+    const bool supported = false;
+#endif
+    if (!supported) {
+      MicroPrintf("Compressed tensors need int8 conv without dilation (ESP-NN)");
+      return kTfLiteError;
+    }
+  }
+  data->op_data.bias_scratch_index =
+      micro_context->AllocateDecompressionScratchBuffer(node, kConvBiasTensor);
+  data->op_data.weights_scratch_index = -1;
+  if (weights_compressed) {
+    const int bytes_per_channel = filter_height * filter_width *
+                                      filter_input_channels +
+                                  output_height * output_width;
+    const int channels = DecompressionTileChannels(bytes_per_channel,
+                                                   output->dims->data[3]);
+    TF_LITE_ENSURE_OK(context, RequestDecompressionTile(
+                                   context, channels * bytes_per_channel,
+                                   &data->op_data.weights_scratch_index));
+  }
+
+#endif  // USE_TFLM_COMPRESSION
+
   micro_context->DeallocateTempTfLiteTensor(output);
   micro_context->DeallocateTempTfLiteTensor(input);
   micro_context->DeallocateTempTfLiteTensor(filter);
@@ -215,7 +414,19 @@ inline void EvalQuantizedPerChannel(
     const int input_depth = MatchingDim(input_shape, 3, filter_shape, 3);
     const int output_depth = MatchingDim(filter_shape, 0, output_shape, 3);
 
-    if (tflite::micro::GetTensorData<int8_t>(bias)) {
+#ifdef USE_TFLM_COMPRESSION
+    MicroContext* micro_context = GetMicroContext(context);
+    const CompressionTensorData* weights_comp_td =
+        micro_context->GetTensorCompressionData(node, kConvWeightsTensor);
+    const int32_t* bias_data = tflite::micro::GetOptionalTensorData<int32_t>(
+        micro_context, bias,
+        micro_context->GetTensorCompressionData(node, kConvBiasTensor),
+        data.op_data.bias_scratch_index);
+#else
+    const int32_t* bias_data = tflite::micro::GetOptionalTensorData<int32_t>(bias);
+#endif
+
+    if (bias_data) {
       TFLITE_DCHECK_EQ(bias_shape.FlatSize(), output_depth);
     }
 
@@ -223,7 +434,6 @@ inline void EvalQuantizedPerChannel(
     if (data.buffer_idx > -1) {
       scratch_buf = context->GetScratchBuffer(context, data.buffer_idx);
     }
-    esp_nn_set_conv_scratch_buf(scratch_buf);
 
     const int input_size = input_width * input_height * input_depth;
     const int output_size = output_width * output_height * output_depth;
@@ -252,12 +462,108 @@ inline void EvalQuantizedPerChannel(
                                 .mult = data.op_data.per_channel_output_multiplier
                               };
 
-    for (int i_batch = 0; i_batch < batch_size; i_batch++) {
-      esp_nn_conv_s8(&input_dims, input_data + i_batch * input_size,
-                     &filter_dims, tflite::micro::GetTensorData<int8_t>(filter),
-                     tflite::micro::GetTensorData<int32_t>(bias),
-                     &output_dims, output_data + i_batch * output_size,
-                     &conv_params, &quant_data);
+    if (data.sparse.block_len > 0) {
+      const sparse_filter_t sparse_filter = {
+                                              .bitmap = data.sparse.bitmap,
+                                              .values = data.sparse.values,
+                                              .block_len = data.sparse.block_len
+                                            };
+      for (int i_batch = 0; i_batch < batch_size; i_batch++) {
+        esp_nn_conv_sparse_s8(&input_dims, input_data + i_batch * input_size,
+                              &filter_dims, &sparse_filter, bias_data,
+                              &output_dims, output_data + i_batch * output_size,
+                              &conv_params, &quant_data);
+      }
+      return;
+    }
+
+#ifdef USE_TFLM_COMPRESSION
+    if (weights_comp_td != nullptr) {
+      const int filter_size = filter_height * filter_width * input_depth;
+      const int output_pixels = output_height * output_width;
+      const int tile_channels = DecompressionTileChannels(
+          filter_size + output_pixels, output_depth);
+      int8_t* tile_filter = GetDecompressionTile(
+          context, data.op_data.weights_scratch_index,
+          tile_channels * (filter_size + output_pixels));
+      TFLITE_DCHECK(tile_filter != nullptr);
+      int8_t* tile_output = tile_filter + tile_channels * filter_size;
+
+      for (int channel = 0; channel < output_depth; channel += tile_channels) {
+        const int channels = std::min(tile_channels, output_depth - channel);
+        DecompressInt8Range(*filter, *weights_comp_td, channel * filter_size,
+                            channels * filter_size, tile_filter);
+
+        data_dims_t tile_dims = output_dims;
+        tile_dims.channels = channels;
+        quant_data_t tile_quant = {
+                                    .shift = quant_data.shift + channel,
+                                    .mult = quant_data.mult + channel
+                                  };
+        for (int i_batch = 0; i_batch < batch_size; i_batch++) {
+          esp_nn_conv_s8_r(&input_dims, input_data + i_batch * input_size,
+                           &filter_dims, tile_filter,
+                           bias_data ? bias_data + channel : nullptr,
+                           &tile_dims, tile_output, &conv_params, &tile_quant,
+                           scratch_buf);
+
+          int8_t* out = output_data + i_batch * output_size + channel;
+          for (int pixel = 0; pixel < output_pixels; pixel++) {
+            memcpy(out + pixel * output_depth, tile_output + pixel * channels,
+                   channels);
+          }
+        }
+      }
+      return;
+    }
+#endif  // USE_TFLM_COMPRESSION
+
+    if (data.pool_node != nullptr) {
+      // Fused MAX_POOL_2D: `output` already has the pooled shape.
+      const auto* pool_params =
+          static_cast<const TfLitePoolParams*>(data.pool_node->builtin_data);
+      const auto* pool_data =
+          static_cast<const OpDataPooling*>(data.pool_node->user_data);
+      pool_params_t fused_pool_params = {
+                                 .stride = {pool_params->stride_width,
+                                            pool_params->stride_height},
+                                 .filter = {pool_params->filter_width,
+                                            pool_params->filter_height},
+                                 .activation = {pool_data->activation_min,
+                                                pool_data->activation_max}
+                               };
+      int8_t* conv_rows = static_cast<int8_t*>(
+          context->GetScratchBuffer(context, data.rows_buffer_idx));
+      esp_nn_conv_max_pool_s8_r(&input_dims, input_data, &filter_dims,
+                                tflite::micro::GetTensorData<int8_t>(filter),
+                                bias_data, &conv_params, &quant_data,
+                                &fused_pool_params, &output_dims, output_data,
+                                conv_rows, scratch_buf);
+      return;
+    }
+
+    auto run = [&](esp_nn_variant_t variant) {
+      for (int i_batch = 0; i_batch < batch_size; i_batch++) {
+        esp_nn_conv_s8_variant_r(variant, &input_dims,
+                                 input_data + i_batch * input_size,
+                                 &filter_dims,
+                                 tflite::micro::GetTensorData<int8_t>(filter),
+                                 bias_data, &output_dims,
+                                 output_data + i_batch * output_size,
+                                 &conv_params, &quant_data, scratch_buf);
+      }
+    };
+    if (data.variant == kKernelVariantPending) {
+      static_cast<NodeData*>(node->user_data)->variant = TuneKernelVariant(
+          context,
+          [&](esp_nn_variant_t variant) {
+            return esp_nn_get_conv_variant_scratch_size(
+                variant, &input_dims, &filter_dims, &output_dims,
+                &conv_params);
+          },
+          run, output_data, batch_size * output_size);
+    } else {
+      run(static_cast<esp_nn_variant_t>(data.variant));
     }
   } else {
     reference_integer_ops::ConvPerChannel(
@@ -274,6 +580,78 @@ inline void EvalQuantizedPerChannel(
         tflite::micro::GetTensorData<int8_t>(output));
   }
 }
+
+// int16 activations with int8 filters and int64 (or no) bias. The reference
+// kernel handles dilation, grouped filters and int32 bias.
+inline bool CanEvalQuantizedPerChannel16x8(const TfLiteConvParams& params,
+                                           const TfLiteEvalTensor* input,
+                                           const TfLiteEvalTensor* filter,
+                                           const TfLiteEvalTensor* bias) {
+  return params.dilation_width_factor == 1 &&
+         params.dilation_height_factor == 1 &&
+         (bias == nullptr || bias->type == kTfLiteInt64) &&
+         input->dims->data[3] == filter->dims->data[3];
+}
+
+inline void EvalQuantizedPerChannel16x8(
+    const TfLiteConvParams& params, const NodeData& data,
+    const TfLiteEvalTensor* input, const TfLiteEvalTensor* filter,
+    const TfLiteEvalTensor* bias, TfLiteEvalTensor* output) {
+  RuntimeShape filter_shape = tflite::micro::GetTensorShape(filter);
+  RuntimeShape input_shape = tflite::micro::GetTensorShape(input);
+  RuntimeShape output_shape = tflite::micro::GetTensorShape(output);
+
+  const int16_t *input_data = tflite::micro::GetTensorData<int16_t>(input);
+  int16_t *output_data = tflite::micro::GetTensorData<int16_t>(output);
+  const int64_t *bias_data = tflite::micro::GetOptionalTensorData<int64_t>(bias);
+
+  const int input_height = input_shape.Dims(1);
+  const int input_width = input_shape.Dims(2);
+  const int output_height = output_shape.Dims(1);
+  const int output_width = output_shape.Dims(2);
+  const int batch_size = MatchingDim(input_shape, 0, output_shape, 0);
+  const int input_depth = MatchingDim(input_shape, 3, filter_shape, 3);
+  const int output_depth = MatchingDim(filter_shape, 0, output_shape, 3);
+
+  const int input_size = input_width * input_height * input_depth;
+  const int output_size = output_width * output_height * output_depth;
+
+  data_dims_t input_dims =  {
+                              .width = input_width, .height = input_height,
+                              .channels = input_depth, .extra = 1
+                            };
+  data_dims_t output_dims = {
+                              .width = output_width, .height = output_height,
+                              .channels = output_depth, .extra = 1
+                            };
+  data_dims_t filter_dims = {
+                              .width = filter_shape.Dims(2),
+                              .height = filter_shape.Dims(1),
+                              .channels = 0, .extra = 0
+                            };
+  // int16 quantization is symmetric: the offsets are not used
+  conv_params_t conv_params = {
+                                .in_offset = 0, .out_offset = 0,
+                                .stride = {params.stride_width, params.stride_height},
+                                .padding = {data.op_data.padding.width,
+                                            data.op_data.padding.height},
+                                .dilation = {0, 0},
+                                .activation = {data.op_data.output_activation_min,
+                                               data.op_data.output_activation_max}
+                              };
+  quant_data_t quant_data = {
+                              .shift = data.op_data.per_channel_output_shift,
+                              .mult = data.op_data.per_channel_output_multiplier
+                            };
+
+  for (int i_batch = 0; i_batch < batch_size; i_batch++) {
+    esp_nn_conv_s16_s8(&input_dims, input_data + i_batch * input_size,
+                       &filter_dims, tflite::micro::GetTensorData<int8_t>(filter),
+                       bias_data, &output_dims,
+                       output_data + i_batch * output_size,
+                       &conv_params, &quant_data);
+  }
+}
 #endif
 
 static TfLiteStatus Eval(TfLiteContext* context, TfLiteNode* node) {
@@ -294,7 +672,6 @@ static TfLiteStatus Eval(TfLiteContext* context, TfLiteNode* node) {
   TFLITE_DCHECK(node->user_data != nullptr);
   const auto& data = *(static_cast<const NodeData*>(node->user_data));
 
-  long long start_time = esp_timer_get_time();
   switch (input->type) {  // Already know in/out types are same.
     case kTfLiteFloat32: {
       tflite::reference_ops::Conv(
@@ -311,6 +688,12 @@ static TfLiteStatus Eval(TfLiteContext* context, TfLiteNode* node) {
       break;
     }
     case kTfLiteInt16: {
+#if ESP_NN
+      if (CanEvalQuantizedPerChannel16x8(params, input, filter, bias)) {
+        EvalQuantizedPerChannel16x8(params, data, input, filter, bias, output);
+        break;
+      }
+#endif
       if (bias == nullptr || bias->type == kTfLiteInt32) {
         reference_integer_ops::ConvPerChannel(
             ConvParamsQuantized(params, data.op_data),
@@ -398,9 +781,6 @@ static TfLiteStatus Eval(TfLiteContext* context, TfLiteNode* node) {
                   input->type);
       return kTfLiteError;
   }
-  long long time_this_instance = esp_timer_get_time() - start_time;
-  conv_total_time += time_this_instance;
-  // printf("time this conv instance: %llu\n", time_this_instance / 1000);
   return kTfLiteOk;
 }
 
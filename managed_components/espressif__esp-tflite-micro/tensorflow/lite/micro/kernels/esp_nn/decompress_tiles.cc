@@ -0,0 +1,115 @@
+/* Copyright 2025 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/lite/micro/kernels/esp_nn/decompress_tiles.h"
+
+#ifdef USE_TFLM_COMPRESSION
+
+#include <algorithm>
+
+#include "tensorflow/lite/kernels/internal/compatibility.h"
+#include "tensorflow/lite/micro/micro_arena_constants.h"
+#include "tensorflow/lite/micro/micro_context.h"
+#include "tensorflow/lite/micro/micro_utils.h"
+
+namespace tflite {
+
+int DecompressionTileChannels(int bytes_per_channel, int channels) {
+  int tile = std::min(channels, kDecompressionTileBytes / bytes_per_channel);
+  if (tile >= 8) {
+    tile &= ~7;
+  }
+  return std::max(tile, 1);
+}
+
+TfLiteStatus RequestDecompressionTile(TfLiteContext* context, size_t bytes,
+                                      int* scratch_index) {
+  MicroContext* micro_context = GetMicroContext(context);
+  *scratch_index = -1;
+  if (micro_context->AllocateDecompressionMemory(
+          bytes, MicroArenaBufferAlignment()) != nullptr) {
+    return kTfLiteOk;
+  }
+  return context->RequestScratchBufferInArena(context, bytes, scratch_index);
+}
+
+int8_t* GetDecompressionTile(TfLiteContext* context, int scratch_index,
+                             size_t bytes) {
+  if (scratch_index != -1) {
+    return static_cast<int8_t*>(
+        context->GetScratchBuffer(context, scratch_index));
+  }
+  return static_cast<int8_t*>(
+      GetMicroContext(context)->AllocateDecompressionMemory(
+          bytes, MicroArenaBufferAlignment()));
+}
+
+void DecompressInt8Range(const TfLiteEvalTensor& tensor,
+                         const CompressionTensorData& compression_data,
+                         size_t start, size_t count, int8_t* output) {
+  TFLITE_DCHECK(compression_data.scheme == CompressionScheme::kBinQuant);
+  const LookupTableData& lut = *compression_data.data.lut_data;
+  const uint8_t* indices = static_cast<const uint8_t*>(tensor.data.data);
+  const int8_t* values = static_cast<const int8_t*>(lut.value_table);
+  const size_t width = lut.compressed_bit_width;
+  const uint32_t mask = (1u << width) - 1;
+  const size_t stride = lut.value_table_channel_stride;
+
+  size_t num_channels = 1;
+  if (lut.is_per_channel_quantized) {
+    const int axis = lut.use_alternate_axis ? tensor.dims->size - 1 : 0;
+    num_channels = tensor.dims->data[axis];
+  }
+  const size_t per_channel = ElementCount(*tensor.dims) / num_channels;
+
+  // With the channel on the first axis each channel is a contiguous run of
+  // `per_channel` elements; on the last axis the channel cycles every element.
+  size_t channel;
+  size_t left_in_channel;
+  if (lut.use_alternate_axis) {
+    channel = start % num_channels;
+    left_in_channel = 1;
+  } else {
+    channel = start / per_channel;
+    left_in_channel = per_channel - start % per_channel;
+  }
+  const int8_t* table = values + channel * stride;
+
+  // Indices are packed most significant bit first
+  size_t bit = start * width;
+  for (size_t i = 0; i < count; i++, bit += width) {
+    const size_t shift = bit & 7;
+    uint32_t word = static_cast<uint32_t>(indices[bit >> 3]) << 8;
+    if (shift + width > 8) {
+      word |= indices[(bit >> 3) + 1];
+    }
+    output[i] = table[(word >> (16 - shift - width)) & mask];
+
+    if (--left_in_channel == 0) {
+      if (lut.use_alternate_axis) {
+        channel = channel + 1 == num_channels ? 0 : channel + 1;
+        left_in_channel = 1;
+      } else {
+        channel++;
+        left_in_channel = per_channel;
+      }
+      table = values + channel * stride;
+    }
+  }
+}
+
+}  // namespace tflite
+
+#endif  // USE_TFLM_COMPRESSION
@@ -0,0 +1,61 @@
+/* Copyright 2025 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LITE_MICRO_KERNELS_ESP_NN_DECOMPRESS_TILES_H_
+#define TENSORFLOW_LITE_MICRO_KERNELS_ESP_NN_DECOMPRESS_TILES_H_
+
+#ifdef USE_TFLM_COMPRESSION
+
+#include <cstddef>
+#include <cstdint>
+
+#include "tensorflow/lite/c/common.h"
+#include "tensorflow/lite/micro/compression.h"
+
+namespace tflite {
+
+// LUT-compressed weights are expanded a few output channels at a time into a
+// tile of at most this many bytes, instead of decompressing the whole tensor
+// before the kernel runs. The scratch cost stays constant with the layer size
+// and the tile fits in internal RAM when the interpreter has alternate
+// decompression memory (MicroInterpreter::SetDecompressionMemory).
+constexpr int kDecompressionTileBytes = 4096;
+
+// Number of output channels per tile for a tensor with `channels` channels of
+// `bytes_per_channel` bytes each. Always at least one channel; multiples of 8
+// when possible so the optimized kernels avoid their leftover loops.
+int DecompressionTileChannels(int bytes_per_channel, int channels);
+
+// Prepare: reserves a tile of `bytes`. Uses the alternate decompression memory
+// when it has room (sets *scratch_index to -1), otherwise requests a scratch
+// buffer in the arena. Must be called after any other decompression buffer of
+// the node, in the same order the kernel gets them during Eval.
+TfLiteStatus RequestDecompressionTile(TfLiteContext* context, size_t bytes,
+                                      int* scratch_index);
+
+// Eval: returns the tile reserved by RequestDecompressionTile.
+int8_t* GetDecompressionTile(TfLiteContext* context, int scratch_index,
+                             size_t bytes);
+
+// Expands elements [start, start + count) of a LUT-compressed int8 tensor.
+void DecompressInt8Range(const TfLiteEvalTensor& tensor,
+                         const CompressionTensorData& compression_data,
+                         size_t start, size_t count, int8_t* output);
+
+}  // namespace tflite
+
+#endif  // USE_TFLM_COMPRESSION
+
+#endif  // TENSORFLOW_LITE_MICRO_KERNELS_ESP_NN_DECOMPRESS_TILES_H_
@@ -24,13 +24,11 @@ limitations under the License.
 #include "tensorflow/lite/micro/kernels/kernel_util.h"
 #include "tensorflow/lite/micro/micro_log.h"
 
-#include <esp_timer.h>
-
 #if ESP_NN
 #include <esp_nn.h>
-#endif
 
-long long dc_total_time = 0;
+#include "tensorflow/lite/micro/kernels/esp_nn/kernel_variants.h"
+#endif
 
 namespace tflite {
 namespace {
@@ -39,6 +37,8 @@ struct NodeData {
   OpDataConv op_data;
 #if ESP_NN
   int buffer_idx;
+  // esp_nn_variant_t picked by the kernel tuner, or kKernelVariantPending
+  int variant;
 #endif
 };
 
@@ -110,8 +110,6 @@ inline void EvalQuantizedPerChannel(TfLiteContext* context, TfLiteNode* node,
       scratch_buf = context->GetScratchBuffer(context, data.buffer_idx);
     }
 
-    esp_nn_set_depthwise_conv_scratch_buf(scratch_buf);
-
     data_dims_t input_dims =  {
                                 .width = input_width, .height = input_height,
                                 .channels = input_depth, .extra = 1
@@ -136,12 +134,27 @@ inline void EvalQuantizedPerChannel(TfLiteContext* context, TfLiteNode* node,
                                 .mult = data.op_data.per_channel_output_multiplier
                               };
 
-    for (int i_batch = 0; i_batch < batch_size; i_batch++) {
-      esp_nn_depthwise_conv_s8(&input_dims, input_data + i_batch * input_size,
-                               &filter_dims, tflite::micro::GetTensorData<int8_t>(filter),
-                               tflite::micro::GetTensorData<int32_t>(bias),
-                               &output_dims, output_data + i_batch * output_size,
-                               &conv_params, &quant_data);
+    auto run = [&](esp_nn_variant_t variant) {
+      for (int i_batch = 0; i_batch < batch_size; i_batch++) {
+        esp_nn_depthwise_conv_s8_variant_r(
+            variant, &input_dims, input_data + i_batch * input_size,
+            &filter_dims, tflite::micro::GetTensorData<int8_t>(filter),
+            tflite::micro::GetTensorData<int32_t>(bias), &output_dims,
+            output_data + i_batch * output_size, &conv_params, &quant_data,
+            scratch_buf);
+      }
+    };
+    if (data.variant == kKernelVariantPending) {
+      static_cast<NodeData*>(node->user_data)->variant = TuneKernelVariant(
+          context,
+          [&](esp_nn_variant_t variant) {
+            return esp_nn_get_depthwise_conv_variant_scratch_size(
+                variant, &input_dims, &filter_dims, &output_dims,
+                &conv_params);
+          },
+          run, output_data, batch_size * output_size);
+    } else {
+      run(static_cast<esp_nn_variant_t>(data.variant));
     }
   } else {
     reference_integer_ops::DepthwiseConvPerChannel(
@@ -158,6 +171,85 @@ inline void EvalQuantizedPerChannel(TfLiteContext* context, TfLiteNode* node,
         tflite::micro::GetTensorData<int8_t>(output));
   }
 }
+
+// int16 activations, int8 filters and int64 bias
+inline void EvalQuantizedPerChannel16x8(const TfLiteDepthwiseConvParams& params,
+                                        const NodeData& data,
+                                        const TfLiteEvalTensor* input,
+                                        const TfLiteEvalTensor* filter,
+                                        const TfLiteEvalTensor* bias,
+                                        TfLiteEvalTensor* output) {
+  if (params.dilation_width_factor == 1 && params.dilation_height_factor == 1) {
+    RuntimeShape input_shape = tflite::micro::GetTensorShape(input);
+    RuntimeShape filter_shape = tflite::micro::GetTensorShape(filter);
+    RuntimeShape output_shape = tflite::micro::GetTensorShape(output);
+
+    const int16_t *input_data = tflite::micro::GetTensorData<int16_t>(input);
+    int16_t *output_data = tflite::micro::GetTensorData<int16_t>(output);
+
+    const int input_height = input_shape.Dims(1);
+    const int input_width = input_shape.Dims(2);
+    const int input_depth = input_shape.Dims(3);
+    const int output_height = output_shape.Dims(1);
+    const int output_width = output_shape.Dims(2);
+    const int batch_size = MatchingDim(input_shape, 0, output_shape, 0);
+    const int output_depth = MatchingDim(filter_shape, 3, output_shape, 3);
+    TFLITE_DCHECK_EQ(output_depth, input_depth * params.depth_multiplier);
+
+    const int input_size = input_width * input_height * input_depth;
+    const int output_size = output_width * output_height * output_depth;
+
+    data_dims_t input_dims =  {
+                                .width = input_width, .height = input_height,
+                                .channels = input_depth, .extra = 1
+                              };
+    data_dims_t output_dims = {
+                                .width = output_width, .height = output_height,
+                                .channels = output_depth, .extra = 1
+                              };
+    data_dims_t filter_dims = {
+                                .width = filter_shape.Dims(2),
+                                .height = filter_shape.Dims(1),
+                                .channels = 0, .extra = 0
+                              };
+    // int16 quantization is symmetric: the offsets are not used
+    dw_conv_params_t conv_params =  {
+                                      .in_offset = 0, .out_offset = 0,
+                                      .ch_mult = params.depth_multiplier,
+                                      .stride = {params.stride_width, params.stride_height},
+                                      .padding = {data.op_data.padding.width,
+                                                  data.op_data.padding.height},
+                                      .dilation = {0, 0},
+                                      .activation = {data.op_data.output_activation_min,
+                                                     data.op_data.output_activation_max}
+                                    };
+    quant_data_t quant_data = {
+                                .shift = data.op_data.per_channel_output_shift,
+                                .mult = data.op_data.per_channel_output_multiplier
+                              };
+
+    for (int i_batch = 0; i_batch < batch_size; i_batch++) {
+      esp_nn_depthwise_conv_s16_s8(
+          &input_dims, input_data + i_batch * input_size, &filter_dims,
+          tflite::micro::GetTensorData<int8_t>(filter),
+          tflite::micro::GetOptionalTensorData<int64_t>(bias), &output_dims,
+          output_data + i_batch * output_size, &conv_params, &quant_data);
+    }
+  } else {
+    reference_integer_ops::DepthwiseConvPerChannel(
+        DepthwiseConvParamsQuantized(params, data.op_data),
+        data.op_data.per_channel_output_multiplier,
+        data.op_data.per_channel_output_shift,
+        tflite::micro::GetTensorShape(input),
+        tflite::micro::GetTensorData<int16_t>(input),
+        tflite::micro::GetTensorShape(filter),
+        tflite::micro::GetTensorData<int8_t>(filter),
+        tflite::micro::GetTensorShape(bias),
+        tflite::micro::GetOptionalTensorData<int64_t>(bias),
+        tflite::micro::GetTensorShape(output),
+        tflite::micro::GetTensorData<int16_t>(output));
+  }
+}
 #endif
 
 TfLiteStatus Prepare(TfLiteContext* context, TfLiteNode* node) {
@@ -277,6 +369,18 @@ TfLiteStatus Prepare(TfLiteContext* context, TfLiteNode* node) {
 
     int scratch_buf_size = esp_nn_get_depthwise_conv_scratch_size(
         &input_dims, &filter_dims, &output_dims, &conv_params);
+    data->variant = ESP_NN_VARIANT_DEFAULT;
+    if (filter->type == kTfLiteInt8 && params.dilation_width_factor == 1 &&
+        params.dilation_height_factor == 1) {
+      data->variant = PrepareKernelVariant(
+          context,
+          [&](esp_nn_variant_t variant) {
+            return esp_nn_get_depthwise_conv_variant_scratch_size(
+                variant, &input_dims, &filter_dims, &output_dims,
+                &conv_params);
+          },
+          &scratch_buf_size);
+    }
     if (scratch_buf_size > 0) {
       TF_LITE_ENSURE_STATUS(context->RequestScratchBufferInArena(
         context, scratch_buf_size, &data->buffer_idx));
@@ -312,7 +416,6 @@ TfLiteStatus Eval(TfLiteContext* context, TfLiteNode* node) {
           ? tflite::micro::GetEvalInput(context, node, kDepthwiseConvBiasTensor)
           : nullptr;
 
-  long long start_time = esp_timer_get_time();
   switch (input->type) {  // Already know in/out types are same.
     case kTfLiteFloat32: {
       tflite::reference_ops::DepthwiseConv(
@@ -380,6 +483,9 @@ TfLiteStatus Eval(TfLiteContext* context, TfLiteNode* node) {
     case kTfLiteInt16: {
       switch (filter->type) {
         case kTfLiteInt8: {
+#if ESP_NN
+          EvalQuantizedPerChannel16x8(params, data, input, filter, bias, output);
+#else
           reference_integer_ops::DepthwiseConvPerChannel(
               DepthwiseConvParamsQuantized(params, data.op_data),
               data.op_data.per_channel_output_multiplier,
@@ -392,6 +498,7 @@ TfLiteStatus Eval(TfLiteContext* context, TfLiteNode* node) {
               tflite::micro::GetOptionalTensorData<int64_t>(bias),
               tflite::micro::GetTensorShape(output),
               tflite::micro::GetTensorData<int16_t>(output));
+#endif
           break;
         }
         default:
@@ -407,9 +514,6 @@ TfLiteStatus Eval(TfLiteContext* context, TfLiteNode* node) {
                   TfLiteTypeGetName(input->type), input->type);
       return kTfLiteError;
   }
-  long long time_this_instance = esp_timer_get_time() - start_time;
-  dc_total_time += time_this_instance;
-  // printf("time this dc instance: %llu\n", time_this_instance / 1000);
 
   return kTfLiteOk;
 }
@@ -23,31 +23,55 @@ limitations under the License.
 #include "tensorflow/lite/micro/kernels/kernel_util.h"
 #include "tensorflow/lite/micro/micro_log.h"
 
+#ifdef USE_TFLM_COMPRESSION
+
+#include <algorithm>
+
+#include "tensorflow/lite/micro/kernels/esp_nn/decompress_tiles.h"
+
+#endif  // USE_TFLM_COMPRESSION
+
 #if ESP_NN
 #include <esp_nn.h>
-#endif
-
-#include <esp_timer.h>
 
-long long fc_total_time = 0;
+#include "tensorflow/lite/micro/kernels/esp_nn/kernel_variants.h"
+#include "tensorflow/lite/micro/micro_sparse_weights.h"
+#endif
 
 namespace tflite {
 namespace {
 
+struct NodeData {
+  OpDataFullyConnected op_data;
+#if ESP_NN
+  // esp_nn_variant_t picked by the kernel tuner, or kKernelVariantPending
+  int variant;
+  // block-sparse copy of the weights from the model, run instead of them
+  SparseWeights sparse;
+#endif
+};
+
 void* FullyConnectedInit(TfLiteContext* context, const char* buffer,
                          size_t length) {
   TFLITE_DCHECK(context->AllocatePersistentBuffer != nullptr);
-  return context->AllocatePersistentBuffer(context,
-                                           sizeof(OpDataFullyConnected));
+  return context->AllocatePersistentBuffer(context, sizeof(NodeData));
 }
 
+#if ESP_NN
+// Candidates of the per tensor int8 kernel; it needs no scratch.
+int FullyConnectedVariantScratchSize(esp_nn_variant_t variant) {
+  return esp_nn_fully_connected_variant_available(variant) ? 0 : -1;
+}
+#endif
+
 TfLiteStatus FullyConnectedPrepare(TfLiteContext* context, TfLiteNode* node) {
   MicroContext* micro_context = GetMicroContext(context);
 
   TFLITE_DCHECK(node->user_data != nullptr);
   TFLITE_DCHECK(node->builtin_data != nullptr);
 
-  auto* data = static_cast<OpDataFullyConnected*>(node->user_data);
+  NodeData* node_data = static_cast<NodeData*>(node->user_data);
+  OpDataFullyConnected* data = &node_data->op_data;
   const auto params =
       static_cast<const TfLiteFullyConnectedParams*>(node->builtin_data);
 
@@ -87,6 +111,62 @@ TfLiteStatus FullyConnectedPrepare(TfLiteContext* context, TfLiteNode* node) {
                                  context, params->activation, input->type,
                                  input, filter, bias, output, data));
 
+#ifdef USE_TFLM_COMPRESSION
+
+  // Only the ESP-NN int8 path reads compressed tensors. The bias is small and
+  // is decompressed whole; the weights a block of rows at a time during Eval.
+  const bool weights_compressed =
+      micro_context->IsTensorCompressed(node, kFullyConnectedWeightsTensor);
+  if (weights_compressed ||
+      micro_context->IsTensorCompressed(node, kFullyConnectedBiasTensor)) {
+#if ESP_NN
+    const bool supported =
+        input->type == kTfLiteInt8 && filter->type == kTfLiteInt8;
+#else
+    const bool supported = false;
+#endif
+    if (!supported) {
+      MicroPrintf("Compressed tensors need int8 input and filter (ESP-NN)");
+      return kTfLiteError;
+    }
+  }
+  data->bias_scratch_index = micro_context->AllocateDecompressionScratchBuffer(
+      node, kFullyConnectedBiasTensor);
+  data->weights_scratch_index = -1;
+  if (weights_compressed) {
+    const int accum_depth = filter->dims->data[filter->dims->size - 1];
+    const int output_depth = filter->dims->data[filter->dims->size - 2];
+    const int rows = DecompressionTileChannels(accum_depth, output_depth);
+    TF_LITE_ENSURE_OK(context,
+                      RequestDecompressionTile(context, rows * accum_depth,
+                                               &data->weights_scratch_index));
+  }
+
+#endif  // USE_TFLM_COMPRESSION
+
+#if ESP_NN
+  node_data->variant = ESP_NN_VARIANT_DEFAULT;
+  node_data->sparse = SparseWeights();
+#ifdef USE_TFLM_COMPRESSION
+  const bool tunable =
+      !micro_context->IsTensorCompressed(node, kFullyConnectedWeightsTensor);
+#else
+  const bool tunable = true;
+#endif
+  // The sparse kernel has no filter offset and is not tuned
+  if (tunable && input->type == kTfLiteInt8 && filter->type == kTfLiteInt8 &&
+      data->filter_zero_point == 0 && filter->dims->size == 2) {
+    micro_context->GetSparseWeights(node, kFullyConnectedWeightsTensor,
+                                    &node_data->sparse);
+  }
+  if (tunable && node_data->sparse.block_len == 0 &&
+      input->type == kTfLiteInt8 && filter->type == kTfLiteInt8) {
+    int scratch_bytes = 0;
+    node_data->variant = PrepareKernelVariant(
+        context, FullyConnectedVariantScratchSize, &scratch_bytes);
+  }
+#endif
+
   micro_context->DeallocateTempTfLiteTensor(input);
   micro_context->DeallocateTempTfLiteTensor(filter);
   if (bias != nullptr) {
@@ -112,10 +192,21 @@ TfLiteStatus FullyConnectedEval(TfLiteContext* context, TfLiteNode* node) {
 
   TFLITE_DCHECK(node->user_data != nullptr);
 
-  const auto& data =
-      *(static_cast<const OpDataFullyConnected*>(node->user_data));
+  const NodeData& node_data = *(static_cast<const NodeData*>(node->user_data));
+  const OpDataFullyConnected& data = node_data.op_data;
+
+#if defined(USE_TFLM_COMPRESSION) && ESP_NN
+
+  // Only the ESP-NN int8 path reads compressed tensors (see Prepare)
+  MicroContext* micro_context = GetMicroContext(context);
+  const CompressionTensorData* weights_comp_td =
+      micro_context->GetTensorCompressionData(node,
+                                              kFullyConnectedWeightsTensor);
+  const CompressionTensorData* bias_comp_td =
+      micro_context->GetTensorCompressionData(node, kFullyConnectedBiasTensor);
+
+#endif  // defined(USE_TFLM_COMPRESSION) && ESP_NN
 
-  long long start_time = esp_timer_get_time();
   // Checks in Prepare ensure input, output and filter types are all the same.
   switch (input->type) {
     case kTfLiteFloat32: {
@@ -166,24 +257,86 @@ TfLiteStatus FullyConnectedEval(TfLiteContext* context, TfLiteNode* node) {
           TFLITE_DCHECK_LE(output_depth, filter_shape.Dims(filter_dim_count - 2));
           const int accum_depth = filter_shape.Dims(filter_dim_count - 1);
 
+#ifdef USE_TFLM_COMPRESSION
+          const int32_t* bias_data =
+              tflite::micro::GetOptionalTensorData<int32_t>(
+                  micro_context, bias, bias_comp_td, data.bias_scratch_index);
+#else
           const int32_t* bias_data =
               tflite::micro::GetOptionalTensorData<int32_t>(bias);
+#endif
 
           const int8_t *input_data = tflite::micro::GetTensorData<int8_t>(input);
           int8_t *output_data = tflite::micro::GetTensorData<int8_t>(output);
+
+#ifdef USE_TFLM_COMPRESSION
+          if (weights_comp_td != nullptr) {
+            // Decompress a block of rows and run it for every batch before
+            // moving on, so each weight is decoded once per Eval.
+            const int tile_rows =
+                DecompressionTileChannels(accum_depth, output_depth);
+            int8_t* tile = GetDecompressionTile(
+                context, data.weights_scratch_index, tile_rows * accum_depth);
+            TF_LITE_ENSURE(context, tile != nullptr);
+            for (int row = 0; row < output_depth; row += tile_rows) {
+              const int rows = std::min(tile_rows, output_depth - row);
+              DecompressInt8Range(*filter, *weights_comp_td, row * accum_depth,
+                                  rows * accum_depth, tile);
+              for (int b = 0; b < batches; ++b) {
+                esp_nn_fully_connected_s8(input_data + b * accum_depth,
+                                          -data.input_zero_point, accum_depth,
+                                          tile, -data.filter_zero_point,
+                                          bias_data ? bias_data + row : nullptr,
+                                          output_data + b * output_depth + row,
+                                          rows, data.output_zero_point,
+                                          data.output_shift,
+                                          data.output_multiplier,
+                                          data.output_activation_min,
+                                          data.output_activation_max);
+              }
+            }
+            break;
+          }
+#endif  // USE_TFLM_COMPRESSION
+
+          if (node_data.sparse.block_len > 0) {
+            const sparse_filter_t sparse_filter = {
+                                                    .bitmap = node_data.sparse.bitmap,
+                                                    .values = node_data.sparse.values,
+                                                    .block_len = node_data.sparse.block_len
+                                                  };
+            for (int b = 0; b < batches; ++b) {
+              esp_nn_fully_connected_sparse_s8(
+                  input_data + b * accum_depth, -data.input_zero_point,
+                  accum_depth, &sparse_filter, bias_data,
+                  output_data + b * output_depth, output_depth,
+                  data.output_zero_point, data.output_shift,
+                  data.output_multiplier, data.output_activation_min,
+                  data.output_activation_max);
+            }
+            break;
+          }
+
           const int8_t *filter_data = tflite::micro::GetTensorData<int8_t>(filter);
 
-          for (int b = 0; b < batches; ++b) {
-            esp_nn_fully_connected_s8(input_data, -data.input_zero_point,
-                                      accum_depth,
-                                      filter_data, -data.filter_zero_point,
-                                      bias_data, output_data, output_depth,
-                                      data.output_zero_point,
-                                      data.output_shift, data.output_multiplier,
-                                      data.output_activation_min,
-                                      data.output_activation_max);
-            input_data += accum_depth;
-            output_data += output_depth;
+          auto run = [&](esp_nn_variant_t variant) {
+            for (int b = 0; b < batches; ++b) {
+              esp_nn_fully_connected_s8_variant(
+                  variant, input_data + b * accum_depth,
+                  -data.input_zero_point, accum_depth, filter_data,
+                  -data.filter_zero_point, bias_data,
+                  output_data + b * output_depth, output_depth,
+                  data.output_zero_point, data.output_shift,
+                  data.output_multiplier, data.output_activation_min,
+                  data.output_activation_max);
+            }
+          };
+          if (node_data.variant == kKernelVariantPending) {
+            static_cast<NodeData*>(node->user_data)->variant =
+                TuneKernelVariant(context, FullyConnectedVariantScratchSize,
+                                  run, output_data, batches * output_depth);
+          } else {
+            run(static_cast<esp_nn_variant_t>(node_data.variant));
           }
 #else
           tflite::reference_integer_ops::FullyConnected(
@@ -211,6 +364,33 @@ TfLiteStatus FullyConnectedEval(TfLiteContext* context, TfLiteNode* node) {
     case kTfLiteInt16: {
       switch (filter->type) {
         case kTfLiteInt8: {
+#if ESP_NN
+          // int16 quantization is symmetric; the esp_nn kernel has no offsets
+          if (data.input_zero_point == 0 && data.filter_zero_point == 0 &&
+              data.output_zero_point == 0) {
+            const RuntimeShape& filter_shape = tflite::micro::GetTensorShape(filter);
+            const RuntimeShape& output_shape = tflite::micro::GetTensorShape(output);
+            const int filter_dim_count = filter_shape.DimensionsCount();
+            const int output_dim_count = output_shape.DimensionsCount();
+            const int batches = FlatSizeSkipDim(output_shape, output_dim_count - 1);
+            const int output_depth = output_shape.Dims(output_dim_count - 1);
+            TFLITE_DCHECK_LE(output_depth, filter_shape.Dims(filter_dim_count - 2));
+            const int accum_depth = filter_shape.Dims(filter_dim_count - 1);
+
+            const int16_t *input_data = tflite::micro::GetTensorData<int16_t>(input);
+            int16_t *output_data = tflite::micro::GetTensorData<int16_t>(output);
+            for (int b = 0; b < batches; ++b) {
+              esp_nn_fully_connected_s16_s8(
+                  input_data + b * accum_depth, accum_depth,
+                  tflite::micro::GetTensorData<int8_t>(filter),
+                  tflite::micro::GetOptionalTensorData<int64_t>(bias),
+                  output_data + b * output_depth, output_depth,
+                  data.output_shift, data.output_multiplier,
+                  data.output_activation_min, data.output_activation_max);
+            }
+            break;
+          }
+#endif
           tflite::reference_integer_ops::FullyConnected(
               FullyConnectedParamsQuantized(data),
               tflite::micro::GetTensorShape(input),
@@ -238,7 +418,6 @@ TfLiteStatus FullyConnectedEval(TfLiteContext* context, TfLiteNode* node) {
       return kTfLiteError;
     }
   }
-  fc_total_time += esp_timer_get_time() - start_time;
   return kTfLiteOk;
 }
 
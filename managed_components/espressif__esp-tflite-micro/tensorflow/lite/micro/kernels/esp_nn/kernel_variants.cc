@@ -0,0 +1,72 @@
+/* Copyright 2025 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/lite/micro/kernels/esp_nn/kernel_variants.h"
+
+#if ESP_NN
+
+#include "tensorflow/lite/micro/micro_context.h"
+#include "tensorflow/lite/micro/micro_kernel_tuner.h"
+#include "tensorflow/lite/micro/micro_log.h"
+
+namespace tflite {
+
+int RecordedKernelVariant(TfLiteContext* context) {
+  MicroContext* micro_context = GetMicroContext(context);
+  const MicroKernelTuner* tuner = micro_context->GetKernelTuner();
+  if (tuner == nullptr) {
+    return ESP_NN_VARIANT_DEFAULT;
+  }
+  MicroGraph& graph = micro_context->graph();
+  const int variant = tuner->Lookup(graph.GetCurrentSubgraphIndex(),
+                                    graph.GetCurrentOperatorIndex());
+  if (variant >= 0 && variant < ESP_NN_VARIANT_COUNT) {
+    return variant;
+  }
+  return tuner->calibrating() ? kKernelVariantPending : ESP_NN_VARIANT_DEFAULT;
+}
+
+uint32_t KernelOutputHash(const int8_t* output, size_t bytes) {
+  // FNV-1a
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < bytes; i++) {
+    hash = (hash ^ static_cast<uint8_t>(output[i])) * 16777619u;
+  }
+  return hash;
+}
+
+void RecordKernelVariant(TfLiteContext* context, int variant, uint32_t ticks) {
+  MicroContext* micro_context = GetMicroContext(context);
+  MicroKernelTuner* tuner = micro_context->GetKernelTuner();
+  if (tuner == nullptr) {
+    return;
+  }
+  const uint32_t per_second = ticks_per_second();
+  const uint32_t us =
+      per_second > 0
+          ? static_cast<uint32_t>(static_cast<uint64_t>(ticks) * 1000000 /
+                                  per_second)
+          : 0;
+  MicroGraph& graph = micro_context->graph();
+  if (!tuner->Record(graph.GetCurrentSubgraphIndex(),
+                     graph.GetCurrentOperatorIndex(), variant, us)) {
+    MicroPrintf("Kernel tuner full, operator %d keeps this variant until reboot",
+                graph.GetCurrentOperatorIndex());
+  }
+}
+
+}  // namespace tflite
+
+#endif  // ESP_NN
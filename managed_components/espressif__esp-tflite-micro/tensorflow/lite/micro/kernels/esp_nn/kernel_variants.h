@@ -0,0 +1,137 @@
+/* Copyright 2025 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LITE_MICRO_KERNELS_ESP_NN_KERNEL_VARIANTS_H_
+#define TENSORFLOW_LITE_MICRO_KERNELS_ESP_NN_KERNEL_VARIANTS_H_
+
+#if ESP_NN
+
+#include <esp_nn.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+#include "tensorflow/lite/c/common.h"
+#include "tensorflow/lite/micro/micro_time.h"
+
+namespace tflite {
+
+// Selection of the esp_nn variant (esp_nn_variants.h) of each operator through
+// the interpreter's MicroKernelTuner. Without a tuner every operator runs
+// ESP_NN_VARIANT_DEFAULT, which is the code the esp_nn_* names dispatch to.
+
+// Returned by RecordedKernelVariant when the operator measures its variants on
+// its first Eval.
+constexpr int kKernelVariantPending = -1;
+
+// Each candidate runs this many times while measuring; the fastest run counts.
+constexpr int kKernelVariantRuns = 2;
+
+// Variant recorded for the current operator: ESP_NN_VARIANT_DEFAULT without a
+// tuner or entry, kKernelVariantPending if the tuner is calibrating.
+int RecordedKernelVariant(TfLiteContext* context);
+
+// Hash of an output, to compare the result of each variant with the reference
+// without keeping a copy.
+uint32_t KernelOutputHash(const int8_t* output, size_t bytes);
+
+// Records the winner of the current operator in the tuner.
+void RecordKernelVariant(TfLiteContext* context, int variant, uint32_t ticks);
+
+// Prepare: returns the variant the current operator runs, and raises
+// `*scratch_bytes` (the size the default variant needs) to what it needs.
+// `scratch_size(variant)` is the esp_nn scratch size of a variant, -1 if it is
+// not a candidate. A pending operator needs room for any candidate; a recorded
+// variant that is no longer a candidate falls back to the default.
+template <typename ScratchSize>
+int PrepareKernelVariant(TfLiteContext* context, ScratchSize scratch_size,
+                         int* scratch_bytes) {
+  const int variant = RecordedKernelVariant(context);
+  if (variant == kKernelVariantPending) {
+    for (int v = 0; v < ESP_NN_VARIANT_COUNT; v++) {
+      *scratch_bytes = std::max(
+          *scratch_bytes, scratch_size(static_cast<esp_nn_variant_t>(v)));
+    }
+    return variant;
+  }
+  if (variant == ESP_NN_VARIANT_DEFAULT) {
+    return variant;
+  }
+  const int size = scratch_size(static_cast<esp_nn_variant_t>(variant));
+  if (size < 0) {
+    return ESP_NN_VARIANT_DEFAULT;
+  }
+  *scratch_bytes = std::max(*scratch_bytes, size);
+  return variant;
+}
+
+// Eval of a pending operator: `run(variant)` computes the whole operator into
+// `output` with a variant. ESP_NN_VARIANT_ANSI runs first as the reference,
+// then the other candidates; the fastest one that gives the same output is
+// recorded and returned, and `output` ends with its result. Without a clock
+// the default variant is kept.
+template <typename ScratchSize, typename Run>
+int TuneKernelVariant(TfLiteContext* context, ScratchSize scratch_size,
+                      Run run, const int8_t* output, size_t output_bytes) {
+  if (ticks_per_second() == 0) {
+    run(ESP_NN_VARIANT_DEFAULT);
+    RecordKernelVariant(context, ESP_NN_VARIANT_DEFAULT, 0);
+    return ESP_NN_VARIANT_DEFAULT;
+  }
+
+  int best = ESP_NN_VARIANT_DEFAULT;
+  uint32_t best_ticks = UINT32_MAX;
+  uint32_t reference = 0;
+  int last = -1;
+  for (int i = 0; i < ESP_NN_VARIANT_COUNT; i++) {
+    // ANSI (1) first, then DEFAULT (0), then the rest
+    const int v = i <= ESP_NN_VARIANT_ANSI ? ESP_NN_VARIANT_ANSI - i : i;
+    const esp_nn_variant_t variant = static_cast<esp_nn_variant_t>(v);
+    if (v != ESP_NN_VARIANT_ANSI && scratch_size(variant) < 0) {
+      continue;
+    }
+    uint32_t ticks = UINT32_MAX;
+    for (int r = 0; r < kKernelVariantRuns; r++) {
+      const uint32_t start = GetCurrentTimeTicks();
+      run(variant);
+      ticks = std::min(ticks, GetCurrentTimeTicks() - start);
+    }
+    last = v;
+    const uint32_t hash = KernelOutputHash(output, output_bytes);
+    if (v == ESP_NN_VARIANT_ANSI) {
+      reference = hash;
+    } else if (hash != reference) {
+      continue;  // wrong for this shape, never picked
+    }
+    // on a tie the default wins
+    if (ticks < best_ticks ||
+        (ticks == best_ticks && v == ESP_NN_VARIANT_DEFAULT)) {
+      best = v;
+      best_ticks = ticks;
+    }
+  }
+  if (last != best) {
+    run(static_cast<esp_nn_variant_t>(best));
+  }
+  RecordKernelVariant(context, best, best_ticks);
+  return best;
+}
+
+}  // namespace tflite
+
+#endif  // ESP_NN
+
+#endif  // TENSORFLOW_LITE_MICRO_KERNELS_ESP_NN_KERNEL_VARIANTS_H_
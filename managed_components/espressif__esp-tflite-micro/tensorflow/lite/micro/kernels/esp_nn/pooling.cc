@@ -14,6 +14,8 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/lite/kernels/internal/reference/pooling.h"
 
+#include <cstring>
+
 #include "tensorflow/lite/c/builtin_op_data.h"
 #include "tensorflow/lite/kernels/kernel_util.h"
 #include "tensorflow/lite/micro/kernels/kernel_util.h"
@@ -24,14 +26,18 @@ limitations under the License.
 #include <esp_nn.h>
 #endif
 
-#include <esp_timer.h>
-
-long long pooling_total_time = 0;
-
 namespace tflite {
 
 namespace {
 #if ESP_NN
+// The S3 assembly kernels only take channel counts multiple of 4; the other
+// targets use the generic optimized ones, which take any.
+#if defined(ARCH_ESP32_S3)
+constexpr bool kPoolingChannelsMultipleOf4 = true;
+#else
+constexpr bool kPoolingChannelsMultipleOf4 = false;
+#endif
+
 void AverageEvalQuantized(TfLiteContext* context, const TfLiteNode* node,
                           const TfLitePoolParams* params, const OpDataPooling* data,
                           const TfLiteEvalTensor* input,
@@ -64,7 +70,7 @@ void AverageEvalQuantized(TfLiteContext* context, const TfLiteNode* node,
   const int input_size = input_width * input_height * depth;
   const int output_size = output_width * output_height * depth;
 
-  if (depth % 4 == 0) { // S3 version only supports channels multiple of 4
+  if (!kPoolingChannelsMultipleOf4 || depth % 4 == 0) {
     for (int batch = 0; batch < batches; ++batch) {
       esp_nn_avg_pool_s8(input_data, input_width, input_height,
                          output_data, output_width, output_height,
@@ -119,7 +125,7 @@ void MaxEvalQuantized(TfLiteContext* context, TfLiteNode* node,
 
   const int input_size = input_width * input_height * depth;
   const int output_size = output_width * output_height * depth;
-  if (depth % 4 == 0) { // S3 version only supports channels multiple of 4
+  if (!kPoolingChannelsMultipleOf4 || depth % 4 == 0) {
     for (int batch = 0; batch < batches; ++batch) {
       esp_nn_max_pool_s8(input_data, input_width, input_height,
                          output_data, output_width, output_height,
@@ -158,7 +164,6 @@ TfLiteStatus AverageEval(TfLiteContext* context, TfLiteNode* node) {
   TfLiteEvalTensor* output =
       micro::GetEvalOutput(context, node, kPoolingOutputTensor);
 
-  long long start_time = esp_timer_get_time();
   // Inputs and outputs share the same type, guaranteed by the converter.
   switch (input->type) {
     case kTfLiteFloat32:
@@ -181,7 +186,6 @@ TfLiteStatus AverageEval(TfLiteContext* context, TfLiteNode* node) {
                          TfLiteTypeGetName(input->type));
       return kTfLiteError;
   }
-  pooling_total_time += esp_timer_get_time() - start_time;
   return kTfLiteOk;
 }
 
@@ -198,7 +202,13 @@ TfLiteStatus MaxEval(TfLiteContext* context, TfLiteNode* node) {
   TfLiteEvalTensor* output =
       micro::GetEvalOutput(context, node, kPoolingOutputTensor);
 
-  long long start_time = esp_timer_get_time();
+  if (data->computed_by_input_op) {
+    // The conv before it wrote the pooled values (see esp_nn/conv.cc).
+    std::memcpy(output->data.data, input->data.data,
+                micro::GetTensorShape(output).FlatSize());
+    return kTfLiteOk;
+  }
+
   switch (input->type) {
     case kTfLiteFloat32:
       MaxPoolingEvalFloat(context, node, params, data, input, output);
@@ -220,13 +230,17 @@ TfLiteStatus MaxEval(TfLiteContext* context, TfLiteNode* node) {
                   TfLiteTypeGetName(input->type));
       return kTfLiteError;
   }
-  pooling_total_time += esp_timer_get_time() - start_time;
   return kTfLiteOk;
 }
 
 void* PoolInit(TfLiteContext* context, const char* buffer, size_t length) {
   TFLITE_DCHECK(context->AllocatePersistentBuffer != nullptr);
-  return context->AllocatePersistentBuffer(context, sizeof(OpDataPooling));
+  OpDataPooling* data = static_cast<OpDataPooling*>(
+      context->AllocatePersistentBuffer(context, sizeof(OpDataPooling)));
+  if (data != nullptr) {
+    data->computed_by_input_op = false;
+  }
+  return data;
 }
 
 }  // namespace
@@ -0,0 +1,35 @@
+/* Copyright 2025 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/lite/kernels/internal/reference/requantize.h"
+#include "tensorflow/lite/micro/kernels/quantize.h"
+
+#if ESP_NN
+#include <esp_nn.h>
+#endif
+
+namespace tflite {
+
+void QuantizeInt16ToInt8(const int16_t* input, int size, int32_t multiplier,
+                         int shift, int32_t zero_point, int8_t* output) {
+#if ESP_NN
+  esp_nn_quantize_s16_s8(input, output, zero_point, multiplier, shift, size);
+#else
+  reference_ops::Requantize(input, size, multiplier, shift, 0, zero_point,
+                            output);
+#endif
+}
+
+}  // namespace tflite
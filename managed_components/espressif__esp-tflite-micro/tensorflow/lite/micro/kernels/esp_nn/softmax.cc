@@ -15,6 +15,8 @@ limitations under the License.
 
 #include "tensorflow/lite/micro/kernels/softmax.h"
 
+#include <cstring>
+
 #include "tensorflow/lite/c/builtin_op_data.h"
 #include "tensorflow/lite/c/common.h"
 #include "tensorflow/lite/kernels/internal/common.h"
@@ -25,15 +27,12 @@ limitations under the License.
 #include "tensorflow/lite/kernels/op_macros.h"
 #include "tensorflow/lite/micro/kernels/kernel_util.h"
 #include "tensorflow/lite/micro/micro_log.h"
-
-#include <esp_timer.h>
+#include "tensorflow/lite/micro/micro_utils.h"
 
 #if ESP_NN
 #include <esp_nn.h>
 #endif
 
-long long softmax_total_time = 0;
-
 namespace tflite {
 namespace {
 // Softmax parameter data that persists in user_data
@@ -78,9 +77,8 @@ void SoftmaxQuantized(TfLiteContext* context, const TfLiteEvalTensor* input,
       if (data->buffer_idx > -1) {
         scratch_buf = context->GetScratchBuffer(context, data->buffer_idx);
       }
-      esp_nn_set_softmax_scratch_buf(scratch_buf);
-      esp_nn_softmax_s8(in_ptr, outer_size, depth, input_beta_multiplier,
-                        input_beta_left_shift, diff_min, out_ptr);
+      esp_nn_softmax_s8_r(in_ptr, outer_size, depth, input_beta_multiplier,
+                          input_beta_left_shift, diff_min, out_ptr, scratch_buf);
 #else
       tflite::reference_ops::Softmax(
           data->op_data, tflite::micro::GetTensorShape(input),
@@ -105,7 +103,6 @@ static TfLiteStatus Eval(TfLiteContext* context, TfLiteNode* node) {
   TFLITE_DCHECK(node->user_data != nullptr);
   NodeData data = *static_cast<NodeData*>(node->user_data);
 
-  long long start_time = esp_timer_get_time();
   switch (input->type) {
     case kTfLiteFloat32: {
       tflite::reference_ops::Softmax(
@@ -125,7 +122,6 @@ static TfLiteStatus Eval(TfLiteContext* context, TfLiteNode* node) {
                          TfLiteTypeGetName(input->type), input->type);
       return kTfLiteError;
   }
-  softmax_total_time += esp_timer_get_time() - start_time;
   return kTfLiteOk;
 }
 
@@ -168,10 +164,74 @@ static TfLiteStatus Prepare(TfLiteContext* context, TfLiteNode* node) {
   return ret_val;
 }
 
+// Trailing softmax left to the caller: the int8 logits are copied to the
+// output tensor unchanged. The argmax is the same, and the caller can get the
+// probabilities with SoftmaxInt8Row() only when it needs them.
+static TfLiteStatus LogitsPrepare(TfLiteContext* context, TfLiteNode* node) {
+  MicroContext* micro_context = GetMicroContext(context);
+
+  TF_LITE_ENSURE_EQ(context, NumInputs(node), 1);
+  TF_LITE_ENSURE_EQ(context, NumOutputs(node), 1);
+  TfLiteTensor* input = micro_context->AllocateTempInputTensor(node, 0);
+  TF_LITE_ENSURE(context, input != nullptr);
+  TfLiteTensor* output = micro_context->AllocateTempOutputTensor(node, 0);
+  TF_LITE_ENSURE(context, output != nullptr);
+
+  TF_LITE_ENSURE_TYPES_EQ(context, input->type, kTfLiteInt8);
+  TF_LITE_ENSURE_TYPES_EQ(context, output->type, kTfLiteInt8);
+  TF_LITE_ENSURE_EQ(context, input->bytes, output->bytes);
+
+  micro_context->DeallocateTempTfLiteTensor(input);
+  micro_context->DeallocateTempTfLiteTensor(output);
+  return kTfLiteOk;
+}
+
+static TfLiteStatus LogitsEval(TfLiteContext* context, TfLiteNode* node) {
+  const TfLiteEvalTensor* input = tflite::micro::GetEvalInput(context, node, 0);
+  TfLiteEvalTensor* output = tflite::micro::GetEvalOutput(context, node, 0);
+
+  const int8_t* in_ptr = tflite::micro::GetTensorData<int8_t>(input);
+  int8_t* out_ptr = tflite::micro::GetTensorData<int8_t>(output);
+  if (in_ptr != out_ptr) {
+    std::memcpy(out_ptr, in_ptr, ElementCount(*input->dims));
+  }
+  return kTfLiteOk;
+}
+
 }  // namespace
 
 TFLMRegistration Register_SOFTMAX() {
   return tflite::micro::RegisterOp(Init, Prepare, Eval);
 }
 
+TFLMRegistration Register_SOFTMAX_INT8_LOGITS() {
+  return tflite::micro::RegisterOp(nullptr, LogitsPrepare, LogitsEval);
+}
+
+void SoftmaxInt8Params(float beta, float input_scale, SoftmaxParams* params) {
+  // Same as CalculateSoftmaxParams() for int8 input and output
+  static const int kScaledDiffIntegerBits = 5;
+  int input_left_shift;
+  tflite::PreprocessSoftmaxScaling(static_cast<double>(beta),
+                                   static_cast<double>(input_scale),
+                                   kScaledDiffIntegerBits,
+                                   &params->input_multiplier,
+                                   &input_left_shift);
+  params->input_left_shift = input_left_shift;
+  params->diff_min = -1.0 * tflite::CalculateInputRadius(
+                                kScaledDiffIntegerBits, input_left_shift);
+}
+
+void SoftmaxInt8Row(const SoftmaxParams& params, const int8_t* logits,
+                    int depth, int8_t* probs, int32_t* scratch) {
+#if ESP_NN
+  esp_nn_softmax_s8_r(logits, 1, depth, params.input_multiplier,
+                      params.input_left_shift, params.diff_min, probs, scratch);
+#else
+  (void)scratch;
+  const RuntimeShape shape({1, depth});
+  tflite::reference_ops::Softmax(params, shape, logits, shape, probs);
+#endif
+}
+
 }  // namespace tflite
@@ -40,6 +40,9 @@ struct OpDataPooling {
   int32_t activation_max;
   float activation_min_f32;
   float activation_max_f32;
+  // Set by the op that produces the input (the ESP-NN conv) when it already
+  // computed the pooling: the input holds the output values.
+  bool computed_by_input_op;
 };
 
 TfLiteStatus CalculateOpDataPooling(const TfLiteContext* context,
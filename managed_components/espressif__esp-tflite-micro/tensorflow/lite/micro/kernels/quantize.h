@@ -32,6 +32,13 @@ struct OpDataQuantizeReference {
 
 TfLiteStatus EvalQuantizeReference(TfLiteContext* context, TfLiteNode* node);
 TfLiteStatus PrepareQuantizeReference(TfLiteContext* context, TfLiteNode* node);
+
+// Quantizes `size` int16 values into int8 for a caller filling an input
+// tensor: output = clamp(MultiplyByQuantizedMultiplier(input, multiplier,
+// shift) + zero_point). `shift` must be in [-31, 15]. Uses the esp-nn block
+// kernel when available.
+void QuantizeInt16ToInt8(const int16_t* input, int size, int32_t multiplier,
+                         int shift, int32_t zero_point, int8_t* output);
 }  // namespace tflite
 
 #endif  // TENSORFLOW_LITE_MICRO_KERNELS_QUANTIZE_H_
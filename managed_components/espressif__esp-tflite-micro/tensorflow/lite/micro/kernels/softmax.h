@@ -62,6 +62,22 @@ inline TFLMRegistration Register_SOFTMAX_INT8() { return Register_SOFTMAX(); }
 inline TFLMRegistration Register_SOFTMAX_INT16() { return Register_SOFTMAX(); }
 #endif
 
+// Int8 softmax whose Eval only copies the logits to the output tensor, for
+// models whose last op is the softmax and whose caller only needs the top
+// class. Provided by the ESP-NN kernels.
+TFLMRegistration Register_SOFTMAX_INT8_LOGITS();
+
+// int8 -> int8 softmax parameters (output scale 1/256, zero point -128) for
+// logits quantized with `input_scale`.
+void SoftmaxInt8Params(float beta, float input_scale, SoftmaxParams* params);
+
+// Softmax of a single row of `depth` int8 logits into `probs`. `scratch` must
+// hold `depth` int32 values (4-byte aligned); it is used by the ESP-NN kernel
+// instead of a shared buffer, so concurrent calls with their own `scratch` are
+// safe.
+void SoftmaxInt8Row(const SoftmaxParams& params, const int8_t* logits,
+                    int depth, int8_t* probs, int32_t* scratch);
+
 }  // namespace tflite
 
 #endif  // TENSORFLOW_LITE_MICRO_KERNELS_SOFTMAX_H_
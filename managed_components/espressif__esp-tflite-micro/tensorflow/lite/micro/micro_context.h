@@ -18,6 +18,7 @@ limitations under the License.
 
 #include "tensorflow/lite/c/common.h"
 #include "tensorflow/lite/micro/micro_graph.h"
+#include "tensorflow/lite/micro/micro_kernel_tuner.h"
 #include "tensorflow/lite/micro/micro_profiler_interface.h"
 
 #ifdef USE_TFLM_COMPRESSION
@@ -29,6 +30,9 @@ limitations under the License.
 #endif  // USE_TFLM_COMPRESSION
 
 namespace tflite {
+
+struct SparseWeights;  // micro_sparse_weights.h
+
 // TODO(b/149795762): kTfLiteAbort cannot be part of the tflite TfLiteStatus.
 const TfLiteStatus kTfLiteAbort = static_cast<TfLiteStatus>(15);
 
@@ -167,6 +171,23 @@ class MicroContext {
     return nullptr;
   }
 
+  // Set the MicroKernelTuner that kernels with several variants (esp_nn) use
+  // to pick one per operator. Must be set before Prepare.
+  virtual TfLiteStatus SetKernelTuner(MicroKernelTuner* kernel_tuner) {
+    return kTfLiteError;
+  }
+
+  // Get the MicroKernelTuner, nullptr if there is none: kernels then run
+  // their default variant.
+  virtual MicroKernelTuner* GetKernelTuner() const { return nullptr; }
+
+  // Block-sparse copy of input `tensor_idx` of `node` from the model metadata
+  // (see micro_sparse_weights.h). Returns false if it has none.
+  virtual bool GetSparseWeights(const TfLiteNode* node, int tensor_idx,
+                                SparseWeights* sparse) const {
+    return false;
+  }
+
  private:
   TF_LITE_REMOVE_VIRTUAL_DELETE
 };
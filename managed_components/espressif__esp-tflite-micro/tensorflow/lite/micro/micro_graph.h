@@ -50,6 +50,22 @@ class MicroGraph {
   // Number of subgraphs in the model.
   virtual int NumSubgraphs() = 0;
 
+  // Subgraph and operator being prepared or invoked, and the operators of a
+  // subgraph, so that a kernel can look at its neighbours from Prepare (e.g.
+  // to fuse with the operator that consumes its output). Graphs that do not
+  // track them report no operators.
+  virtual int GetCurrentSubgraphIndex() { return 0; }
+  virtual int GetCurrentOperatorIndex() { return -1; }
+  virtual int NumOperatorsInSubgraph(int subgraph_idx) { return 0; }
+
+  // Node of the specified operator of a specified subgraph, with its
+  // registration in `registration`, or nullptr if out of range.
+  virtual TfLiteNode* GetSubgraphOperator(
+      int subgraph_idx, int operator_idx,
+      const TFLMRegistration** registration) {
+    return nullptr;
+  }
+
   // Get the resource variables for this TFLM graph.
   virtual MicroResourceVariables* GetResourceVariables() = 0;
 
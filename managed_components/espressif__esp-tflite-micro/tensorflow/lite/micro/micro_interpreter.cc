@@ -339,6 +339,10 @@ TfLiteStatus MicroInterpreter::SetAlternateProfiler(
   return micro_context_.SetAlternateProfiler(alt_profiler);
 }
 
+TfLiteStatus MicroInterpreter::SetKernelTuner(MicroKernelTuner* kernel_tuner) {
+  return micro_context_.SetKernelTuner(kernel_tuner);
+}
+
 #ifdef USE_TFLM_COMPRESSION
 
 TfLiteStatus MicroInterpreter::SetDecompressionMemory(
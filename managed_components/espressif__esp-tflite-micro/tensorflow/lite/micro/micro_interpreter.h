@@ -160,6 +160,12 @@ class MicroInterpreter {
   // decompression subsystem.
   TfLiteStatus SetAlternateProfiler(MicroProfilerInterface* alt_profiler);
 
+  // Set the MicroKernelTuner that picks the kernel variant of each operator
+  // (see micro_kernel_tuner.h). It must outlive the interpreter.
+  // Can only be called during the MicroInterpreter kInit state (i.e. must
+  // be called before MicroInterpreter::AllocateTensors).
+  TfLiteStatus SetKernelTuner(MicroKernelTuner* kernel_tuner);
+
 #ifdef USE_TFLM_COMPRESSION
 
   // Set the alternate decompression memory regions.
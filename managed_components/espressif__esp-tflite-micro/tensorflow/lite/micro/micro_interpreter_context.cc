@@ -27,6 +27,7 @@ limitations under the License.
 #endif  // USE_TFLM_COMPRESSION
 
 #include "tensorflow/lite/kernels/internal/compatibility.h"
+#include "tensorflow/lite/micro/micro_sparse_weights.h"
 #include "tensorflow/lite/micro/micro_utils.h"
 
 namespace tflite {
@@ -277,4 +278,31 @@ MicroProfilerInterface* MicroInterpreterContext::GetAlternateProfiler() const {
   return alt_profiler_;
 }
 
+TfLiteStatus MicroInterpreterContext::SetKernelTuner(
+    MicroKernelTuner* kernel_tuner) {
+  if (state_ != InterpreterState::kInit) {
+    MicroPrintf(
+        "MicroInterpreterContext::SetKernelTuner: "
+        "only available during kInit state");
+    return kTfLiteError;
+  }
+  kernel_tuner_ = kernel_tuner;
+  return kTfLiteOk;
+}
+
+MicroKernelTuner* MicroInterpreterContext::GetKernelTuner() const {
+  return kernel_tuner_;
+}
+
+bool MicroInterpreterContext::GetSparseWeights(const TfLiteNode* node,
+                                               int tensor_idx,
+                                               SparseWeights* sparse) const {
+  if (tensor_idx >= node->inputs->size ||
+      node->inputs->data[tensor_idx] < 0) {
+    return false;
+  }
+  return FindSparseWeights(*model_, graph_.GetCurrentSubgraphIndex(),
+                           node->inputs->data[tensor_idx], sparse);
+}
+
 }  // namespace tflite
@@ -159,6 +159,17 @@ class MicroInterpreterContext : public MicroContext {
   // decompression subsystem.
   MicroProfilerInterface* GetAlternateProfiler() const override;
 
+  // Set the MicroKernelTuner used by kernels with several variants.
+  // Can only be called during the MicroInterpreter kInit state.
+  TfLiteStatus SetKernelTuner(MicroKernelTuner* kernel_tuner) override;
+
+  // Get the MicroKernelTuner, nullptr if there is none.
+  MicroKernelTuner* GetKernelTuner() const override;
+
+  // Block-sparse copy of an input of `node`, from the model metadata.
+  bool GetSparseWeights(const TfLiteNode* node, int tensor_idx,
+                        SparseWeights* sparse) const override;
+
  private:
   MicroAllocator& allocator_;
   MicroInterpreterGraph& graph_;
@@ -168,6 +179,7 @@ class MicroInterpreterContext : public MicroContext {
   ScratchBufferHandle* scratch_buffer_handles_ = nullptr;
   void* external_context_payload_ = nullptr;
   MicroProfilerInterface* alt_profiler_ = nullptr;
+  MicroKernelTuner* kernel_tuner_ = nullptr;
 
 #ifdef USE_TFLM_COMPRESSION
 
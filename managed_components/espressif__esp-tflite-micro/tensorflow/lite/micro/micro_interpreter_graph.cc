@@ -220,7 +220,8 @@ TfLiteStatus MicroInterpreterGraph::InvokeSubgraph(int subgraph_idx) {
 // only defined for builds with the error strings.
 #if !defined(TF_LITE_STRIP_ERROR_STRINGS)
     ScopedMicroProfiler scoped_profiler(
-        OpNameFromRegistration(registration),
+        OpNameFromRegistration(registration), subgraph_idx,
+        current_operator_index_,
         reinterpret_cast<MicroProfilerInterface*>(context_->profiler));
 #endif
 
@@ -281,6 +282,26 @@ int MicroInterpreterGraph::NumSubgraphs() {
   return model_->subgraphs()->size();
 }
 
+int MicroInterpreterGraph::NumOperatorsInSubgraph(int subgraph_idx) {
+  if (subgraph_idx < 0 || subgraph_idx >= NumSubgraphs()) {
+    return 0;
+  }
+  return static_cast<int>(NumSubgraphOperators(model_, subgraph_idx));
+}
+
+TfLiteNode* MicroInterpreterGraph::GetSubgraphOperator(
+    int subgraph_idx, int operator_idx,
+    const TFLMRegistration** registration) {
+  if (operator_idx < 0 ||
+      operator_idx >= NumOperatorsInSubgraph(subgraph_idx)) {
+    return nullptr;
+  }
+  NodeAndRegistration& node_and_registration =
+      subgraph_allocations_[subgraph_idx].node_and_registrations[operator_idx];
+  *registration = node_and_registration.registration;
+  return &node_and_registration.node;
+}
+
 void MicroInterpreterGraph::SetSubgraphAllocations(
     SubgraphAllocations* subgraph_allocations) {
   subgraph_allocations_ = subgraph_allocations;
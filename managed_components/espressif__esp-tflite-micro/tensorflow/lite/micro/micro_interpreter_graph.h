@@ -84,12 +84,20 @@ class MicroInterpreterGraph : public MicroGraph {
 
   // Get the current subgraph index. Within an on operator, this is guaranteed
   // to be the subgraph of that operator.
-  int GetCurrentSubgraphIndex() { return current_subgraph_index_; }
+  virtual int GetCurrentSubgraphIndex() { return current_subgraph_index_; }
 
   // Get the current operator index inside a subgraph.
   // The couple GetCurrentSubgraphIndex GetCurrentSubgraphIndex creates a unique
   // identifier of the operator inside the subgraph
-  int GetCurrentOperatorIndex() { return current_operator_index_; }
+  virtual int GetCurrentOperatorIndex() { return current_operator_index_; }
+
+  // Number of operators in a specified subgraph in the model.
+  virtual int NumOperatorsInSubgraph(int subgraph_idx);
+
+  // Node and registration of the specified operator of a specified subgraph.
+  virtual TfLiteNode* GetSubgraphOperator(
+      int subgraph_idx, int operator_idx,
+      const TFLMRegistration** registration);
 
   // Gets the list of allocations for each subgraph. This is the source of truth
   // for all per-subgraph allocation data.
@@ -0,0 +1,119 @@
+/* Copyright 2025 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/lite/micro/micro_kernel_tuner.h"
+
+#include <cinttypes>
+#include <cstdint>
+#include <cstring>
+
+#include "tensorflow/lite/micro/micro_log.h"
+
+namespace tflite {
+
+namespace {
+
+// Serialized form: header, then the entries as they are in memory. It is
+// read back by the same firmware on the same device, so layout and
+// endianness do not need converting.
+struct Header {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t num_entries;
+};
+
+constexpr uint32_t kMagic = 0x4e52544b;  // "KTRN"
+constexpr uint16_t kVersion = 1;
+
+}  // namespace
+
+int MicroKernelTuner::Lookup(int subgraph_idx, int operator_idx) const {
+  for (int i = 0; i < num_entries_; ++i) {
+    if (entries_[i].subgraph_idx == subgraph_idx &&
+        entries_[i].operator_idx == operator_idx) {
+      return entries_[i].variant;
+    }
+  }
+  return -1;
+}
+
+bool MicroKernelTuner::Record(int subgraph_idx, int operator_idx, int variant,
+                              uint32_t time_us) {
+  Entry* entry = nullptr;
+  for (int i = 0; i < num_entries_; ++i) {
+    if (entries_[i].subgraph_idx == subgraph_idx &&
+        entries_[i].operator_idx == operator_idx) {
+      entry = &entries_[i];
+      break;
+    }
+  }
+  if (entry == nullptr) {
+    if (num_entries_ == kMaxEntries) {
+      return false;
+    }
+    entry = &entries_[num_entries_++];
+    entry->subgraph_idx = static_cast<int16_t>(subgraph_idx);
+    entry->operator_idx = static_cast<int16_t>(operator_idx);
+  }
+  entry->variant = static_cast<int8_t>(variant);
+  entry->time_us = time_us;
+  changed_ = true;
+  return true;
+}
+
+size_t MicroKernelTuner::SerializedSize() const {
+  return sizeof(Header) + num_entries_ * sizeof(Entry);
+}
+
+size_t MicroKernelTuner::Serialize(uint8_t* buffer, size_t size) const {
+  const size_t bytes = SerializedSize();
+  if (size < bytes) {
+    return 0;
+  }
+  Header header = {kMagic, kVersion, static_cast<uint16_t>(num_entries_)};
+  memcpy(buffer, &header, sizeof(header));
+  memcpy(buffer + sizeof(header), entries_, num_entries_ * sizeof(Entry));
+  return bytes;
+}
+
+bool MicroKernelTuner::Deserialize(const uint8_t* buffer, size_t size) {
+  num_entries_ = 0;
+  changed_ = false;
+  Header header;
+  if (size < sizeof(header)) {
+    return false;
+  }
+  memcpy(&header, buffer, sizeof(header));
+  if (header.magic != kMagic || header.version != kVersion ||
+      header.num_entries > kMaxEntries ||
+      size != sizeof(header) + header.num_entries * sizeof(Entry)) {
+    return false;
+  }
+  memcpy(entries_, buffer + sizeof(header), header.num_entries * sizeof(Entry));
+  num_entries_ = header.num_entries;
+  return true;
+}
+
+void MicroKernelTuner::Log() const {
+#if !defined(TF_LITE_STRIP_ERROR_STRINGS)
+  for (int i = 0; i < num_entries_; ++i) {
+    const Entry& entry = entries_[i];
+    MicroPrintf("[%d:%d] variant %d, %" PRIu32 " us", entry.subgraph_idx,
+                entry.operator_idx, entry.variant, entry.time_us);
+  }
+#endif
+}
+
+}  // namespace tflite
@@ -0,0 +1,94 @@
+/* Copyright 2025 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LITE_MICRO_MICRO_KERNEL_TUNER_H_
+#define TENSORFLOW_LITE_MICRO_MICRO_KERNEL_TUNER_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace tflite {
+
+// Kernel variant chosen for each operator of a model, keyed by subgraph and
+// operator index. Kernels that have several implementations of the same
+// operation (the esp_nn ones) look their operator up in Prepare and run the
+// recorded variant.
+//
+// While calibrating(), an operator without an entry measures its candidates
+// on its first Eval, keeps the fastest one whose output matches the reference
+// variant, and records it. The table can then be saved with Serialize() and
+// given back with Deserialize() on the next boot, so the measurement is done
+// once per model. The variant numbers belong to the kernels; the tuner only
+// stores them.
+//
+// Set it with MicroInterpreter::SetKernelTuner() before AllocateTensors().
+class MicroKernelTuner {
+ public:
+  static constexpr int kMaxEntries = 64;
+
+  struct Entry {
+    int16_t subgraph_idx;
+    int16_t operator_idx;
+    int8_t variant;
+    uint8_t reserved[3];
+    uint32_t time_us;  // of the winner when it was measured, 0 if unknown
+  };
+
+  MicroKernelTuner() = default;
+
+  // Whether operators without an entry measure their variants on first Eval.
+  bool calibrating() const { return calibrating_; }
+  void set_calibrating(bool calibrating) { calibrating_ = calibrating; }
+
+  // Recorded variant of an operator, or -1 if there is none.
+  int Lookup(int subgraph_idx, int operator_idx) const;
+
+  // Records (or replaces) the variant of an operator. Returns false if the
+  // table is full.
+  bool Record(int subgraph_idx, int operator_idx, int variant,
+              uint32_t time_us);
+
+  int num_entries() const { return num_entries_; }
+  const Entry& entry(int i) const { return entries_[i]; }
+
+  // True once Record() changed the table since construction, Deserialize()
+  // or clear_changed().
+  bool changed() const { return changed_; }
+  void clear_changed() { changed_ = false; }
+
+  // Size of the serialized table.
+  size_t SerializedSize() const;
+
+  // Writes the table to `buffer`; returns the bytes written, or 0 if `size`
+  // is too small.
+  size_t Serialize(uint8_t* buffer, size_t size) const;
+
+  // Replaces the table with one written by Serialize(). Returns false, and
+  // leaves the table empty, if the data is not a valid table.
+  bool Deserialize(const uint8_t* buffer, size_t size);
+
+  // Prints one line per entry in human readable form.
+  void Log() const;
+
+ private:
+  Entry entries_[kMaxEntries] = {};
+  int num_entries_ = 0;
+  bool calibrating_ = false;
+  bool changed_ = false;
+};
+
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_MICRO_MICRO_KERNEL_TUNER_H_
@@ -99,6 +99,8 @@ class ScopedMicroProfiler {
  public:
   explicit ScopedMicroProfiler(const char* tag,
                                MicroProfilerInterface* profiler) {}
+  ScopedMicroProfiler(const char* tag, int subgraph_idx, int operator_idx,
+                      MicroProfilerInterface* profiler) {}
 };
 
 #else
@@ -123,6 +125,17 @@ class ScopedMicroProfiler {
     }
   }
 
+  // Same, for an operator of the model (see
+  // MicroProfilerInterface::BeginOperatorEvent).
+  ScopedMicroProfiler(const char* tag, int subgraph_idx, int operator_idx,
+                      MicroProfilerInterface* profiler)
+      : profiler_(profiler) {
+    if (profiler_ != nullptr) {
+      event_handle_ =
+          profiler_->BeginOperatorEvent(tag, subgraph_idx, operator_idx);
+    }
+  }
+
   ~ScopedMicroProfiler() {
     if (profiler_ != nullptr) {
       profiler_->EndEvent(event_handle_);
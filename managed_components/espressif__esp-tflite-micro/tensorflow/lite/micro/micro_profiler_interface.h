@@ -29,6 +29,14 @@ class MicroProfilerInterface {
   // to mark the end of the event via EndEvent.
   virtual uint32_t BeginEvent(const char* tag) = 0;
 
+  // Marks the start of the invocation of operator `operator_idx` of subgraph
+  // `subgraph_idx`. The interpreter calls this for every operator it runs;
+  // profilers that keep per-operator data override it.
+  virtual uint32_t BeginOperatorEvent(const char* tag, int subgraph_idx,
+                                      int operator_idx) {
+    return BeginEvent(tag);
+  }
+
   // Marks the end of an event associated with event_handle.
   virtual void EndEvent(uint32_t event_handle) = 0;
 };
@@ -0,0 +1,122 @@
+/* Copyright 2025 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/lite/micro/micro_sparse_weights.h"
+
+#include <cstddef>
+#include <cstring>
+
+#include "tensorflow/lite/micro/micro_log.h"
+
+namespace tflite {
+
+namespace {
+
+constexpr uint32_t kVersion = 1;
+constexpr size_t kHeaderWords = 2;
+constexpr size_t kEntryWords = 4;
+
+uint32_t ReadWord(const uint8_t* data, size_t index) {
+  uint32_t word;
+  std::memcpy(&word, data + index * sizeof(word), sizeof(word));
+  return word;
+}
+
+const flatbuffers::Vector<uint8_t>* BufferData(const Model& model,
+                                               uint32_t index) {
+  if (model.buffers() == nullptr || index == 0 ||
+      index >= model.buffers()->size()) {
+    return nullptr;
+  }
+  return model.buffers()->Get(index)->data();
+}
+
+const flatbuffers::Vector<uint8_t>* SparseMetadata(const Model& model) {
+  if (model.metadata() == nullptr) {
+    return nullptr;
+  }
+  for (const auto* metadata : *model.metadata()) {
+    if (metadata->name() != nullptr &&
+        std::strcmp(metadata->name()->c_str(), kSparseWeightsMetadata) == 0) {
+      return BufferData(model, metadata->buffer());
+    }
+  }
+  return nullptr;
+}
+
+}  // namespace
+
+bool FindSparseWeights(const Model& model, int subgraph_idx, int tensor_idx,
+                       SparseWeights* sparse) {
+  const auto* metadata = SparseMetadata(model);
+  if (metadata == nullptr || metadata->size() < kHeaderWords * 4 ||
+      ReadWord(metadata->data(), 0) != kVersion) {
+    return false;
+  }
+  const uint32_t count = ReadWord(metadata->data(), 1);
+  if (metadata->size() < (kHeaderWords + count * kEntryWords) * 4) {
+    MicroPrintf("%s: truncated metadata", kSparseWeightsMetadata);
+    return false;
+  }
+
+  for (uint32_t i = 0; i < count; i++) {
+    const size_t entry = kHeaderWords + i * kEntryWords;
+    if (ReadWord(metadata->data(), entry) !=
+            static_cast<uint32_t>(subgraph_idx) ||
+        ReadWord(metadata->data(), entry + 1) !=
+            static_cast<uint32_t>(tensor_idx)) {
+      continue;
+    }
+    const auto* data = BufferData(model, ReadWord(metadata->data(), entry + 2));
+    const uint32_t block_len = ReadWord(metadata->data(), entry + 3);
+    const auto* tensor =
+        model.subgraphs()->Get(subgraph_idx)->tensors()->Get(tensor_idx);
+    if (data == nullptr || (block_len != 4 && block_len != 8) ||
+        tensor->type() != TensorType_INT8 || tensor->shape() == nullptr ||
+        tensor->shape()->size() < 2) {
+      MicroPrintf("%s: invalid entry for tensor %d", kSparseWeightsMetadata,
+                  tensor_idx);
+      return false;
+    }
+
+    // rows of the first dimension, each padded to whole blocks and bytes
+    size_t size = 1;
+    for (const int32_t dim : *tensor->shape()) {
+      size *= dim;
+    }
+    const size_t rows = tensor->shape()->Get(0);
+    const size_t row_len = rows > 0 ? size / rows : 0;
+    const size_t blocks = (row_len + block_len - 1) / block_len;
+    const size_t bitmap_bytes = rows * ((blocks + 7) / 8);
+    size_t set_blocks = 0;
+    for (size_t b = 0; b < bitmap_bytes && b < data->size(); b++) {
+      set_blocks += __builtin_popcount(data->Get(b));
+    }
+    if (data->size() != bitmap_bytes + set_blocks * block_len) {
+      MicroPrintf("%s: buffer of tensor %d does not match its shape",
+                  kSparseWeightsMetadata, tensor_idx);
+      return false;
+    }
+
+    sparse->bitmap = data->data();
+    sparse->values = reinterpret_cast<const int8_t*>(data->data()) +
+                     bitmap_bytes;
+    sparse->block_len = static_cast<int>(block_len);
+    return true;
+  }
+  return false;
+}
+
+}  // namespace tflite
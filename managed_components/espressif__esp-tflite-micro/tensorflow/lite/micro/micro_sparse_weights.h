@@ -0,0 +1,49 @@
+/* Copyright 2025 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LITE_MICRO_MICRO_SPARSE_WEIGHTS_H_
+#define TENSORFLOW_LITE_MICRO_MICRO_SPARSE_WEIGHTS_H_
+
+#include <cstdint>
+
+#include "tensorflow/lite/schema/schema_generated.h"
+
+namespace tflite {
+
+// Block-sparse copies of int8 weight tensors, added to a model by
+// tools/esparcir_modelo.py. The dense tensor stays in the model, so kernels
+// without a sparse path still run it.
+//
+// The metadata buffer is little endian uint32 values: version, entry count,
+// then per entry subgraph, tensor, buffer and block length. The buffer of an
+// entry holds the bitmap of the tensor, then the non-zero blocks (the layout
+// of esp-nn's sparse_filter_t). A row is the first dimension of the tensor.
+static constexpr const char* kSparseWeightsMetadata = "ESP_NN_SPARSE_WEIGHTS";
+
+struct SparseWeights {
+  const uint8_t* bitmap = nullptr;
+  const int8_t* values = nullptr;
+  int block_len = 0;  // 0: the tensor has no sparse copy
+};
+
+// Looks up the sparse copy of a tensor. Returns false, leaving `sparse`
+// untouched, if there is none or if its buffer does not match the shape of
+// the tensor.
+bool FindSparseWeights(const Model& model, int subgraph_idx, int tensor_idx,
+                       SparseWeights* sparse);
+
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_MICRO_MICRO_SPARSE_WEIGHTS_H_
@@ -28,11 +28,23 @@ limitations under the License.
 
 #if defined(TF_LITE_USE_CTIME)
 #include <ctime>
+#elif defined(ESP_PLATFORM)
+#include <esp_timer.h>
 #endif
 
 namespace tflite {
 
-#if !defined(TF_LITE_USE_CTIME)
+#if defined(ESP_PLATFORM) && !defined(TF_LITE_USE_CTIME)
+
+// On ESP-IDF a tick is a microsecond of esp_timer. It wraps every ~71 minutes,
+// which is harmless for the differences the profilers compute.
+uint32_t ticks_per_second() { return 1000000; }
+
+uint32_t GetCurrentTimeTicks() {
+  return static_cast<uint32_t>(esp_timer_get_time());
+}
+
+#elif !defined(TF_LITE_USE_CTIME)
 
 // Reference implementation of the ticks_per_second() function that's required
 // for a platform to support Tensorflow Lite for Microcontrollers profiling.
@@ -0,0 +1,134 @@
+/* Copyright 2025 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/lite/micro/micro_timing_registry.h"
+
+#include <cinttypes>
+#include <cstdint>
+#include <cstring>
+
+#include "tensorflow/lite/micro/micro_log.h"
+#include "tensorflow/lite/micro/micro_time.h"
+
+namespace tflite {
+
+uint32_t MicroTimingRegistry::BeginEvent(const char* tag) {
+  for (int i = 0; i < num_entries_; ++i) {
+    if (entries_[i].subgraph_idx == -1 && strcmp(entries_[i].tag, tag) == 0) {
+      return Begin(i);
+    }
+  }
+  if (num_entries_ == kMaxEntries) {
+    dropped_++;
+    return kMaxEntries;
+  }
+  Entry& entry = entries_[num_entries_];
+  entry.tag = tag;
+  entry.subgraph_idx = -1;
+  entry.operator_idx = -1;
+  entry.min_us = UINT32_MAX;
+  return Begin(num_entries_++);
+}
+
+uint32_t MicroTimingRegistry::BeginOperatorEvent(const char* tag,
+                                                 int subgraph_idx,
+                                                 int operator_idx) {
+  // Operators run in order, so the entry after the last one is usually it
+  for (int n = 1; n <= num_entries_; ++n) {
+    const int i = (last_entry_ + n) % num_entries_;
+    if (entries_[i].subgraph_idx == subgraph_idx &&
+        entries_[i].operator_idx == operator_idx) {
+      return Begin(i);
+    }
+  }
+  if (num_entries_ == kMaxEntries) {
+    dropped_++;
+    return kMaxEntries;
+  }
+  Entry& entry = entries_[num_entries_];
+  entry.tag = tag;
+  entry.subgraph_idx = static_cast<int16_t>(subgraph_idx);
+  entry.operator_idx = static_cast<int16_t>(operator_idx);
+  entry.min_us = UINT32_MAX;
+  return Begin(num_entries_++);
+}
+
+uint32_t MicroTimingRegistry::Begin(int entry) {
+  last_entry_ = entry;
+  start_ticks_[entry] = GetCurrentTimeTicks();
+  return entry;
+}
+
+void MicroTimingRegistry::EndEvent(uint32_t event_handle) {
+  if (event_handle >= static_cast<uint32_t>(num_entries_)) {
+    return;
+  }
+  const uint32_t ticks = GetCurrentTimeTicks() - start_ticks_[event_handle];
+  const uint32_t per_second = ticks_per_second();
+  const uint32_t us =
+      per_second > 0
+          ? static_cast<uint32_t>(static_cast<uint64_t>(ticks) * 1000000 /
+                                  per_second)
+          : 0;
+
+  Entry& entry = entries_[event_handle];
+  entry.count++;
+  entry.total_us += us;
+  if (us < entry.min_us) entry.min_us = us;
+  if (us > entry.max_us) entry.max_us = us;
+  int bin = 0;
+  while (bin < kHistogramBins - 1 && us >= BinUpperBoundUs(bin)) {
+    bin++;
+  }
+  entry.histogram[bin]++;
+}
+
+uint32_t MicroTimingRegistry::BinUpperBoundUs(int bin) {
+  return bin < kHistogramBins - 1 ? kFirstBinUs << (2 * bin) : UINT32_MAX;
+}
+
+void MicroTimingRegistry::Reset() {
+  for (int i = 0; i < num_entries_; ++i) {
+    Entry& entry = entries_[i];
+    entry.count = 0;
+    entry.total_us = 0;
+    entry.min_us = UINT32_MAX;
+    entry.max_us = 0;
+    memset(entry.histogram, 0, sizeof(entry.histogram));
+  }
+  dropped_ = 0;
+}
+
+void MicroTimingRegistry::Log() const {
+#if !defined(TF_LITE_STRIP_ERROR_STRINGS)
+  for (int i = 0; i < num_entries_; ++i) {
+    const Entry& entry = entries_[i];
+    if (entry.count == 0) {
+      continue;
+    }
+    MicroPrintf("[%d:%d] %s: %" PRIu32 " calls, avg %" PRIu32
+                " us, min %" PRIu32 " us, max %" PRIu32 " us",
+                entry.subgraph_idx, entry.operator_idx, entry.tag, entry.count,
+                static_cast<uint32_t>(entry.total_us / entry.count),
+                entry.min_us, entry.max_us);
+  }
+  if (dropped_ > 0) {
+    MicroPrintf("%" PRIu32 " events dropped (more than %d entries)", dropped_,
+                kMaxEntries);
+  }
+#endif
+}
+
+}  // namespace tflite
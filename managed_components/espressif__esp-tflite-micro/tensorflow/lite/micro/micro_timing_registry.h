@@ -0,0 +1,92 @@
+/* Copyright 2025 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LITE_MICRO_MICRO_TIMING_REGISTRY_H_
+#define TENSORFLOW_LITE_MICRO_MICRO_TIMING_REGISTRY_H_
+
+#include <cstdint>
+
+#include "tensorflow/lite/micro/compatibility.h"
+#include "tensorflow/lite/micro/micro_profiler_interface.h"
+
+namespace tflite {
+
+// Accumulated timing of every operator of a model, keyed by subgraph and
+// operator index. Pass it as the profiler of a MicroInterpreter: each Invoke()
+// adds one call to the entry of each operator it runs, with count, total,
+// minimum, maximum and a latency histogram. Unlike MicroProfiler it does not
+// grow with the number of invocations, so it can stay attached in production.
+//
+// Without a profiler the interpreter does no timing at all, and with
+// TF_LITE_STRIP_ERROR_STRINGS the operator events are compiled out.
+class MicroTimingRegistry : public MicroProfilerInterface {
+ public:
+  // Operators (and other events) tracked; the rest are counted in dropped().
+  static constexpr int kMaxEntries = 64;
+
+  // Bin i holds calls shorter than kFirstBinUs << (2 * i) microseconds (16 us,
+  // 64 us, 256 us, ...); the last bin holds everything longer.
+  static constexpr int kHistogramBins = 8;
+  static constexpr uint32_t kFirstBinUs = 16;
+
+  struct Entry {
+    const char* tag;
+    int16_t subgraph_idx;  // -1 for events that are not operators
+    int16_t operator_idx;
+    uint32_t count;
+    uint64_t total_us;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint32_t histogram[kHistogramBins];
+  };
+
+  MicroTimingRegistry() = default;
+  virtual ~MicroTimingRegistry() = default;
+
+  // Events that are not operators are grouped by tag.
+  virtual uint32_t BeginEvent(const char* tag) override;
+  virtual uint32_t BeginOperatorEvent(const char* tag, int subgraph_idx,
+                                      int operator_idx) override;
+  virtual void EndEvent(uint32_t event_handle) override;
+
+  int num_entries() const { return num_entries_; }
+  const Entry& entry(int i) const { return entries_[i]; }
+  uint32_t dropped() const { return dropped_; }
+
+  // Upper bound in microseconds of histogram bin `bin` (UINT32_MAX for the
+  // last one).
+  static uint32_t BinUpperBoundUs(int bin);
+
+  // Zeroes the statistics; the entries (and their order) are kept.
+  void Reset();
+
+  // Prints one line per entry in human readable form.
+  void Log() const;
+
+ private:
+  uint32_t Begin(int entry);
+
+  Entry entries_[kMaxEntries] = {};
+  uint32_t start_ticks_[kMaxEntries] = {};
+  int num_entries_ = 0;
+  int last_entry_ = -1;
+  uint32_t dropped_ = 0;
+
+  TF_LITE_REMOVE_VIRTUAL_DELETE
+};
+
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_MICRO_MICRO_TIMING_REGISTRY_H_
@@ -0,0 +1,137 @@
+#!/usr/bin/env python3
+"""Escribe las capas de un modelo como formas para el benchmark de esp-nn.
+
+El benchmark de kernels (managed_components/espressif__esp-nn/bench) mide
+formas sueltas; con --shapes lee un archivo con una capa por línea. Esta
+herramienta saca ese archivo de un .tflite: cada CONV_2D, DEPTHWISE_CONV_2D,
+FULLY_CONNECTED, MAX_POOL_2D, AVERAGE_POOL_2D, SOFTMAX, ADD, MUL, RELU y
+RELU6 int8 del primer subgrafo se vuelve una línea con sus dimensiones,
+pasos y relleno (el de SAME se calcula como TFLite). Las capas que esp-nn no
+ejecuta así (dilatación, lote mayor que 1, ADD o MUL con broadcast) se
+informan y se dejan afuera.
+
+Uso: capas_bench.py modelo.tflite [-o capas.txt]
+"""
+
+import argparse
+import os
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import tflite_fb  # noqa: E402
+
+TIPO_INT8 = 9
+PADDING_SAME = 0
+
+ADD, AVERAGE_POOL_2D, CONV_2D, DEPTHWISE_CONV_2D = 0, 1, 3, 4
+FULLY_CONNECTED, MAX_POOL_2D, MUL, RELU, RELU6, SOFTMAX = 9, 17, 18, 19, 21, 25
+
+NOMBRES = {CONV_2D: "conv", DEPTHWISE_CONV_2D: "depthwise", FULLY_CONNECTED: "fc",
+           MAX_POOL_2D: "max_pool", AVERAGE_POOL_2D: "avg_pool", SOFTMAX: "softmax",
+           ADD: "add", MUL: "mul", RELU: "relu", RELU6: "relu"}
+
+
+def relleno(entrada, salida, filtro, paso, same):
+    """Relleno de arriba/izquierda, como ComputePaddingHeightWidth de TFLite."""
+    if not same:
+        return 0
+    return max((salida - 1) * paso + filtro - entrada, 0) // 2
+
+
+def nhwc(forma):
+    """(alto, ancho, canales) de una forma con lote 1, o None."""
+    if len(forma) != 4 or forma[0] != 1:
+        return None
+    return forma[1], forma[2], forma[3]
+
+
+def linea(modelo, sg, op):
+    """Parámetros de la línea de `op`, o (None, motivo) si no se puede medir."""
+    codigo = modelo.codigos_op[op.indice_codigo][0]
+    entrada = sg.tensores[op.entradas[0]]
+    salida = sg.tensores[op.salidas[0]]
+    o = op.opciones
+    if entrada.tipo != TIPO_INT8:
+        return None, "no es int8"
+
+    if codigo in (CONV_2D, DEPTHWISE_CONV_2D, MAX_POOL_2D, AVERAGE_POOL_2D):
+        ent, sal = nhwc(entrada.forma), nhwc(salida.forma)
+        if ent is None or sal is None:
+            return None, "lote distinto de 1"
+        same = o.escalar(0, "b") == PADDING_SAME
+        paso_an, paso_al = o.escalar(1, "i"), o.escalar(2, "i")
+        if codigo == CONV_2D:
+            dil = (o.escalar(4, "i", 1), o.escalar(5, "i", 1))
+            filtro = sg.tensores[op.entradas[1]].forma[1:3]
+        elif codigo == DEPTHWISE_CONV_2D:
+            dil = (o.escalar(5, "i", 1), o.escalar(6, "i", 1))
+            filtro = sg.tensores[op.entradas[1]].forma[1:3]
+        else:
+            dil = (1, 1)
+            filtro = [o.escalar(4, "i"), o.escalar(3, "i")]
+        if dil != (1, 1):
+            return None, "dilatación"
+
+        params = ["in=%dx%dx%d" % ent, "filter=%dx%d" % tuple(filtro)]
+        if codigo == CONV_2D:
+            params.append("out=%d" % sal[2])
+        elif codigo == DEPTHWISE_CONV_2D:
+            params.append("mult=%d" % (sal[2] // ent[2]))
+        params += ["stride=%dx%d" % (paso_al, paso_an),
+                   "pad=%dx%d" % (relleno(ent[0], sal[0], filtro[0], paso_al, same),
+                                  relleno(ent[1], sal[1], filtro[1], paso_an, same)),
+                   "out_hw=%dx%d" % sal[:2]]
+        return params, None
+
+    if codigo == FULLY_CONNECTED:
+        pesos = sg.tensores[op.entradas[1]].forma
+        lotes = entrada.bytes // pesos[1]
+        if lotes != 1:
+            return None, "lote distinto de 1"
+        return ["in=%d" % pesos[1], "out=%d" % pesos[0]], None
+
+    if codigo in (ADD, MUL):
+        if sg.tensores[op.entradas[1]].forma != entrada.forma:
+            return None, "broadcast"
+        return ["in=%d" % entrada.bytes], None
+
+    if codigo == SOFTMAX:
+        filas = entrada.bytes // entrada.forma[-1]
+        return ["in=%dx%d" % (filas, entrada.forma[-1])], None
+
+    # RELU y RELU6: esp-nn sólo tiene relu6, que hace el mismo recorrido
+    return ["in=%d" % entrada.bytes], None
+
+
+def main():
+    p = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    p.add_argument("modelo")
+    p.add_argument("-o", "--salida", help="por defecto se escribe en la salida estándar")
+    args = p.parse_args()
+
+    modelo = tflite_fb.Modelo.leer(args.modelo)
+    sg = modelo.subgrafos[0]
+    base = os.path.splitext(os.path.basename(args.modelo))[0][:20]
+
+    lineas = ["# capas de %s" % os.path.basename(args.modelo)]
+    for i, op in enumerate(sg.operadores):
+        codigo = modelo.codigos_op[op.indice_codigo][0]
+        if codigo not in NOMBRES:
+            continue
+        params, motivo = linea(modelo, sg, op)
+        if params is None:
+            print("  operador %d (%s): %s, se deja afuera" % (i, NOMBRES[codigo], motivo), file=sys.stderr)
+            continue
+        lineas.append("%-10s %-24s %s" % (NOMBRES[codigo], "%s_%d" % (base, i), " ".join(params)))
+
+    texto = "\n".join(lineas) + "\n"
+    if args.salida:
+        with open(args.salida, "w") as f:
+            f.write(texto)
+        print("%s: %d capas" % (args.salida, len(lineas) - 1))
+    else:
+        sys.stdout.write(texto)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,214 @@
+#!/usr/bin/env python3
+"""Comprime los pesos de un modelo con paletas (LUT) para TFLite Micro.
+
+Cada canal de salida de los pesos int8 de FULLY_CONNECTED y CONV_2D se
+reduce a una paleta de 2^bits valores (k-means sobre el histograma del
+canal) y el tensor pasa a guardar sólo el índice de cada peso, empaquetado
+con `bits` bits (de 2 a 7). Las paletas van en un buffer nuevo y el
+metadato COMPRESSION_METADATA le dice a TFLM qué tensores están comprimidos;
+los kernels de esp-nn los descomprimen por bloques al ejecutar.
+
+Si un canal ya tiene 2^bits valores distintos o menos la compresión es sin
+pérdida. Si no, se informa el error máximo y el cuadrático medio (en pasos
+de cuantización) de cada tensor. Los tensores con copia dispersa
+(esparcir_modelo.py) se dejan igual.
+
+Uso: comprimir_modelo.py modelo.tflite [-o salida.tflite] [--bits N] [--min-bytes N]
+"""
+
+import argparse
+import math
+import os
+import struct
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import tflite_fb  # noqa: E402
+
+METADATO = "COMPRESSION_METADATA"
+METADATO_DISPERSO = "ESP_NN_SPARSE_WEIGHTS"
+TIPO_INT8 = 9
+OPS_CON_PESOS = {3: "CONV_2D", 9: "FULLY_CONNECTED"}
+ENTRADA_PESOS = 1
+
+# Esquema de tensorflow/lite/micro/compression/metadata.fbs
+ESQ_LUT_TENSOR = {0: ("s", "i"), 1: ("s", "I"), 2: ("s", "B")}
+ESQ_SUBGRAFO_LUT = {0: ("vt", ESQ_LUT_TENSOR)}
+ESQ_METADATA = {0: ("s", "i"), 1: ("vt", ESQ_SUBGRAFO_LUT)}
+VERSION_ESQUEMA = 1
+
+
+def paleta(valores, n):
+    """Hasta `n` centroides enteros para `valores` (k-means 1D sobre el histograma)."""
+    hist = {}
+    for v in valores:
+        hist[v] = hist.get(v, 0) + 1
+    distintos = sorted(hist)
+    if len(distintos) <= n:
+        return distintos
+
+    def cercano(v, centros):
+        return min(range(len(centros)), key=lambda j: abs(v - centros[j]))
+
+    def completar(centros):
+        # Si quedaron menos de n centros se suma el valor más lejano a todos
+        centros = set(centros)
+        while len(centros) < n:
+            centros.add(max(distintos, key=lambda v: min(abs(v - c) for c in centros)))
+        return sorted(centros)
+
+    # Arranca en los cuantiles y ajusta con Lloyd; con int8 converge en pocas vueltas
+    total = sum(hist.values())
+    centros = []
+    acumulado = 0
+    k = 0
+    for v in distintos:
+        acumulado += hist[v]
+        while k < n and acumulado >= (k + 0.5) * total / n:
+            centros.append(v)
+            k += 1
+    centros = completar(centros)
+
+    for _ in range(30):
+        sumas = [0] * n
+        cuentas = [0] * n
+        for v in distintos:
+            j = cercano(v, centros)
+            sumas[j] += v * hist[v]
+            cuentas[j] += hist[v]
+        nuevos = completar(int(round(s / c)) for s, c in zip(sumas, cuentas) if c)
+        if nuevos == centros:
+            break
+        centros = nuevos
+    return centros
+
+
+def empaquetar(indices, bits):
+    """Índices de `bits` bits, el más significativo primero (como decompress.cc)."""
+    salida = bytearray((len(indices) * bits + 7) // 8)
+    pos = 0
+    for i in indices:
+        for b in range(bits - 1, -1, -1):
+            if (i >> b) & 1:
+                salida[pos >> 3] |= 0x80 >> (pos & 7)
+            pos += 1
+    return bytes(salida)
+
+
+def comprimir_tensor(pesos, forma, eje, bits):
+    """Devuelve (índices empaquetados, tabla de valores, error máximo, error cuadrático medio)."""
+    n = 1 << bits
+    if eje is None:
+        canales = [pesos]
+    elif eje == 0:
+        por_canal = len(pesos) // forma[0]
+        canales = [pesos[c * por_canal:(c + 1) * por_canal] for c in range(forma[0])]
+    else:  # último eje
+        canales = [pesos[c::forma[-1]] for c in range(forma[-1])]
+
+    tabla = bytearray()
+    mapas = []
+    for valores in canales:
+        centros = paleta(valores, n)
+        tabla += struct.pack("<%db" % n, *(centros + [0] * (n - len(centros))))
+        mapas.append({v: min(range(len(centros)), key=lambda j: abs(v - centros[j])) for v in set(valores)})
+
+    indices = []
+    error_max = 0
+    error_cuad = 0
+    for i, v in enumerate(pesos):
+        if eje is None:
+            c = 0
+        elif eje == 0:
+            c = i // (len(pesos) // forma[0])
+        else:
+            c = i % forma[-1]
+        j = mapas[c][v]
+        indices.append(j)
+        e = abs(v - struct.unpack_from("<b", tabla, c * n + j)[0])
+        error_max = max(error_max, e)
+        error_cuad += e * e
+    return empaquetar(indices, bits), bytes(tabla), error_max, math.sqrt(error_cuad / len(pesos))
+
+
+def main():
+    p = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    p.add_argument("modelo")
+    p.add_argument("-o", "--salida", help="por defecto se reescribe el modelo")
+    p.add_argument("--bits", type=int, default=4, choices=range(2, 8),
+                   help="bits por índice (2 a 7, por defecto 4)")
+    p.add_argument("--min-bytes", type=int, default=1024,
+                   help="no comprimir tensores más chicos (por defecto 1024)")
+    args = p.parse_args()
+
+    with open(args.modelo, "rb") as f:
+        datos = f.read()
+    modelo = tflite_fb.Modelo(datos)
+    if modelo.metadato(METADATO) is not None:
+        sys.exit("%s ya está comprimido" % args.modelo)
+
+    # Los kernels usan la copia dispersa, que tiene que seguir igual a los pesos densos
+    dispersos = set()
+    if modelo.metadato(METADATO_DISPERSO) is not None:
+        import esparcir_modelo
+        dispersos = {(e[0], e[1]) for e in esparcir_modelo.leer_entradas(modelo.metadato(METADATO_DISPERSO))}
+
+    arbol = tflite_fb.decodificar(datos)
+    buffers = arbol[4]
+    subgrafos_lut = []
+    antes = despues = 0
+
+    for s, sg in enumerate(modelo.subgrafos):
+        # Los buffers compartidos entre tensores no se tocan
+        usos = {}
+        for t in sg.tensores:
+            usos[t.buffer] = usos.get(t.buffer, 0) + 1
+
+        candidatos = sorted({op.entradas[ENTRADA_PESOS] for op in sg.operadores
+                             if modelo.codigos_op[op.indice_codigo][0] in OPS_CON_PESOS})
+        luts = []
+        for i in candidatos:
+            t = sg.tensores[i]
+            pesos = modelo.buffers[t.buffer]
+            if t.tipo != TIPO_INT8 or len(pesos) < args.min_bytes or usos[t.buffer] != 1:
+                continue
+            if (s, i) in dispersos:
+                print("  %s: tiene copia dispersa, se deja igual" % t.nombre[:48])
+                continue
+            eje = None
+            if len(t.escala) > 1:
+                eje = t.dimension_cuantizada
+                if eje not in (0, len(t.forma) - 1):
+                    print("  %s: eje de cuantización %d no soportado, se deja igual" % (t.nombre, eje))
+                    continue
+
+            valores = list(struct.unpack("<%db" % len(pesos), pesos))
+            indices, tabla, error_max, error_rms = comprimir_tensor(valores, t.forma, eje, args.bits)
+            if len(indices) + len(tabla) >= len(pesos):
+                print("  %s: con %d bits no se achica, se deja igual" % (t.nombre[:48], args.bits))
+                continue
+            buffers[t.buffer][0] = indices
+            buffers.append(tflite_fb.Nodo(tflite_fb.ESQ_BUFFER, {0: tabla}))
+            luts.append(tflite_fb.Nodo(ESQ_LUT_TENSOR, {0: i, 1: len(buffers) - 1, 2: args.bits}))
+
+            antes += len(pesos)
+            despues += len(indices) + len(tabla)
+            print("  %s: %d -> %d bytes, error máx %d, rms %.2f" % (
+                t.nombre[:48], len(pesos), len(indices) + len(tabla), error_max, error_rms))
+        subgrafos_lut.append(tflite_fb.Nodo(ESQ_SUBGRAFO_LUT, {0: luts}))
+
+    if not despues:
+        sys.exit("No hay pesos para comprimir")
+
+    metadatos = tflite_fb.Nodo(ESQ_METADATA, {0: VERSION_ESQUEMA, 1: subgrafos_lut})
+    tflite_fb.poner_metadato(arbol, METADATO, tflite_fb.codificar_tabla(metadatos))
+    salida = tflite_fb.codificar(arbol)
+    with open(args.salida or args.modelo, "wb") as f:
+        f.write(salida)
+
+    print("%s: pesos %d -> %d bytes, modelo %d -> %d bytes (%d bits)" % (
+        os.path.basename(args.modelo), antes, despues, len(datos), len(salida), args.bits))
+
+
+if __name__ == "__main__":
+    main()
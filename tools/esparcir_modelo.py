@@ -0,0 +1,182 @@
+#!/usr/bin/env python3
+"""Agrega copias dispersas por bloques de los pesos de un modelo para esp-nn.
+
+Cada fila de los pesos int8 de FULLY_CONNECTED (un canal de salida) y de
+CONV_2D (un filtro, recorrido en orden alto, ancho, canal) se parte en
+bloques de `--bloque` pesos consecutivos. La copia dispersa guarda un mapa
+de bits con los bloques que tienen algún peso distinto de cero y sólo esos
+bloques; el metadato ESP_NN_SPARSE_WEIGHTS le dice a TFLM qué tensores la
+tienen y los kernels de esp-nn saltean los bloques nulos. Los pesos densos
+quedan en el modelo para las capas que no pueden usar la copia.
+
+Sólo conviene con muchos bloques nulos: por debajo de `--min-ceros` el
+tensor se deja igual. `--podar` anula además, en cada tensor, los bloques de
+menor norma L1 hasta llegar a ese porcentaje (en la copia y en los pesos
+densos) e informa el error; la precisión hay que comprobarla después.
+
+Los pesos tienen que tener punto cero 0 y, en CONV_2D, los canales de
+entrada tienen que ser múltiplo del bloque. Un modelo se esparce antes de
+comprimirlo: comprimir_modelo.py deja igual los tensores con copia dispersa.
+
+Uso: esparcir_modelo.py modelo.tflite [-o salida.tflite] [--bloque N] [--min-ceros PORC] [--podar PORC]
+"""
+
+import argparse
+import os
+import struct
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import tflite_fb  # noqa: E402
+
+METADATO = "ESP_NN_SPARSE_WEIGHTS"
+METADATO_COMPRESION = "COMPRESSION_METADATA"
+VERSION = 1
+TIPO_INT8 = 9
+OPS_CON_PESOS = {3: "CONV_2D", 9: "FULLY_CONNECTED"}
+ENTRADA_PESOS = 1
+
+
+def leer_entradas(contenido):
+    """Entradas (subgrafo, tensor, buffer, bloque) de un metadato ESP_NN_SPARSE_WEIGHTS."""
+    version, n = struct.unpack_from("<II", contenido, 0)
+    if version != VERSION:
+        raise ValueError("versión %d de %s no soportada" % (version, METADATO))
+    return [struct.unpack_from("<IIII", contenido, 8 + 16 * j) for j in range(n)]
+
+
+def bloques_de(pesos, filas, largo, bloque):
+    """Lista por fila de (inicio, fin) de cada bloque; el último de la fila puede ser más corto."""
+    return [[(f * largo + b, f * largo + min(b + bloque, largo)) for b in range(0, largo, bloque)]
+            for f in range(filas)]
+
+
+def podar(pesos, filas, largo, bloque, porcentaje):
+    """Anula los bloques de menor norma L1 hasta tener `porcentaje` de bloques nulos.
+
+    Devuelve (bloques anulados, error máximo, fracción de la norma L1 quitada).
+    """
+    todos = [b for fila in bloques_de(pesos, filas, largo, bloque) for b in fila]
+    normas = sorted((sum(abs(v) for v in pesos[i:j]), i, j) for i, j in todos)
+    objetivo = (len(todos) * porcentaje + 99) // 100
+    total = sum(abs(v) for v in pesos) or 1
+    anulados = error_max = quitado = 0
+    for norma, i, j in normas[:objetivo]:
+        if norma == 0:
+            continue
+        error_max = max([error_max] + [abs(v) for v in pesos[i:j]])
+        quitado += norma
+        pesos[i:j] = [0] * (j - i)
+        anulados += 1
+    return anulados, error_max, quitado / total
+
+
+def esparcir(pesos, filas, largo, bloque):
+    """Mapa de bits y bloques no nulos, como esp_nn_sparse_filter_encode."""
+    bytes_fila = ((largo + bloque - 1) // bloque + 7) // 8
+    mapa = bytearray(filas * bytes_fila)
+    valores = bytearray()
+    for f, fila in enumerate(bloques_de(pesos, filas, largo, bloque)):
+        for b, (i, j) in enumerate(fila):
+            if not any(pesos[i:j]):
+                continue
+            mapa[f * bytes_fila + b // 8] |= 1 << (b % 8)
+            valores += struct.pack("<%db" % (j - i), *pesos[i:j]) + bytes(bloque - (j - i))
+    return bytes(mapa), bytes(valores)
+
+
+def main():
+    p = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    p.add_argument("modelo")
+    p.add_argument("-o", "--salida", help="por defecto se reescribe el modelo")
+    p.add_argument("--bloque", type=int, default=8, choices=(4, 8),
+                   help="pesos por bloque (4 u 8, por defecto 8)")
+    p.add_argument("--min-ceros", type=int, default=60,
+                   help="porcentaje mínimo de bloques nulos para esparcir un tensor (por defecto 60)")
+    p.add_argument("--podar", type=int, default=0,
+                   help="anular bloques de menor norma hasta este porcentaje (por defecto 0, no poda)")
+    p.add_argument("--min-bytes", type=int, default=1024,
+                   help="no esparcir tensores más chicos (por defecto 1024)")
+    args = p.parse_args()
+    if not 0 <= args.podar < 100 or not 0 <= args.min_ceros <= 100:
+        sys.exit("--podar y --min-ceros son porcentajes")
+
+    with open(args.modelo, "rb") as f:
+        datos = f.read()
+    modelo = tflite_fb.Modelo(datos)
+    if modelo.metadato(METADATO) is not None:
+        sys.exit("%s ya está esparcido" % args.modelo)
+    if modelo.metadato(METADATO_COMPRESION) is not None:
+        sys.exit("%s está comprimido; hay que esparcirlo antes de comprimirlo" % args.modelo)
+
+    arbol = tflite_fb.decodificar(datos)
+    buffers = arbol[4]
+    entradas = []
+    densos = dispersos = 0
+
+    for s, sg in enumerate(modelo.subgrafos):
+        # Los buffers compartidos entre tensores no se tocan
+        usos = {}
+        for t in sg.tensores:
+            usos[t.buffer] = usos.get(t.buffer, 0) + 1
+
+        candidatos = {}
+        for op in sg.operadores:
+            codigo = modelo.codigos_op[op.indice_codigo][0]
+            if codigo in OPS_CON_PESOS:
+                candidatos[op.entradas[ENTRADA_PESOS]] = codigo
+        for i in sorted(candidatos):
+            t = sg.tensores[i]
+            pesos = modelo.buffers[t.buffer]
+            if t.tipo != TIPO_INT8 or len(pesos) < args.min_bytes or usos[t.buffer] != 1 \
+                    or len(t.forma) < 2 or any(t.punto_cero):
+                continue
+            if OPS_CON_PESOS[candidatos[i]] == "CONV_2D" and t.forma[-1] % args.bloque:
+                print("  %s: %d canales de entrada no son múltiplo de %d, se deja igual" % (
+                    t.nombre[:48], t.forma[-1], args.bloque))
+                continue
+
+            filas = t.forma[0]
+            largo = len(pesos) // filas
+            valores = list(struct.unpack("<%db" % len(pesos), pesos))
+            nota = ""
+            if args.podar:
+                anulados, error_max, quitado = podar(valores, filas, largo, args.bloque, args.podar)
+                if anulados:
+                    nota = ", %d bloques podados (error máx %d, %.1f%% de la norma)" % (
+                        anulados, error_max, 100 * quitado)
+
+            mapa, no_nulos = esparcir(valores, filas, largo, args.bloque)
+            total = filas * ((largo + args.bloque - 1) // args.bloque)
+            nulos = 100 * (total - len(no_nulos) // args.bloque) / total
+            if nulos < args.min_ceros:
+                print("  %s: %.0f%% de bloques nulos, se deja igual" % (t.nombre[:48], nulos))
+                continue
+
+            if args.podar:
+                buffers[t.buffer][0] = struct.pack("<%db" % len(valores), *valores)
+            buffers.append(tflite_fb.Nodo(tflite_fb.ESQ_BUFFER, {0: mapa + no_nulos}))
+            entradas.append((s, i, len(buffers) - 1, args.bloque))
+
+            densos += len(pesos)
+            dispersos += len(mapa) + len(no_nulos)
+            print("  %s: %.0f%% de bloques nulos, %d -> %d bytes%s" % (
+                t.nombre[:48], nulos, len(pesos), len(mapa) + len(no_nulos), nota))
+
+    if not entradas:
+        sys.exit("No hay pesos para esparcir")
+
+    contenido = struct.pack("<II", VERSION, len(entradas))
+    contenido += b"".join(struct.pack("<IIII", *e) for e in entradas)
+    tflite_fb.poner_metadato(arbol, METADATO, contenido)
+    salida = tflite_fb.codificar(arbol)
+    with open(args.salida or args.modelo, "wb") as f:
+        f.write(salida)
+
+    print("%s: %d tensores, pesos %d -> %d bytes dispersos, modelo %d -> %d bytes (bloques de %d)" % (
+        os.path.basename(args.modelo), len(entradas), densos, dispersos, len(datos), len(salida),
+        args.bloque))
+
+
+if __name__ == "__main__":
+    main()
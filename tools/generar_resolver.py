@@ -0,0 +1,189 @@
+#!/usr/bin/env python3
+"""Genera un op resolver de TFLite Micro con exactamente las operaciones de los modelos.
+
+Lee los .tflite indicados, junta sus operaciones builtin y escribe un header
+con la clase ResolverModelos: una tabla constexpr con hash perfecto
+(código % kTamTabla) que lleva de cada operación a su registro y su parser.
+Los registros y parsers se toman de micro_mutable_op_resolver.h del
+componente esp-tflite-micro, así que son los mismos que usaría AddX()
+(con los kernels de esp-nn cuando están habilitados).
+
+Con --ops se agregan operaciones que no están en los modelos de la imagen
+pero pueden llegar por OTA (p. ej. las de un modelo streaming).
+
+Uso: generar_resolver.py --tflm <dir esp-tflite-micro> [--ops OP ...] --salida resolver_modelos.h modelo1.tflite [...]
+"""
+
+import argparse
+import os
+import re
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import tflite_fb  # noqa: E402
+
+CODIGO_CUSTOM = 32
+
+
+def leer_enum(esquema):
+    """BuiltinOperator_X = N en schema_generated.h -> {N: 'X'}."""
+    with open(esquema) as f:
+        texto = f.read()
+    return {int(v): n for n, v in re.findall(r"^\s*BuiltinOperator_(\w+) = (\d+),", texto, re.M)}
+
+
+def leer_registros(resolver):
+    """Para cada AddX() de MicroMutableOpResolver: operación -> (registro, parser)."""
+    with open(resolver) as f:
+        texto = f.read()
+    registros = {}
+    patron = r"TfLiteStatus Add\w+\(([^)]*(?:\(\))?[^)]*)\)\s*\{\s*return AddBuiltin\(\s*BuiltinOperator_(\w+),\s*([^,]+?),\s*(\w+)\)"
+    for argumentos, op, registro, parser in re.findall(patron, texto, re.S):
+        registro = " ".join(registro.split())
+        if registro == "registration":  # Registro por defecto del parámetro
+            registro = re.search(r"=\s*(.*)$", " ".join(argumentos.split())).group(1)
+        if not registro.startswith("tflite::"):
+            registro = "tflite::" + registro
+        registros[op] = (registro, "tflite::" + parser)
+    return registros
+
+
+def tabla_perfecta(codigos):
+    """Menor módulo con el que `codigo % m` no choca para ningún código."""
+    m = len(codigos)
+    while len({c % m for c in codigos}) != len(codigos):
+        m += 1
+    tabla = [-1] * m
+    for i, c in enumerate(codigos):
+        tabla[c % m] = i
+    return m, tabla
+
+
+def generar(modelos, nombres_op, registros, extra=()):
+    codigos_por_nombre = {n: c for c, n in nombres_op.items()}
+    desconocidas = [n for n in extra if n not in codigos_por_nombre]
+    if desconocidas:
+        sys.exit("Operaciones desconocidas: " + ", ".join(desconocidas))
+    codigos = {codigos_por_nombre[n] for n in extra}
+    for ruta in modelos:
+        modelo = tflite_fb.Modelo.leer(ruta)
+        for codigo, custom in modelo.codigos_op:
+            if codigo == CODIGO_CUSTOM:
+                sys.exit("%s: la operación custom '%s' no está soportada" % (ruta, custom))
+            codigos.add(codigo)
+
+    codigos = sorted(codigos)
+    faltan = [nombres_op.get(c, str(c)) for c in codigos if nombres_op.get(c) not in registros]
+    if faltan:
+        sys.exit("Operaciones sin registro en TFLite Micro: " + ", ".join(faltan))
+
+    m, tabla = tabla_perfecta(codigos)
+    ops = [nombres_op[c] for c in codigos]
+    lineas = [
+        "// Generado por tools/generar_resolver.py a partir de:",
+    ]
+    lineas += ["//   %s" % os.path.basename(r) for r in modelos]
+    if extra:
+        lineas += ["// y las operaciones extra: %s" % " ".join(extra)]
+    lineas += [
+        "// No editar: se regenera al compilar cuando cambian los modelos.",
+        "",
+        "#pragma once",
+        "",
+        "#include <stdint.h>",
+        "",
+        '#include "tensorflow/lite/core/api/flatbuffer_conversions.h"',
+        '#include "tensorflow/lite/micro/kernels/micro_ops.h"',
+        '#include "tensorflow/lite/micro/micro_op_resolver.h"',
+        "",
+        "namespace resolver_modelos {",
+        "",
+        "constexpr int kNumOps = %d;" % len(ops),
+        "constexpr int kTamTabla = %d;" % m,
+        "",
+        "constexpr tflite::BuiltinOperator kOps[kNumOps] = {",
+    ]
+    lineas += ["    tflite::BuiltinOperator_%s," % op for op in ops]
+    lineas += [
+        "};",
+        "",
+        "// código % kTamTabla -> índice en kOps (-1 si ninguna operación cae ahí)",
+        "constexpr int8_t kTabla[kTamTabla] = { %s };" % ", ".join(str(i) for i in tabla),
+        "",
+        "constexpr tflite::TfLiteBridgeBuiltinParseFunction kParsers[kNumOps] = {",
+    ]
+    lineas += ["    %s," % registros[op][1] for op in ops]
+    lineas += [
+        "};",
+        "",
+        "constexpr int indice(tflite::BuiltinOperator op) {",
+        "    return kTabla[static_cast<uint32_t>(op) % kTamTabla] >= 0 &&",
+        "           kOps[kTabla[static_cast<uint32_t>(op) % kTamTabla]] == op",
+        "               ? kTabla[static_cast<uint32_t>(op) % kTamTabla] : -1;",
+        "}",
+        "",
+        "// El hash es perfecto: cada operación se encuentra a sí misma",
+        "constexpr bool tabla_valida(int i = 0) {",
+        "    return i == kNumOps || (indice(kOps[i]) == i && tabla_valida(i + 1));",
+        "}",
+        "static_assert(tabla_valida(), \"colisión en la tabla de operaciones\");",
+        "",
+        "}  // namespace resolver_modelos",
+        "",
+        "class ResolverModelos : public tflite::MicroOpResolver {",
+        " public:",
+        "    ResolverModelos() : registros_{",
+    ]
+    lineas += ["        %s," % registros[op][0] for op in ops]
+    lineas += [
+        "    } {",
+        "        for (int i = 0; i < resolver_modelos::kNumOps; i++) {",
+        "            registros_[i].builtin_code = resolver_modelos::kOps[i];",
+        "        }",
+        "    }",
+        "",
+        "    const TFLMRegistration* FindOp(tflite::BuiltinOperator op) const override {",
+        "        int i = resolver_modelos::indice(op);",
+        "        return i >= 0 ? &registros_[i] : nullptr;",
+        "    }",
+        "",
+        "    const TFLMRegistration* FindOp(const char* /*op*/) const override {",
+        "        return nullptr;  // Los modelos no usan operaciones custom",
+        "    }",
+        "",
+        "    tflite::TfLiteBridgeBuiltinParseFunction GetOpDataParser(tflite::BuiltinOperator op) const override {",
+        "        int i = resolver_modelos::indice(op);",
+        "        return i >= 0 ? resolver_modelos::kParsers[i] : nullptr;",
+        "    }",
+        "",
+        " private:",
+        "    TFLMRegistration registros_[resolver_modelos::kNumOps];",
+        "};",
+        "",
+    ]
+    return "\n".join(lineas)
+
+
+def main():
+    p = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    p.add_argument("--tflm", required=True, help="directorio del componente esp-tflite-micro")
+    p.add_argument("--salida", required=True, help="header a generar")
+    p.add_argument("--ops", nargs="*", default=[], help="operaciones extra (nombres de BuiltinOperator)")
+    p.add_argument("modelos", nargs="+", help="modelos .tflite")
+    args = p.parse_args()
+
+    nombres_op = leer_enum(os.path.join(args.tflm, "tensorflow/lite/schema/schema_generated.h"))
+    registros = leer_registros(os.path.join(args.tflm, "tensorflow/lite/micro/micro_mutable_op_resolver.h"))
+    texto = generar(args.modelos, nombres_op, registros, args.ops)
+
+    # Sólo se reescribe si cambia, para no recompilar de más
+    if os.path.exists(args.salida):
+        with open(args.salida) as f:
+            if f.read() == texto:
+                return
+    with open(args.salida, "w") as f:
+        f.write(texto)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,249 @@
+#!/usr/bin/env python3
+"""Convierte las primeras convoluciones de un modelo en convoluciones con estado (streaming).
+
+Con ventanas que se solapan, cada Invoke() vuelve a calcular las
+convoluciones y poolings sobre frames que ya procesó. El modelo convertido
+recibe sólo los `salto` frames nuevos: antes de cada CONV_2D de la cadena
+inicial se agregan las últimas filas de su entrada anterior (guardadas en
+variables de recurso de TFLM: VAR_HANDLE, READ_VARIABLE, ASSIGN_VARIABLE) y
+al final de la cadena se arma la ventana completa que espera el resto del
+modelo (RESHAPE, FULLY_CONNECTED...), que no cambia.
+
+La cadena es la sucesión de CONV_2D (padding VALID, paso 1 y sin dilatación
+en el tiempo) y MAX/AVERAGE_POOL_2D (VALID, ventana igual al paso en el
+tiempo) que empieza en la entrada [1, frames, ancho, canales]. `salto` tiene
+que ser múltiplo del producto de los pasos de los poolings.
+
+El resultado de cada Invoke() es el del modelo original sobre la ventana que
+termina en el último frame recibido; las variables arrancan en el punto cero
+(silencio), así que las primeras ventanas mezclan ceros.
+
+El firmware reconoce el modelo por el metadato "Streaming" (versión 0,
+frames por salto, frames de la ventana original). Si el modelo tenía plan de
+memoria offline se descarta: hay que volver a correr planificar_memoria.py.
+
+Uso: modelo_streaming.py modelo.tflite --salto N [-o salida.tflite]
+"""
+
+import argparse
+import os
+import struct
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import tflite_fb  # noqa: E402
+from tflite_fb import Nodo  # noqa: E402
+
+METADATO = "Streaming"
+METADATO_PLAN = "OfflineMemoryAllocation"
+
+# BuiltinOperator
+AVERAGE_POOL_2D = 1
+CONCATENATION = 2
+CONV_2D = 3
+MAX_POOL_2D = 17
+SLICE = 65
+VAR_HANDLE = 142
+READ_VARIABLE = 143
+ASSIGN_VARIABLE = 144
+
+# BuiltinOptions
+OPCIONES_CONCATENATION = 10
+OPCIONES_VAR_HANDLE = 111
+ESQ_CONCATENATION = {0: ("s", "i"), 1: ("s", "b")}
+ESQ_VAR_HANDLE = {0: ("str",), 1: ("str",)}
+
+TIPO_INT32 = 2
+TIPO_INT8 = 9
+TIPO_RESOURCE = 13
+PADDING_VALID = 1
+
+
+def cadena_inicial(modelo, salto):
+    """[(operador, filas de estado, filas de salida por salto)], tensor final y su alto original."""
+    sg = modelo.subgrafos[0]
+    consumidores = {}
+    for i, op in enumerate(sg.operadores):
+        for t in op.entradas:
+            consumidores.setdefault(t, []).append(i)
+
+    actual = sg.entradas[0]
+    filas = salto
+    capas = []
+    while len(consumidores.get(actual, [])) == 1 and actual not in sg.salidas:
+        i = consumidores[actual][0]
+        op = sg.operadores[i]
+        codigo = modelo.codigos_op[op.indice_codigo][0]
+        o = op.opciones
+        if codigo == CONV_2D and op.entradas[0] == actual:
+            alto = sg.tensores[op.entradas[1]].forma[1]
+            if o.escalar(0, "b") != PADDING_VALID or o.escalar(2, "i") != 1 or o.escalar(5, "i", 1) != 1:
+                break
+            capas.append((i, alto - 1, filas))
+        elif codigo in (MAX_POOL_2D, AVERAGE_POOL_2D):
+            paso = o.escalar(2, "i")
+            if o.escalar(0, "b") != PADDING_VALID or o.escalar(4, "i") != paso:
+                break
+            if filas % paso:
+                sys.exit("El salto tiene que ser múltiplo de %d (paso de los poolings)" % (salto // filas * paso))
+            filas //= paso
+            capas.append((i, 0, filas))
+        else:
+            break
+        actual = op.salidas[0]
+
+    if not any(estado for _, estado, _ in capas):
+        sys.exit("El modelo no empieza con convoluciones que se puedan hacer streaming")
+    alto_final = sg.tensores[actual].forma[1]
+    if filas > alto_final:
+        sys.exit("El salto es más largo que la ventana")
+    return capas, actual, alto_final
+
+
+class Conversor:
+    def __init__(self, arbol):
+        self.arbol = arbol
+        self.sg = arbol[2][0]
+        self.variables = 0
+
+    def codigo_op(self, builtin):
+        codigos = self.arbol.campos.setdefault(1, [])
+        for i, c in enumerate(codigos):
+            if (c[3] if c[3] is not None else c[0]) == builtin:
+                return i
+        codigos.append(Nodo(tflite_fb.ESQ_OPERATOR_CODE, {0: min(builtin, 127), 2: 1, 3: builtin}))
+        return len(codigos) - 1
+
+    def tensor(self, nombre, forma, tipo, cuantizacion=None, datos=None):
+        t = Nodo(tflite_fb.ESQ_TENSOR, {0: forma, 1: tipo, 2: 0, 3: nombre})
+        if cuantizacion is not None:
+            t[4] = Nodo(tflite_fb.ESQ_QUANTIZACION, dict(cuantizacion.campos))
+        if datos is not None:
+            buffers = self.arbol[4]
+            buffers.append(Nodo(tflite_fb.ESQ_BUFFER, {0: datos}))
+            t[2] = len(buffers) - 1
+        self.sg[0].append(t)
+        return len(self.sg[0]) - 1
+
+    def op(self, builtin, entradas, salidas, tipo_opciones=None, opciones=None):
+        o = Nodo(tflite_fb.ESQ_OPERATOR, {0: self.codigo_op(builtin), 1: entradas, 2: salidas})
+        if opciones is not None:
+            o[3] = tipo_opciones
+            o[4] = opciones
+        return o
+
+    def cambiar_filas(self, t, filas):
+        nodo = self.sg[0][t]
+        nodo[0] = [nodo[0][0], filas] + list(nodo[0][2:])
+        nodo.campos.pop(7, None)  # shape_signature
+
+    def con_estado(self, ops, entrada, estado, ventana=None):
+        """Agrega a `ops` lo que antepone a `entrada` sus `estado` filas anteriores.
+
+        Devuelve la ventana resultante (`ventana` si se indica, si no un tensor nuevo).
+        """
+        e = self.sg[0][entrada]
+        lote, filas = e[0][0], e[0][1]
+        resto = list(e[0][2:])
+        forma_estado = [lote, estado] + resto
+        k = self.variables
+        self.variables += 1
+
+        nombre = "streaming/estado%d" % k
+        recurso = self.tensor(nombre + "/recurso", [], TIPO_RESOURCE)
+        anterior = self.tensor(nombre, forma_estado, e[1], e[4])
+        siguiente = self.tensor(nombre + "/siguiente", forma_estado, e[1], e[4])
+        if ventana is None:
+            ventana = self.tensor("streaming/ventana%d" % k, [lote, filas + estado] + resto, e[1], e[4])
+        inicio = self.tensor(nombre + "/inicio", [4], TIPO_INT32, datos=struct.pack("<4i", 0, filas, 0, 0))
+        tam = self.tensor(nombre + "/tam", [4], TIPO_INT32, datos=struct.pack("<4i", *forma_estado))
+
+        ops += [
+            self.op(VAR_HANDLE, [], [recurso], OPCIONES_VAR_HANDLE,
+                    Nodo(ESQ_VAR_HANDLE, {0: "", 1: "streaming_estado%d" % k})),
+            self.op(READ_VARIABLE, [recurso], [anterior]),
+            self.op(CONCATENATION, [anterior, entrada], [ventana], OPCIONES_CONCATENATION,
+                    Nodo(ESQ_CONCATENATION, {0: 1, 1: 0})),
+            self.op(SLICE, [ventana, inicio, tam], [siguiente]),
+            self.op(ASSIGN_VARIABLE, [recurso, siguiente], []),
+        ]
+        return ventana
+
+    def convertir(self, capas, fin, alto_final, salto):
+        self.cambiar_filas(self.sg[1][0], salto)
+        por_op = {i: (estado, filas) for i, estado, filas in capas}
+        ultimo = capas[-1][0]
+        ops = []
+        for i, op in enumerate(self.sg[3]):
+            if i not in por_op:
+                ops.append(op)
+                continue
+            estado, filas = por_op[i]
+            if estado:
+                op[1] = [self.con_estado(ops, op[1][0], estado)] + list(op[1][1:])
+            ops.append(op)
+
+            if i != ultimo:
+                self.cambiar_filas(op[2][0], filas)
+            elif filas < alto_final:
+                # El resto del modelo sigue viendo la ventana completa en `fin`
+                original = self.sg[0][fin]
+                salida = self.tensor(original[3] + "/salto", list(original[0]), original[1], original[4])
+                self.cambiar_filas(salida, filas)
+                op[2] = [salida]
+                self.con_estado(ops, salida, alto_final - filas, ventana=fin)
+        self.sg[3] = ops
+
+
+def main():
+    p = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    p.add_argument("modelo")
+    p.add_argument("--salto", type=int, required=True, help="frames nuevos por Invoke()")
+    p.add_argument("-o", "--salida", help="por defecto se reescribe el modelo")
+    args = p.parse_args()
+
+    with open(args.modelo, "rb") as f:
+        datos = f.read()
+    modelo = tflite_fb.Modelo(datos)
+    if modelo.metadato(METADATO) is not None:
+        sys.exit("%s ya es un modelo streaming" % args.modelo)
+    if len(modelo.subgrafos) != 1 or len(modelo.subgrafos[0].entradas) != 1:
+        sys.exit("Sólo se convierten modelos con un subgrafo y una entrada")
+    entrada = modelo.subgrafos[0].tensores[modelo.subgrafos[0].entradas[0]]
+    if len(entrada.forma) != 4 or entrada.forma[0] != 1 or entrada.tipo != TIPO_INT8:
+        sys.exit("La entrada tiene que ser int8 [1, frames, ancho, canales]")
+    ventana = entrada.forma[1]
+    if not 0 < args.salto < ventana:
+        sys.exit("El salto tiene que estar entre 1 y %d frames" % (ventana - 1))
+
+    capas, fin, alto_final = cadena_inicial(modelo, args.salto)
+
+    arbol = tflite_fb.decodificar(datos)
+    conversor = Conversor(arbol)
+    conversor.convertir(capas, fin, alto_final, args.salto)
+    tflite_fb.poner_metadato(arbol, METADATO, struct.pack("<3i", 0, args.salto, ventana))
+    if modelo.metadato(METADATO_PLAN) is not None:
+        arbol[6] = [m for m in arbol[6] if m[0] != METADATO_PLAN]
+        print("Se quitó el plan de memoria offline: volver a correr planificar_memoria.py")
+
+    with open(args.salida or args.modelo, "wb") as f:
+        f.write(tflite_fb.codificar(arbol))
+
+    # Costo por Invoke() de la parte convertida, en MACs, comparado con la ventana entera
+    sg = modelo.subgrafos[0]
+    antes = despues = 0
+    for i, estado, filas in capas:
+        op = sg.operadores[i]
+        if modelo.codigos_op[op.indice_codigo][0] != CONV_2D:
+            continue
+        pesos = sg.tensores[op.entradas[1]].forma
+        salida = sg.tensores[op.salidas[0]].forma
+        por_fila = salida[2] * pesos[0] * pesos[1] * pesos[2] * pesos[3]
+        antes += salida[1] * por_fila
+        despues += filas * por_fila
+    print("%s: salto de %d de %d frames, %d variables de estado, convoluciones %d -> %d MACs por Invoke()" % (
+        os.path.basename(args.modelo), args.salto, ventana, conversor.variables, antes, despues))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,155 @@
+#!/usr/bin/env python3
+"""Calcula offline el plan de memoria de un modelo y lo guarda en el .tflite.
+
+TFLite Micro busca el metadato "OfflineMemoryAllocation" (ver
+micro/docs/memory_management.md): [versión 0, subgrafo 0, N, offset de cada
+tensor...] con -1 para los que planifica en línea. Con el plan embebido
+AllocateTensors() ya no ejecuta el GreedyMemoryPlanner sobre los tensores
+(sólo sobre los buffers de trabajo que piden los kernels).
+
+Las vidas de los tensores se calculan igual que micro_allocation_info.cc. El
+plan parte del mismo heurístico que el greedy de TFLM (por tamaño, en el
+offset libre más bajo) y luego prueba órdenes de colocación con ramificación
+y poda hasta llegar a la cota inferior (el pico de memoria viva) o agotar el
+presupuesto de búsqueda; para modelos chicos el resultado es óptimo.
+
+Uso: planificar_memoria.py modelo.tflite [-o salida.tflite] [--presupuesto N]
+"""
+
+import argparse
+import os
+import struct
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import tflite_fb  # noqa: E402
+
+METADATO = "OfflineMemoryAllocation"
+ALINEACION = 16  # MicroArenaBufferAlignment()
+
+
+def alinear(n):
+    return (n + ALINEACION - 1) // ALINEACION * ALINEACION
+
+
+def vidas(modelo):
+    """Buffers a planificar: [(tensor, bytes alineados, primer uso, último uso)]."""
+    sg = modelo.subgrafos[0]
+    primero = {}
+    ultimo = {}
+
+    def crear(t, s):
+        if t not in primero or primero[t] > s:
+            primero[t] = s
+
+    def usar(t, s):
+        if ultimo.get(t, -1) < s:
+            ultimo[t] = s
+
+    s = 0
+    for t in sg.entradas:
+        crear(t, s)
+        usar(t, s)
+    for op in sg.operadores:
+        s += 1
+        for t in op.salidas:
+            crear(t, s)
+        for t in op.entradas:
+            if t >= 0:
+                usar(t, s)
+        for t in op.salidas:
+            usar(t, s)
+    for t in sg.salidas:
+        crear(t, s)
+        usar(t, s)
+
+    buffers = []
+    for i, t in enumerate(sg.tensores):
+        constante = len(modelo.buffers[t.buffer]) > 0
+        if constante or t.bytes == 0 or i not in primero:
+            continue
+        buffers.append((i, alinear(t.bytes), primero[i], ultimo[i]))
+    return buffers
+
+
+def se_pisan_en_tiempo(a, b):
+    return not (a[2] > b[3] or a[3] < b[2])
+
+
+def offset_mas_bajo(buf, colocados):
+    """Primer hueco donde entra `buf` sin pisar a los que viven a la vez."""
+    ocupados = sorted((o, o + b[1]) for b, o in colocados if se_pisan_en_tiempo(buf, b))
+    offset = 0
+    for ini, fin in ocupados:
+        if offset + buf[1] <= ini:
+            break
+        offset = max(offset, fin)
+    return offset
+
+
+def cota_inferior(buffers):
+    tiempos = {b[2] for b in buffers} | {b[3] for b in buffers}
+    return max((sum(b[1] for b in buffers if b[2] <= t <= b[3]) for t in tiempos), default=0)
+
+
+def planificar(buffers, presupuesto):
+    """Devuelve ({tensor: offset}, pico, pico_greedy, cota)."""
+    cota = cota_inferior(buffers)
+
+    # Heurístico de TFLM: de mayor a menor, en el offset libre más bajo
+    colocados = []
+    for b in sorted(buffers, key=lambda b: -b[1]):
+        colocados.append((b, offset_mas_bajo(b, colocados)))
+    pico_greedy = max((o + b[1] for b, o in colocados), default=0)
+    mejor = [pico_greedy, list(colocados)]
+    visitas = [0]
+
+    def buscar(restantes, colocados, pico):
+        if pico >= mejor[0] or visitas[0] >= presupuesto or mejor[0] == cota:
+            return
+        if not restantes:
+            mejor[0] = pico
+            mejor[1] = list(colocados)
+            return
+        for j, b in enumerate(restantes):
+            visitas[0] += 1
+            o = offset_mas_bajo(b, colocados)
+            colocados.append((b, o))
+            buscar(restantes[:j] + restantes[j + 1:], colocados, max(pico, o + b[1]))
+            colocados.pop()
+
+    buscar(sorted(buffers, key=lambda b: -b[1]), [], 0)
+    return {b[0]: o for b, o in mejor[1]}, mejor[0], pico_greedy, cota
+
+
+def main():
+    p = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    p.add_argument("modelo")
+    p.add_argument("-o", "--salida", help="por defecto se reescribe el modelo")
+    p.add_argument("--presupuesto", type=int, default=200000,
+                   help="colocaciones a probar en la búsqueda (por defecto 200000)")
+    args = p.parse_args()
+
+    with open(args.modelo, "rb") as f:
+        datos = f.read()
+    modelo = tflite_fb.Modelo(datos)
+    if len(modelo.subgrafos) != 1:
+        sys.exit("Sólo se planifican modelos con un subgrafo")
+
+    buffers = vidas(modelo)
+    offsets, pico, pico_greedy, cota = planificar(buffers, args.presupuesto)
+    n = len(modelo.subgrafos[0].tensores)
+    plan = [0, 0, n] + [offsets.get(i, -1) for i in range(n)]
+
+    arbol = tflite_fb.decodificar(datos)
+    tflite_fb.poner_metadato(arbol, METADATO, struct.pack("<%di" % len(plan), *plan))
+    with open(args.salida or args.modelo, "wb") as f:
+        f.write(tflite_fb.codificar(arbol))
+
+    print("%s: %d tensores planificados, pico %d bytes (greedy %d, cota inferior %d)%s" % (
+        os.path.basename(args.modelo), len(offsets), pico, pico_greedy, cota,
+        "" if pico == cota else " - no se probó que sea óptimo"))
+
+
+if __name__ == "__main__":
+    main()
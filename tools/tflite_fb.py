@@ -0,0 +1,352 @@
+"""Lectura de modelos .tflite (flatbuffer) sin dependencias externas.
+
+Sólo cubre las tablas del esquema de TFLite que usan las herramientas de
+este directorio: códigos de operación, subgrafos, tensores, operadores,
+buffers y metadatos. Los índices de campo siguen tensorflow/lite/schema/schema.fbs.
+"""
+
+import struct
+
+# Tipos de tensor (TensorType en schema.fbs) y su tamaño en bytes
+TIPOS = {0: ("float32", 4), 1: ("float16", 2), 2: ("int32", 4), 3: ("uint8", 1),
+         4: ("int64", 8), 7: ("int16", 2), 9: ("int8", 1), 10: ("float64", 8),
+         13: ("resource", 4)}
+
+
+class Tabla:
+    """Tabla de un flatbuffer: `pos` es la posición absoluta de la tabla."""
+
+    def __init__(self, datos, pos):
+        self.datos = datos
+        self.pos = pos
+        vtabla = pos - struct.unpack_from("<i", datos, pos)[0]
+        largo_vtabla = struct.unpack_from("<H", datos, vtabla)[0]
+        self.campos = [struct.unpack_from("<H", datos, vtabla + 4 + 2 * i)[0]
+                       for i in range((largo_vtabla - 4) // 2)]
+
+    def campo(self, i):
+        """Posición absoluta del campo `i`, o None si no está presente."""
+        if i < len(self.campos) and self.campos[i]:
+            return self.pos + self.campos[i]
+        return None
+
+    def escalar(self, i, formato, defecto=0):
+        p = self.campo(i)
+        return struct.unpack_from("<" + formato, self.datos, p)[0] if p is not None else defecto
+
+    def _ref(self, i):
+        p = self.campo(i)
+        return None if p is None else p + struct.unpack_from("<I", self.datos, p)[0]
+
+    def tabla(self, i):
+        p = self._ref(i)
+        return None if p is None else Tabla(self.datos, p)
+
+    def vector(self, i):
+        """(posición del primer elemento, cantidad) o (None, 0)."""
+        p = self._ref(i)
+        if p is None:
+            return None, 0
+        return p + 4, struct.unpack_from("<I", self.datos, p)[0]
+
+    def vector_escalar(self, i, formato):
+        p, n = self.vector(i)
+        tam = struct.calcsize("<" + formato)
+        return [struct.unpack_from("<" + formato, self.datos, p + tam * j)[0] for j in range(n)]
+
+    def vector_tablas(self, i):
+        p, n = self.vector(i)
+        return [Tabla(self.datos, p + 4 * j + struct.unpack_from("<I", self.datos, p + 4 * j)[0])
+                for j in range(n)]
+
+    def bytes(self, i):
+        p, n = self.vector(i)
+        return b"" if p is None else bytes(self.datos[p:p + n])
+
+    def cadena(self, i):
+        p = self._ref(i)
+        return None if p is None else self.bytes(i).decode()
+
+
+class Tensor:
+    def __init__(self, t):
+        self.forma = t.vector_escalar(0, "i")
+        self.tipo = t.escalar(1, "B")
+        self.buffer = t.escalar(2, "I")
+        self.nombre = t.cadena(3) or ""
+        q = t.tabla(4)
+        self.escala = q.vector_escalar(2, "f") if q else []
+        self.punto_cero = q.vector_escalar(3, "q") if q else []
+        self.dimension_cuantizada = q.escalar(6, "i") if q else 0
+
+    @property
+    def bytes(self):
+        n = 1
+        for d in self.forma:
+            n *= d
+        return n * TIPOS.get(self.tipo, ("?", 1))[1]
+
+
+class Operador:
+    def __init__(self, t):
+        self.indice_codigo = t.escalar(0, "I")
+        self.entradas = t.vector_escalar(1, "i")
+        self.salidas = t.vector_escalar(2, "i")
+        self.tipo_opciones = t.escalar(3, "B")
+        self.opciones = t.tabla(4)  # Tabla de BuiltinOptions según tipo_opciones, o None
+        self.intermedios = t.vector_escalar(8, "i")
+
+
+class Subgrafo:
+    def __init__(self, t):
+        self.tensores = [Tensor(x) for x in t.vector_tablas(0)]
+        self.entradas = t.vector_escalar(1, "i")
+        self.salidas = t.vector_escalar(2, "i")
+        self.operadores = [Operador(x) for x in t.vector_tablas(3)]
+        self.nombre = t.cadena(4) or ""
+
+
+class Modelo:
+    def __init__(self, datos):
+        if datos[4:8] != b"TFL3":
+            raise ValueError("no es un modelo TFLite (falta el identificador TFL3)")
+        self.datos = datos
+        raiz = Tabla(datos, struct.unpack_from("<I", datos, 0)[0])
+        self.raiz = raiz
+        self.version = raiz.escalar(0, "I")
+
+        # builtin_code (campo 3) reemplazó a deprecated_builtin_code (campo 0, int8);
+        # los conversores escriben los dos y el valor real es el mayor
+        self.codigos_op = []
+        for c in raiz.vector_tablas(1):
+            codigo = max(c.escalar(0, "b"), c.escalar(3, "i"))
+            self.codigos_op.append((codigo, c.cadena(1)))
+
+        self.subgrafos = [Subgrafo(x) for x in raiz.vector_tablas(2)]
+        self.buffers = [b.bytes(0) for b in raiz.vector_tablas(4)]
+        self.metadatos = {m.cadena(0): m.escalar(1, "I") for m in raiz.vector_tablas(6)}
+
+    @classmethod
+    def leer(cls, ruta):
+        with open(ruta, "rb") as f:
+            return cls(f.read())
+
+    def metadato(self, nombre):
+        """Contenido del buffer de metadatos `nombre`, o None."""
+        i = self.metadatos.get(nombre)
+        return None if i is None else self.buffers[i]
+
+
+# ---- Reescritura ----
+#
+# Para modificar un modelo se decodifica a un árbol de Nodo según la
+# descripción del esquema de abajo y se vuelve a serializar entero: así los
+# buffers que se reemplazan no dejan bytes huérfanos en el archivo.
+#
+# Tipos de campo:
+#   ("s", fmt)              escalar (formato de struct)
+#   ("str",)                cadena
+#   ("v", fmt)              vector de escalares
+#   ("b", alineación)       vector de bytes (Buffer.data exige 16)
+#   ("t", tabla)            tabla
+#   ("vt", tabla)           vector de tablas
+#   ("u", campo_tipo, {tipo: tabla})  unión; los tipos que no están en el
+#                           diccionario se copian en crudo (sólo escalares)
+
+OPCIONES_CON_VECTORES = {
+    3: {1: ("v", "i"), 2: ("v", "i")},      # ConcatEmbeddingsOptions
+    17: {0: ("v", "i")},                    # ReshapeOptions
+    30: {0: ("v", "i")},                    # SqueezeOptions
+    111: {0: ("str",), 1: ("str",)},        # VarHandleOptions
+    115: {0: ("v", "f")},                   # BucketizeOptions
+}
+
+ESQ_OPERATOR_CODE = {0: ("s", "b"), 1: ("str",), 2: ("s", "i"), 3: ("s", "i")}
+ESQ_QUANTIZACION = {0: ("v", "f"), 1: ("v", "f"), 2: ("v", "f"), 3: ("v", "q"), 6: ("s", "i")}
+ESQ_TENSOR = {0: ("v", "i"), 1: ("s", "B"), 2: ("s", "I"), 3: ("str",), 4: ("t", ESQ_QUANTIZACION),
+              5: ("s", "?"), 7: ("v", "i"), 8: ("s", "?")}
+ESQ_OPERATOR = {0: ("s", "I"), 1: ("v", "i"), 2: ("v", "i"), 3: ("s", "B"),
+                4: ("u", 3, OPCIONES_CON_VECTORES), 5: ("v", "B"), 6: ("s", "b"), 7: ("v", "?"),
+                8: ("v", "i"), 9: ("s", "Q"), 10: ("s", "Q"), 13: ("s", "i")}
+ESQ_SUBGRAFO = {0: ("vt", ESQ_TENSOR), 1: ("v", "i"), 2: ("v", "i"), 3: ("vt", ESQ_OPERATOR), 4: ("str",)}
+ESQ_BUFFER = {0: ("b", 16), 1: ("s", "Q"), 2: ("s", "Q")}
+ESQ_METADATO = {0: ("str",), 1: ("s", "I")}
+ESQ_TENSOR_MAP = {0: ("str",), 1: ("s", "I")}
+ESQ_FIRMA = {0: ("vt", ESQ_TENSOR_MAP), 1: ("vt", ESQ_TENSOR_MAP), 2: ("str",), 4: ("s", "I")}
+ESQ_MODELO = {0: ("s", "I"), 1: ("vt", ESQ_OPERATOR_CODE), 2: ("vt", ESQ_SUBGRAFO), 3: ("str",),
+              4: ("vt", ESQ_BUFFER), 5: ("v", "i"), 6: ("vt", ESQ_METADATO), 7: ("vt", ESQ_FIRMA)}
+
+
+class Nodo:
+    """Tabla decodificada: `campos` va de índice de campo a valor Python."""
+
+    def __init__(self, esquema, campos=None, crudo=None):
+        self.esquema = esquema
+        self.campos = campos if campos is not None else {}
+        self.crudo = crudo  # (desplazamientos de la vtable, bytes de la tabla, alineación) para copias en crudo
+
+    def __getitem__(self, i):
+        return self.campos.get(i)
+
+    def __setitem__(self, i, valor):
+        self.campos[i] = valor
+
+
+def _decodificar(t, esquema):
+    if esquema is None:
+        # Tabla sin campos de referencia: se copia tal cual
+        tam = struct.unpack_from("<H", t.datos, t.pos - struct.unpack_from("<i", t.datos, t.pos)[0] + 2)[0]
+        return Nodo(None, crudo=(list(t.campos), bytes(t.datos[t.pos:t.pos + tam]), t.pos % 8))
+
+    nodo = Nodo(esquema)
+    for i, desp in enumerate(t.campos):
+        if not desp:
+            continue
+        tipo = esquema.get(i)
+        if tipo is None:
+            raise ValueError("campo %d no soportado por tflite_fb" % i)
+        clase = tipo[0]
+        if clase == "s":
+            nodo[i] = t.escalar(i, tipo[1])
+        elif clase == "str":
+            nodo[i] = t.cadena(i)
+        elif clase == "v":
+            nodo[i] = t.vector_escalar(i, tipo[1])
+        elif clase == "b":
+            nodo[i] = t.bytes(i)
+        elif clase == "t":
+            nodo[i] = _decodificar(t.tabla(i), tipo[1])
+        elif clase == "vt":
+            nodo[i] = [_decodificar(x, tipo[1]) for x in t.vector_tablas(i)]
+        elif clase == "u":
+            nodo[i] = _decodificar(t.tabla(i), tipo[2].get(t.escalar(tipo[1], "B")))
+    return nodo
+
+
+def decodificar(datos):
+    """Árbol de Nodo del modelo completo."""
+    return _decodificar(Tabla(datos, struct.unpack_from("<I", datos, 0)[0]), ESQ_MODELO)
+
+
+class _Escritor:
+    """Serializa de adelante hacia atrás: cada hijo va después de quien lo referencia."""
+
+    def __init__(self):
+        self.b = bytearray()
+
+    def alinear(self, a, resto=0):
+        while (len(self.b) + resto) % a:
+            self.b.append(0)
+
+    def apuntar(self, campo, destino):
+        struct.pack_into("<I", self.b, campo, destino - campo)
+
+    def tabla(self, nodo, esquema_union=None):
+        if nodo.crudo is not None:
+            desps, cuerpo, mod8 = nodo.crudo
+            self.alinear(2)
+            vtabla = len(self.b)
+            self.b += struct.pack("<HH", 4 + 2 * len(desps), len(cuerpo))
+            self.b += b"".join(struct.pack("<H", d) for d in desps)
+            self.alinear(8, (8 - mod8) % 8)
+            pos = len(self.b)
+            self.b += cuerpo
+            struct.pack_into("<i", self.b, pos, pos - vtabla)
+            return pos
+
+        esquema = nodo.esquema
+        presentes = sorted(i for i in nodo.campos if nodo.campos[i] is not None)
+
+        # Tamaño en línea de cada campo: escalares por su formato, referencias 4 bytes
+        def tam(i):
+            tipo = esquema[i]
+            return struct.calcsize("<" + tipo[1]) if tipo[0] == "s" else 4
+
+        orden = sorted(presentes, key=lambda i: -tam(i))
+        desps = {}
+        d = 4
+        for i in orden:
+            d = (d + tam(i) - 1) // tam(i) * tam(i)
+            desps[i] = d
+            d += tam(i)
+        largo = d
+        alineacion = max([tam(i) for i in presentes] + [4])
+
+        num = (max(presentes) + 1) if presentes else 0
+        self.alinear(2)
+        vtabla = len(self.b)
+        self.b += struct.pack("<HH", 4 + 2 * num, largo)
+        self.b += b"".join(struct.pack("<H", desps.get(i, 0)) for i in range(num))
+        self.alinear(alineacion)
+        pos = len(self.b)
+        self.b += bytes(largo)
+        struct.pack_into("<i", self.b, pos, pos - vtabla)
+
+        for i in orden:
+            tipo = esquema[i]
+            if tipo[0] == "s":
+                struct.pack_into("<" + tipo[1], self.b, pos + desps[i], nodo.campos[i])
+        for i in orden:
+            tipo = esquema[i]
+            if tipo[0] != "s":
+                self.apuntar(pos + desps[i], self.valor(tipo, nodo.campos[i]))
+        return pos
+
+    def valor(self, tipo, v):
+        clase = tipo[0]
+        if clase == "str":
+            crudo = v.encode()
+            self.alinear(4)
+            pos = len(self.b)
+            self.b += struct.pack("<I", len(crudo)) + crudo + b"\0"
+            return pos
+        if clase in ("v", "b"):
+            if clase == "b":
+                elementos, a = bytes(v), tipo[1]
+            else:
+                elementos = b"".join(struct.pack("<" + tipo[1], x) for x in v)
+                a = struct.calcsize("<" + tipo[1])
+            self.alinear(max(a, 4), 4)
+            pos = len(self.b)
+            self.b += struct.pack("<I", len(v)) + elementos
+            return pos
+        if clase in ("t", "u"):
+            return self.tabla(v)
+        if clase == "vt":
+            self.alinear(4)
+            pos = len(self.b)
+            self.b += struct.pack("<I", len(v)) + bytes(4 * len(v))
+            for j, hijo in enumerate(v):
+                self.apuntar(pos + 4 + 4 * j, self.tabla(hijo))
+            return pos
+        raise ValueError(clase)
+
+
+def codificar(modelo):
+    """Bytes del modelo a partir de su árbol de Nodo."""
+    e = _Escritor()
+    e.b += bytes(4) + b"TFL3"
+    e.apuntar(0, e.tabla(modelo))
+    e.alinear(16)
+    return bytes(e.b)
+
+
+def codificar_tabla(nodo):
+    """Bytes de un flatbuffer sin identificador cuya raíz es `nodo` (p. ej. un metadato)."""
+    e = _Escritor()
+    e.b += bytes(4)
+    e.apuntar(0, e.tabla(nodo))
+    e.alinear(4)
+    return bytes(e.b)
+
+
+def poner_metadato(modelo, nombre, contenido):
+    """Agrega (o reemplaza) el metadato `nombre` con su propio buffer."""
+    buffers = modelo.campos.setdefault(4, [])
+    metadatos = modelo.campos.setdefault(6, [])
+    for m in metadatos:
+        if m[0] == nombre:
+            buffers[m[1]][0] = contenido
+            return
+    buffers.append(Nodo(ESQ_BUFFER, {0: contenido}))
+    metadatos.append(Nodo(ESQ_METADATO, {0: nombre, 1: len(buffers) - 1}))